@@ -66,7 +66,8 @@ Java_com_example_android_lyra_MainActivity_lyraBenchmark(
       chromemedia::codec::lyra_benchmark(num_cond_vectors, cpp_model_base_path,
                                          /*benchmark_feature_extraction=*/true,
                                          /*benchmark_quantizer=*/true,
-                                         /*benchmark_generative_model=*/true);
+                                         /*benchmark_generative_model=*/true,
+                                         /*output_dir=*/"");
   env->ReleaseStringUTFChars(model_base_path, cpp_model_base_path);
   return ret;
 }
@@ -0,0 +1,185 @@
+// Copyright 2022 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "lyra/benchmark_report.h"
+
+#include <sys/utsname.h>
+
+#include <cmath>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <thread>  // NOLINT(build/c++11)
+
+#include "absl/strings/ascii.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_format.h"
+#include "absl/strings/string_view.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "glog/logging.h"  // IWYU pragma: keep
+#include "include/ghc/filesystem.hpp"
+#include "lyra/latency_histogram.h"
+
+namespace chromemedia {
+namespace codec {
+namespace {
+
+// Reads the first "model name" of /proc/cpuinfo, or "Hardware" on ARM kernels
+// which do not name the model.
+std::string ReadCpuModel() {
+  std::ifstream cpuinfo("/proc/cpuinfo");
+  std::string line;
+  std::string hardware;
+  while (std::getline(cpuinfo, line)) {
+    const size_t colon = line.find(':');
+    if (colon == std::string::npos) {
+      continue;
+    }
+    const absl::string_view key =
+        absl::StripAsciiWhitespace(absl::string_view(line).substr(0, colon));
+    const absl::string_view value =
+        absl::StripAsciiWhitespace(absl::string_view(line).substr(colon + 1));
+    if (key == "model name") {
+      return std::string(value);
+    }
+    if (key == "Hardware" && hardware.empty()) {
+      hardware = std::string(value);
+    }
+  }
+  return hardware;
+}
+
+std::string JsonString(absl::string_view text) {
+  std::string json = "\"";
+  for (const char c : text) {
+    switch (c) {
+      case '"':
+        json += "\\\"";
+        break;
+      case '\\':
+        json += "\\\\";
+        break;
+      case '\n':
+        json += "\\n";
+        break;
+      case '\t':
+        json += "\\t";
+        break;
+      default:
+        if (static_cast<unsigned char>(c) < 0x20) {
+          absl::StrAppendFormat(&json, "\\u%04x", static_cast<int>(c));
+        } else {
+          json += c;
+        }
+    }
+  }
+  return json + "\"";
+}
+
+// JSON has no representation for infinities and NaN.
+std::string JsonNumber(double value) {
+  return std::isfinite(value) ? absl::StrFormat("%.6g", value) : "null";
+}
+
+}  // namespace
+
+HostInfo GetHostInfo() {
+  HostInfo host_info;
+  struct utsname uts;
+  if (uname(&uts) == 0) {
+    host_info.hostname = uts.nodename;
+    host_info.os = absl::StrCat(uts.sysname, " ", uts.release);
+    host_info.architecture = uts.machine;
+  }
+  host_info.cpu_model = ReadCpuModel();
+  host_info.num_cpus = std::thread::hardware_concurrency();
+  return host_info;
+}
+
+BenchmarkReport::BenchmarkReport(absl::string_view benchmark_name)
+    : benchmark_name_(benchmark_name),
+      start_time_(absl::Now()),
+      host_info_(GetHostInfo()) {}
+
+void BenchmarkReport::AddParameter(absl::string_view name, int64_t value) {
+  parameters_.emplace_back(std::string(name), value);
+}
+
+void BenchmarkReport::AddMetric(absl::string_view name, double value) {
+  metrics_.emplace_back(std::string(name), value);
+}
+
+void BenchmarkReport::AddStage(absl::string_view name,
+                               const LatencyHistogram& histogram) {
+  stages_.emplace_back(std::string(name), histogram);
+}
+
+std::string BenchmarkReport::ToJson() const {
+  std::string json = absl::StrCat(
+      "{\n  \"benchmark\": ", JsonString(benchmark_name_),
+      ",\n  \"time\": ",
+      JsonString(absl::FormatTime(absl::RFC3339_sec, start_time_,
+                                  absl::UTCTimeZone())),
+      ",\n  \"host\": {\n    \"hostname\": ",
+      JsonString(host_info_.hostname),
+      ",\n    \"os\": ", JsonString(host_info_.os),
+      ",\n    \"architecture\": ", JsonString(host_info_.architecture),
+      ",\n    \"cpu_model\": ", JsonString(host_info_.cpu_model),
+      ",\n    \"num_cpus\": ", host_info_.num_cpus, "\n  },\n");
+  json += "  \"parameters\": {";
+  for (int i = 0; i < parameters_.size(); ++i) {
+    absl::StrAppend(&json, i == 0 ? "\n" : ",\n", "    ",
+                    JsonString(parameters_[i].first), ": ",
+                    parameters_[i].second);
+  }
+  json += parameters_.empty() ? "},\n" : "\n  },\n";
+  json += "  \"metrics\": {";
+  for (int i = 0; i < metrics_.size(); ++i) {
+    absl::StrAppend(&json, i == 0 ? "\n" : ",\n", "    ",
+                    JsonString(metrics_[i].first), ": ",
+                    JsonNumber(metrics_[i].second));
+  }
+  json += metrics_.empty() ? "},\n" : "\n  },\n";
+  json += "  \"stages\": {";
+  for (int i = 0; i < stages_.size(); ++i) {
+    const LatencyHistogram& histogram = stages_[i].second;
+    absl::StrAppendFormat(
+        &json,
+        "%s    %s: {\"num_calls\": %d, \"min_us\": %d, \"mean_us\": %.3f, "
+        "\"max_us\": %d, \"stdev_us\": %.3f, \"p50_us\": %d, \"p95_us\": %d, "
+        "\"p99_us\": %d, \"p999_us\": %d}",
+        i == 0 ? "\n" : ",\n", JsonString(stages_[i].first),
+        histogram.num_values(), histogram.min(), histogram.mean(),
+        histogram.max(), histogram.standard_deviation(),
+        histogram.Percentile(50), histogram.Percentile(95),
+        histogram.Percentile(99), histogram.Percentile(99.9));
+  }
+  json += stages_.empty() ? "}\n}\n" : "\n  }\n}\n";
+  return json;
+}
+
+bool BenchmarkReport::WriteJson(const ghc::filesystem::path& path) const {
+  std::ofstream output(path.string());
+  output << ToJson();
+  output.close();
+  if (output.fail()) {
+    LOG(ERROR) << "Could not write benchmark report " << path;
+    return false;
+  }
+  return true;
+}
+
+}  // namespace codec
+}  // namespace chromemedia
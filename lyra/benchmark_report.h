@@ -0,0 +1,83 @@
+/*
+ * Copyright 2022 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LYRA_BENCHMARK_REPORT_H_
+#define LYRA_BENCHMARK_REPORT_H_
+
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/strings/string_view.h"
+#include "absl/time/time.h"
+#include "include/ghc/filesystem.hpp"
+#include "lyra/latency_histogram.h"
+
+namespace chromemedia {
+namespace codec {
+
+// The machine a benchmark ran on.
+struct HostInfo {
+  std::string hostname;
+  // Like "Linux 5.15.0".
+  std::string os;
+  // Like "x86_64" or "aarch64".
+  std::string architecture;
+  // The CPU model as reported by the kernel, or empty if unknown.
+  std::string cpu_model;
+  int num_cpus;
+};
+
+HostInfo GetHostInfo();
+
+// Collects the parameters and per-stage latencies of a benchmark run into a
+// JSON document, so that runs can be compared across commits and machines.
+// Latencies are in microseconds.
+class BenchmarkReport {
+ public:
+  // Records the current time and host.
+  explicit BenchmarkReport(absl::string_view benchmark_name);
+
+  void AddParameter(absl::string_view name, int64_t value);
+
+  // Adds a result which is not a latency, like a rate. Infinite and NaN values
+  // are written as null.
+  void AddMetric(absl::string_view name, double value);
+
+  // Adds count, min, mean, max, standard deviation and the p50, p95, p99 and
+  // p99.9 percentiles of |histogram|. Stages are reported in the order they
+  // were added.
+  void AddStage(absl::string_view name, const LatencyHistogram& histogram);
+
+  std::string ToJson() const;
+
+  // Writes |ToJson| to |path|. Returns false on failure.
+  bool WriteJson(const ghc::filesystem::path& path) const;
+
+ private:
+  const std::string benchmark_name_;
+  const absl::Time start_time_;
+  const HostInfo host_info_;
+  std::vector<std::pair<std::string, int64_t>> parameters_;
+  std::vector<std::pair<std::string, double>> metrics_;
+  std::vector<std::pair<std::string, LatencyHistogram>> stages_;
+};
+
+}  // namespace codec
+}  // namespace chromemedia
+
+#endif  // LYRA_BENCHMARK_REPORT_H_
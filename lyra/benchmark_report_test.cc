@@ -0,0 +1,93 @@
+// Copyright 2022 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "lyra/benchmark_report.h"
+
+#include <fstream>
+#include <iterator>
+#include <limits>
+#include <string>
+
+#include "absl/strings/match.h"
+#include "gtest/gtest.h"
+#include "include/ghc/filesystem.hpp"
+#include "lyra/latency_histogram.h"
+
+namespace chromemedia {
+namespace codec {
+namespace {
+
+TEST(BenchmarkReportTest, DescribesHost) {
+  const HostInfo host_info = GetHostInfo();
+  EXPECT_FALSE(host_info.os.empty());
+  EXPECT_FALSE(host_info.architecture.empty());
+  EXPECT_GE(host_info.num_cpus, 0);
+}
+
+TEST(BenchmarkReportTest, JsonHasParametersAndStages) {
+  BenchmarkReport report("test \"benchmark\"");
+  report.AddParameter("num_cond_vectors", 2000);
+  report.AddMetric("missed_deadline_rate", 0.125);
+  LatencyHistogram histogram;
+  for (int value = 1; value <= 100; ++value) {
+    histogram.Record(value);
+  }
+  report.AddStage("model_decode", histogram);
+  report.AddStage("total", LatencyHistogram());
+
+  const std::string json = report.ToJson();
+  EXPECT_TRUE(absl::StrContains(json, R"("benchmark": "test \"benchmark\"")"));
+  EXPECT_TRUE(absl::StrContains(json, R"("num_cond_vectors": 2000)"));
+  EXPECT_TRUE(absl::StrContains(json, R"("missed_deadline_rate": 0.125)"));
+  EXPECT_TRUE(absl::StrContains(
+      json,
+      R"("model_decode": {"num_calls": 100, "min_us": 1, "mean_us": 50.500, )"
+      R"("max_us": 100, "stdev_us": 28.866, "p50_us": 50, "p95_us": 95, )"
+      R"("p99_us": 99, "p999_us": 100})"));
+  EXPECT_TRUE(absl::StrContains(json, R"("total": {"num_calls": 0)"));
+  EXPECT_TRUE(absl::StrContains(json, R"("cpu_model": )"));
+  // The model decode stage comes first.
+  EXPECT_LT(json.find("model_decode"), json.find("total"));
+}
+
+TEST(BenchmarkReportTest, WritesNonFiniteMetricsAsNull) {
+  BenchmarkReport report("lyra_benchmark");
+  report.AddMetric("infinite", std::numeric_limits<double>::infinity());
+  report.AddMetric("not_a_number", std::numeric_limits<double>::quiet_NaN());
+  report.AddMetric("finite", 1.5);
+
+  const std::string json = report.ToJson();
+  EXPECT_TRUE(absl::StrContains(json, R"("infinite": null)"));
+  EXPECT_TRUE(absl::StrContains(json, R"("not_a_number": null)"));
+  EXPECT_TRUE(absl::StrContains(json, R"("finite": 1.5)"));
+  EXPECT_FALSE(absl::StrContains(json, ": inf"));
+  EXPECT_FALSE(absl::StrContains(json, ": nan"));
+}
+
+TEST(BenchmarkReportTest, WritesJson) {
+  BenchmarkReport report("lyra_benchmark");
+  const ghc::filesystem::path path =
+      ghc::filesystem::path(testing::TempDir()) / "report.json";
+  ASSERT_TRUE(report.WriteJson(path));
+  std::ifstream input(path.string());
+  const std::string contents{std::istreambuf_iterator<char>(input),
+                             std::istreambuf_iterator<char>()};
+  EXPECT_EQ(contents, report.ToJson());
+
+  EXPECT_FALSE(report.WriteJson("/invalid/path/report.json"));
+}
+
+}  // namespace
+}  // namespace codec
+}  // namespace chromemedia
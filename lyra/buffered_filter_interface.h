@@ -22,6 +22,8 @@
 #include <optional>
 #include <vector>
 
+#include "absl/types/span.h"
+
 namespace chromemedia {
 namespace codec {
 
@@ -34,6 +36,12 @@ class BufferedFilterInterface {
       const std::function<std::optional<std::vector<int16_t>>(int)>&
           sample_generator,
       int num_samples) = 0;
+
+  // Fills |samples| without allocating in steady state. |sample_generator|
+  // must fill the whole span it is passed and return false on failure.
+  virtual bool FilterAndBufferInto(
+      const std::function<bool(absl::Span<int16_t>)>& sample_generator,
+      absl::Span<int16_t> samples) = 0;
 };
 
 }  // namespace codec
@@ -24,8 +24,11 @@
 #include <vector>
 
 #include "absl/memory/memory.h"
+#include "absl/types/span.h"
 #include "glog/logging.h"  // IWYU pragma: keep
+#include "lyra/dsp_utils.h"
 #include "lyra/resampler.h"
+#include "lyra/tracing.h"
 
 namespace chromemedia {
 namespace codec {
@@ -64,29 +67,51 @@ std::optional<std::vector<int16_t>> BufferedResampler::FilterAndBuffer(
     const std::function<std::optional<std::vector<int16_t>>(int)>&
         sample_generator,
     int num_external_samples_requested) {
+  std::vector<int16_t> samples(num_external_samples_requested);
+  const auto generate_into = [&sample_generator](
+                                 absl::Span<int16_t> internal_samples) {
+    auto generated = sample_generator(internal_samples.size());
+    if (!generated.has_value()) {
+      return false;
+    }
+    CHECK_EQ(generated->size(), internal_samples.size());
+    std::copy(generated->begin(), generated->end(), internal_samples.begin());
+    return true;
+  };
+  if (!FilterAndBufferInto(generate_into, absl::MakeSpan(samples))) {
+    return std::nullopt;
+  }
+  return samples;
+}
+
+bool BufferedResampler::FilterAndBufferInto(
+    const std::function<bool(absl::Span<int16_t>)>& sample_generator,
+    absl::Span<int16_t> samples) {
+  LYRA_TRACE_SCOPE("BufferedResampler::FilterAndBufferInto");
+  const int num_external_samples_requested = samples.size();
   const int num_internal_samples_to_generate =
       GetInternalNumSamplesToGenerate(num_external_samples_requested);
 
   // 1. If we have any leftover samples from last time we must use them.
-  std::vector<int16_t> samples(num_external_samples_requested);
   const int num_leftover_used =
-      UseLeftoverSamples(num_external_samples_requested, &samples);
+      UseLeftoverSamples(num_external_samples_requested, samples);
 
   // 2. Generate samples using |sample_generator|.
-  auto internal_samples = sample_generator(num_internal_samples_to_generate);
-  if (!internal_samples.has_value()) {
-    return std::nullopt;
+  internal_samples_.resize(num_internal_samples_to_generate);
+  if (!sample_generator(absl::MakeSpan(internal_samples_))) {
+    return false;
   }
-  CHECK_EQ(internal_samples->size(), num_internal_samples_to_generate);
 
   // 3. Resample the internal samples to produce new samples.
-  const std::vector<int16_t> external_samples =
-      Resample(internal_samples.value());
+  const auto external_samples = Resample(internal_samples_);
+  if (!external_samples.has_value()) {
+    return false;
+  }
 
   // 4. Copy the new samples to output and the leftover buffers.
-  CopyNewSamples(external_samples, num_external_samples_requested,
-                 num_leftover_used, &samples);
-  return samples;
+  CopyNewSamples(external_samples.value(), num_external_samples_requested,
+                 num_leftover_used, samples);
+  return true;
 }
 
 int BufferedResampler::GetInternalNumSamplesToGenerate(
@@ -105,32 +130,42 @@ int BufferedResampler::GetInternalNumSamplesToGenerate(
 }
 
 int BufferedResampler::UseLeftoverSamples(int num_external_samples_requested,
-                                          std::vector<int16_t>* samples) {
+                                          absl::Span<int16_t> samples) {
   const int num_leftover_used =
       std::min(static_cast<int>(leftover_samples_.size()),
                num_external_samples_requested);
   std::move(leftover_samples_.begin(),
-            leftover_samples_.begin() + num_leftover_used, samples->begin());
+            leftover_samples_.begin() + num_leftover_used, samples.begin());
   std::move(leftover_samples_.begin() + num_leftover_used,
             leftover_samples_.end(), leftover_samples_.begin());
   leftover_samples_.resize(leftover_samples_.size() - num_leftover_used);
   return num_leftover_used;
 }
 
-std::vector<int16_t> BufferedResampler::Resample(
-    const std::vector<int16_t>& internal_samples) {
+std::optional<absl::Span<const int16_t>> BufferedResampler::Resample(
+    absl::Span<const int16_t> internal_samples) {
   // If the internal and external sample rates match, no need to do anything.
   if (resampler_->target_sample_rate_hz() ==
       resampler_->input_sample_rate_hz()) {
     return internal_samples;
   }
-  return resampler_->Resample(internal_samples);
+  external_samples_.resize(ConvertNumSamplesBetweenSampleRate(
+      internal_samples.size(), resampler_->input_sample_rate_hz(),
+      resampler_->target_sample_rate_hz()));
+  const auto num_resampled = resampler_->ResampleInto(
+      internal_samples, absl::MakeSpan(external_samples_));
+  if (!num_resampled.has_value()) {
+    LOG(ERROR) << "Could not resample " << internal_samples.size()
+               << " samples.";
+    return std::nullopt;
+  }
+  return absl::MakeConstSpan(external_samples_).first(num_resampled.value());
 }
 
 void BufferedResampler::CopyNewSamples(
-    const std::vector<int16_t>& external_samples,
+    absl::Span<const int16_t> external_samples,
     int num_external_samples_requested, int num_leftover_used,
-    std::vector<int16_t>* samples) {
+    absl::Span<int16_t> samples) {
   // Copy the needed samples to the destination, which already has some
   // leftover samples from the last run.
   const int num_samples_to_copy =
@@ -138,7 +173,7 @@ void BufferedResampler::CopyNewSamples(
   CHECK_GE(external_samples.size(), num_samples_to_copy);
   std::copy(external_samples.begin(),
             external_samples.begin() + num_samples_to_copy,
-            samples->begin() + num_leftover_used);
+            samples.begin() + num_leftover_used);
 
   // Store the rest in the |leftover_samples_|.
   leftover_samples_.insert(leftover_samples_.end(),
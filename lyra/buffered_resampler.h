@@ -23,6 +23,7 @@
 #include <optional>
 #include <vector>
 
+#include "absl/types/span.h"
 #include "lyra/buffered_filter_interface.h"
 #include "lyra/resampler_interface.h"
 
@@ -45,6 +46,13 @@ class BufferedResampler : public BufferedFilterInterface {
           sample_generator,
       int num_external_samples_requested) override;
 
+  // Same as |FilterAndBuffer|, but writes |samples.size()| samples into
+  // |samples|. Intermediate buffers are kept between calls, so this does not
+  // allocate once they have grown to the largest request.
+  bool FilterAndBufferInto(
+      const std::function<bool(absl::Span<int16_t>)>& sample_generator,
+      absl::Span<int16_t> samples) override;
+
  private:
   explicit BufferedResampler(std::unique_ptr<ResamplerInterface> resampler);
 
@@ -57,13 +65,16 @@ class BufferedResampler : public BufferedFilterInterface {
   // Use at most |num_external_samples_requested| from |leftover_samples_| to
   // fill the beginning of |samples|.
   int UseLeftoverSamples(int num_external_samples_requested,
-                         std::vector<int16_t>* samples);
+                         absl::Span<int16_t> samples);
 
-  std::vector<int16_t> Resample(const std::vector<int16_t>& internal_samples);
+  // Returns the resampled |internal_samples|, which may point into
+  // |external_samples_|, or nullopt on failure.
+  std::optional<absl::Span<const int16_t>> Resample(
+      absl::Span<const int16_t> internal_samples);
 
-  void CopyNewSamples(const std::vector<int16_t>& external_samples,
+  void CopyNewSamples(absl::Span<const int16_t> external_samples,
                       int num_external_samples_requested, int num_leftover_used,
-                      std::vector<int16_t>* samples);
+                      absl::Span<int16_t> samples);
 
   // If the resample ratio is greater than 1, buffer at most
   // |external_sample_rate| / |internal_sample_rate_hz|/ - 1 leftover samples
@@ -72,6 +83,10 @@ class BufferedResampler : public BufferedFilterInterface {
 
   std::unique_ptr<ResamplerInterface> resampler_;
 
+  // Samples at the internal and external sample rates, reused between calls.
+  std::vector<int16_t> internal_samples_;
+  std::vector<int16_t> external_samples_;
+
   friend class BufferedResamplerPeer;
 };
 
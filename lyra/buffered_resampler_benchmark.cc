@@ -0,0 +1,101 @@
+// Copyright 2022 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <vector>
+
+#include "absl/random/random.h"
+#include "absl/types/span.h"
+#include "benchmark/benchmark.h"
+#include "lyra/buffered_resampler.h"
+#include "lyra/dsp_utils.h"
+#include "lyra/lyra_config.h"
+
+static constexpr int kMaxNumSamplesRequested = 317;
+static constexpr int kNumSamplesRequested[] = {1, 37, 161,
+                                              kMaxNumSamplesRequested};
+
+// Returns enough random samples at the internal sample rate for the largest
+// request at the lowest external sample rate.
+std::vector<int16_t> RandomInternalSamples() {
+  absl::BitGen gen;
+  std::vector<int16_t> samples(
+      chromemedia::codec::ConvertNumSamplesBetweenSampleRate(
+          kMaxNumSamplesRequested, chromemedia::codec::kSupportedSampleRates[0],
+          chromemedia::codec::kInternalSampleRateHz));
+  for (auto& sample : samples) {
+    sample = absl::Uniform<uint16_t>(gen);
+  }
+  return samples;
+}
+
+// Requests |state.range(1)| samples at |state.range(0)| Hz per iteration. The
+// odd request sizes do not line up with the ratio between the sample rates, so
+// when upsampling most calls also use leftovers from the previous call.
+void BM_FilterAndBuffer(benchmark::State& state) {
+  const int external_sample_rate_hz = state.range(0);
+  const int num_samples_requested = state.range(1);
+  auto resampler = chromemedia::codec::BufferedResampler::Create(
+      chromemedia::codec::kInternalSampleRateHz, external_sample_rate_hz);
+  const std::vector<int16_t> internal_samples = RandomInternalSamples();
+  const auto sample_generator =
+      [&internal_samples](int num_samples)
+      -> std::optional<std::vector<int16_t>> {
+    return std::vector<int16_t>(internal_samples.begin(),
+                                internal_samples.begin() + num_samples);
+  };
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(
+        resampler->FilterAndBuffer(sample_generator, num_samples_requested));
+  }
+  state.SetItemsProcessed(state.iterations() * num_samples_requested);
+}
+
+// Same as |BM_FilterAndBuffer| through the non-allocating interface.
+void BM_FilterAndBufferInto(benchmark::State& state) {
+  const int external_sample_rate_hz = state.range(0);
+  const int num_samples_requested = state.range(1);
+  auto resampler = chromemedia::codec::BufferedResampler::Create(
+      chromemedia::codec::kInternalSampleRateHz, external_sample_rate_hz);
+  const std::vector<int16_t> internal_samples = RandomInternalSamples();
+  const auto sample_generator =
+      [&internal_samples](absl::Span<int16_t> samples) {
+        std::copy(internal_samples.begin(),
+                  internal_samples.begin() + samples.size(), samples.begin());
+        return true;
+      };
+  std::vector<int16_t> samples(num_samples_requested);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(resampler->FilterAndBufferInto(
+        sample_generator, absl::MakeSpan(samples)));
+  }
+  state.SetItemsProcessed(state.iterations() * num_samples_requested);
+}
+
+// Every supported sample rate with each of |kNumSamplesRequested|.
+void OddRequestSizes(benchmark::internal::Benchmark* benchmark) {
+  benchmark->ArgNames({"external_hz", "num_samples"});
+  for (int sample_rate_hz : chromemedia::codec::kSupportedSampleRates) {
+    for (int num_samples : kNumSamplesRequested) {
+      benchmark->Args({sample_rate_hz, num_samples});
+    }
+  }
+}
+
+BENCHMARK(BM_FilterAndBuffer)->Apply(OddRequestSizes);
+BENCHMARK(BM_FilterAndBufferInto)->Apply(OddRequestSizes);
+BENCHMARK_MAIN();
@@ -0,0 +1,197 @@
+// Copyright 2022 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "lyra/cli_example/batch_transcoder.h"
+
+#include <algorithm>
+#include <fstream>
+#include <optional>
+#include <set>
+#include <string>
+#include <system_error>  // NOLINT(build/c++11)
+#include <utility>
+#include <vector>
+
+#include "absl/strings/match.h"
+#include "absl/strings/string_view.h"
+#include "absl/strings/strip.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "glog/logging.h"  // IWYU pragma: keep
+#include "include/ghc/filesystem.hpp"
+#include "lyra/thread_pool.h"
+
+namespace chromemedia {
+namespace codec {
+namespace {
+
+std::optional<std::vector<BatchInput>> ListDirectory(
+    const ghc::filesystem::path& dir, absl::string_view extension) {
+  std::vector<BatchInput> inputs;
+  std::error_code error_code;
+  for (ghc::filesystem::recursive_directory_iterator it(dir, error_code), end;
+       !error_code && it != end; it.increment(error_code)) {
+    if (it->is_regular_file() &&
+        absl::EqualsIgnoreCase(it->path().extension().string(), extension)) {
+      inputs.push_back({it->path(), it->path().lexically_relative(dir)});
+    }
+  }
+  if (error_code) {
+    LOG(ERROR) << "Could not list " << dir << ": " << error_code.message();
+    return std::nullopt;
+  }
+  // Directory order is arbitrary; sorting makes runs reproducible.
+  std::sort(inputs.begin(), inputs.end(),
+            [](const BatchInput& a, const BatchInput& b) {
+              return a.input_path < b.input_path;
+            });
+  return inputs;
+}
+
+std::optional<std::vector<BatchInput>> ReadFileList(
+    const ghc::filesystem::path& list_path) {
+  std::ifstream list_stream(list_path.string());
+  if (!list_stream.is_open()) {
+    LOG(ERROR) << "Open on file list " << list_path << " failed.";
+    return std::nullopt;
+  }
+  std::vector<BatchInput> inputs;
+  std::string line;
+  while (std::getline(list_stream, line)) {
+    const ghc::filesystem::path path(
+        std::string(absl::StripAsciiWhitespace(line)));
+    if (path.empty()) {
+      continue;
+    }
+    // Mirroring the whole path keeps inputs with the same file name in
+    // different directories from writing the same output.
+    if (path.is_absolute()) {
+      inputs.push_back({path, path.lexically_normal().relative_path()});
+    } else {
+      inputs.push_back({list_path.parent_path() / path,
+                        path.lexically_normal()});
+    }
+  }
+  return inputs;
+}
+
+// Returns true if |relative_path| stays below the directory it is relative to.
+bool IsContained(const ghc::filesystem::path& relative_path) {
+  return !relative_path.empty() && !relative_path.has_root_path() &&
+         *relative_path.lexically_normal().begin() != "..";
+}
+
+}  // namespace
+
+bool IsBatchInput(const ghc::filesystem::path& input) {
+  std::error_code error_code;
+  return ghc::filesystem::is_directory(input, error_code) ||
+         absl::EqualsIgnoreCase(input.extension().string(), ".txt");
+}
+
+std::optional<std::vector<BatchInput>> ListBatchInputs(
+    const ghc::filesystem::path& input, absl::string_view extension) {
+  std::error_code error_code;
+  if (ghc::filesystem::is_directory(input, error_code)) {
+    return ListDirectory(input, extension);
+  }
+  return ReadFileList(input);
+}
+
+double BatchStats::realtime_factor() const {
+  return absl::FDivDuration(audio_duration, elapsed);
+}
+
+double BatchStats::files_per_second() const {
+  return (num_files - num_failed) / absl::ToDoubleSeconds(elapsed);
+}
+
+BatchStats TranscodeBatch(const std::vector<BatchInput>& inputs,
+                          const ghc::filesystem::path& output_dir,
+                          absl::string_view output_suffix, int num_threads,
+                          const TranscodeFunction& transcode) {
+  const auto start = absl::Now();
+  // Output paths are checked up front so that no two workers ever write the
+  // same file. An empty path marks an input that fails without conversion.
+  std::vector<ghc::filesystem::path> output_paths(inputs.size());
+  std::set<ghc::filesystem::path> seen_output_paths;
+  for (int i = 0; i < inputs.size(); ++i) {
+    if (!IsContained(inputs[i].relative_path)) {
+      LOG(ERROR) << "Output of " << inputs[i].input_path
+                 << " would be written outside of " << output_dir;
+      continue;
+    }
+    ghc::filesystem::path output_path =
+        (output_dir / inputs[i].relative_path.lexically_normal())
+            .replace_extension()
+            .concat(std::string(output_suffix));
+    if (!seen_output_paths.insert(output_path).second) {
+      LOG(ERROR) << "Output of " << inputs[i].input_path << " would overwrite "
+                 << output_path;
+      continue;
+    }
+    output_paths[i] = std::move(output_path);
+  }
+
+  // Each file writes only its own entry, so no locking is needed.
+  std::vector<std::optional<absl::Duration>> audio_durations(inputs.size());
+  auto thread_pool = ThreadPool::Create(
+      std::max(1, std::min<int>(num_threads, inputs.size())));
+  thread_pool->ParallelFor(inputs.size(), [&](int i) {
+    const BatchInput& input = inputs[i];
+    const ghc::filesystem::path& output_path = output_paths[i];
+    if (output_path.empty()) {
+      return;
+    }
+    // Several threads may create the same directory at once, so only the end
+    // result is checked.
+    std::error_code error_code;
+    ghc::filesystem::create_directories(output_path.parent_path(), error_code);
+    if (!ghc::filesystem::is_directory(output_path.parent_path(),
+                                       error_code)) {
+      LOG(ERROR) << "Could not create output dir "
+                 << output_path.parent_path();
+      return;
+    }
+    audio_durations[i] = transcode(input.input_path, output_path);
+    if (audio_durations[i].has_value()) {
+      VLOG(1) << "Wrote " << output_path;
+    } else {
+      LOG(ERROR) << "Could not convert " << input.input_path;
+    }
+  });
+
+  BatchStats stats;
+  stats.num_files = inputs.size();
+  for (const std::optional<absl::Duration>& audio_duration : audio_durations) {
+    if (audio_duration.has_value()) {
+      stats.audio_duration += *audio_duration;
+    } else {
+      ++stats.num_failed;
+    }
+  }
+  stats.elapsed = absl::Now() - start;
+  LOG(INFO) << "Converted " << stats.num_files - stats.num_failed << " of "
+            << stats.num_files << " files, "
+            << absl::ToDoubleSeconds(stats.audio_duration)
+            << " seconds of audio, in "
+            << absl::ToDoubleSeconds(stats.elapsed) << " seconds on "
+            << thread_pool->num_threads() << " threads.";
+  LOG(INFO) << "Realtime factor : " << stats.realtime_factor();
+  LOG(INFO) << "Files per second : " << stats.files_per_second();
+  return stats;
+}
+
+}  // namespace codec
+}  // namespace chromemedia
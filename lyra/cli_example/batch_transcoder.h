@@ -0,0 +1,87 @@
+/*
+ * Copyright 2022 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LYRA_CLI_EXAMPLE_BATCH_TRANSCODER_H_
+#define LYRA_CLI_EXAMPLE_BATCH_TRANSCODER_H_
+
+#include <functional>
+#include <optional>
+#include <vector>
+
+#include "absl/strings/string_view.h"
+#include "absl/time/time.h"
+#include "include/ghc/filesystem.hpp"
+
+namespace chromemedia {
+namespace codec {
+
+// An input file of a batch and where its output goes, relative to the output
+// dir.
+struct BatchInput {
+  ghc::filesystem::path input_path;
+  ghc::filesystem::path relative_path;
+};
+
+// Returns true if |input| names a batch rather than a single file: a directory,
+// or a file list with a ".txt" extension in any case.
+bool IsBatchInput(const ghc::filesystem::path& input);
+
+// Collects the inputs of a batch. If |input| is a directory, these are all
+// files below it with the extension |extension|, like ".wav", matched
+// regardless of case, and the output tree mirrors the directory tree.
+// Otherwise |input| is a text file listing one path per line. Relative paths
+// in the list are resolved against the directory of the list, absolute ones
+// are used as they are, and both are mirrored in the output tree without their
+// root. Returns nullopt if |input| cannot be read.
+std::optional<std::vector<BatchInput>> ListBatchInputs(
+    const ghc::filesystem::path& input, absl::string_view extension);
+
+// Converts the file at |input_path| and writes the result to |output_path|.
+// Returns the duration of the audio, or nullopt on failure. Called
+// concurrently from several threads.
+using TranscodeFunction = std::function<std::optional<absl::Duration>(
+    const ghc::filesystem::path& input_path,
+    const ghc::filesystem::path& output_path)>;
+
+struct BatchStats {
+  int num_files = 0;
+  int num_failed = 0;
+  // Total duration of the audio of the files that were converted.
+  absl::Duration audio_duration = absl::ZeroDuration();
+  absl::Duration elapsed = absl::ZeroDuration();
+
+  // Seconds of audio converted per second of wall time.
+  double realtime_factor() const;
+  double files_per_second() const;
+};
+
+// Runs |transcode| for every input on |num_threads| threads, each taking the
+// next unconverted file as soon as it is done with its last one. The output
+// of an input is written to |output_dir| / |relative_path|, with the
+// extension replaced by |output_suffix|, like "_decoded.wav". Directories of
+// the output tree are created as needed. Inputs whose output would leave
+// |output_dir| through "..", or would overwrite the output of an earlier
+// input, fail without being converted. A failed file is logged and does not
+// stop the others.
+BatchStats TranscodeBatch(const std::vector<BatchInput>& inputs,
+                          const ghc::filesystem::path& output_dir,
+                          absl::string_view output_suffix, int num_threads,
+                          const TranscodeFunction& transcode);
+
+}  // namespace codec
+}  // namespace chromemedia
+
+#endif  // LYRA_CLI_EXAMPLE_BATCH_TRANSCODER_H_
@@ -0,0 +1,216 @@
+// Copyright 2022 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "lyra/cli_example/batch_transcoder.h"
+
+#include <atomic>
+#include <fstream>
+#include <optional>
+#include <set>
+#include <string>
+#include <system_error>  // NOLINT(build/c++11)
+#include <thread>        // NOLINT(build/c++11)
+#include <vector>
+
+#include "absl/synchronization/mutex.h"
+#include "absl/time/time.h"
+#include "gtest/gtest.h"
+#include "include/ghc/filesystem.hpp"
+
+namespace chromemedia {
+namespace codec {
+namespace {
+
+class BatchTranscoderTest : public testing::Test {
+ protected:
+  BatchTranscoderTest()
+      : input_dir_(ghc::filesystem::path(testing::TempDir()) / "batch_input"),
+        output_dir_(ghc::filesystem::path(testing::TempDir()) /
+                    "batch_output") {}
+
+  void SetUp() override {
+    for (const auto& file :
+         {"a.wav", "b.wav", "notes.txt", "sub/c.wav", "sub/deeper/d.WAV"}) {
+      WriteFile(input_dir_ / file, file);
+    }
+  }
+
+  void TearDown() override {
+    std::error_code error_code;
+    ghc::filesystem::remove_all(input_dir_, error_code);
+    ghc::filesystem::remove_all(output_dir_, error_code);
+  }
+
+  static void WriteFile(const ghc::filesystem::path& path,
+                        const std::string& contents) {
+    std::error_code error_code;
+    ghc::filesystem::create_directories(path.parent_path(), error_code);
+    std::ofstream(path.string()) << contents;
+  }
+
+  // Copies the input and reports one second of audio per file.
+  static std::optional<absl::Duration> Copy(
+      const ghc::filesystem::path& input_path,
+      const ghc::filesystem::path& output_path) {
+    std::error_code error_code;
+    if (!ghc::filesystem::copy_file(input_path, output_path, error_code)) {
+      return std::nullopt;
+    }
+    return absl::Seconds(1);
+  }
+
+  const ghc::filesystem::path input_dir_;
+  const ghc::filesystem::path output_dir_;
+};
+
+TEST_F(BatchTranscoderTest, ListsDirectoryRecursively) {
+  const auto inputs = ListBatchInputs(input_dir_, ".wav");
+  ASSERT_TRUE(inputs.has_value());
+  std::vector<std::string> relative_paths;
+  for (const BatchInput& input : *inputs) {
+    EXPECT_EQ(input.input_path, input_dir_ / input.relative_path);
+    relative_paths.push_back(input.relative_path.generic_string());
+  }
+  EXPECT_EQ(relative_paths, (std::vector<std::string>{
+                                "a.wav", "b.wav", "sub/c.wav",
+                                "sub/deeper/d.WAV"}));
+}
+
+TEST_F(BatchTranscoderTest, ReadsFileList) {
+  const ghc::filesystem::path absolute = input_dir_ / "sub" / "c.wav";
+  WriteFile(input_dir_ / "list.txt",
+            "a.wav\n\n  sub/deeper/d.WAV \n" + absolute.string() + "\n");
+
+  const auto inputs = ListBatchInputs(input_dir_ / "list.txt", ".wav");
+  ASSERT_TRUE(inputs.has_value());
+  ASSERT_EQ(inputs->size(), 3);
+  EXPECT_EQ((*inputs)[0].input_path, input_dir_ / "a.wav");
+  EXPECT_EQ((*inputs)[0].relative_path, "a.wav");
+  EXPECT_EQ((*inputs)[1].input_path, input_dir_ / "sub/deeper/d.WAV");
+  EXPECT_EQ((*inputs)[1].relative_path, "sub/deeper/d.WAV");
+  EXPECT_EQ((*inputs)[2].input_path, absolute);
+  EXPECT_EQ((*inputs)[2].relative_path, absolute.relative_path());
+
+  EXPECT_FALSE(ListBatchInputs(input_dir_ / "missing.txt", ".wav"));
+}
+
+TEST_F(BatchTranscoderTest, DetectsBatchInputs) {
+  EXPECT_TRUE(IsBatchInput(input_dir_));
+  EXPECT_TRUE(IsBatchInput(input_dir_ / "notes.txt"));
+  EXPECT_TRUE(IsBatchInput(input_dir_ / "LIST.TXT"));
+  EXPECT_FALSE(IsBatchInput(input_dir_ / "a.wav"));
+  EXPECT_FALSE(IsBatchInput(input_dir_ / "sub/deeper/d.WAV"));
+  EXPECT_FALSE(IsBatchInput(input_dir_ / "x.wave"));
+  EXPECT_FALSE(IsBatchInput(input_dir_ / "encoded.bin"));
+}
+
+TEST_F(BatchTranscoderTest, FailsOutputsThatCollideOrEscape) {
+  WriteFile(input_dir_ / "other" / "a.wav", "other");
+  const std::vector<BatchInput> inputs = {
+      {input_dir_ / "a.wav", "x/a.wav"},
+      {input_dir_ / "other" / "a.wav", "x/./a.wav"},
+      {input_dir_ / "b.wav", "../b.wav"},
+      {input_dir_ / "sub" / "c.wav", "sub/../c.wav"},
+  };
+
+  const BatchStats stats =
+      TranscodeBatch(inputs, output_dir_, "_out.lyra", 2, Copy);
+  EXPECT_EQ(stats.num_files, 4);
+  EXPECT_EQ(stats.num_failed, 2);
+  EXPECT_TRUE(ghc::filesystem::is_regular_file(output_dir_ / "x/a_out.lyra"));
+  EXPECT_TRUE(ghc::filesystem::is_regular_file(output_dir_ / "c_out.lyra"));
+  EXPECT_FALSE(ghc::filesystem::exists(output_dir_.parent_path() /
+                                       "b_out.lyra"));
+}
+
+TEST_F(BatchTranscoderTest, MirrorsInputTree) {
+  const auto inputs = ListBatchInputs(input_dir_, ".wav");
+  ASSERT_TRUE(inputs.has_value());
+
+  const BatchStats stats =
+      TranscodeBatch(*inputs, output_dir_, "_out.lyra", 3, Copy);
+  EXPECT_EQ(stats.num_files, 4);
+  EXPECT_EQ(stats.num_failed, 0);
+  EXPECT_EQ(stats.audio_duration, absl::Seconds(4));
+  EXPECT_GT(stats.realtime_factor(), 0.0);
+  EXPECT_GT(stats.files_per_second(), 0.0);
+  for (const auto& file :
+       {"a_out.lyra", "b_out.lyra", "sub/c_out.lyra",
+        "sub/deeper/d_out.lyra"}) {
+    EXPECT_TRUE(ghc::filesystem::is_regular_file(output_dir_ / file)) << file;
+  }
+}
+
+TEST_F(BatchTranscoderTest, RunsFilesInParallel) {
+  std::vector<BatchInput> inputs;
+  for (int i = 0; i < 8; ++i) {
+    inputs.push_back({input_dir_ / "a.wav", std::to_string(i) + ".wav"});
+  }
+
+  absl::Mutex mutex;
+  std::set<std::thread::id> thread_ids;
+  std::atomic<int> num_running(0);
+  std::atomic<int> max_running(0);
+  const BatchStats stats = TranscodeBatch(
+      inputs, output_dir_, ".lyra", 4,
+      [&](const ghc::filesystem::path& input_path,
+          const ghc::filesystem::path& output_path) {
+        const int running = ++num_running;
+        int max = max_running.load();
+        while (running > max && !max_running.compare_exchange_weak(max,
+                                                                    running)) {
+        }
+        {
+          absl::MutexLock lock(&mutex);
+          thread_ids.insert(std::this_thread::get_id());
+        }
+        absl::SleepFor(absl::Milliseconds(20));
+        --num_running;
+        return Copy(input_path, output_path);
+      });
+  EXPECT_EQ(stats.num_failed, 0);
+  EXPECT_LE(thread_ids.size(), 4);
+  EXPECT_LE(max_running.load(), 4);
+  EXPECT_GT(max_running.load(), 1);
+}
+
+TEST_F(BatchTranscoderTest, FailedFilesDoNotStopTheBatch) {
+  const auto inputs = ListBatchInputs(input_dir_, ".wav");
+  ASSERT_TRUE(inputs.has_value());
+
+  const BatchStats stats = TranscodeBatch(
+      *inputs, output_dir_, ".lyra", 2,
+      [](const ghc::filesystem::path& input_path,
+         const ghc::filesystem::path& output_path)
+          -> std::optional<absl::Duration> {
+        if (input_path.filename() == "b.wav") {
+          return std::nullopt;
+        }
+        return Copy(input_path, output_path);
+      });
+  EXPECT_EQ(stats.num_files, 4);
+  EXPECT_EQ(stats.num_failed, 1);
+  EXPECT_EQ(stats.audio_duration, absl::Seconds(3));
+  EXPECT_TRUE(ghc::filesystem::is_regular_file(output_dir_ / "sub/c.lyra"));
+}
+
+TEST_F(BatchTranscoderTest, EmptyBatch) {
+  const BatchStats stats = TranscodeBatch({}, output_dir_, ".lyra", 4, Copy);
+  EXPECT_EQ(stats.num_files, 0);
+  EXPECT_EQ(stats.num_failed, 0);
+}
+
+}  // namespace
+}  // namespace codec
+}  // namespace chromemedia
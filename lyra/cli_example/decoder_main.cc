@@ -12,30 +12,51 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <algorithm>
+#include <iostream>
+#include <optional>
 #include <string>
 #include <system_error>  // NOLINT(build/c++11)
+#include <thread>        // NOLINT(build/c++11)
 #include <vector>
 
 #include "absl/flags/flag.h"
 #include "absl/flags/parse.h"
 #include "absl/flags/usage.h"
+#include "absl/random/random.h"
 #include "absl/strings/string_view.h"
+#include "absl/time/time.h"
 #include "glog/logging.h"  // IWYU pragma: keep
 #include "include/ghc/filesystem.hpp"
 #include "lyra/architecture_utils.h"
+#include "lyra/cli_example/batch_transcoder.h"
 #include "lyra/cli_example/decoder_main_lib.h"
+#include "lyra/lyra_config.h"
+#include "lyra/lyra_decoder.h"
 
 ABSL_FLAG(std::string, encoded_path, "",
-          "Complete path to the file containing the encoded features.");
+          "Complete path to the file containing the encoded features. A "
+          "directory decodes every .lyra file below it, and a .txt file is "
+          "read as a list of encoded files, one per line. '-' decodes raw "
+          "packets at --bitrate from stdin to a wav stream on stdout, hop by "
+          "hop, and ignores --output_dir.");
+ABSL_FLAG(bool, raw_output, false,
+          "When decoding from stdin, writes headerless 16 bit little-endian "
+          "samples to stdout instead of a wav stream.");
 ABSL_FLAG(std::string, output_dir, "",
           "The complete output dir for the wav to be written out. "
           "Recursively creates dir if it does not exist. Will "
-          "overwrite existing files.");
+          "overwrite existing files. Batches mirror the input tree here.");
+ABSL_FLAG(int, num_threads, 0,
+          "Number of files decoded in parallel when decoding a batch. 0 uses "
+          "one thread per core.");
 ABSL_FLAG(std::string, output_suffix, "_decoded",
           "A prefix for each of the output .wav files.");
 ABSL_FLAG(int, sample_rate_hz, 16000, "Desired output sample rate in Hertz.");
 ABSL_FLAG(int, bitrate, 3200,
-          "The bitrate in bps at which the file has been quantized.");
+          "The bitrate in bps at which the file has been quantized. Only used "
+          "for files of raw packets, since containers record the bitrate of "
+          "each frame.");
 ABSL_FLAG(bool, randomize_num_samples_requested, false,
           "If true, requests a random number of samples for decoding within "
           "each hop. If false, requests only one whole hop at a time.");
@@ -74,6 +95,10 @@ int main(int argc, char** argv) {
   const ghc::filesystem::path model_path =
       chromemedia::codec::GetCompleteArchitecturePath(
           absl::GetFlag(FLAGS_model_path));
+  int num_threads = absl::GetFlag(FLAGS_num_threads);
+  if (num_threads == 0) {
+    num_threads = std::max(1u, std::thread::hardware_concurrency());
+  }
   if (!fixed_packet_loss_pattern.starts_.empty()) {
     LOG(INFO) << "Using fixed packet loss pattern instead of gilbert model.";
   }
@@ -81,6 +106,32 @@ int main(int argc, char** argv) {
     LOG(ERROR) << "Flag --encoded_path not set.";
     return -1;
   }
+
+  if (encoded_path == "-") {
+    auto decoder = chromemedia::codec::LyraDecoder::Create(
+        sample_rate_hz, chromemedia::codec::kNumChannels, model_path);
+    if (decoder == nullptr) {
+      LOG(ERROR) << "Could not create lyra decoder.";
+      return -1;
+    }
+    auto packet_loss_model = chromemedia::codec::CreatePacketLossModel(
+        sample_rate_hz, packet_loss_rate, average_burst_length,
+        fixed_packet_loss_pattern);
+    if (packet_loss_model == nullptr) {
+      LOG(ERROR) << "Could not create packet loss simulator model.";
+      return -1;
+    }
+    std::ios_base::sync_with_stdio(false);
+    absl::BitGen gen;
+    if (!chromemedia::codec::DecodeStream(
+            &std::cin, &std::cout, bitrate, absl::GetFlag(FLAGS_raw_output),
+            randomize_num_samples_requested, gen, decoder.get(),
+            packet_loss_model.get())) {
+      LOG(ERROR) << "Could not decode stdin.";
+      return -1;
+    }
+    return 0;
+  }
   if (output_dir.empty()) {
     LOG(ERROR) << "Flag --output_dir not set.";
     return -1;
@@ -95,6 +146,38 @@ int main(int argc, char** argv) {
       return -1;
     }
   }
+
+  if (chromemedia::codec::IsBatchInput(encoded_path)) {
+    if (num_threads < 1) {
+      LOG(ERROR) << "Flag --num_threads must not be negative.";
+      return -1;
+    }
+    const std::optional<std::vector<chromemedia::codec::BatchInput>> inputs =
+        chromemedia::codec::ListBatchInputs(encoded_path, ".lyra");
+    if (!inputs.has_value()) {
+      return -1;
+    }
+    // Every file gets fresh decoder state. The model weights are loaded once
+    // and shared by all decoders in the process.
+    const chromemedia::codec::BatchStats stats =
+        chromemedia::codec::TranscodeBatch(
+            *inputs, output_dir, output_suffix + ".wav", num_threads,
+            [&](const ghc::filesystem::path& input_path,
+                const ghc::filesystem::path& output_path)
+                -> std::optional<absl::Duration> {
+              if (!chromemedia::codec::DecodeFile(
+                      input_path, output_path, sample_rate_hz, bitrate,
+                      randomize_num_samples_requested, packet_loss_rate,
+                      average_burst_length, fixed_packet_loss_pattern,
+                      model_path)) {
+                return std::nullopt;
+              }
+              return chromemedia::codec::GetEncodedFileDuration(input_path,
+                                                                bitrate);
+            });
+    return stats.num_failed == 0 ? 0 : -1;
+  }
+
   auto base_name = encoded_path.stem();
   const auto output_path = ghc::filesystem::path(output_dir) /
                            encoded_path.stem().concat(output_suffix + ".wav");
@@ -17,11 +17,13 @@
 #include <algorithm>
 #include <cstdint>
 #include <fstream>
-#include <iterator>
+#include <istream>
 #include <memory>
 #include <optional>
+#include <ostream>
 #include <sstream>
 #include <string>
+#include <system_error>  // NOLINT(build/c++11)
 #include <type_traits>
 #include <vector>
 
@@ -29,6 +31,7 @@
 #include "absl/random/bit_gen_ref.h"
 #include "absl/random/random.h"
 #include "absl/status/status.h"
+#include "absl/status/statusor.h"
 #include "absl/strings/string_view.h"
 #include "absl/time/clock.h"
 #include "absl/time/time.h"
@@ -38,11 +41,115 @@
 #include "lyra/fixed_packet_loss_model.h"
 #include "lyra/gilbert_model.h"
 #include "lyra/lyra_config.h"
+#include "lyra/lyra_container.h"
 #include "lyra/lyra_decoder.h"
 #include "lyra/wav_utils.h"
 
 namespace chromemedia {
 namespace codec {
+namespace {
+
+// Decodes the hop of |frame_index| into |decoded_audio|. The hop is concealed
+// if |packet| is empty, because DTX skipped it, or if |packet_loss_model|
+// loses it.
+bool DecodeHop(absl::Span<const uint8_t> packet, int64_t frame_index,
+               bool randomize_num_samples_requested, absl::BitGenRef gen,
+               LyraDecoder* decoder,
+               PacketLossModelInterface* packet_loss_model,
+               std::vector<int16_t>* decoded_audio) {
+  const int num_samples_per_packet =
+      GetNumSamplesPerHop(decoder->sample_rate_hz());
+  const float packet_start_seconds =
+      static_cast<float>(frame_index) / decoder->frame_rate();
+  // Consulted for every hop, so that time based models stay aligned.
+  const bool received =
+      packet_loss_model == nullptr || packet_loss_model->IsPacketReceived();
+  if (received && !packet.empty()) {
+    if (!decoder->SetEncodedPacket(packet)) {
+      LOG(ERROR) << "Unable to set encoded packet of frame " << frame_index
+                 << " at time " << packet_start_seconds << "s.";
+      return false;
+    }
+  } else {
+    VLOG(1) << "Decoding packet starting at " << packet_start_seconds
+            << "seconds in PLC mode.";
+  }
+  std::optional<std::vector<int16_t>> decoded;
+  int samples_decoded_so_far = 0;
+  while (samples_decoded_so_far < num_samples_per_packet) {
+    int samples_to_request =
+        randomize_num_samples_requested
+            ? std::min(absl::Uniform<int>(absl::IntervalOpenClosed, gen, 0,
+                                          num_samples_per_packet),
+                       num_samples_per_packet - samples_decoded_so_far)
+            : num_samples_per_packet;
+    VLOG(1) << "Requesting " << samples_to_request
+            << " samples for decoding.";
+    decoded = decoder->DecodeSamples(samples_to_request);
+    if (!decoded.has_value()) {
+      LOG(ERROR) << "Unable to decode features of frame " << frame_index;
+      return false;
+    }
+    samples_decoded_so_far += decoded->size();
+    decoded_audio->insert(decoded_audio->end(), decoded.value().begin(),
+                          decoded.value().end());
+  }
+  return true;
+}
+
+// Like |DecodeHop|, but appends the audio to |wav_writer|. |hop_audio| is
+// reused across hops to avoid allocating for each.
+bool DecodeHopToWav(absl::Span<const uint8_t> packet, int64_t frame_index,
+                    bool randomize_num_samples_requested, absl::BitGenRef gen,
+                    LyraDecoder* decoder,
+                    PacketLossModelInterface* packet_loss_model,
+                    std::vector<int16_t>* hop_audio, WavWriter* wav_writer) {
+  hop_audio->clear();
+  if (!DecodeHop(packet, frame_index, randomize_num_samples_requested, gen,
+                 decoder, packet_loss_model, hop_audio)) {
+    return false;
+  }
+  absl::Status write_status = wav_writer->Write(*hop_audio);
+  if (!write_status.ok()) {
+    LOG(ERROR) << write_status;
+    return false;
+  }
+  return true;
+}
+
+// Decodes the raw packets of |packet_size| bytes in |encoded_stream| one at a
+// time.
+bool DecodePacketStream(std::istream* encoded_stream, int packet_size,
+                        bool randomize_num_samples_requested,
+                        absl::BitGenRef gen, LyraDecoder* decoder,
+                        PacketLossModelInterface* packet_loss_model,
+                        WavWriter* wav_writer) {
+  std::vector<uint8_t> packet(packet_size);
+  std::vector<int16_t> hop_audio;
+  int64_t frame_index = 0;
+  while (encoded_stream->read(reinterpret_cast<char*>(packet.data()),
+                              packet_size)) {
+    if (!DecodeHopToWav(packet, frame_index++,
+                        randomize_num_samples_requested, gen, decoder,
+                        packet_loss_model, &hop_audio, wav_writer)) {
+      return false;
+    }
+  }
+  if (encoded_stream->bad()) {
+    LOG(ERROR) << "Could not read encoded packets.";
+    return false;
+  }
+  return true;
+}
+
+void LogDecodingSpeed(absl::Time benchmark_start, int64_t num_samples) {
+  const auto elapsed = absl::Now() - benchmark_start;
+  LOG(INFO) << "Elapsed seconds : " << absl::ToInt64Seconds(elapsed);
+  LOG(INFO) << "Samples per second : "
+            << num_samples / absl::ToDoubleSeconds(elapsed);
+}
+
+}  // namespace
 
 std::string AbslUnparseFlag(chromemedia::codec::PacketLossPattern pattern) {
   std::ostringstream flag_text;
@@ -83,61 +190,103 @@ bool AbslParseFlag(absl::string_view text,
   return true;
 }
 
+std::unique_ptr<PacketLossModelInterface> CreatePacketLossModel(
+    int sample_rate_hz, float packet_loss_rate, float average_burst_length,
+    const PacketLossPattern& fixed_packet_loss_pattern) {
+  if (fixed_packet_loss_pattern.starts_.empty()) {
+    return GilbertModel::Create(packet_loss_rate, average_burst_length);
+  }
+  return std::make_unique<FixedPacketLossModel>(
+      sample_rate_hz, GetNumSamplesPerHop(sample_rate_hz),
+      fixed_packet_loss_pattern.starts_, fixed_packet_loss_pattern.durations_);
+}
+
 bool DecodeFeatures(const std::vector<uint8_t>& packet_stream, int packet_size,
                     bool randomize_num_samples_requested, absl::BitGenRef gen,
                     LyraDecoder* decoder,
                     PacketLossModelInterface* packet_loss_model,
                     std::vector<int16_t>* decoded_audio) {
-  const int num_samples_per_packet =
-      GetNumSamplesPerHop(decoder->sample_rate_hz());
-
   const auto benchmark_start = absl::Now();
   for (int encoded_index = 0; encoded_index < packet_stream.size();
        encoded_index += packet_size) {
     const absl::Span<const uint8_t> encoded_packet =
         absl::MakeConstSpan(packet_stream.data() + encoded_index, packet_size);
-
-    const int frame_index = encoded_index / packet_size;
-    const float packet_start_seconds =
-        static_cast<float>(frame_index) / decoder->frame_rate();
-    std::optional<std::vector<int16_t>> decoded;
-    if (packet_loss_model == nullptr || packet_loss_model->IsPacketReceived()) {
-      if (!decoder->SetEncodedPacket(encoded_packet)) {
-        LOG(ERROR) << "Unable to set encoded packet starting at byte "
-                   << encoded_index << " at time " << packet_start_seconds
-                   << "s.";
-        return false;
-      }
-    } else {
-      VLOG(1) << "Decoding packet starting at " << packet_start_seconds
-              << "seconds in PLC mode.";
-    }
-    int samples_decoded_so_far = 0;
-    while (samples_decoded_so_far < num_samples_per_packet) {
-      int samples_to_request =
-          randomize_num_samples_requested
-              ? std::min(absl::Uniform<int>(absl::IntervalOpenClosed, gen, 0,
-                                            num_samples_per_packet),
-                         num_samples_per_packet - samples_decoded_so_far)
-              : num_samples_per_packet;
-      VLOG(1) << "Requesting " << samples_to_request
-              << " samples for decoding.";
-      decoded = decoder->DecodeSamples(samples_to_request);
-      if (!decoded.has_value()) {
-        LOG(ERROR) << "Unable to decode features starting at byte "
-                   << encoded_index;
-        return false;
-      }
-      samples_decoded_so_far += decoded->size();
-      decoded_audio->insert(decoded_audio->end(), decoded.value().begin(),
-                            decoded.value().end());
+    if (!DecodeHop(encoded_packet, encoded_index / packet_size,
+                   randomize_num_samples_requested, gen, decoder,
+                   packet_loss_model, decoded_audio)) {
+      return false;
     }
   }
+  LogDecodingSpeed(benchmark_start, decoded_audio->size());
+  return true;
+}
 
-  const auto elapsed = absl::Now() - benchmark_start;
-  LOG(INFO) << "Elapsed seconds : " << absl::ToInt64Seconds(elapsed);
-  LOG(INFO) << "Samples per second : "
-            << decoded_audio->size() / absl::ToDoubleSeconds(elapsed);
+bool DecodeContainer(const LyraContainerReader& reader,
+                     bool randomize_num_samples_requested, absl::BitGenRef gen,
+                     LyraDecoder* decoder,
+                     PacketLossModelInterface* packet_loss_model,
+                     WavWriter* wav_writer) {
+  std::vector<int16_t> hop_audio;
+  int64_t frame_index = 0;
+  bool decoded = true;
+  const bool read = reader.ReadFrames(
+      0, reader.num_frames(), [&](absl::Span<const uint8_t> packet) {
+        decoded = decoded &&
+                  DecodeHopToWav(packet, frame_index++,
+                                 randomize_num_samples_requested, gen, decoder,
+                                 packet_loss_model, &hop_audio, wav_writer);
+      });
+  return read && decoded;
+}
+
+bool DecodeStream(std::istream* input, std::ostream* output, int bitrate,
+                  bool raw_output, bool randomize_num_samples_requested,
+                  absl::BitGenRef gen, LyraDecoder* decoder,
+                  PacketLossModelInterface* packet_loss_model) {
+  if (!raw_output) {
+    absl::Status write_status = Write16BitWavStreamHeader(
+        decoder->num_channels(), decoder->sample_rate_hz(), output);
+    if (!write_status.ok()) {
+      LOG(ERROR) << write_status;
+      return false;
+    }
+  }
+  const int packet_size = BitrateToPacketSize(bitrate);
+  std::vector<uint8_t> packet(packet_size);
+  std::vector<int16_t> decoded_audio;
+  std::vector<char> bytes;
+  int64_t frame_index = 0;
+  while (input->read(reinterpret_cast<char*>(packet.data()), packet_size)) {
+    decoded_audio.clear();
+    if (!DecodeHop(packet, frame_index++, randomize_num_samples_requested, gen,
+                   decoder, packet_loss_model, &decoded_audio)) {
+      return false;
+    }
+    bytes.resize(decoded_audio.size() * sizeof(int16_t));
+    for (int i = 0; i < decoded_audio.size(); ++i) {
+      const uint16_t sample = decoded_audio[i];
+      bytes[2 * i] = static_cast<char>(sample & 0xFF);
+      bytes[2 * i + 1] = static_cast<char>(sample >> 8);
+    }
+    output->write(bytes.data(), bytes.size());
+    output->flush();
+  }
+  if (input->bad()) {
+    LOG(ERROR) << "Could not read from input stream.";
+    return false;
+  }
+  if (input->gcount() > 0) {
+    LOG(WARNING) << "Dropping the last " << input->gcount()
+                 << " bytes of the input, which are less than a packet.";
+  }
+  if (frame_index == 0) {
+    LOG(ERROR) << "Input stream was empty or shorter than a packet.";
+    return false;
+  }
+  if (!output->good()) {
+    LOG(ERROR) << "Could not write to output stream.";
+    return false;
+  }
   return true;
 }
 
@@ -152,70 +301,106 @@ bool DecodeFile(const ghc::filesystem::path& encoded_path,
     LOG(ERROR) << "Could not create lyra decoder.";
     return false;
   }
-  std::unique_ptr<PacketLossModelInterface> packet_loss_model;
-  if (fixed_packet_loss_pattern.starts_.empty()) {
-    packet_loss_model =
-        GilbertModel::Create(packet_loss_rate, average_burst_length);
-
-  } else {
-    packet_loss_model = std::make_unique<FixedPacketLossModel>(
-        sample_rate_hz, GetNumSamplesPerHop(sample_rate_hz),
-        fixed_packet_loss_pattern.starts_,
-        fixed_packet_loss_pattern.durations_);
-  }
+  std::unique_ptr<PacketLossModelInterface> packet_loss_model =
+      CreatePacketLossModel(sample_rate_hz, packet_loss_rate,
+                            average_burst_length, fixed_packet_loss_pattern);
   if (packet_loss_model == nullptr) {
     LOG(ERROR) << "Could not create packet loss simulator model.";
     return false;
   }
-  std::ifstream encoded_stream(encoded_path.string(), std::ios_base::binary);
-  if (!encoded_stream.is_open()) {
-    LOG(ERROR) << "Open on file " << encoded_path << " failed.";
-    return false;
-  }
-
-  std::string packet_stream_string{
-      std::istreambuf_iterator<char>(encoded_stream),
-      std::istreambuf_iterator<char>()};
 
+  // The input is checked before the output is created, so that a missing or
+  // empty input leaves no output behind.
+  std::unique_ptr<LyraContainerReader> reader;
+  std::ifstream encoded_stream;
   const int packet_size = BitrateToPacketSize(bitrate);
-  const int stream_size_remainder = packet_stream_string.size() % packet_size;
-  if (stream_size_remainder != 0) {
-    LOG(WARNING)
-        << "Read " << packet_stream_string.size()
-        << " bytes from file, which has a remainder when divided by packet "
-           "size. Removing the excess bytes from the end and attempting to "
-           "decode.";
-    packet_stream_string = packet_stream_string.substr(
-        0, packet_stream_string.size() - stream_size_remainder);
-  }
-  if (packet_stream_string.empty()) {
-    LOG(ERROR) << "File was empty or incomplete and truncated to empty size.";
+  if (LyraContainerReader::IsContainerFile(encoded_path)) {
+    // Containers record the bitrate of every frame, so |bitrate| is unused.
+    reader = LyraContainerReader::Open(encoded_path);
+    if (reader == nullptr) {
+      return false;
+    }
+    if (reader->num_frames() == 0) {
+      LOG(ERROR) << "Container " << encoded_path << " has no frames.";
+      return false;
+    }
+  } else {
+    // Otherwise the file holds raw packets, all at |bitrate|.
+    encoded_stream.open(encoded_path.string(), std::ios_base::binary);
+    if (!encoded_stream.is_open()) {
+      LOG(ERROR) << "Open on file " << encoded_path << " failed.";
+      return false;
+    }
+    std::error_code error_code;
+    const uintmax_t file_size =
+        ghc::filesystem::file_size(encoded_path, error_code);
+    if (!error_code && file_size % packet_size != 0) {
+      LOG(WARNING)
+          << "Read " << file_size
+          << " bytes from file, which has a remainder when divided by packet "
+             "size. Ignoring the excess bytes at the end and attempting to "
+             "decode.";
+    }
+    if (error_code || file_size < static_cast<uintmax_t>(packet_size)) {
+      LOG(ERROR) << "File was empty or incomplete and truncated to empty size.";
+      return false;
+    }
+  }
+
+  absl::StatusOr<std::unique_ptr<WavWriter>> wav_writer = WavWriter::Create(
+      output_path.string(), decoder->num_channels(), decoder->sample_rate_hz());
+  if (!wav_writer.ok()) {
+    LOG(ERROR) << wav_writer.status();
     return false;
   }
-  std::vector<uint8_t> packet_stream(packet_stream_string.size());
-  std::transform(packet_stream_string.begin(), packet_stream_string.end(),
-                 packet_stream.begin(),
-                 [](char packet) { return static_cast<uint8_t>(packet); });
 
-  std::vector<int16_t> decoded_audio;
   // Use one |gen| across each file. Creating |gen| inside |DecodeFeatures|
   // would use the same pattern for each hop.
   absl::BitGen gen;
-  if (!DecodeFeatures(packet_stream, packet_size,
-                      randomize_num_samples_requested, gen, decoder.get(),
-                      packet_loss_model.get(), &decoded_audio)) {
-    LOG(ERROR) << "Unable to decode features for file " << encoded_path;
+  const auto benchmark_start = absl::Now();
+  const bool decoded =
+      reader != nullptr
+          ? DecodeContainer(*reader, randomize_num_samples_requested, gen,
+                            decoder.get(), packet_loss_model.get(),
+                            wav_writer->get())
+          : DecodePacketStream(&encoded_stream, packet_size,
+                               randomize_num_samples_requested, gen,
+                               decoder.get(), packet_loss_model.get(),
+                               wav_writer->get());
+  absl::Status close_status = (*wav_writer)->Close();
+  if (!decoded || !close_status.ok()) {
+    if (!decoded) {
+      LOG(ERROR) << "Unable to decode features for file " << encoded_path;
+    } else {
+      LOG(ERROR) << close_status;
+    }
+    std::error_code error_code;
+    ghc::filesystem::remove(output_path, error_code);
     return false;
   }
+  LogDecodingSpeed(benchmark_start, (*wav_writer)->num_samples());
+  return true;
+}
 
-  absl::Status write_status =
-      Write16BitWavFileFromVector(output_path.string(), decoder->num_channels(),
-                                  decoder->sample_rate_hz(), decoded_audio);
-  if (!write_status.ok()) {
-    LOG(ERROR) << write_status;
-    return false;
+std::optional<absl::Duration> GetEncodedFileDuration(
+    const ghc::filesystem::path& encoded_path, int bitrate) {
+  if (LyraContainerReader::IsContainerFile(encoded_path)) {
+    auto reader = LyraContainerReader::Open(encoded_path);
+    if (reader == nullptr) {
+      return std::nullopt;
+    }
+    return reader->duration();
   }
-  return true;
+  std::error_code error_code;
+  const uintmax_t file_size =
+      ghc::filesystem::file_size(encoded_path, error_code);
+  if (error_code) {
+    LOG(ERROR) << "Could not get size of " << encoded_path << ": "
+               << error_code.message();
+    return std::nullopt;
+  }
+  const int64_t num_packets = file_size / BitrateToPacketSize(bitrate);
+  return absl::Seconds(num_packets) / kFrameRate;
 }
 
 }  // namespace codec
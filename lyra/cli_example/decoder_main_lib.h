@@ -18,14 +18,21 @@
 #define LYRA_CLI_EXAMPLE_DECODER_MAIN_LIB_H_
 
 #include <cstdint>
+#include <istream>
+#include <memory>
+#include <optional>
+#include <ostream>
 #include <string>
 #include <vector>
 
 #include "absl/random/bit_gen_ref.h"
 #include "absl/strings/string_view.h"
+#include "absl/time/time.h"
 #include "include/ghc/filesystem.hpp"
+#include "lyra/lyra_container.h"
 #include "lyra/lyra_decoder.h"
 #include "lyra/packet_loss_model_interface.h"
+#include "lyra/wav_utils.h"
 
 namespace chromemedia {
 namespace codec {
@@ -46,6 +53,13 @@ bool AbslParseFlag(absl::string_view text,
                    chromemedia::codec::PacketLossPattern* p,
                    std::string* error);
 
+// Returns a model that loses packets following |fixed_packet_loss_pattern|, or
+// if that is empty, at random with |packet_loss_rate| and
+// |average_burst_length|. Returns nullptr if the parameters are invalid.
+std::unique_ptr<PacketLossModelInterface> CreatePacketLossModel(
+    int sample_rate_hz, float packet_loss_rate, float average_burst_length,
+    const PacketLossPattern& fixed_packet_loss_pattern);
+
 // Decodes a vector of bytes into wav data.
 // If |packet_loss_model| is nullptr no packets will be lost.
 bool DecodeFeatures(const std::vector<uint8_t>& packet_stream, int packet_size,
@@ -54,7 +68,31 @@ bool DecodeFeatures(const std::vector<uint8_t>& packet_stream, int packet_size,
                     PacketLossModelInterface* packet_loss_model,
                     std::vector<int16_t>* decoded_audio);
 
-// Decodes an encoded features file into a wav file.
+// Decodes every frame of a container and appends the audio of each hop to
+// |wav_writer| as soon as it is decoded. Hops skipped by DTX are concealed like
+// lost packets.
+// If |packet_loss_model| is nullptr no packets will be lost.
+bool DecodeContainer(const LyraContainerReader& reader,
+                     bool randomize_num_samples_requested, absl::BitGenRef gen,
+                     LyraDecoder* decoder,
+                     PacketLossModelInterface* packet_loss_model,
+                     WavWriter* wav_writer);
+
+// Decodes raw packets at |bitrate| read incrementally from |input| and writes
+// the audio of each hop to |output| as soon as its packet has been read.
+// |output| is a .wav stream of unknown length, or headerless 16 bit
+// little-endian samples if |raw_output| is true. Memory use does not depend
+// on the length of the input.
+// If |packet_loss_model| is nullptr no packets will be lost.
+bool DecodeStream(std::istream* input, std::ostream* output, int bitrate,
+                  bool raw_output, bool randomize_num_samples_requested,
+                  absl::BitGenRef gen, LyraDecoder* decoder,
+                  PacketLossModelInterface* packet_loss_model);
+
+// Decodes an encoded features file into a wav file. The file is either a
+// container, see lyra_container.h, or raw packets at |bitrate|. The wav file is
+// written hop by hop, so memory use does not depend on the length of the file,
+// and is removed again if decoding fails.
 // Uses the model and quant files located under |model_path|.
 // Given the file /tmp/lyra/file1.lyra exists and is a valid encoded file. For:
 // |encoded_path| = "/tmp/lyra/file1.lyra"
@@ -68,6 +106,12 @@ bool DecodeFile(const ghc::filesystem::path& encoded_path,
                 const PacketLossPattern& fixed_packet_loss_pattern,
                 const ghc::filesystem::path& model_path);
 
+// Returns the duration of the audio in an encoded features file, without
+// decoding it. Only whole packets of raw files at |bitrate| are counted.
+// Returns nullopt if the file cannot be read.
+std::optional<absl::Duration> GetEncodedFileDuration(
+    const ghc::filesystem::path& encoded_path, int bitrate);
+
 }  // namespace codec
 }  // namespace chromemedia
 
@@ -14,18 +14,25 @@
 
 #include "lyra/cli_example/decoder_main_lib.h"
 
+#include <cstdint>
+#include <fstream>
+#include <iterator>
+#include <sstream>
 #include <string>
 #include <system_error>  // NOLINT(build/c++11)
 #include <vector>
 
 // Placeholder for get runfiles header.
 #include "absl/flags/flag.h"
+#include "absl/random/random.h"
 #include "absl/status/statusor.h"
 #include "absl/strings/str_cat.h"
 #include "absl/strings/string_view.h"
 #include "gtest/gtest.h"
 #include "include/ghc/filesystem.hpp"
 #include "lyra/lyra_config.h"
+#include "lyra/lyra_container.h"
+#include "lyra/lyra_decoder.h"
 #include "lyra/wav_utils.h"
 
 namespace chromemedia {
@@ -164,6 +171,84 @@ TEST_P(DecoderMainLibTest, TwoEncodedPacketsWithFixedPacketLoss) {
   EXPECT_EQ(NumSamplesInWavFile(output_path_), expected_num_samples);
 }
 
+TEST_P(DecoderMainLibTest, ContainerWithDtxFrame) {
+  SetInputOutputPath("two_encoded_packets_16khz");
+  std::ifstream raw_stream(input_path_.string(), std::ios_base::binary);
+  const std::vector<uint8_t> raw_packets{
+      std::istreambuf_iterator<char>(raw_stream),
+      std::istreambuf_iterator<char>()};
+  const int packet_size = BitrateToPacketSize(6000);
+  ASSERT_EQ(raw_packets.size(), 2 * packet_size);
+
+  // The packets with a hop skipped by DTX between them.
+  const ghc::filesystem::path container_path =
+      output_dir_ / absl::StrCat("dtx_", GetParam(), ".lyra");
+  auto writer = LyraContainerWriter::Create(container_path, 16000);
+  ASSERT_NE(writer, nullptr);
+  ASSERT_TRUE(writer->AddFrame(
+      absl::MakeConstSpan(raw_packets).first(packet_size)));
+  ASSERT_TRUE(writer->AddFrame({}));
+  ASSERT_TRUE(writer->AddFrame(
+      absl::MakeConstSpan(raw_packets).last(packet_size)));
+  ASSERT_TRUE(writer->Close());
+
+  // The container records the bitrate, so the flag does not matter.
+  EXPECT_TRUE(DecodeFile(
+      container_path, output_path_, sample_rate_hz_,
+      /*bitrate=*/3200, /*randomize_num_samples_requested=*/false,
+      /*packet_loss_rate=*/0.f,
+      /*average_burst_length=*/1.f, PacketLossPattern({}, {}), model_path_));
+  EXPECT_EQ(NumSamplesInWavFile(output_path_), 3 * num_samples_in_packet_);
+}
+
+TEST_P(DecoderMainLibTest, DecodeStreamWritesEveryHop) {
+  SetInputOutputPath("two_encoded_packets_16khz");
+  std::ifstream encoded_stream(input_path_.string(), std::ios_base::binary);
+  std::stringstream encoded;
+  encoded << encoded_stream.rdbuf();
+  // A trailing partial packet is dropped.
+  encoded << "x";
+
+  auto decoder = LyraDecoder::Create(sample_rate_hz_, kNumChannels,
+                                     model_path_);
+  ASSERT_NE(decoder, nullptr);
+  absl::BitGen gen;
+  std::stringstream decoded;
+  ASSERT_TRUE(DecodeStream(&encoded, &decoded, /*bitrate=*/6000,
+                           /*raw_output=*/false,
+                           /*randomize_num_samples_requested=*/false, gen,
+                           decoder.get(), /*packet_loss_model=*/nullptr));
+
+  absl::StatusOr<WavStreamHeader> header = Read16BitWavStreamHeader(&decoded);
+  ASSERT_TRUE(header.ok()) << header.status();
+  EXPECT_EQ(header->sample_rate_hz, sample_rate_hz_);
+  EXPECT_EQ(header->num_channels, kNumChannels);
+  const std::string samples(std::istreambuf_iterator<char>(decoded), {});
+  EXPECT_EQ(samples.size(), 2 * num_samples_in_packet_ * sizeof(int16_t));
+}
+
+TEST_P(DecoderMainLibTest, DecodeStreamRawOutput) {
+  SetInputOutputPath("one_encoded_packet_16khz");
+  std::ifstream encoded(input_path_.string(), std::ios_base::binary);
+
+  auto decoder = LyraDecoder::Create(sample_rate_hz_, kNumChannels,
+                                     model_path_);
+  ASSERT_NE(decoder, nullptr);
+  absl::BitGen gen;
+  std::ostringstream decoded;
+  ASSERT_TRUE(DecodeStream(&encoded, &decoded, /*bitrate=*/6000,
+                           /*raw_output=*/true,
+                           /*randomize_num_samples_requested=*/true, gen,
+                           decoder.get(), /*packet_loss_model=*/nullptr));
+  EXPECT_EQ(decoded.str().size(), num_samples_in_packet_ * sizeof(int16_t));
+
+  std::istringstream empty("");
+  EXPECT_FALSE(DecodeStream(&empty, &decoded, /*bitrate=*/6000,
+                            /*raw_output=*/true,
+                            /*randomize_num_samples_requested=*/false, gen,
+                            decoder.get(), /*packet_loss_model=*/nullptr));
+}
+
 INSTANTIATE_TEST_SUITE_P(SampleRates, DecoderMainLibTest,
                          testing::ValuesIn(kSupportedSampleRates));
 
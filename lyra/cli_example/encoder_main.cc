@@ -12,25 +12,48 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <optional>
 #include <string>
 #include <system_error>  // NOLINT(build/c++11)
+#include <thread>        // NOLINT(build/c++11)
+#include <vector>
 
 #include "absl/flags/flag.h"
 #include "absl/flags/parse.h"
 #include "absl/flags/usage.h"
 #include "absl/strings/string_view.h"
+#include "absl/time/time.h"
 #include "glog/logging.h"  // IWYU pragma: keep
 #include "include/ghc/filesystem.hpp"
 #include "lyra/architecture_utils.h"
+#include "lyra/cli_example/batch_transcoder.h"
 #include "lyra/cli_example/encoder_main_lib.h"
+#include "lyra/lyra_config.h"
+#include "lyra/lyra_container.h"
 
 ABSL_FLAG(std::string, input_path, "",
-          "Complete path to the WAV file to be encoded.");
+          "Complete path to the WAV file to be encoded. A directory encodes "
+          "every WAV file below it, and a .txt file is read as a list of WAV "
+          "files, one per line. '-' encodes a WAV or raw stream from stdin to "
+          "raw packets on stdout, hop by hop, and ignores --output_dir.");
+ABSL_FLAG(int, raw_sample_rate_hz, 0,
+          "When encoding from stdin, the sample rate of headerless 16 bit "
+          "little-endian mono samples. 0 expects a WAV stream instead.");
 ABSL_FLAG(std::string, output_dir, "",
           "The dir for the encoded file to be written out. Recursively "
           "creates dir if it does not exist. Output files use the same "
           "name as the wav file they come from with a '.lyra' postfix. Will "
-          "overwrite existing files.");
+          "overwrite existing files. Batches mirror the input tree here.");
+ABSL_FLAG(int, num_threads, 0,
+          "Number of files encoded in parallel when encoding a batch, or of "
+          "chunks with --chunk_seconds. 0 uses one thread per core.");
+ABSL_FLAG(double, chunk_seconds, 0.0,
+          "If positive, a single file is cut into chunks of this many seconds "
+          "which are encoded in parallel. The packets only depend on the "
+          "chunk length, not on --num_threads. 0 encodes serially.");
 ABSL_FLAG(int, bitrate, 3200,
           "The bitrate in bps with which to quantize the file.  The "
           "bitrate options can be seen in lyra_encoder.h");
@@ -58,15 +81,48 @@ int main(int argc, char** argv) {
   const int bitrate = absl::GetFlag(FLAGS_bitrate);
   const bool enable_preprocessing = absl::GetFlag(FLAGS_enable_preprocessing);
   const bool enable_dtx = absl::GetFlag(FLAGS_enable_dtx);
+  int num_threads = absl::GetFlag(FLAGS_num_threads);
+  if (num_threads == 0) {
+    num_threads = std::max(1u, std::thread::hardware_concurrency());
+  }
+  const int num_hops_per_chunk = static_cast<int>(
+      std::round(absl::GetFlag(FLAGS_chunk_seconds) *
+                 chromemedia::codec::kFrameRate));
 
   if (input_path.empty()) {
     LOG(ERROR) << "Flag --input_path not set.";
     return -1;
   }
+
+  if (input_path == "-") {
+    if (enable_dtx) {
+      LOG(ERROR) << "Flag --enable_dtx is not supported when encoding stdin.";
+      return -1;
+    }
+    const int raw_sample_rate_hz = absl::GetFlag(FLAGS_raw_sample_rate_hz);
+    std::ios_base::sync_with_stdio(false);
+    if (!chromemedia::codec::EncodeStream(
+            &std::cin, &std::cout,
+            raw_sample_rate_hz > 0 ? std::optional<int>(raw_sample_rate_hz)
+                                   : std::nullopt,
+            bitrate, enable_preprocessing, model_path)) {
+      LOG(ERROR) << "Failed to encode stdin.";
+      return -1;
+    }
+    return 0;
+  }
   if (output_dir.empty()) {
     LOG(ERROR) << "Flag --output_dir not set.";
     return -1;
   }
+  if (num_threads < 1) {
+    LOG(ERROR) << "Flag --num_threads must not be negative.";
+    return -1;
+  }
+  if (num_hops_per_chunk < 0) {
+    LOG(ERROR) << "Flag --chunk_seconds must not be negative.";
+    return -1;
+  }
 
   std::error_code error_code;
   if (!ghc::filesystem::is_directory(output_dir, error_code)) {
@@ -77,9 +133,48 @@ int main(int argc, char** argv) {
       return -1;
     }
   }
+
+  if (chromemedia::codec::IsBatchInput(input_path)) {
+    const std::optional<std::vector<chromemedia::codec::BatchInput>> inputs =
+        chromemedia::codec::ListBatchInputs(input_path, ".wav");
+    if (!inputs.has_value()) {
+      return -1;
+    }
+    // Every file gets fresh encoder state. The model weights are loaded once
+    // and shared by all encoders in the process.
+    const chromemedia::codec::BatchStats stats =
+        chromemedia::codec::TranscodeBatch(
+            *inputs, output_dir, ".lyra", num_threads,
+            [&](const ghc::filesystem::path& wav_path,
+                const ghc::filesystem::path& output_path)
+                -> std::optional<absl::Duration> {
+              if (!chromemedia::codec::EncodeFile(
+                      wav_path, output_path, bitrate, enable_preprocessing,
+                      enable_dtx, model_path)) {
+                return std::nullopt;
+              }
+              auto reader =
+                  chromemedia::codec::LyraContainerReader::Open(output_path);
+              if (reader == nullptr) {
+                return std::nullopt;
+              }
+              return reader->duration();
+            });
+    return stats.num_failed == 0 ? 0 : -1;
+  }
+
   const auto output_path =
       ghc::filesystem::path(output_dir) / input_path.stem().concat(".lyra");
 
+  if (num_hops_per_chunk > 0) {
+    if (!chromemedia::codec::EncodeFileInChunks(
+            input_path, output_path, bitrate, enable_preprocessing, enable_dtx,
+            model_path, num_hops_per_chunk, num_threads)) {
+      LOG(ERROR) << "Failed to encode " << input_path;
+      return -1;
+    }
+    return 0;
+  }
   if (!chromemedia::codec::EncodeFile(input_path, output_path, bitrate,
                                       enable_preprocessing, enable_dtx,
                                       model_path)) {
@@ -16,39 +16,45 @@
 
 #include <algorithm>
 #include <cstdint>
-#include <fstream>
+#include <istream>
 #include <iterator>
+#include <limits>
 #include <memory>
 #include <optional>
+#include <ostream>
+#include <utility>
 #include <vector>
 
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
-#include "absl/strings/string_view.h"
 #include "absl/time/clock.h"
 #include "absl/time/time.h"
 #include "absl/types/span.h"
 #include "glog/logging.h"  // IWYU pragma: keep
 #include "include/ghc/filesystem.hpp"
 #include "lyra/lyra_config.h"
-#include "lyra/lyra_encoder.h"
+#include "lyra/lyra_container.h"
+#include "lyra/lyra_stream_encoder.h"
 #include "lyra/no_op_preprocessor.h"
+#include "lyra/thread_pool.h"
 #include "lyra/wav_utils.h"
 
 namespace chromemedia {
 namespace codec {
+namespace {
 
-// Packets are appended to encoded_features. The oldest packet is encoded
-// starting at index 0.
-bool EncodeWav(const std::vector<int16_t>& wav_data, int num_channels,
-               int sample_rate_hz, int bitrate, bool enable_preprocessing,
-               bool enable_dtx, const ghc::filesystem::path& model_path,
-               std::vector<uint8_t>* encoded_features) {
-  auto encoder = LyraEncoder::Create(/*sample_rate_hz=*/sample_rate_hz,
-                                     /*num_channels=*/num_channels,
-                                     /*bitrate=*/bitrate,
-                                     /*enable_dtx=*/enable_dtx,
-                                     /*model_path=*/model_path);
+// Passes the packet of each hop to |packet_callback|, oldest first. Packets of
+// hops skipped by DTX are empty.
+bool EncodeWavToCallback(
+    absl::Span<const int16_t> wav_data, int num_channels, int sample_rate_hz,
+    int bitrate, bool enable_preprocessing, bool enable_dtx,
+    const ghc::filesystem::path& model_path,
+    const LyraStreamEncoder::PacketCallback& packet_callback) {
+  auto encoder = LyraStreamEncoder::Create(/*sample_rate_hz=*/sample_rate_hz,
+                                           /*num_channels=*/num_channels,
+                                           /*bitrate=*/bitrate,
+                                           /*enable_dtx=*/enable_dtx,
+                                           /*model_path=*/model_path);
   if (encoder == nullptr) {
     LOG(ERROR) << "Could not create lyra encoder.";
     return false;
@@ -61,31 +67,19 @@ bool EncodeWav(const std::vector<int16_t>& wav_data, int num_channels,
 
   const auto benchmark_start = absl::Now();
 
-  std::vector<int16_t> processed_data(wav_data);
+  // Only preprocessing copies the samples.
+  absl::Span<const int16_t> audio = wav_data;
+  std::vector<int16_t> processed_data;
   if (enable_preprocessing) {
-    processed_data = preprocessor->Process(
-        absl::MakeConstSpan(wav_data.data(), wav_data.size()), sample_rate_hz);
-  }
-
-  const int num_samples_per_packet = sample_rate_hz / encoder->frame_rate();
-  // Iterate over the wav data until the end of the vector.
-  for (int wav_iterator = 0;
-       wav_iterator + num_samples_per_packet <= processed_data.size();
-       wav_iterator += num_samples_per_packet) {
-    // Move audio samples from the large in memory wav file frame by frame to
-    // the encoder.
-    auto encoded = encoder->Encode(absl::MakeConstSpan(
-        &processed_data.at(wav_iterator), num_samples_per_packet));
-    if (!encoded.has_value()) {
-      LOG(ERROR) << "Unable to encode features starting at samples at byte "
-                 << wav_iterator << ".";
-      return false;
-    }
+    processed_data = preprocessor->Process(wav_data, sample_rate_hz);
+    audio = processed_data;
+  }
 
-    // Append the encoded audio frames to the encoded_features accumulator
-    // vector.
-    encoded_features->insert(encoded_features->end(), encoded.value().begin(),
-                             encoded.value().end());
+  // The tail that does not fill a whole frame is padded with silence.
+  if (!encoder->Encode(audio, packet_callback).has_value() ||
+      !encoder->Flush(packet_callback).has_value()) {
+    LOG(ERROR) << "Unable to encode features.";
+    return false;
   }
   const auto elapsed = absl::Now() - benchmark_start;
   LOG(INFO) << "Elapsed seconds : " << absl::ToInt64Seconds(elapsed);
@@ -95,40 +89,322 @@ bool EncodeWav(const std::vector<int16_t>& wav_data, int num_channels,
   return true;
 }
 
+// Encodes |chunk| with a new encoder that first encodes |pre_roll|, the audio
+// right before the chunk, and drops its packets.
+std::optional<std::vector<std::vector<uint8_t>>> EncodeChunk(
+    absl::Span<const int16_t> pre_roll, absl::Span<const int16_t> chunk,
+    int num_channels, int sample_rate_hz, int bitrate, bool enable_dtx,
+    const ghc::filesystem::path& model_path) {
+  auto encoder = LyraStreamEncoder::Create(/*sample_rate_hz=*/sample_rate_hz,
+                                           /*num_channels=*/num_channels,
+                                           /*bitrate=*/bitrate,
+                                           /*enable_dtx=*/enable_dtx,
+                                           /*model_path=*/model_path);
+  if (encoder == nullptr) {
+    LOG(ERROR) << "Could not create lyra encoder.";
+    return std::nullopt;
+  }
+  if (!encoder->Encode(pre_roll, [](absl::Span<const uint8_t>) {})
+           .has_value()) {
+    LOG(ERROR) << "Unable to encode pre-roll.";
+    return std::nullopt;
+  }
+  std::vector<std::vector<uint8_t>> packets;
+  const auto append_packet = [&packets](absl::Span<const uint8_t> packet) {
+    packets.emplace_back(packet.begin(), packet.end());
+  };
+  // Chunks are whole hops, so only the last one has a tail to flush.
+  if (!encoder->Encode(chunk, append_packet).has_value() ||
+      !encoder->Flush(append_packet).has_value()) {
+    LOG(ERROR) << "Unable to encode features.";
+    return std::nullopt;
+  }
+  return packets;
+}
+
+// The samples of a .wav file, mapped in place when it is 16 bit PCM and
+// otherwise converted to 16 bit in memory.
+struct WavAudio {
+  std::unique_ptr<WavReader> mapped;
+  std::optional<ReadWavResult> converted;
+
+  absl::Span<const int16_t> samples() const {
+    return mapped != nullptr ? mapped->samples()
+                             : absl::MakeConstSpan(converted->samples);
+  }
+  int num_channels() const {
+    return mapped != nullptr ? mapped->num_channels()
+                             : converted->num_channels;
+  }
+  int sample_rate_hz() const {
+    return mapped != nullptr ? mapped->sample_rate_hz()
+                             : converted->sample_rate_hz;
+  }
+};
+
+// Maps |wav_path| if it is 16 bit PCM. Other formats, such as 24 bit PCM or
+// float, are converted by the slower audio_dsp reader instead.
+std::optional<WavAudio> ReadWav(const ghc::filesystem::path& wav_path) {
+  WavAudio audio;
+  absl::StatusOr<std::unique_ptr<WavReader>> wav_reader =
+      WavReader::Open(wav_path.string());
+  if (wav_reader.ok()) {
+    audio.mapped = std::move(*wav_reader);
+    return audio;
+  }
+  absl::StatusOr<ReadWavResult> converted =
+      Read16BitWavFileToVector(wav_path.string());
+  if (!converted.ok()) {
+    LOG(ERROR) << wav_reader.status();
+    LOG(ERROR) << converted.status();
+    return std::nullopt;
+  }
+  VLOG(1) << "Could not map " << wav_path << ", converted it instead: "
+          << wav_reader.status();
+  audio.converted.emplace(*converted);
+  return audio;
+}
+
+}  // namespace
+
+// Packets are appended to encoded_features. The oldest packet is encoded
+// starting at index 0.
+bool EncodeWav(const std::vector<int16_t>& wav_data, int num_channels,
+               int sample_rate_hz, int bitrate, bool enable_preprocessing,
+               bool enable_dtx, const ghc::filesystem::path& model_path,
+               std::vector<uint8_t>* encoded_features) {
+  // Append the encoded audio frames to the encoded_features accumulator
+  // vector.
+  return EncodeWavToCallback(
+      wav_data, num_channels, sample_rate_hz, bitrate, enable_preprocessing,
+      enable_dtx, model_path,
+      [encoded_features](absl::Span<const uint8_t> packet) {
+        encoded_features->insert(encoded_features->end(), packet.begin(),
+                                 packet.end());
+      });
+}
+
 bool EncodeFile(const ghc::filesystem::path& wav_path,
                 const ghc::filesystem::path& output_path, int bitrate,
                 bool enable_preprocessing, bool enable_dtx,
                 const ghc::filesystem::path& model_path) {
-  // Reads the entire wav file into memory.
-  absl::StatusOr<ReadWavResult> read_wav_result =
-      Read16BitWavFileToVector(wav_path.string());
+  // A 16 bit file is mapped, so that its pages are only read as they are
+  // encoded.
+  const std::optional<WavAudio> wav_audio = ReadWav(wav_path);
+  if (!wav_audio.has_value()) {
+    return false;
+  }
+
+  auto writer = LyraContainerWriter::Create(output_path,
+                                            wav_audio->sample_rate_hz());
+  if (writer == nullptr) {
+    LOG(ERROR) << "Could not create container " << output_path;
+    return false;
+  }
+  // Hops skipped by DTX are recorded too, so that decoding keeps the timing.
+  bool frames_written = true;
+  if (!EncodeWavToCallback(
+          wav_audio->samples(), wav_audio->num_channels(),
+          wav_audio->sample_rate_hz(), bitrate, enable_preprocessing,
+          enable_dtx, model_path,
+          [&writer, &frames_written](absl::Span<const uint8_t> packet) {
+            frames_written = writer->AddFrame(packet) && frames_written;
+          })) {
+    LOG(ERROR) << "Unable to encode features for file " << wav_path;
+    return false;
+  }
+  if (!frames_written || !writer->Close()) {
+    LOG(ERROR) << "Could not write container " << output_path;
+    return false;
+  }
+  return true;
+}
+
+std::optional<std::vector<std::vector<uint8_t>>> EncodeWavInChunks(
+    absl::Span<const int16_t> wav_data, int num_channels,
+    int sample_rate_hz, int bitrate, bool enable_preprocessing,
+    bool enable_dtx, const ghc::filesystem::path& model_path,
+    int num_hops_per_chunk, int num_threads) {
+  if (!IsSampleRateSupported(sample_rate_hz)) {
+    LOG(ERROR) << "Sample rate " << sample_rate_hz << " Hz is not supported.";
+    return std::nullopt;
+  }
+  if (num_hops_per_chunk < 1) {
+    LOG(ERROR) << "Chunks must have at least 1 hop but had "
+               << num_hops_per_chunk << ".";
+    return std::nullopt;
+  }
+  auto thread_pool = ThreadPool::Create(num_threads);
+  if (thread_pool == nullptr) {
+    LOG(ERROR) << "Could not create thread pool.";
+    return std::nullopt;
+  }
 
-  if (!read_wav_result.ok()) {
-    LOG(ERROR) << read_wav_result.status();
+  const auto benchmark_start = absl::Now();
+
+  absl::Span<const int16_t> audio = wav_data;
+  std::vector<int16_t> processed_data;
+  if (enable_preprocessing) {
+    processed_data = NoOpPreprocessor().Process(wav_data, sample_rate_hz);
+    audio = processed_data;
+  }
+
+  const int64_t num_samples_per_hop = GetNumSamplesPerHop(sample_rate_hz);
+  const int64_t num_samples_per_chunk =
+      num_hops_per_chunk * num_samples_per_hop;
+  const int64_t num_samples = audio.size();
+  const int num_chunks =
+      (num_samples + num_samples_per_chunk - 1) / num_samples_per_chunk;
+  std::vector<std::optional<std::vector<std::vector<uint8_t>>>> chunk_packets(
+      num_chunks);
+  thread_pool->ParallelFor(num_chunks, [&](int chunk) {
+    const int64_t begin = chunk * num_samples_per_chunk;
+    const int64_t end = std::min(begin + num_samples_per_chunk, num_samples);
+    const int64_t pre_roll_begin = std::max<int64_t>(
+        0, begin - kNumChunkPreRollHops * num_samples_per_hop);
+    chunk_packets[chunk] = EncodeChunk(
+        audio.subspan(pre_roll_begin, begin - pre_roll_begin),
+        audio.subspan(begin, end - begin), num_channels, sample_rate_hz,
+        bitrate, enable_dtx, model_path);
+  });
+
+  std::vector<std::vector<uint8_t>> packets;
+  for (auto& chunk : chunk_packets) {
+    if (!chunk.has_value()) {
+      return std::nullopt;
+    }
+    std::move(chunk->begin(), chunk->end(), std::back_inserter(packets));
+  }
+  const auto elapsed = absl::Now() - benchmark_start;
+  LOG(INFO) << "Elapsed seconds : " << absl::ToInt64Seconds(elapsed);
+  LOG(INFO) << "Samples per second : "
+            << wav_data.size() / absl::ToDoubleSeconds(elapsed);
+  return packets;
+}
+
+bool EncodeFileInChunks(const ghc::filesystem::path& wav_path,
+                        const ghc::filesystem::path& output_path, int bitrate,
+                        bool enable_preprocessing, bool enable_dtx,
+                        const ghc::filesystem::path& model_path,
+                        int num_hops_per_chunk, int num_threads) {
+  const std::optional<WavAudio> wav_audio = ReadWav(wav_path);
+  if (!wav_audio.has_value()) {
     return false;
   }
 
-  // Keep an accumulator vector of all the encoded features to write to file.
-  std::vector<uint8_t> encoded_features;
-  if (!EncodeWav(read_wav_result->samples, read_wav_result->num_channels,
-                 read_wav_result->sample_rate_hz, bitrate, enable_preprocessing,
-                 enable_dtx, model_path, &encoded_features)) {
+  // The chunks read the mapped samples in place from all threads.
+  const std::optional<std::vector<std::vector<uint8_t>>> packets =
+      EncodeWavInChunks(wav_audio->samples(),
+                        wav_audio->num_channels(),
+                        wav_audio->sample_rate_hz(), bitrate,
+                        enable_preprocessing, enable_dtx, model_path,
+                        num_hops_per_chunk, num_threads);
+  if (!packets.has_value()) {
     LOG(ERROR) << "Unable to encode features for file " << wav_path;
     return false;
   }
 
-  std::ofstream output_stream(output_path.string(),
-                              std::ios_base::binary | std::ios_base::trunc);
-  if (!output_stream.is_open()) {
-    LOG(ERROR) << "Could not open output file " << output_path;
+  auto writer = LyraContainerWriter::Create(output_path,
+                                            wav_audio->sample_rate_hz());
+  if (writer == nullptr) {
+    LOG(ERROR) << "Could not create container " << output_path;
+    return false;
+  }
+  for (const std::vector<uint8_t>& packet : *packets) {
+    if (!writer->AddFrame(packet)) {
+      LOG(ERROR) << "Could not write container " << output_path;
+      return false;
+    }
+  }
+  if (!writer->Close()) {
+    LOG(ERROR) << "Could not write container " << output_path;
+    return false;
+  }
+  return true;
+}
+
+bool EncodeStream(std::istream* input, std::ostream* output,
+                  std::optional<int> raw_sample_rate_hz, int bitrate,
+                  bool enable_preprocessing,
+                  const ghc::filesystem::path& model_path) {
+  int sample_rate_hz;
+  // Bounded by the data chunk of a .wav stream if its writer knew the size.
+  int64_t num_bytes_left = std::numeric_limits<int64_t>::max();
+  if (raw_sample_rate_hz.has_value()) {
+    sample_rate_hz = *raw_sample_rate_hz;
+  } else {
+    absl::StatusOr<WavStreamHeader> header = Read16BitWavStreamHeader(input);
+    if (!header.ok()) {
+      LOG(ERROR) << header.status();
+      return false;
+    }
+    if (header->num_channels != kNumChannels) {
+      LOG(ERROR) << "Wav stream has " << header->num_channels
+                 << " channels, but only " << kNumChannels
+                 << " is supported.";
+      return false;
+    }
+    sample_rate_hz = header->sample_rate_hz;
+    num_bytes_left = header->num_data_bytes.value_or(num_bytes_left);
+  }
+
+  auto encoder = LyraStreamEncoder::Create(/*sample_rate_hz=*/sample_rate_hz,
+                                           /*num_channels=*/kNumChannels,
+                                           /*bitrate=*/bitrate,
+                                           /*enable_dtx=*/false,
+                                           /*model_path=*/model_path);
+  if (encoder == nullptr) {
+    LOG(ERROR) << "Could not create lyra encoder.";
     return false;
   }
-  absl::string_view encoded_data(
-      reinterpret_cast<const char*>(encoded_features.data()),
-      encoded_features.size());
-  std::ostreambuf_iterator<char> output_iterator(output_stream);
-  std::copy(encoded_data.begin(), encoded_data.end(), output_iterator);
+  std::unique_ptr<PreprocessorInterface> preprocessor;
+  if (enable_preprocessing) {
+    preprocessor = std::make_unique<NoOpPreprocessor>();
+  }
 
+  const auto write_packet = [output](absl::Span<const uint8_t> packet) {
+    output->write(reinterpret_cast<const char*>(packet.data()), packet.size());
+    output->flush();
+  };
+  // Reads one hop at a time, so that a live input is encoded as it arrives.
+  std::vector<char> bytes(encoder->num_samples_per_hop() * sizeof(int16_t));
+  std::vector<int16_t> samples(encoder->num_samples_per_hop());
+  while (num_bytes_left > 0 && input->good()) {
+    input->read(bytes.data(),
+                std::min<int64_t>(bytes.size(), num_bytes_left));
+    num_bytes_left -= input->gcount();
+    // A trailing odd byte is not a whole sample and is dropped.
+    const int num_samples = input->gcount() / sizeof(int16_t);
+    for (int i = 0; i < num_samples; ++i) {
+      samples[i] = static_cast<int16_t>(
+          static_cast<uint8_t>(bytes[2 * i]) |
+          (static_cast<uint8_t>(bytes[2 * i + 1]) << 8));
+    }
+    absl::Span<const int16_t> hop =
+        absl::MakeConstSpan(samples).first(num_samples);
+    std::vector<int16_t> processed;
+    if (enable_preprocessing) {
+      processed = preprocessor->Process(hop, sample_rate_hz);
+      hop = processed;
+    }
+    if (!encoder->Encode(hop, write_packet).has_value()) {
+      LOG(ERROR) << "Unable to encode features.";
+      return false;
+    }
+  }
+  if (input->bad()) {
+    LOG(ERROR) << "Could not read from input stream.";
+    return false;
+  }
+  // The tail that does not fill a whole frame is padded with silence.
+  if (!encoder->Flush(write_packet).has_value()) {
+    LOG(ERROR) << "Unable to encode features.";
+    return false;
+  }
+  if (!output->good()) {
+    LOG(ERROR) << "Could not write to output stream.";
+    return false;
+  }
   return true;
 }
 
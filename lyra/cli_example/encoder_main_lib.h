@@ -18,14 +18,19 @@
 #define LYRA_CLI_EXAMPLE_ENCODER_MAIN_LIB_H_
 
 #include <cstdint>
+#include <istream>
+#include <optional>
+#include <ostream>
 #include <vector>
 
+#include "absl/types/span.h"
 #include "include/ghc/filesystem.hpp"
 
 namespace chromemedia {
 namespace codec {
 
-// Encodes a vector of wav_data into encoded_features.
+// Encodes a vector of wav_data into encoded_features. A final partial frame is
+// padded with silence.
 // Uses the quant files located under |model_path|.
 bool EncodeWav(const std::vector<int16_t>& wav_data, int num_channels,
                int sample_rate_hz, int bitrate, bool enable_preprocessing,
@@ -33,13 +38,52 @@ bool EncodeWav(const std::vector<int16_t>& wav_data, int num_channels,
                std::vector<uint8_t>* encoded_features);
 
 // Encodes a wav file into an encoded feature file. Encodes num_samples from the
-// file at |wav_path| and writes the encoded features out to |output_path|.
+// file at |wav_path| and writes the encoded features out to |output_path| as a
+// container, see lyra_container.h.
 // Uses the quant files located under |model_path|.
 bool EncodeFile(const ghc::filesystem::path& wav_path,
                 const ghc::filesystem::path& output_path, int bitrate,
                 bool enable_preprocessing, bool enable_dtx,
                 const ghc::filesystem::path& model_path);
 
+// Number of hops before a chunk that are encoded and discarded by the chunk's
+// encoder, so that its SoundStream and noise estimator state have converged
+// to that of a serial encoder when the chunk starts.
+inline constexpr int kNumChunkPreRollHops = 50;
+
+// Encodes |wav_data| like |EncodeWav|, but cuts it into chunks of
+// |num_hops_per_chunk| hops which are encoded in parallel on |num_threads|
+// threads, each with its own encoder warmed on the |kNumChunkPreRollHops|
+// hops before the chunk. The chunk boundaries depend only on
+// |num_hops_per_chunk|, so the packets do not depend on |num_threads|.
+// Returns one packet per hop, empty for hops skipped by DTX, or nullopt on
+// failure.
+std::optional<std::vector<std::vector<uint8_t>>> EncodeWavInChunks(
+    absl::Span<const int16_t> wav_data, int num_channels,
+    int sample_rate_hz, int bitrate, bool enable_preprocessing,
+    bool enable_dtx, const ghc::filesystem::path& model_path,
+    int num_hops_per_chunk, int num_threads);
+
+// Like |EncodeFile|, but encodes the file in parallel chunks with
+// |EncodeWavInChunks|.
+bool EncodeFileInChunks(const ghc::filesystem::path& wav_path,
+                        const ghc::filesystem::path& output_path, int bitrate,
+                        bool enable_preprocessing, bool enable_dtx,
+                        const ghc::filesystem::path& model_path,
+                        int num_hops_per_chunk, int num_threads);
+
+// Encodes mono audio read incrementally from |input| and writes the packet of
+// each hop to |output| as soon as the hop has been read, as raw packets like
+// those of |EncodeWav|. |input| holds headerless 16 bit little-endian samples
+// at |raw_sample_rate_hz| if it has a value, and a .wav stream otherwise.
+// Memory use does not depend on the length of the input. DTX is not supported
+// since raw packets cannot represent the hops it skips.
+// Uses the quant files located under |model_path|.
+bool EncodeStream(std::istream* input, std::ostream* output,
+                  std::optional<int> raw_sample_rate_hz, int bitrate,
+                  bool enable_preprocessing,
+                  const ghc::filesystem::path& model_path);
+
 }  // namespace codec
 }  // namespace chromemedia
 
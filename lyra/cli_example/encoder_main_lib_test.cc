@@ -14,15 +14,25 @@
 
 #include "lyra/cli_example/encoder_main_lib.h"
 
+#include <bitset>
+#include <cstdint>
+#include <fstream>
+#include <iterator>
+#include <optional>
+#include <sstream>
 #include <string>
 #include <system_error>  // NOLINT(build/c++11)
+#include <vector>
 
 // Placeholder for get runfiles header.
 // Placeholder for testing header.
 #include "absl/flags/flag.h"
+#include "absl/strings/str_cat.h"
 #include "absl/strings/string_view.h"
 #include "gtest/gtest.h"
 #include "include/ghc/filesystem.hpp"
+#include "lyra/lyra_config.h"
+#include "lyra/wav_utils.h"
 
 namespace chromemedia {
 namespace codec {
@@ -33,6 +43,39 @@ static constexpr absl::string_view kWavFiles[] = {
 
 static constexpr absl::string_view kTestdataDir = "lyra/testdata";
 
+// Writes |samples| as a mono 24 bit PCM .wav file, which WavReader cannot map.
+void Write24BitWavFile(const ghc::filesystem::path& path,
+                       const std::vector<int16_t>& samples,
+                       int sample_rate_hz) {
+  std::ofstream output(path.string(), std::ios_base::binary);
+  const auto write_le = [&output](uint32_t value, int num_bytes) {
+    for (int i = 0; i < num_bytes; ++i) {
+      output.put(static_cast<char>((value >> (8 * i)) & 0xff));
+    }
+  };
+  const uint32_t num_data_bytes = 3 * samples.size();
+  output.write("RIFF", 4);
+  write_le(36 + num_data_bytes, 4);
+  output.write("WAVEfmt ", 8);
+  write_le(16, 4);
+  write_le(/*PCM=*/1, 2);
+  write_le(/*num_channels=*/1, 2);
+  write_le(sample_rate_hz, 4);
+  write_le(3 * sample_rate_hz, 4);
+  write_le(/*block_align=*/3, 2);
+  write_le(/*bits_per_sample=*/24, 2);
+  output.write("data", 4);
+  write_le(num_data_bytes, 4);
+  for (const int16_t sample : samples) {
+    write_le(static_cast<uint32_t>(static_cast<int32_t>(sample) * 256), 3);
+  }
+}
+
+std::string ReadFile(const ghc::filesystem::path& path) {
+  std::ifstream input(path.string(), std::ios_base::binary);
+  return std::string(std::istreambuf_iterator<char>(input), {});
+}
+
 class EncoderMainLibTest : public testing::Test {
  protected:
   EncoderMainLibTest()
@@ -79,6 +122,179 @@ TEST_F(EncoderMainLibTest, EncodeSingleWavFiles) {
   }
 }
 
+TEST_F(EncoderMainLibTest, EncodesWavFilesThatCannotBeMapped) {
+  const auto wav = Read16BitWavFileToVector(
+      (testdata_dir_ / "sample1_16kHz.wav").string());
+  ASSERT_TRUE(wav.ok());
+  const auto wav_24_bit = output_dir_ / "sample1_16kHz_24bit.wav";
+  Write24BitWavFile(wav_24_bit, wav->samples, wav->sample_rate_hz);
+  ASSERT_FALSE(WavReader::Open(wav_24_bit.string()).ok());
+
+  // The 24 bit samples convert back to exactly the 16 bit ones.
+  const auto expected = output_dir_ / "expected.lyra";
+  const auto encoded = output_dir_ / "encoded.lyra";
+  ASSERT_TRUE(EncodeFile(testdata_dir_ / "sample1_16kHz.wav", expected,
+                         /*bitrate=*/3200, /*enable_preprocessing=*/false,
+                         /*enable_dtx=*/false, model_path_));
+  ASSERT_TRUE(EncodeFile(wav_24_bit, encoded, /*bitrate=*/3200,
+                         /*enable_preprocessing=*/false,
+                         /*enable_dtx=*/false, model_path_));
+  EXPECT_EQ(ReadFile(encoded), ReadFile(expected));
+
+  ASSERT_TRUE(EncodeFileInChunks(testdata_dir_ / "sample1_16kHz.wav",
+                                 expected, /*bitrate=*/3200,
+                                 /*enable_preprocessing=*/false,
+                                 /*enable_dtx=*/false, model_path_,
+                                 /*num_hops_per_chunk=*/25,
+                                 /*num_threads=*/2));
+  ASSERT_TRUE(EncodeFileInChunks(wav_24_bit, encoded, /*bitrate=*/3200,
+                                 /*enable_preprocessing=*/false,
+                                 /*enable_dtx=*/false, model_path_,
+                                 /*num_hops_per_chunk=*/25,
+                                 /*num_threads=*/2));
+  EXPECT_EQ(ReadFile(encoded), ReadFile(expected));
+}
+
+TEST_F(EncoderMainLibTest, ChunkedEncodingDoesNotDependOnThreadCount) {
+  const auto wav = Read16BitWavFileToVector(
+      (testdata_dir_ / "sample1_16kHz.wav").string());
+  ASSERT_TRUE(wav.ok());
+
+  const auto one_thread = EncodeWavInChunks(
+      wav->samples, wav->num_channels, wav->sample_rate_hz, /*bitrate=*/3200,
+      /*enable_preprocessing=*/false, /*enable_dtx=*/false, model_path_,
+      /*num_hops_per_chunk=*/25, /*num_threads=*/1);
+  const auto four_threads = EncodeWavInChunks(
+      wav->samples, wav->num_channels, wav->sample_rate_hz, /*bitrate=*/3200,
+      /*enable_preprocessing=*/false, /*enable_dtx=*/false, model_path_,
+      /*num_hops_per_chunk=*/25, /*num_threads=*/4);
+  ASSERT_TRUE(one_thread.has_value());
+  ASSERT_TRUE(four_threads.has_value());
+  EXPECT_EQ(*one_thread, *four_threads);
+}
+
+TEST_F(EncoderMainLibTest, ChunkedEncodingMatchesSerialEncoding) {
+  constexpr int kBitrate = 3200;
+  constexpr int kNumHopsPerChunk = 25;
+  for (const auto wav_file : kWavFiles) {
+    const auto wav = Read16BitWavFileToVector(
+        (testdata_dir_ / wav_file).concat(".wav").string());
+    ASSERT_TRUE(wav.ok());
+
+    std::vector<uint8_t> serial;
+    ASSERT_TRUE(EncodeWav(wav->samples, wav->num_channels,
+                          wav->sample_rate_hz, kBitrate,
+                          /*enable_preprocessing=*/false,
+                          /*enable_dtx=*/false, model_path_, &serial));
+    const auto chunked = EncodeWavInChunks(
+        wav->samples, wav->num_channels, wav->sample_rate_hz, kBitrate,
+        /*enable_preprocessing=*/false, /*enable_dtx=*/false, model_path_,
+        kNumHopsPerChunk, /*num_threads=*/4);
+    ASSERT_TRUE(chunked.has_value());
+
+    const int packet_size = BitrateToPacketSize(kBitrate);
+    ASSERT_EQ(serial.size(), chunked->size() * packet_size);
+    ASSERT_GT(chunked->size(), 2 * kNumHopsPerChunk) << wav_file;
+    int num_different_packets = 0;
+    int num_different_bits = 0;
+    for (int hop = 0; hop < chunked->size(); ++hop) {
+      const std::vector<uint8_t>& packet = (*chunked)[hop];
+      ASSERT_EQ(packet.size(), packet_size);
+      int num_packet_different_bits = 0;
+      for (int i = 0; i < packet_size; ++i) {
+        num_packet_different_bits +=
+            std::bitset<8>(packet[i] ^ serial[hop * packet_size + i]).count();
+      }
+      // The first chunk is encoded exactly like the serial stream.
+      if (hop < kNumHopsPerChunk) {
+        EXPECT_EQ(num_packet_different_bits, 0) << wav_file << " hop " << hop;
+      }
+      num_different_packets += num_packet_different_bits > 0;
+      num_different_bits += num_packet_different_bits;
+    }
+    const float packet_difference =
+        static_cast<float>(num_different_packets) / chunked->size();
+    const float bit_difference =
+        static_cast<float>(num_different_bits) / (serial.size() * 8);
+    RecordProperty(absl::StrCat(wav_file, "_packet_difference"),
+                   absl::StrCat(packet_difference));
+    RecordProperty(absl::StrCat(wav_file, "_bit_difference"),
+                   absl::StrCat(bit_difference));
+    // The pre-roll lets the chunk encoders converge, so the stitched stream
+    // stays close to the serial one.
+    EXPECT_LE(bit_difference, 0.02f) << wav_file;
+  }
+}
+
+TEST_F(EncoderMainLibTest, ChunkedEncodingFailsWithInvalidArguments) {
+  const std::vector<int16_t> wav_data(16000);
+  EXPECT_FALSE(EncodeWavInChunks(wav_data, /*num_channels=*/1,
+                                 /*sample_rate_hz=*/16000, /*bitrate=*/3200,
+                                 /*enable_preprocessing=*/false,
+                                 /*enable_dtx=*/false, model_path_,
+                                 /*num_hops_per_chunk=*/0, /*num_threads=*/1)
+                   .has_value());
+  EXPECT_FALSE(EncodeWavInChunks(wav_data, /*num_channels=*/1,
+                                 /*sample_rate_hz=*/16000, /*bitrate=*/3200,
+                                 /*enable_preprocessing=*/false,
+                                 /*enable_dtx=*/false, model_path_,
+                                 /*num_hops_per_chunk=*/10, /*num_threads=*/0)
+                   .has_value());
+  EXPECT_FALSE(EncodeWavInChunks(wav_data, /*num_channels=*/1,
+                                 /*sample_rate_hz=*/44100, /*bitrate=*/3200,
+                                 /*enable_preprocessing=*/false,
+                                 /*enable_dtx=*/false, model_path_,
+                                 /*num_hops_per_chunk=*/10, /*num_threads=*/1)
+                   .has_value());
+}
+
+TEST_F(EncoderMainLibTest, EncodeStreamMatchesEncodeWav) {
+  const ghc::filesystem::path wav_path = testdata_dir_ / "sample1_16kHz.wav";
+  const auto wav = Read16BitWavFileToVector(wav_path.string());
+  ASSERT_TRUE(wav.ok());
+  std::vector<uint8_t> expected;
+  ASSERT_TRUE(EncodeWav(wav->samples, wav->num_channels, wav->sample_rate_hz,
+                        /*bitrate=*/6000, /*enable_preprocessing=*/false,
+                        /*enable_dtx=*/false, model_path_, &expected));
+  const std::string expected_bytes(expected.begin(), expected.end());
+
+  // A wav stream.
+  std::ifstream wav_stream(wav_path.string(), std::ios_base::binary);
+  std::ostringstream from_wav;
+  ASSERT_TRUE(EncodeStream(&wav_stream, &from_wav,
+                           /*raw_sample_rate_hz=*/std::nullopt,
+                           /*bitrate=*/6000, /*enable_preprocessing=*/false,
+                           model_path_));
+  EXPECT_EQ(from_wav.str(), expected_bytes);
+
+  // The same samples without a header.
+  std::string raw_samples;
+  for (const int16_t sample : wav->samples) {
+    raw_samples.push_back(static_cast<char>(sample & 0xFF));
+    raw_samples.push_back(static_cast<char>((sample >> 8) & 0xFF));
+  }
+  std::istringstream raw_stream(raw_samples);
+  std::ostringstream from_raw;
+  ASSERT_TRUE(EncodeStream(&raw_stream, &from_raw, wav->sample_rate_hz,
+                           /*bitrate=*/6000, /*enable_preprocessing=*/false,
+                           model_path_));
+  EXPECT_EQ(from_raw.str(), expected_bytes);
+}
+
+TEST_F(EncoderMainLibTest, EncodeStreamRejectsInvalidInput) {
+  std::istringstream not_wav("not a wav stream");
+  std::ostringstream output;
+  EXPECT_FALSE(EncodeStream(&not_wav, &output,
+                            /*raw_sample_rate_hz=*/std::nullopt,
+                            /*bitrate=*/3200, /*enable_preprocessing=*/false,
+                            model_path_));
+
+  std::istringstream raw("\x01\x02\x03\x04");
+  EXPECT_FALSE(EncodeStream(&raw, &output, /*raw_sample_rate_hz=*/44100,
+                            /*bitrate=*/3200, /*enable_preprocessing=*/false,
+                            model_path_));
+}
+
 }  // namespace
 }  // namespace codec
 }  // namespace chromemedia
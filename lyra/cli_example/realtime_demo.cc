@@ -4,6 +4,7 @@
 #include <memory>
 #include <string>
 #include <algorithm> // For std::copy and std::fill
+#include <cstdlib>
 
 #include "portaudio.h"
 #include "absl/types/span.h" // Needed for absl::MakeConstSpan
@@ -11,6 +12,7 @@
 #include "lyra/lyra_encoder.h"
 #include "lyra/lyra_decoder.h"
 #include "lyra/lyra_config.h"
+#include "lyra/tracing.h"
 
 using chromemedia::codec::LyraDecoder;
 using chromemedia::codec::LyraEncoder;
@@ -53,6 +55,8 @@ static int audioCallback(const void* inputBuffer, void* outputBuffer,
                          void* userData) {
     const int16_t* in = reinterpret_cast<const int16_t*>(inputBuffer);
     int16_t* out = reinterpret_cast<int16_t*>(outputBuffer);
+    LYRA_TRACE_THREAD_NAME("audio");
+    LYRA_TRACE_SCOPE("audioCallback");
 
     // 1. 编码
     std::optional<std::vector<uint8_t>> encoded = encoder->Encode(
@@ -101,6 +105,18 @@ int main() {
     }
     std::cout << "Lyra 编解码器初始化成功。" << std::endl;
 
+    // The audio callback names its thread without allocating, whether or not
+    // a trace is recorded.
+    LYRA_TRACE_RESERVE_THREADS(1);
+    // Records a trace into this file, if built with --define=lyra_tracing=1.
+    const char* trace_path = std::getenv("LYRA_TRACE_FILE");
+    if (trace_path != nullptr) {
+        if (!chromemedia::codec::IsTracingCompiledIn()) {
+            std::cerr << "LYRA_TRACE_FILE is set, but tracing is not compiled in." << std::endl;
+        }
+        chromemedia::codec::StartTracing();
+    }
+
     PaStream* stream;
     PaError err;
 
@@ -155,6 +171,13 @@ int main() {
     PA_CHECK(Pa_CloseStream(stream));
 
     Pa_Terminate();
+    if (trace_path != nullptr) {
+        chromemedia::codec::StopTracing();
+        const auto status = chromemedia::codec::WriteChromeTrace(trace_path);
+        if (!status.ok()) {
+            std::cerr << status << std::endl;
+        }
+    }
     std::cout << "程序结束。" << std::endl;
     return 0;
 
@@ -4,13 +4,22 @@
 #include <optional>
 #include <memory>
 #include <thread>
-#include <queue>
-#include <mutex>
-#include <chrono>
+#include <atomic>
+#include <algorithm>
+#include <cstdint>
+#include <utility>
+#include <cstdlib>
 
 #include "portaudio.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "absl/types/span.h"
+#include "lyra/jitter_buffer.h"
 #include "lyra/lyra_decoder.h"
 #include "lyra/lyra_config.h"
+#include "lyra/rtp_payload.h"
+#include "lyra/spsc_ring_buffer.h"
+#include "lyra/tracing.h"
 
 // Platform-specific socket headers
 #ifdef _WIN32
@@ -23,24 +32,55 @@
 #include <unistd.h>
 #endif
 
+using chromemedia::codec::JitterBuffer;
 using chromemedia::codec::LyraDecoder;
+using chromemedia::codec::RtpDepacketizer;
+using chromemedia::codec::RtpFrame;
+using chromemedia::codec::SpscRingBuffer;
 
 // --- 配置常量 ---
 constexpr int kSampleRate = 16000;
 constexpr int kNumChannels = 1;
 constexpr int kFramesPerBuffer = kSampleRate / 50; // 320 frames for 20ms
 
-// --- 线程安全的数据队列 ---
-std::queue<std::vector<uint8_t>> g_jitter_buffer; // Encoded packets
-std::mutex g_jitter_mutex;
-std::queue<int16_t> g_pcm_buffer; // Decoded samples
-std::mutex g_pcm_mutex;
-bool g_finished = false;
+// Large enough for an RTP packet of 120ms of Lyra frames.
+constexpr int kMaxRtpPacketSize = 256;
+// Lyra packets are at most 23 bytes.
+constexpr int kMaxPacketSize = 64;
+// Must match the sender.
+constexpr int kDefaultPacketDurationMs = 60;
+constexpr uint8_t kPayloadType = 96;
+// About a second of packets.
+constexpr int kPacketQueueCapacity = 64;
+// Decoded audio waiting for playback, in frames of kFramesPerBuffer samples.
+// The jitter buffer absorbs network jitter, so this only covers scheduling of
+// the decoder thread.
+constexpr int kPcmQueueFrames = 2;
+// Upper bound of the adaptive jitter buffer delay, in 20ms frames. The lower
+// bound is one RTP packet.
+constexpr int kMaxDelayFrames = 10;
+
+// One Lyra frame of a received RTP packet.
+struct PacketSlot {
+  // Frame index since the first received frame, wrapping at 16 bits.
+  uint16_t sequence_number;
+  int64_t arrival_time_us;
+  int size;
+  uint8_t bytes[kMaxPacketSize];
+};
+
+// --- 无锁单生产者单消费者队列 ---
+// Network thread -> decoder thread.
+std::unique_ptr<SpscRingBuffer<PacketSlot>> g_received_packets;
+// Decoder thread -> audio callback.
+std::unique_ptr<SpscRingBuffer<int16_t>> g_pcm_buffer;
+std::atomic<bool> g_finished{false};
 int g_socket_handle = -1;
 
 // --- 网络线程函数 ---
 // 接收 UDP 包并放入抖动缓冲器
 void network_thread_func(int port) {
+    LYRA_TRACE_THREAD_NAME("network");
 #ifdef _WIN32
     WSADATA wsaData;
     if (WSAStartup(MAKEWORD(2, 2), &wsaData) != 0) {
@@ -63,14 +103,49 @@ void network_thread_func(int port) {
     }
 
     std::cout << "Network thread started. Listening on port " << port << std::endl;
+    auto depacketizer = RtpDepacketizer::Create(kSampleRate);
+    const int num_samples_per_hop = kFramesPerBuffer;
+    const int64_t hop_duration_us = 1000000 / chromemedia::codec::kFrameRate;
+    uint8_t rtp_packet[kMaxRtpPacketSize];
+    std::vector<RtpFrame> frames;
+    bool has_first_timestamp = false;
+    uint32_t first_timestamp = 0;
+    PacketSlot slot;
     while(!g_finished) {
-        std::vector<uint8_t> buffer(256);
-        int bytes_received = recvfrom(g_socket_handle, reinterpret_cast<char*>(buffer.data()),
-                                    buffer.size(), 0, nullptr, nullptr);
-        if(bytes_received > 0) {
-            buffer.resize(bytes_received);
-            std::lock_guard<std::mutex> lock(g_jitter_mutex);
-            g_jitter_buffer.push(buffer);
+        int bytes_received = recvfrom(g_socket_handle, reinterpret_cast<char*>(rtp_packet),
+                                    sizeof(rtp_packet), 0, nullptr, nullptr);
+        if(bytes_received <= 0) {
+            continue;
+        }
+        LYRA_TRACE_SCOPE("Receive packet");
+        // Stamped here rather than by the decoder thread, so that queueing
+        // does not add to the measured jitter.
+        const int64_t arrival_time_us = absl::ToUnixMicros(absl::Now());
+        const auto header = depacketizer->Depacketize(
+            absl::MakeConstSpan(rtp_packet, bytes_received), &frames);
+        if(!header || header->payload_type != kPayloadType) {
+            continue;
+        }
+        if(!has_first_timestamp) {
+            has_first_timestamp = true;
+            first_timestamp = header->timestamp;
+        }
+        for(int i = 0; i < frames.size(); ++i) {
+            // Frames skipped by DTX are left for the jitter buffer to conceal.
+            if(frames[i].packet.empty() || frames[i].packet.size() > kMaxPacketSize) {
+                continue;
+            }
+            slot.sequence_number = static_cast<int32_t>(frames[i].timestamp - first_timestamp) /
+                                   num_samples_per_hop;
+            // All frames of an RTP packet arrive together, but were encoded one
+            // hop apart. Backdating the earlier ones keeps the bundling out of
+            // the jitter estimate.
+            slot.arrival_time_us = arrival_time_us -
+                                   static_cast<int64_t>(frames.size() - 1 - i) * hop_duration_us;
+            slot.size = frames[i].packet.size();
+            std::copy(frames[i].packet.begin(), frames[i].packet.end(), slot.bytes);
+            // Dropped if the decoder has fallen a whole queue behind.
+            g_received_packets->Write(absl::MakeConstSpan(&slot, 1));
         }
     }
 #ifdef _WIN32
@@ -84,31 +159,31 @@ void network_thread_func(int port) {
 
 // --- 解码线程函数 ---
 // 从抖动缓冲器取出数据，解码后放入 PCM 缓冲
-void decoder_thread_func(LyraDecoder* decoder) {
-    while(!g_finished) {
-        std::vector<uint8_t> encoded_packet;
-        {
-            std::lock_guard<std::mutex> lock(g_jitter_mutex);
-            if(!g_jitter_buffer.empty()) {
-                encoded_packet = g_jitter_buffer.front();
-                g_jitter_buffer.pop();
-            }
+// Runs on the playout clock of the audio device: whenever the callback has
+// made room for a frame, the received packets are handed to the jitter buffer
+// and it plays out the next frame, concealing it if its packet is missing.
+void decoder_thread_func(JitterBuffer* jitter_buffer) {
+    LYRA_TRACE_THREAD_NAME("decoder");
+    PacketSlot received;
+    int16_t decoded[kFramesPerBuffer];
+    // Returns false once the queue is closed.
+    while(g_pcm_buffer->WaitForSpace(kFramesPerBuffer)) {
+        LYRA_TRACE_SCOPE("Playout");
+        while(g_received_packets->Read(absl::MakeSpan(&received, 1)) == 1) {
+            jitter_buffer->InsertPacket(received.sequence_number,
+                                        absl::MakeConstSpan(received.bytes, received.size),
+                                        absl::FromUnixMicros(received.arrival_time_us));
         }
-        if(!encoded_packet.empty()) {
-            if(decoder->SetEncodedPacket(encoded_packet)) {
-                auto decoded = decoder->DecodeSamples(kFramesPerBuffer);
-                if(decoded.has_value()) {
-                    std::lock_guard<std::mutex> lock(g_pcm_mutex);
-                    for(int16_t sample : decoded.value()) {
-                        g_pcm_buffer.push(sample);
-                    }
-                }
-            }
-        }else {
-            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        if(!jitter_buffer->Playout(absl::MakeSpan(decoded))) {
+            break;
         }
+        g_pcm_buffer->Write(absl::MakeConstSpan(decoded));
     }
-    std::cout << "Decoder thread finished.\n";
+    const auto& stats = jitter_buffer->stats();
+    std::cout << "Decoder thread finished. Decoded " << stats.num_hops_decoded
+              << " frames, concealed " << stats.num_hops_concealed + stats.num_hops_expanded
+              << ", dropped " << stats.num_packets_late + stats.num_packets_discarded
+              << " late packets.\n";
 }
 
 // --- PortAudio 回调函数 ---
@@ -119,37 +194,57 @@ static int audioCallback(const void* inputBuffer, void* outputBuffer,
                          PaStreamCallbackFlags statusFlags,
                          void* userData) {
     auto* out = reinterpret_cast<int16_t*>(outputBuffer);
-    std::lock_guard<std::mutex> lock(g_pcm_mutex);
-    
-    for (int i = 0; i < frameCount; ++i) {
-        if (!g_pcm_buffer.empty()) {
-            out[i] = g_pcm_buffer.front();
-            g_pcm_buffer.pop();
-        } else {
-            // Underrun: Play silence if no data is available
-            out[i] = 0;
-        }
+    LYRA_TRACE_THREAD_NAME("audio");
+    LYRA_TRACE_SCOPE("audioCallback");
+    // Lock-free, so the audio thread never waits on the decoder thread.
+    const int num_read = g_pcm_buffer->Read(absl::MakeSpan(out, frameCount));
+    if (num_read < frameCount) {
+        LYRA_TRACE_INSTANT("PCM underrun");
     }
+    // Underrun: Play silence if no data is available
+    std::fill(out + num_read, out + frameCount, 0);
     return paContinue;
 }
 
 int main(int argc, char* argv[]) {
-    if (argc != 2) {
-        std::cerr << "Usage: " << argv[0] << " <listen_port>\n";
+    if (argc != 2 && argc != 3) {
+        std::cerr << "Usage: " << argv[0] << " <listen_port> [ptime_ms]\n";
         return 1;
     }
     const int port = std::stoi(argv[1]);
+    const int packet_duration_ms = argc == 3 ? std::stoi(argv[2]) : kDefaultPacketDurationMs;
     const std::string model_path = "lyra/model_coeffs";
+    // The audio callback names its thread without allocating, whether or not
+    // a trace is recorded.
+    LYRA_TRACE_RESERVE_THREADS(1);
+    // Records a trace into this file, if built with --define=lyra_tracing=1.
+    const char* trace_path = std::getenv("LYRA_TRACE_FILE");
+    if (trace_path != nullptr) {
+        if (!chromemedia::codec::IsTracingCompiledIn()) {
+            std::cerr << "LYRA_TRACE_FILE is set, but tracing is not compiled in.\n";
+        }
+        chromemedia::codec::StartTracing();
+    }
 
     // 1. 初始化Lyra解码器
     auto decoder = LyraDecoder::Create(kSampleRate, kNumChannels, model_path);
     if (!decoder) {
         std::cerr << "Failed to create Lyra decoder.\n"; return 1;
     }
+    // Frames arrive a whole RTP packet at a time, so at least that much has to
+    // be buffered.
+    const int min_delay_frames = std::max(1, packet_duration_ms / 20);
+    auto jitter_buffer = JitterBuffer::Create(std::move(decoder), min_delay_frames,
+                                              std::max(min_delay_frames, kMaxDelayFrames));
+    if (!jitter_buffer) {
+        std::cerr << "Failed to create jitter buffer.\n"; return 1;
+    }
 
     // 2. 启动网络和解码线程
+    g_received_packets = SpscRingBuffer<PacketSlot>::Create(kPacketQueueCapacity);
+    g_pcm_buffer = SpscRingBuffer<int16_t>::Create(kPcmQueueFrames * kFramesPerBuffer);
     std::thread network_thread(network_thread_func, port);
-    std::thread decoder_thread(decoder_thread_func, decoder.get());
+    std::thread decoder_thread(decoder_thread_func, jitter_buffer.get());
 
         // 3. 初始化 PortAudio (仅输出)
     Pa_Initialize();
@@ -179,12 +274,22 @@ int main(int argc, char* argv[]) {
 #endif
 
     network_thread.join();
+    // Wake the decoder thread wherever it is waiting.
+    g_received_packets->Close();
+    g_pcm_buffer->Close();
     decoder_thread.join();
     
     Pa_StopStream(stream);
     Pa_CloseStream(stream);
     Pa_Terminate();
-    
+
+    if (trace_path != nullptr) {
+        chromemedia::codec::StopTracing();
+        const auto status = chromemedia::codec::WriteChromeTrace(trace_path);
+        if (!status.ok()) {
+            std::cerr << status << "\n";
+        }
+    }
     std::cout << "Receiver finished.\n";
     return 0;
 
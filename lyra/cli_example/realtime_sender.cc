@@ -4,14 +4,18 @@
 #include <optional>
 #include <memory>
 #include <thread>
-#include <queue>
-#include <mutex>
-#include <chrono>
+#include <algorithm>
+#include <cstdint>
+#include <random>
+#include <cstdlib>
 
 #include "portaudio.h"
 #include "absl/types/span.h"
-#include "lyra/lyra_encoder.h"
+#include "lyra/lyra_stream_encoder.h"
 #include "lyra/lyra_config.h"
+#include "lyra/rtp_payload.h"
+#include "lyra/spsc_ring_buffer.h"
+#include "lyra/tracing.h"
 
 // Platform-specific socket headers
 #ifdef _WIN32
@@ -25,37 +29,70 @@
 #include <unistd.h>
 #endif
 
-using chromemedia::codec::LyraEncoder;
+using chromemedia::codec::LyraStreamEncoder;
 using chromemedia::codec::GetBitrate;
+using chromemedia::codec::RtpPacketizer;
+using chromemedia::codec::SpscRingBuffer;
 
 constexpr int kSampleRate = 16000;
 constexpr int kNumChannels = 1;
 constexpr int kBitrate = 3200; // 3.2 kbps, Lyra V2's lowest bitrate
 constexpr int kFramesPerBuffer = kSampleRate / 50; // 320 frames for 20ms
 
-std::queue<std::vector<uint8_t>> g_encoded_packets_queue;
-std::mutex g_queue_mutex;
-bool g_finished = false;
+// Bundling several 20ms frames per RTP packet saves most of the 40 bytes of
+// IP/UDP/RTP headers per frame, at the cost of latency.
+constexpr int kDefaultPacketDurationMs = 60;
+// Dynamic RTP payload type.
+constexpr uint8_t kPayloadType = 96;
+// Large enough for an RTP packet of 120ms of Lyra frames.
+constexpr int kMaxPacketSize = 256;
+// About a second of packets.
+constexpr int kPacketQueueCapacity = 64;
+
+struct PacketSlot {
+  int size;
+  uint8_t bytes[kMaxPacketSize];
+};
+
+// Written by the audio callback and read by the network thread.
+std::unique_ptr<SpscRingBuffer<PacketSlot>> g_encoded_packets;
+// Only touched by the audio callback, and by main after the stream stopped.
+std::unique_ptr<RtpPacketizer> g_packetizer;
+
+static void push_rtp_packet(absl::Span<const uint8_t> rtp_packet) {
+  PacketSlot slot;
+  slot.size = rtp_packet.size();
+  std::copy(rtp_packet.begin(), rtp_packet.end(), slot.bytes);
+  // Never blocks the audio thread. If the network thread has fallen a whole
+  // queue behind, the packet is dropped.
+  g_encoded_packets->Write(absl::MakeConstSpan(&slot, 1));
+}
 
+static void push_packet(absl::Span<const uint8_t> packet) {
+  // Frames skipped by DTX are marked in the table of contents, and RTP
+  // packets of only such frames are not sent at all.
+  g_packetizer->AddFrame(packet, push_rtp_packet);
+}
 
 static int audioCallback(const void* inputBuffer, void* outputBuffer,
                          unsigned long frameCount,
                          const PaStreamCallbackTimeInfo* timeInfo,
                          PaStreamCallbackFlags statusFlags, void* userData) {
-  auto* encoder = reinterpret_cast<LyraEncoder*>(userData);
+  auto* encoder = reinterpret_cast<LyraStreamEncoder*>(userData);
   const auto* in = reinterpret_cast<const int16_t*>(inputBuffer);
+  LYRA_TRACE_THREAD_NAME("audio");
+  LYRA_TRACE_SCOPE("audioCallback");
 
-  std::optional<std::vector<uint8_t>> encoded = encoder->Encode(absl::MakeConstSpan(in, frameCount));
-  if(encoded.has_value()) {
-    std::lock_guard<std::mutex> lock(g_queue_mutex);
-    g_encoded_packets_queue.push(encoded.value());
-  }
+  // The stream encoder buffers across callbacks, so frameCount does not have
+  // to be a whole 20ms frame.
+  encoder->Encode(absl::MakeConstSpan(in, frameCount), push_packet);
   return paContinue;
 }
 
 // 网络线程函数
 // 从队列中取出数据包并通过UDP发送
 void network_thread_func(const std::string& server_ip, int port) {
+  LYRA_TRACE_THREAD_NAME("network");
   #ifdef _WIN32
     WSADATA wsaData;
     if (WSAStartup(MAKEWORD(2, 2), &wsaData) != 0) {
@@ -74,24 +111,14 @@ void network_thread_func(const std::string& server_ip, int port) {
     inet_pton(AF_INET, server_ip.c_str(), &server_address.sin_addr);
     std::cout << "Network thread started. Sending to " << server_ip << ":" << port << std::endl;
 
-    while(!g_finished) {
-      std::vector<uint8_t> packet_to_send;
-      {
-        std::lock_guard<std::mutex> lock(g_queue_mutex);
-        if(!g_encoded_packets_queue.empty()) {
-          packet_to_send = g_encoded_packets_queue.front();
-          g_encoded_packets_queue.pop();
-        }
-      }
-
-      if(!packet_to_send.empty()) {
-        sendto(sock, reinterpret_cast<const char*>(packet_to_send.data()), packet_to_send.size(),
-                             0, (const struct sockaddr*)&server_address, sizeof(server_address));
-      } else {
-        // 等待一会儿
-        std::this_thread::sleep_for(std::chrono::milliseconds(5));
-      }
-      
+    // Sleeps until a packet is queued. Returns false once the queue has been
+    // closed and drained.
+    PacketSlot packet_to_send;
+    while(g_encoded_packets->WaitForItems(1)) {
+      LYRA_TRACE_SCOPE("sendto");
+      g_encoded_packets->Read(absl::MakeSpan(&packet_to_send, 1));
+      sendto(sock, reinterpret_cast<const char*>(packet_to_send.bytes), packet_to_send.size,
+                           0, (const struct sockaddr*)&server_address, sizeof(server_address));
     }
 #ifdef _WIN32
     closesocket(sock);
@@ -103,22 +130,43 @@ void network_thread_func(const std::string& server_ip, int port) {
 }
 
 int main(int argc, char* argv[]) {
-  if (argc != 3) {
-      std::cerr << "Usage: " << argv[0] << " <server_ip> <port>\n";
+  if (argc != 3 && argc != 4) {
+      std::cerr << "Usage: " << argv[0] << " <server_ip> <port> [ptime_ms]\n";
       return 1;
   }
   const std::string server_ip = argv[1];
   const int port = std::stoi(argv[2]);
+  const int packet_duration_ms = argc == 4 ? std::stoi(argv[3]) : kDefaultPacketDurationMs;
   const std::string model_path = "lyra/model_coeffs";
+  // The audio callback names its thread without allocating, whether or not
+  // a trace is recorded.
+  LYRA_TRACE_RESERVE_THREADS(1);
+  // Records a trace into this file, if built with --define=lyra_tracing=1.
+  const char* trace_path = std::getenv("LYRA_TRACE_FILE");
+  if (trace_path != nullptr) {
+    if (!chromemedia::codec::IsTracingCompiledIn()) {
+      std::cerr << "LYRA_TRACE_FILE is set, but tracing is not compiled in.\n";
+    }
+    chromemedia::codec::StartTracing();
+  }
 
   // 1. 初始化编码器
-  auto encoder = LyraEncoder::Create(kSampleRate, kNumChannels, kBitrate, false, model_path);
+  auto encoder = LyraStreamEncoder::Create(kSampleRate, kNumChannels, kBitrate, false, model_path);
   if(!encoder) {
     std::cerr << "Failed to create Lyra encoder.\n";
     return 1;
   }
+  // RFC 3550 asks for a random SSRC, initial sequence number and timestamp.
+  std::random_device random;
+  g_packetizer = RtpPacketizer::Create(packet_duration_ms, kSampleRate, kPayloadType,
+                                       random(), random(), random());
+  if(!g_packetizer) {
+    std::cerr << "Failed to create RTP packetizer.\n";
+    return 1;
+  }
   
   // 2. 启动网络线程
+  g_encoded_packets = SpscRingBuffer<PacketSlot>::Create(kPacketQueueCapacity);
   std::thread network_thread(network_thread_func, server_ip, port);
 
   // 3. 初始化 PortAudio
@@ -138,12 +186,23 @@ int main(int argc, char* argv[]) {
     std::cin.get();
 
     // 4. 清理
-    g_finished = true;
     Pa_StopStream(stream);
     Pa_CloseStream(stream);
     Pa_Terminate();
+    // Send the last partial frame, padded with silence, and whatever frames
+    // are waiting for a full RTP packet.
+    encoder->Flush(push_packet);
+    g_packetizer->Flush(push_rtp_packet);
+    g_encoded_packets->Close();
     network_thread.join();
 
+    if (trace_path != nullptr) {
+      chromemedia::codec::StopTracing();
+      const auto status = chromemedia::codec::WriteChromeTrace(trace_path);
+      if (!status.ok()) {
+        std::cerr << status << "\n";
+      }
+    }
     std::cout << "Sender finished.\n";
     return 0;
 }
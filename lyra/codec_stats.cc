@@ -0,0 +1,83 @@
+// Copyright 2022 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "lyra/codec_stats.h"
+
+#include <cstdint>
+#include <string>
+
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_format.h"
+#include "absl/time/time.h"
+#include "lyra/codec_stats_sink_interface.h"
+#include "lyra/latency_histogram.h"
+
+namespace chromemedia {
+namespace codec {
+
+CodecStats::CodecStats() {
+  // Sinks are called from the codec's hot path, so the histograms must not
+  // grow there.
+  stage_latencies_ns_.fill(LatencyHistogram(kMaxExpectedStageLatencyNs));
+}
+
+void CodecStats::RecordStage(CodecStage stage, absl::Duration duration) {
+  stage_latencies_ns_[static_cast<int>(stage)].Record(
+      absl::ToInt64Nanoseconds(duration));
+}
+
+void CodecStats::RecordEvent(CodecEvent event) {
+  ++event_counts_[static_cast<int>(event)];
+}
+
+absl::Duration CodecStats::total_duration() const {
+  double total_ns = 0;
+  for (const LatencyHistogram& latencies : stage_latencies_ns_) {
+    total_ns += latencies.mean() * latencies.num_values();
+  }
+  return absl::Nanoseconds(total_ns);
+}
+
+void CodecStats::Reset() {
+  for (LatencyHistogram& latencies : stage_latencies_ns_) {
+    latencies.Clear();
+  }
+  event_counts_.fill(0);
+}
+
+std::string CodecStats::ToString() const {
+  std::string result;
+  for (int i = 0; i < stage_latencies_ns_.size(); ++i) {
+    const LatencyHistogram& latencies = stage_latencies_ns_[i];
+    if (latencies.num_values() == 0) {
+      continue;
+    }
+    absl::StrAppendFormat(
+        &result, "%16s: calls: %d  mean: %.3f us  p50: %.3f us  p99: %.3f us  "
+        "max: %.3f us\n",
+        CodecStageName(static_cast<CodecStage>(i)), latencies.num_values(),
+        latencies.mean() / 1e3, latencies.Percentile(50) / 1e3,
+        latencies.Percentile(99) / 1e3, latencies.max() / 1e3);
+  }
+  for (int i = 0; i < event_counts_.size(); ++i) {
+    absl::StrAppend(&result, i == 0 ? "" : "  ",
+                    CodecEventName(static_cast<CodecEvent>(i)), ": ",
+                    event_counts_[i]);
+  }
+  absl::StrAppend(&result, "\n");
+  return result;
+}
+
+}  // namespace codec
+}  // namespace chromemedia
@@ -0,0 +1,78 @@
+/*
+ * Copyright 2022 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LYRA_CODEC_STATS_H_
+#define LYRA_CODEC_STATS_H_
+
+#include <array>
+#include <cstdint>
+#include <string>
+
+#include "absl/time/time.h"
+#include "lyra/codec_stats_sink_interface.h"
+#include "lyra/latency_histogram.h"
+
+namespace chromemedia {
+namespace codec {
+
+// A stats sink which keeps a latency histogram per stage and a count per
+// event. Use one per encoder or decoder; it is not thread-safe, just like the
+// codec itself.
+//
+//   CodecStats stats;
+//   decoder->set_stats_sink(&stats);
+//   ...
+//   LOG(INFO) << stats.ToString();
+class CodecStats : public CodecStatsSinkInterface {
+ public:
+  // Latencies up to this long are recorded without allocating.
+  static constexpr int64_t kMaxExpectedStageLatencyNs = 10'000'000'000;
+
+  CodecStats();
+
+  void RecordStage(CodecStage stage, absl::Duration duration) override;
+
+  void RecordEvent(CodecEvent event) override;
+
+  // Latencies of |stage| in nanoseconds.
+  const LatencyHistogram& stage_latency_ns(CodecStage stage) const {
+    return stage_latencies_ns_[static_cast<int>(stage)];
+  }
+
+  int64_t event_count(CodecEvent event) const {
+    return event_counts_[static_cast<int>(event)];
+  }
+
+  // Sum of the recorded durations of all stages.
+  absl::Duration total_duration() const;
+
+  void Reset();
+
+  // One line per stage that was recorded with the number of calls and the
+  // mean, p50, p99 and max latency, followed by the event counts.
+  std::string ToString() const;
+
+ private:
+  std::array<LatencyHistogram, static_cast<int>(CodecStage::kNumStages)>
+      stage_latencies_ns_;
+  std::array<int64_t, static_cast<int>(CodecEvent::kNumEvents)>
+      event_counts_ = {};
+};
+
+}  // namespace codec
+}  // namespace chromemedia
+
+#endif  // LYRA_CODEC_STATS_H_
@@ -0,0 +1,148 @@
+/*
+ * Copyright 2022 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LYRA_CODEC_STATS_SINK_INTERFACE_H_
+#define LYRA_CODEC_STATS_SINK_INTERFACE_H_
+
+#include <chrono>  // NOLINT(build/c++11)
+
+#include "absl/time/time.h"
+
+namespace chromemedia {
+namespace codec {
+
+// The stages of the encoder and decoder hot paths which are timed.
+enum class CodecStage {
+  kResample,
+  kExtractFeatures,
+  kQuantize,
+  kPack,
+  kUnpack,
+  kDequantize,
+  kGenerativeModel,
+  kComfortNoise,
+  kNoiseEstimation,
+  kNumStages,
+};
+
+// Events which are counted once per occurrence.
+enum class CodecEvent {
+  // A hop of the generative model conditioned on estimated features, because
+  // no packet was received for it.
+  kConcealedHop,
+  // A hop of comfort noise, whether faded in or played out alone.
+  kComfortNoiseHop,
+  // A hop the encoder did not send because DTX classified it as noise.
+  kDtxFrame,
+  // A change of direction of the fade between the generative model and
+  // comfort noise.
+  kFadeTransition,
+  kNumEvents,
+};
+
+// Returns a short lower case name like "generative_model", for logs.
+inline const char* CodecStageName(CodecStage stage) {
+  switch (stage) {
+    case CodecStage::kResample:
+      return "resample";
+    case CodecStage::kExtractFeatures:
+      return "extract_features";
+    case CodecStage::kQuantize:
+      return "quantize";
+    case CodecStage::kPack:
+      return "pack";
+    case CodecStage::kUnpack:
+      return "unpack";
+    case CodecStage::kDequantize:
+      return "dequantize";
+    case CodecStage::kGenerativeModel:
+      return "generative_model";
+    case CodecStage::kComfortNoise:
+      return "comfort_noise";
+    case CodecStage::kNoiseEstimation:
+      return "noise_estimation";
+    case CodecStage::kNumStages:
+      break;
+  }
+  return "unknown";
+}
+
+inline const char* CodecEventName(CodecEvent event) {
+  switch (event) {
+    case CodecEvent::kConcealedHop:
+      return "concealed_hops";
+    case CodecEvent::kComfortNoiseHop:
+      return "comfort_noise_hops";
+    case CodecEvent::kDtxFrame:
+      return "dtx_frames";
+    case CodecEvent::kFadeTransition:
+      return "fade_transitions";
+    case CodecEvent::kNumEvents:
+      break;
+  }
+  return "unknown";
+}
+
+// Receives the stage durations and events of one encoder or decoder. It is
+// called on the thread that calls into the codec, inside the hot path, so
+// implementations should be cheap and must not block.
+class CodecStatsSinkInterface {
+ public:
+  virtual ~CodecStatsSinkInterface() {}
+
+  virtual void RecordStage(CodecStage stage, absl::Duration duration) = 0;
+
+  virtual void RecordEvent(CodecEvent event) = 0;
+};
+
+// Times its scope as |stage| if |sink| is not nullptr. Without a sink it does
+// not read the clock, so instrumentation costs a branch when disabled.
+class ScopedStageTimer {
+ public:
+  ScopedStageTimer(CodecStatsSinkInterface* sink, CodecStage stage)
+      : sink_(sink), stage_(stage) {
+    if (sink_ != nullptr) {
+      start_ = std::chrono::steady_clock::now();
+    }
+  }
+
+  ~ScopedStageTimer() {
+    if (sink_ != nullptr) {
+      sink_->RecordStage(
+          stage_, absl::FromChrono(std::chrono::steady_clock::now() - start_));
+    }
+  }
+
+  ScopedStageTimer(const ScopedStageTimer&) = delete;
+  ScopedStageTimer& operator=(const ScopedStageTimer&) = delete;
+
+ private:
+  CodecStatsSinkInterface* const sink_;
+  const CodecStage stage_;
+  std::chrono::steady_clock::time_point start_;
+};
+
+// Records |event| if |sink| is not nullptr.
+inline void RecordCodecEvent(CodecStatsSinkInterface* sink, CodecEvent event) {
+  if (sink != nullptr) {
+    sink->RecordEvent(event);
+  }
+}
+
+}  // namespace codec
+}  // namespace chromemedia
+
+#endif  // LYRA_CODEC_STATS_SINK_INTERFACE_H_
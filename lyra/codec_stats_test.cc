@@ -0,0 +1,110 @@
+// Copyright 2022 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "lyra/codec_stats.h"
+
+#include <string>
+
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "lyra/codec_stats_sink_interface.h"
+
+namespace chromemedia {
+namespace codec {
+namespace {
+
+using testing::HasSubstr;
+using testing::Not;
+
+TEST(CodecStatsTest, StartsEmpty) {
+  CodecStats stats;
+  for (int i = 0; i < static_cast<int>(CodecStage::kNumStages); ++i) {
+    EXPECT_EQ(stats.stage_latency_ns(static_cast<CodecStage>(i)).num_values(),
+              0);
+  }
+  for (int i = 0; i < static_cast<int>(CodecEvent::kNumEvents); ++i) {
+    EXPECT_EQ(stats.event_count(static_cast<CodecEvent>(i)), 0);
+  }
+  EXPECT_EQ(stats.total_duration(), absl::ZeroDuration());
+}
+
+TEST(CodecStatsTest, RecordsStagesAndEvents) {
+  CodecStats stats;
+  stats.RecordStage(CodecStage::kQuantize, absl::Microseconds(3));
+  stats.RecordStage(CodecStage::kQuantize, absl::Microseconds(5));
+  stats.RecordStage(CodecStage::kGenerativeModel, absl::Microseconds(100));
+  stats.RecordEvent(CodecEvent::kConcealedHop);
+  stats.RecordEvent(CodecEvent::kConcealedHop);
+  stats.RecordEvent(CodecEvent::kFadeTransition);
+
+  const LatencyHistogram& quantize =
+      stats.stage_latency_ns(CodecStage::kQuantize);
+  EXPECT_EQ(quantize.num_values(), 2);
+  EXPECT_EQ(quantize.min(), 3000);
+  EXPECT_EQ(quantize.max(), 5000);
+  EXPECT_EQ(stats.stage_latency_ns(CodecStage::kGenerativeModel).num_values(),
+            1);
+  EXPECT_EQ(stats.event_count(CodecEvent::kConcealedHop), 2);
+  EXPECT_EQ(stats.event_count(CodecEvent::kFadeTransition), 1);
+  EXPECT_EQ(stats.event_count(CodecEvent::kDtxFrame), 0);
+  EXPECT_EQ(stats.total_duration(), absl::Microseconds(108));
+
+  const std::string text = stats.ToString();
+  EXPECT_THAT(text, HasSubstr("quantize: calls: 2"));
+  EXPECT_THAT(text, HasSubstr("generative_model: calls: 1"));
+  EXPECT_THAT(text, Not(HasSubstr("resample")));
+  EXPECT_THAT(text, HasSubstr("concealed_hops: 2"));
+  EXPECT_THAT(text, HasSubstr("dtx_frames: 0"));
+
+  stats.Reset();
+  EXPECT_EQ(stats.stage_latency_ns(CodecStage::kQuantize).num_values(), 0);
+  EXPECT_EQ(stats.event_count(CodecEvent::kConcealedHop), 0);
+}
+
+TEST(CodecStatsTest, ScopedStageTimerRecordsOnlyWithSink) {
+  CodecStats stats;
+  {
+    ScopedStageTimer timer(&stats, CodecStage::kResample);
+    absl::SleepFor(absl::Milliseconds(2));
+  }
+  {
+    ScopedStageTimer timer(nullptr, CodecStage::kResample);
+  }
+  RecordCodecEvent(&stats, CodecEvent::kDtxFrame);
+  RecordCodecEvent(nullptr, CodecEvent::kDtxFrame);
+
+  const LatencyHistogram& resample =
+      stats.stage_latency_ns(CodecStage::kResample);
+  EXPECT_EQ(resample.num_values(), 1);
+  EXPECT_GE(resample.min(), 2000000);
+  EXPECT_EQ(stats.event_count(CodecEvent::kDtxFrame), 1);
+}
+
+TEST(CodecStatsTest, NamesAreUnique) {
+  for (int i = 0; i < static_cast<int>(CodecStage::kNumStages); ++i) {
+    for (int j = 0; j < i; ++j) {
+      EXPECT_STRNE(CodecStageName(static_cast<CodecStage>(i)),
+                   CodecStageName(static_cast<CodecStage>(j)));
+    }
+  }
+  for (int i = 0; i < static_cast<int>(CodecEvent::kNumEvents); ++i) {
+    EXPECT_STRNE(CodecEventName(static_cast<CodecEvent>(i)), "unknown");
+  }
+}
+
+}  // namespace
+}  // namespace codec
+}  // namespace chromemedia
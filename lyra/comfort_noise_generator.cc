@@ -14,6 +14,7 @@
 
 #include "lyra/comfort_noise_generator.h"
 
+#include <algorithm>
 #include <cmath>
 #include <complex>
 #include <cstdint>
@@ -31,6 +32,7 @@
 #include "glog/logging.h"  // IWYU pragma: keep
 #include "lyra/dsp_utils.h"
 #include "lyra/log_mel_spectrogram_extractor_impl.h"
+#include "lyra/tracing.h"
 
 namespace chromemedia {
 namespace codec {
@@ -68,53 +70,62 @@ ComfortNoiseGenerator::ComfortNoiseGenerator(
     : GenerativeModel(num_samples_per_hop, num_mel_bins),
       mel_filterbank_(std::move(mel_filterbank)),
       inverse_spectrogram_(std::move(inverse_spectrogram)),
+      mel_features_(num_mel_bins),
       squared_magnitude_fft_(num_samples_per_hop),
+      random_phase_spectrogram_(1),
       reconstructed_samples_(num_samples_per_hop) {}
 
 bool ComfortNoiseGenerator::RunConditioning(
     const std::vector<float>& features) {
+  LYRA_TRACE_SCOPE("ComfortNoiseGenerator::RunConditioning");
   FftFromFeatures(features);
   return InvertFft();
 }
 
-std::optional<std::vector<int16_t>> ComfortNoiseGenerator::RunModel(
-    int num_samples) {
-  return std::vector<int16_t>(
-      reconstructed_samples_.begin() + next_sample_in_hop(),
-      reconstructed_samples_.begin() + next_sample_in_hop() + num_samples);
+bool ComfortNoiseGenerator::RunModel(absl::Span<int16_t> samples) {
+  std::copy(reconstructed_samples_.begin() + next_sample_in_hop(),
+            reconstructed_samples_.begin() + next_sample_in_hop() +
+                samples.size(),
+            samples.begin());
+  return true;
 }
 
 void ComfortNoiseGenerator::FftFromFeatures(
     const std::vector<float>& log_mel_features) {
-  std::vector<double> mel_features(log_mel_features.size());
-  for (int i = 0; i < mel_features.size(); ++i) {
-    mel_features.at(i) = static_cast<double>(
+  LYRA_TRACE_SCOPE("ComfortNoiseGenerator::FftFromFeatures");
+  mel_features_.resize(log_mel_features.size());
+  for (int i = 0; i < mel_features_.size(); ++i) {
+    mel_features_.at(i) = static_cast<double>(
         std::exp(log_mel_features.at(i) *
                  LogMelSpectrogramExtractorImpl::GetNormalizationFactor()));
   }
-  mel_filterbank_->EstimateInverse(mel_features, &squared_magnitude_fft_);
+  mel_filterbank_->EstimateInverse(mel_features_, &squared_magnitude_fft_);
 }
 
 bool ComfortNoiseGenerator::InvertFft() {
+  LYRA_TRACE_SCOPE("ComfortNoiseGenerator::InvertFft");
   // Add random phase to squared-magnitude FFT to make it a complex FFT.
   // InverseSpectrogram class expects a 2D spectrogram, so one containing just
   // one slice is constructed.
-  std::vector<std::vector<std::complex<double>>> random_phase_spectrogram(1);
-  absl::BitGen gen;
+  std::vector<std::complex<double>>& random_phase_slice =
+      random_phase_spectrogram_[0];
+  random_phase_slice.resize(squared_magnitude_fft_.size());
   for (int i = 0; i < squared_magnitude_fft_.size(); ++i) {
     double magnitude = sqrt(squared_magnitude_fft_.at(i));
-    double random_angle = absl::Uniform<double>(gen, 0, 2 * M_PI);
-    random_phase_spectrogram[0].push_back(
-        magnitude * std::exp(std::complex<double>(0.0, 1.0) * random_angle));
+    double random_angle = absl::Uniform<double>(gen_, 0, 2 * M_PI);
+    random_phase_slice[i] =
+        magnitude * std::exp(std::complex<double>(0.0, 1.0) * random_angle);
   }
 
-  std::vector<double> temp_samples;
-  if (!inverse_spectrogram_->Process(random_phase_spectrogram, &temp_samples)) {
+  if (!inverse_spectrogram_->Process(random_phase_spectrogram_,
+                                     &temp_samples_)) {
     return false;
   }
 
   // Store samples in buffer to ensure continuity between samples.
-  reconstructed_samples_ = ClipToInt16(absl::MakeConstSpan(temp_samples));
+  reconstructed_samples_.resize(temp_samples_.size());
+  ClipToInt16(absl::MakeConstSpan(temp_samples_),
+              absl::MakeSpan(reconstructed_samples_));
   return true;
 }
 
@@ -17,11 +17,14 @@
 #ifndef LYRA_COMFORT_NOISE_GENERATOR_H_
 #define LYRA_COMFORT_NOISE_GENERATOR_H_
 
+#include <complex>
 #include <cstdint>
 #include <memory>
 #include <optional>
 #include <vector>
 
+#include "absl/random/random.h"
+#include "absl/types/span.h"
 #include "audio/dsp/mfcc/mel_filterbank.h"
 #include "audio/dsp/spectrogram/inverse_spectrogram.h"
 #include "lyra/generative_model_interface.h"
@@ -48,7 +51,7 @@ class ComfortNoiseGenerator : public GenerativeModel {
 
   bool RunConditioning(const std::vector<float>& features) override;
 
-  std::optional<std::vector<int16_t>> RunModel(int num_samples) override;
+  bool RunModel(absl::Span<int16_t> samples) override;
 
   // Estimates the Squared-Magnitude FFT that corresponds to the Log Mel
   // features. Returns true if the estimation completed successfully and false
@@ -63,8 +66,13 @@ class ComfortNoiseGenerator : public GenerativeModel {
   const std::unique_ptr<const audio_dsp::MelFilterbank> mel_filterbank_;
   const std::unique_ptr<audio_dsp::InverseSpectrogram> inverse_spectrogram_;
 
+  // Buffers reused across hops.
+  std::vector<double> mel_features_;
   std::vector<double> squared_magnitude_fft_;
+  std::vector<std::vector<std::complex<double>>> random_phase_spectrogram_;
+  std::vector<double> temp_samples_;
   std::vector<int16_t> reconstructed_samples_;
+  absl::BitGen gen_;
 };
 
 }  // namespace codec
@@ -0,0 +1,85 @@
+// Copyright 2022 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "absl/random/random.h"
+#include "absl/types/span.h"
+#include "benchmark/benchmark.h"
+#include "lyra/comfort_noise_generator.h"
+#include "lyra/lyra_config.h"
+
+static constexpr int kNumRandVectors = 100;
+
+std::unique_ptr<chromemedia::codec::ComfortNoiseGenerator>
+CreateComfortNoiseGenerator() {
+  return chromemedia::codec::ComfortNoiseGenerator::Create(
+      chromemedia::codec::kInternalSampleRateHz,
+      chromemedia::codec::GetNumSamplesPerHop(
+          chromemedia::codec::kInternalSampleRateHz),
+      chromemedia::codec::GetNumSamplesPerWindow(
+          chromemedia::codec::kInternalSampleRateHz),
+      chromemedia::codec::kNumMelBins);
+}
+
+// Returns random log mel features in the range of a noise estimate.
+std::vector<std::vector<float>> RandomFeatures() {
+  absl::BitGen gen;
+  std::vector<std::vector<float>> features(
+      kNumRandVectors, std::vector<float>(chromemedia::codec::kNumMelBins));
+  for (auto& feature_vector : features) {
+    for (auto& feature : feature_vector) {
+      feature = absl::Uniform(gen, -10.f, 5.f);
+    }
+  }
+  return features;
+}
+
+// Generates one hop of comfort noise from new features per iteration.
+void BM_GenerateSamples(benchmark::State& state) {
+  auto comfort_noise_generator = CreateComfortNoiseGenerator();
+  const std::vector<std::vector<float>> features = RandomFeatures();
+  const int num_samples_per_hop = chromemedia::codec::GetNumSamplesPerHop(
+      chromemedia::codec::kInternalSampleRateHz);
+  int i = 0;
+  for (auto _ : state) {
+    comfort_noise_generator->AddFeatures(features[i]);
+    benchmark::DoNotOptimize(
+        comfort_noise_generator->GenerateSamples(num_samples_per_hop));
+    i = (i + 1) % kNumRandVectors;
+  }
+  state.SetItemsProcessed(state.iterations() * num_samples_per_hop);
+}
+
+// Same as |BM_GenerateSamples| through the non-allocating interface.
+void BM_GenerateSamplesInto(benchmark::State& state) {
+  auto comfort_noise_generator = CreateComfortNoiseGenerator();
+  const std::vector<std::vector<float>> features = RandomFeatures();
+  std::vector<int16_t> samples(chromemedia::codec::GetNumSamplesPerHop(
+      chromemedia::codec::kInternalSampleRateHz));
+  int i = 0;
+  for (auto _ : state) {
+    comfort_noise_generator->AddFeatures(features[i]);
+    benchmark::DoNotOptimize(
+        comfort_noise_generator->GenerateSamplesInto(absl::MakeSpan(samples)));
+    i = (i + 1) % kNumRandVectors;
+  }
+  state.SetItemsProcessed(state.iterations() * samples.size());
+}
+
+BENCHMARK(BM_GenerateSamples);
+BENCHMARK(BM_GenerateSamplesInto);
+BENCHMARK_MAIN();
@@ -72,6 +72,15 @@ ClipToInt16(const absl::Span<const T> input) {
   return output;
 }
 
+// Clips unit-floats or unit-doubles to 16-bit integers in |output|, which
+// must have the same size as |input|. Does not perform scaling.
+template <typename T>
+typename std::enable_if<std::is_floating_point<T>::value>::type ClipToInt16(
+    const absl::Span<const T> input, absl::Span<int16_t> output) {
+  std::transform(input.begin(), input.end(), output.begin(),
+                 ClipToInt16Scalar<T>);
+}
+
 // Converts from a unit-float or unit-double to a 16-bit integer.
 // If |value| is in the [-1, 1) interval it will scale linearly to the
 // int16_t limits.  Values outside the interval are clipped to the limits.
@@ -100,6 +109,15 @@ UnitToInt16(const absl::Span<const T> input) {
   return output;
 }
 
+// Converts unit-floats or unit-doubles to 16-bit integers in |output|, which
+// must have the same size as |input|.
+template <typename T>
+typename std::enable_if<std::is_floating_point<T>::value>::type UnitToInt16(
+    const absl::Span<const T> input, absl::Span<int16_t> output) {
+  std::transform(input.begin(), input.end(), output.begin(),
+                 UnitToInt16Scalar<T>);
+}
+
 // Converts from a 16-bit integers to a unit-floats or unit-doubles.
 template <typename T>
 typename std::enable_if<std::is_floating_point<T>::value, T>::type
@@ -0,0 +1,83 @@
+// Copyright 2022 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <cstdint>
+#include <vector>
+
+#include "absl/random/random.h"
+#include "absl/types/span.h"
+#include "benchmark/benchmark.h"
+#include "lyra/dsp_utils.h"
+
+// Converts |state.range(0)| unit floats, slightly more than the [-1, 1) range
+// so that some are clipped, to 16 bit integers per iteration.
+template <typename T>
+void BM_UnitToInt16(benchmark::State& state) {
+  absl::BitGen gen;
+  std::vector<T> input(state.range(0));
+  for (auto& value : input) {
+    value = absl::Uniform<T>(gen, -1.1, 1.1);
+  }
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(
+        chromemedia::codec::UnitToInt16(absl::MakeConstSpan(input)));
+  }
+  state.SetItemsProcessed(state.iterations() * input.size());
+}
+
+// Same as |BM_UnitToInt16| without allocating the output.
+template <typename T>
+void BM_UnitToInt16Into(benchmark::State& state) {
+  absl::BitGen gen;
+  std::vector<T> input(state.range(0));
+  for (auto& value : input) {
+    value = absl::Uniform<T>(gen, -1.1, 1.1);
+  }
+  std::vector<int16_t> output(input.size());
+  for (auto _ : state) {
+    chromemedia::codec::UnitToInt16(absl::MakeConstSpan(input),
+                                    absl::MakeSpan(output));
+    benchmark::DoNotOptimize(output.data());
+    benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(state.iterations() * input.size());
+}
+
+// Converts |state.range(0)| 16 bit integers to unit floats per iteration.
+template <typename T>
+void BM_Int16ToUnit(benchmark::State& state) {
+  absl::BitGen gen;
+  std::vector<int16_t> input(state.range(0));
+  for (auto& value : input) {
+    value = absl::Uniform<uint16_t>(gen);
+  }
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(
+        chromemedia::codec::Int16ToUnit<T>(absl::MakeConstSpan(input)));
+  }
+  state.SetItemsProcessed(state.iterations() * input.size());
+}
+
+// One hop at 16 kHz and at 48 kHz.
+void HopSizes(benchmark::internal::Benchmark* benchmark) {
+  benchmark->ArgName("num_samples")->Arg(320)->Arg(960);
+}
+
+BENCHMARK_TEMPLATE(BM_UnitToInt16, float)->Apply(HopSizes);
+BENCHMARK_TEMPLATE(BM_UnitToInt16, double)->Apply(HopSizes);
+BENCHMARK_TEMPLATE(BM_UnitToInt16Into, float)->Apply(HopSizes);
+BENCHMARK_TEMPLATE(BM_UnitToInt16Into, double)->Apply(HopSizes);
+BENCHMARK_TEMPLATE(BM_Int16ToUnit, float)->Apply(HopSizes);
+BENCHMARK_TEMPLATE(BM_Int16ToUnit, double)->Apply(HopSizes);
+BENCHMARK_MAIN();
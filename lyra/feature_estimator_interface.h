@@ -30,7 +30,7 @@ class FeatureEstimatorInterface {
 
   virtual void Update(absl::Span<const float> features) = 0;
 
-  virtual std::vector<float> Estimate() const = 0;
+  virtual const std::vector<float>& Estimate() const = 0;
 };
 
 }  // namespace codec
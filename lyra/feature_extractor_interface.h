@@ -17,6 +17,7 @@
 #ifndef LYRA_FEATURE_EXTRACTOR_INTERFACE_H_
 #define LYRA_FEATURE_EXTRACTOR_INTERFACE_H_
 
+#include <algorithm>
 #include <cstdint>
 #include <optional>
 #include <vector>
@@ -36,6 +37,20 @@ class FeatureExtractorInterface {
   // Extracts features from the audio. On failure returns a nullopt.
   virtual std::optional<std::vector<float>> Extract(
       const absl::Span<const int16_t> audio) = 0;
+
+  // Extracts features from the audio into |features|, which must be sized to
+  // the number of features. Returns false on failure. The default
+  // implementation copies the result of |Extract|; implementations override it
+  // to avoid the allocation.
+  virtual bool ExtractInto(const absl::Span<const int16_t> audio,
+                           absl::Span<float> features) {
+    const auto extracted = Extract(audio);
+    if (!extracted.has_value() || extracted->size() != features.size()) {
+      return false;
+    }
+    std::copy(extracted->begin(), extracted->end(), features.begin());
+    return true;
+  }
 };
 
 }  // namespace codec
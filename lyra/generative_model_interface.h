@@ -17,11 +17,12 @@
 #ifndef LYRA_GENERATIVE_MODEL_INTERFACE_H_
 #define LYRA_GENERATIVE_MODEL_INTERFACE_H_
 
+#include <algorithm>
 #include <cstdint>
 #include <optional>
-#include <queue>
 #include <vector>
 
+#include "absl/types/span.h"
 #include "glog/logging.h"  // IWYU pragma: keep
 
 namespace chromemedia {
@@ -38,6 +39,18 @@ class GenerativeModelInterface {
   virtual std::optional<std::vector<int16_t>> GenerateSamples(
       int num_samples) = 0;
 
+  // Generates |samples.size()| samples into |samples|. Returns false on
+  // failure. The default implementation copies the result of
+  // |GenerateSamples|; implementations override it to avoid the allocation.
+  virtual bool GenerateSamplesInto(absl::Span<int16_t> samples) {
+    const auto generated = GenerateSamples(samples.size());
+    if (!generated.has_value() || generated->size() != samples.size()) {
+      return false;
+    }
+    std::copy(generated->begin(), generated->end(), samples.begin());
+    return true;
+  }
+
   virtual int num_samples_available() const = 0;
 };
 
@@ -53,7 +66,18 @@ class GenerativeModel : public GenerativeModelInterface {
                  << " but were of shape " << features.size() << ".";
       return false;
     }
-    features_queue_.push(features);
+    if (num_queued_features_ == features_queue_.size()) {
+      // Grow the queue, keeping the queued features in order.
+      std::rotate(features_queue_.begin(),
+                  features_queue_.begin() + features_queue_front_,
+                  features_queue_.end());
+      features_queue_front_ = 0;
+      features_queue_.emplace_back();
+    }
+    features_queue_[(features_queue_front_ + num_queued_features_) %
+                    features_queue_.size()]
+        .assign(features.begin(), features.end());
+    ++num_queued_features_;
     return true;
   }
 
@@ -65,18 +89,29 @@ class GenerativeModel : public GenerativeModelInterface {
       LOG(ERROR) << "Number of samples must be positive.";
       return std::nullopt;
     }
+    std::vector<int16_t> samples(num_samples);
+    if (!GenerateSamplesInto(absl::MakeSpan(samples))) {
+      return std::nullopt;
+    }
+    return samples;
+  }
+
+  // Same as |GenerateSamples|, but writes into |samples|. Does not allocate
+  // once the feature queue has grown to its steady-state depth.
+  bool GenerateSamplesInto(absl::Span<int16_t> samples) override final {
+    const int num_samples = samples.size();
     // Do not call costly models if no samples have been requested.
     if (num_samples == 0) {
-      return std::vector<int16_t>(0);
+      return true;
     }
     if (num_samples_available() == 0) {
       LOG(ERROR) << "Tried generating " << num_samples << " samples but only "
                  << num_samples_available() << " are available.";
-      return std::nullopt;
+      return false;
     }
     if (next_sample_in_hop_ == 0) {
-      if (!RunConditioning(features_queue_.front())) {
-        return std::nullopt;
+      if (!RunConditioning(features_queue_[features_queue_front_])) {
+        return false;
       }
     }
     const int num_samples_remaining =
@@ -85,30 +120,34 @@ class GenerativeModel : public GenerativeModelInterface {
       LOG(ERROR) << "Tried generating " << num_samples << " samples but only "
                  << num_samples_remaining
                  << " were available in current features.";
-      return std::nullopt;
+      return false;
     }
-    auto samples = RunModel(num_samples);
-    if (samples.has_value()) {
-      next_sample_in_hop_ += samples->size();
-      // Cumulative samples generated are guaranteed to never straddle
-      // multiples of |num_samples_per_hop_|.
-      if (next_sample_in_hop_ == num_samples_per_hop_) {
-        next_sample_in_hop_ = 0;
-        features_queue_.pop();
-      }
+    if (!RunModel(samples)) {
+      return false;
     }
-    return samples;
+    next_sample_in_hop_ += num_samples;
+    // Cumulative samples generated are guaranteed to never straddle
+    // multiples of |num_samples_per_hop_|.
+    if (next_sample_in_hop_ == num_samples_per_hop_) {
+      next_sample_in_hop_ = 0;
+      features_queue_front_ =
+          (features_queue_front_ + 1) % features_queue_.size();
+      --num_queued_features_;
+    }
+    return true;
   }
 
   int num_samples_available() const override final {
-    return features_queue_.size() * num_samples_per_hop_ - next_sample_in_hop_;
+    return num_queued_features_ * num_samples_per_hop_ - next_sample_in_hop_;
   }
 
  protected:
   GenerativeModel(int num_samples_per_hop, int num_features)
       : num_samples_per_hop_(num_samples_per_hop),
         num_features_(num_features),
-        next_sample_in_hop_(0) {
+        next_sample_in_hop_(0),
+        features_queue_front_(0),
+        num_queued_features_(0) {
     VLOG(1) << "Number of features: " << num_features;
     VLOG(1) << "Number of samples per feature: " << num_samples_per_hop;
   }
@@ -117,9 +156,10 @@ class GenerativeModel : public GenerativeModelInterface {
   // Called from |GenerateSamples|.
   virtual bool RunConditioning(const std::vector<float>& features) = 0;
 
-  // Generate samples from the latest set of features added by |AddFeatures|,
-  // which have already been processed by |RunConditioning|.
-  virtual std::optional<std::vector<int16_t>> RunModel(int num_samples) = 0;
+  // Generate |samples.size()| samples into |samples| from the latest set of
+  // features added by |AddFeatures|, which have already been processed by
+  // |RunConditioning|. Returns false on failure.
+  virtual bool RunModel(absl::Span<int16_t> samples) = 0;
 
   int next_sample_in_hop() const { return next_sample_in_hop_; }
 
@@ -130,7 +170,11 @@ class GenerativeModel : public GenerativeModelInterface {
   const int num_samples_per_hop_;
   const int num_features_;
   int next_sample_in_hop_;
-  std::queue<std::vector<float>> features_queue_;
+  // Circular buffer of queued features. Slots are recycled rather than freed
+  // so that feature vectors are not reallocated on every hop.
+  std::vector<std::vector<float>> features_queue_;
+  int features_queue_front_;
+  int num_queued_features_;
 };
 
 }  // namespace codec
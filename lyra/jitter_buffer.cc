@@ -0,0 +1,285 @@
+// Copyright 2022 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "lyra/jitter_buffer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "absl/memory/memory.h"
+#include "absl/time/time.h"
+#include "absl/types/span.h"
+#include "glog/logging.h"  // IWYU pragma: keep
+#include "lyra/lyra_config.h"
+#include "lyra/lyra_decoder_interface.h"
+
+namespace chromemedia {
+namespace codec {
+namespace {
+
+// The target delay covers this many times the mean interarrival jitter.
+constexpr float kJitterMultiplier = 4.f;
+
+// Gain of the jitter estimator, from RFC 3550.
+constexpr int kJitterSmoothing = 16;
+
+// Packets late by more than the whole buffer in a row that make the buffer
+// assume the sender restarted its sequence numbers.
+constexpr int kMaxConsecutiveVeryLatePackets = 3;
+
+// Sequence number of an empty slot. Extended sequence numbers can be negative
+// if the first packets arrive out of order across a wrap-around.
+constexpr int64_t kEmptySlot = std::numeric_limits<int64_t>::min();
+
+int GetMaxPacketSize() {
+  const std::vector<int>& supported_quantized_bits =
+      GetSupportedQuantizedBits();
+  return GetPacketSize(*std::max_element(supported_quantized_bits.begin(),
+                                         supported_quantized_bits.end()));
+}
+
+}  // namespace
+
+std::unique_ptr<JitterBuffer> JitterBuffer::Create(
+    std::unique_ptr<LyraDecoderInterface> decoder, int min_delay_hops,
+    int max_delay_hops) {
+  if (decoder == nullptr) {
+    LOG(ERROR) << "Jitter buffer needs a decoder.";
+    return nullptr;
+  }
+  if (min_delay_hops < 1 || max_delay_hops < min_delay_hops) {
+    LOG(ERROR) << "Delays have to be 1 <= min_delay_hops <= max_delay_hops, "
+               << "but were " << min_delay_hops << " and " << max_delay_hops
+               << ".";
+    return nullptr;
+  }
+
+  // WrapUnique is used because of private c'tor.
+  return absl::WrapUnique(new JitterBuffer(std::move(decoder), min_delay_hops,
+                                           max_delay_hops, GetMaxPacketSize()));
+}
+
+JitterBuffer::JitterBuffer(std::unique_ptr<LyraDecoderInterface> decoder,
+                           int min_delay_hops, int max_delay_hops,
+                           int max_packet_size)
+    : decoder_(std::move(decoder)),
+      min_delay_hops_(min_delay_hops),
+      max_delay_hops_(max_delay_hops),
+      num_samples_per_hop_(decoder_->sample_rate_hz() /
+                           decoder_->frame_rate()),
+      hop_duration_(absl::Seconds(1) / decoder_->frame_rate()),
+      // Holds the most hops ever buffered, plus room for packets that arrive
+      // early.
+      slots_(4 * max_delay_hops + 2 * kMinExcessDelayHops,
+             Slot{kEmptySlot, 0, std::vector<uint8_t>(max_packet_size)}),
+      has_transit_(false),
+      last_transit_(absl::ZeroDuration()),
+      jitter_(absl::ZeroDuration()),
+      target_delay_hops_(min_delay_hops) {
+  Reset();
+}
+
+bool JitterBuffer::InsertPacket(uint16_t sequence_number,
+                                absl::Span<const uint8_t> packet,
+                                absl::Time arrival_time) {
+  if (packet.empty() || packet.size() > slots_.front().bytes.size()) {
+    LOG(ERROR) << "Packet of " << packet.size()
+               << " bytes is not a Lyra packet.";
+    return false;
+  }
+  const int64_t num_slots = slots_.size();
+  int64_t extended_sequence_number = UnwrapSequenceNumber(sequence_number);
+
+  if (has_packets_ && extended_sequence_number < next_sequence_number_) {
+    if (!playing_ &&
+        highest_sequence_number_ - extended_sequence_number < num_slots) {
+      // Reordered before playout started, so it can still be played.
+      next_sequence_number_ = extended_sequence_number;
+    } else {
+      // A run of packets far behind playout means the sender restarted its
+      // sequence numbers further back.
+      const bool is_very_late =
+          next_sequence_number_ - extended_sequence_number > num_slots;
+      num_consecutive_very_late_ =
+          is_very_late ? num_consecutive_very_late_ + 1 : 0;
+      if (num_consecutive_very_late_ < kMaxConsecutiveVeryLatePackets) {
+        ++stats_.num_packets_late;
+        UpdateJitter(extended_sequence_number, arrival_time);
+        return false;
+      }
+      LOG(WARNING) << "Sequence numbers jumped back; restarting playout.";
+      Reset();
+      extended_sequence_number = sequence_number;
+    }
+  }
+  num_consecutive_very_late_ = 0;
+  UpdateJitter(extended_sequence_number, arrival_time);
+
+  if (!has_packets_) {
+    has_packets_ = true;
+    highest_sequence_number_ = extended_sequence_number;
+    next_sequence_number_ = extended_sequence_number;
+  }
+  if (extended_sequence_number >= next_sequence_number_ + num_slots) {
+    // Too far ahead to fit; give up on the oldest hops.
+    DiscardUntil(extended_sequence_number - num_slots + 1);
+  }
+
+  Slot& slot = SlotFor(extended_sequence_number);
+  if (slot.sequence_number == extended_sequence_number) {
+    ++stats_.num_packets_duplicate;
+    return false;
+  }
+  slot.sequence_number = extended_sequence_number;
+  slot.size = packet.size();
+  std::copy(packet.begin(), packet.end(), slot.bytes.begin());
+  highest_sequence_number_ =
+      std::max(highest_sequence_number_, extended_sequence_number);
+  ++stats_.num_packets_inserted;
+  return true;
+}
+
+bool JitterBuffer::Playout(absl::Span<int16_t> samples) {
+  if (static_cast<int>(samples.size()) != num_samples_per_hop_) {
+    LOG(ERROR) << "Playout needs " << num_samples_per_hop_
+               << " samples but got " << samples.size() << ".";
+    return false;
+  }
+  if (!playing_) {
+    // Wait until the target delay is buffered, or until the first packet has
+    // waited that long.
+    if (!has_packets_ || (BufferedHops() < target_delay_hops_ &&
+                          num_hops_waited_ < target_delay_hops_)) {
+      num_hops_waited_ += has_packets_ ? 1 : 0;
+      std::fill(samples.begin(), samples.end(), 0);
+      ++stats_.num_hops_buffering;
+      return true;
+    }
+    playing_ = true;
+  }
+
+  if (BufferedHops() > MaxBufferedHops()) {
+    DiscardUntil(highest_sequence_number_ - target_delay_hops_ + 1);
+  }
+
+  Slot& slot = SlotFor(next_sequence_number_);
+  if (slot.sequence_number == next_sequence_number_) {
+    slot.sequence_number = kEmptySlot;
+    ++next_sequence_number_;
+    if (decoder_->SetEncodedPacket(
+            absl::MakeConstSpan(slot.bytes).first(slot.size))) {
+      ++stats_.num_hops_decoded;
+    } else {
+      LOG(WARNING) << "Could not set packet; concealing it instead.";
+      ++stats_.num_hops_concealed;
+    }
+  } else if (BufferedHops() >= target_delay_hops_) {
+    // Enough newer packets arrived to treat this one as lost.
+    ++next_sequence_number_;
+    ++stats_.num_hops_concealed;
+  } else {
+    ++stats_.num_hops_expanded;
+  }
+  // Without a new packet the decoder conceals, then fades to comfort noise.
+  if (!decoder_->DecodeSamples(samples)) {
+    LOG(ERROR) << "Could not decode samples.";
+    return false;
+  }
+  return true;
+}
+
+int JitterBuffer::target_delay_hops() const { return target_delay_hops_; }
+
+absl::Duration JitterBuffer::jitter() const { return jitter_; }
+
+int JitterBuffer::num_samples_per_hop() const { return num_samples_per_hop_; }
+
+const JitterBufferStats& JitterBuffer::stats() const { return stats_; }
+
+int64_t JitterBuffer::UnwrapSequenceNumber(uint16_t sequence_number) const {
+  if (!has_packets_) {
+    return sequence_number;
+  }
+  int64_t extended =
+      (highest_sequence_number_ & ~int64_t{0xFFFF}) | sequence_number;
+  if (extended - highest_sequence_number_ > 0x8000) {
+    extended -= 0x10000;
+  } else if (highest_sequence_number_ - extended > 0x8000) {
+    extended += 0x10000;
+  }
+  return extended;
+}
+
+void JitterBuffer::UpdateJitter(int64_t sequence_number,
+                                absl::Time arrival_time) {
+  // Transit time up to a constant offset between sender and receiver clocks.
+  const absl::Duration transit =
+      (arrival_time - absl::UnixEpoch()) - sequence_number * hop_duration_;
+  if (has_transit_) {
+    const absl::Duration deviation = absl::AbsDuration(transit - last_transit_);
+    jitter_ += (deviation - jitter_) / kJitterSmoothing;
+  }
+  has_transit_ = true;
+  last_transit_ = transit;
+
+  const int jitter_hops = static_cast<int>(std::ceil(
+      absl::FDivDuration(kJitterMultiplier * jitter_, hop_duration_)));
+  target_delay_hops_ =
+      std::clamp(1 + jitter_hops, min_delay_hops_, max_delay_hops_);
+}
+
+JitterBuffer::Slot& JitterBuffer::SlotFor(int64_t sequence_number) {
+  const int64_t num_slots = slots_.size();
+  return slots_[((sequence_number % num_slots) + num_slots) % num_slots];
+}
+
+void JitterBuffer::DiscardUntil(int64_t sequence_number) {
+  for (Slot& slot : slots_) {
+    if (slot.sequence_number != kEmptySlot &&
+        slot.sequence_number < sequence_number) {
+      slot.sequence_number = kEmptySlot;
+      ++stats_.num_packets_discarded;
+    }
+  }
+  next_sequence_number_ = std::max(next_sequence_number_, sequence_number);
+}
+
+void JitterBuffer::Reset() {
+  for (Slot& slot : slots_) {
+    slot.sequence_number = kEmptySlot;
+  }
+  has_packets_ = false;
+  playing_ = false;
+  num_hops_waited_ = 0;
+  num_consecutive_very_late_ = 0;
+  highest_sequence_number_ = 0;
+  next_sequence_number_ = 0;
+  has_transit_ = false;
+}
+
+int64_t JitterBuffer::BufferedHops() const {
+  return highest_sequence_number_ - next_sequence_number_ + 1;
+}
+
+int64_t JitterBuffer::MaxBufferedHops() const {
+  return target_delay_hops_ + std::max(kMinExcessDelayHops, target_delay_hops_);
+}
+
+}  // namespace codec
+}  // namespace chromemedia
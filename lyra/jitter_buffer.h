@@ -0,0 +1,167 @@
+/*
+ * Copyright 2022 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LYRA_JITTER_BUFFER_H_
+#define LYRA_JITTER_BUFFER_H_
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "absl/time/time.h"
+#include "absl/types/span.h"
+#include "lyra/lyra_decoder_interface.h"
+
+namespace chromemedia {
+namespace codec {
+
+// Counters of what happened to packets and hops in a |JitterBuffer|.
+struct JitterBufferStats {
+  // Packets accepted by |InsertPacket|.
+  int64_t num_packets_inserted = 0;
+  // Packets that arrived after their hop had been played out.
+  int64_t num_packets_late = 0;
+  // Packets whose sequence number was already buffered.
+  int64_t num_packets_duplicate = 0;
+  // Buffered packets skipped to bring the delay back down to the target.
+  int64_t num_packets_discarded = 0;
+  // Hops decoded from a received packet.
+  int64_t num_hops_decoded = 0;
+  // Hops concealed because their packet was missing and the buffer held newer
+  // packets, so the sequence number advanced past it.
+  int64_t num_hops_concealed = 0;
+  // Hops concealed without advancing the sequence number, to wait for a
+  // packet that may still arrive. This adds one hop of delay.
+  int64_t num_hops_expanded = 0;
+  // Hops of silence played before playout started.
+  int64_t num_hops_buffering = 0;
+};
+
+// Reorders Lyra packets by sequence number and plays them out through a
+// |LyraDecoderInterface| on a fixed clock of one hop per |Playout| call.
+//
+// The target delay, in hops, follows the interarrival jitter estimate of
+// RFC 3550 section 6.4.1. When the packet for the next hop is missing,
+// the buffer either conceals it and moves on, if enough newer packets are
+// buffered to show it was lost, or conceals without advancing, which waits
+// one more hop for it and so grows the delay toward the target. Lyra cannot
+// time-stretch, so delay built up during a delay spike is only shed by skipping
+// the oldest hops, once more than max(|kMinExcessDelayHops|, target) hops above
+// the target are buffered.
+//
+// Packets are stored in preallocated slots, so neither |InsertPacket| nor
+// |Playout| allocate. This class is not thread-safe; a network thread should
+// hand packets to the playout thread, e.g. through an |SpscRingBuffer|.
+class JitterBuffer {
+ public:
+  // Smallest number of hops buffered above the target delay before old hops
+  // are skipped.
+  static constexpr int kMinExcessDelayHops = 2;
+
+  // Returns nullptr if |decoder| is null or the delays are not
+  // 1 <= |min_delay_hops| <= |max_delay_hops|.
+  static std::unique_ptr<JitterBuffer> Create(
+      std::unique_ptr<LyraDecoderInterface> decoder, int min_delay_hops,
+      int max_delay_hops);
+
+  // Buffers |packet| with its 16 bit wrapping |sequence_number|, one per hop.
+  // |arrival_time| is read from a clock that runs at the same rate as the
+  // playout clock. Returns false if the packet was late, a duplicate or too
+  // large for a Lyra packet.
+  bool InsertPacket(uint16_t sequence_number, absl::Span<const uint8_t> packet,
+                    absl::Time arrival_time);
+
+  // Writes the next hop into |samples|, which has to hold exactly
+  // |num_samples_per_hop()| samples. Has to be called once per hop duration.
+  // Writes silence until playout starts. Returns false if decoding failed.
+  bool Playout(absl::Span<int16_t> samples);
+
+  // Current target delay in hops, between the minimum and maximum delay.
+  int target_delay_hops() const;
+
+  // Smoothed interarrival jitter.
+  absl::Duration jitter() const;
+
+  int num_samples_per_hop() const;
+
+  const JitterBufferStats& stats() const;
+
+ private:
+  struct Slot {
+    // Extended sequence number of the packet, or the smallest int64_t if the
+    // slot is empty.
+    int64_t sequence_number;
+    int size;
+    std::vector<uint8_t> bytes;
+  };
+
+  JitterBuffer(std::unique_ptr<LyraDecoderInterface> decoder,
+               int min_delay_hops, int max_delay_hops, int max_packet_size);
+
+  // Extends |sequence_number| to the 64 bit value closest to the highest
+  // sequence number received so far.
+  int64_t UnwrapSequenceNumber(uint16_t sequence_number) const;
+
+  void UpdateJitter(int64_t sequence_number, absl::Time arrival_time);
+
+  Slot& SlotFor(int64_t sequence_number);
+
+  // Empties the slots of packets before |sequence_number| and moves playout
+  // up to it.
+  void DiscardUntil(int64_t sequence_number);
+
+  // Empties every slot and restarts buffering.
+  void Reset();
+
+  // Number of hops from the next one to play up to the newest buffered one,
+  // including missing hops in between.
+  int64_t BufferedHops() const;
+
+  // Most hops buffered before the oldest ones are skipped.
+  int64_t MaxBufferedHops() const;
+
+  const std::unique_ptr<LyraDecoderInterface> decoder_;
+  const int min_delay_hops_;
+  const int max_delay_hops_;
+  const int num_samples_per_hop_;
+  const absl::Duration hop_duration_;
+
+  std::vector<Slot> slots_;
+
+  // Whether any packet has been received.
+  bool has_packets_;
+  // Whether playout of packets has started.
+  bool playing_;
+  // Hops of silence played since the first packet arrived.
+  int num_hops_waited_;
+  // Consecutive packets that were late by more than the whole buffer.
+  int num_consecutive_very_late_;
+  int64_t highest_sequence_number_;
+  // Sequence number of the next hop to play.
+  int64_t next_sequence_number_;
+
+  bool has_transit_;
+  absl::Duration last_transit_;
+  absl::Duration jitter_;
+  int target_delay_hops_;
+
+  JitterBufferStats stats_;
+};
+
+}  // namespace codec
+}  // namespace chromemedia
+
+#endif  // LYRA_JITTER_BUFFER_H_
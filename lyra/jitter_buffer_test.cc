@@ -0,0 +1,280 @@
+// Copyright 2022 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "lyra/jitter_buffer.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <random>
+#include <utility>
+#include <vector>
+
+#include "absl/time/time.h"
+#include "absl/types/span.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "lyra/gilbert_model.h"
+#include "lyra/testing/mock_lyra_decoder.h"
+
+namespace chromemedia {
+namespace codec {
+namespace {
+
+using testing::_;
+using testing::Invoke;
+using testing::NiceMock;
+using testing::Return;
+
+static constexpr int kSampleRateHz = 16000;
+static constexpr int kNumSamplesPerHop = 320;
+static constexpr absl::Duration kHopDuration = absl::Milliseconds(20);
+
+// Packets carry their sequence number so that the decoder can record the order
+// in which they were played.
+std::vector<uint8_t> MakePacket(uint16_t sequence_number) {
+  return {static_cast<uint8_t>(sequence_number & 0xFF),
+          static_cast<uint8_t>(sequence_number >> 8)};
+}
+
+// Returns a decoder that appends the sequence number of every packet set on it
+// to |*decoded|.
+std::unique_ptr<LyraDecoderInterface> CreateRecordingDecoder(
+    std::vector<int>* decoded) {
+  auto decoder = std::make_unique<NiceMock<MockLyraDecoder>>();
+  ON_CALL(*decoder, sample_rate_hz()).WillByDefault(Return(kSampleRateHz));
+  ON_CALL(*decoder, frame_rate()).WillByDefault(Return(50));
+  ON_CALL(*decoder, SetEncodedPacket(_))
+      .WillByDefault(Invoke([decoded](absl::Span<const uint8_t> packet) {
+        decoded->push_back(packet[0] | (packet[1] << 8));
+        return true;
+      }));
+  ON_CALL(*decoder, DecodeSamples(testing::An<absl::Span<int16_t>>()))
+      .WillByDefault(Return(true));
+  return decoder;
+}
+
+class JitterBufferTest : public testing::Test {
+ protected:
+  void CreateJitterBuffer(int min_delay_hops, int max_delay_hops) {
+    jitter_buffer_ = JitterBuffer::Create(CreateRecordingDecoder(&decoded_),
+                                          min_delay_hops, max_delay_hops);
+    ASSERT_NE(jitter_buffer_, nullptr);
+  }
+
+  bool Insert(uint16_t sequence_number) {
+    return jitter_buffer_->InsertPacket(
+        sequence_number, MakePacket(sequence_number),
+        absl::UnixEpoch() + sequence_number * kHopDuration);
+  }
+
+  void Playout(int num_hops) {
+    for (int i = 0; i < num_hops; ++i) {
+      ASSERT_TRUE(jitter_buffer_->Playout(absl::MakeSpan(samples_)));
+    }
+  }
+
+  std::vector<int> decoded_;
+  std::vector<int16_t> samples_ = std::vector<int16_t>(kNumSamplesPerHop);
+  std::unique_ptr<JitterBuffer> jitter_buffer_;
+};
+
+TEST_F(JitterBufferTest, CreateFailsWithInvalidArguments) {
+  EXPECT_EQ(JitterBuffer::Create(nullptr, 1, 4), nullptr);
+  EXPECT_EQ(JitterBuffer::Create(CreateRecordingDecoder(&decoded_), 0, 4),
+            nullptr);
+  EXPECT_EQ(JitterBuffer::Create(CreateRecordingDecoder(&decoded_), 3, 2),
+            nullptr);
+}
+
+TEST_F(JitterBufferTest, PlaysSilenceUntilTargetDelayIsBuffered) {
+  CreateJitterBuffer(2, 2);
+  Playout(1);
+  ASSERT_TRUE(Insert(0));
+  Playout(1);
+  EXPECT_TRUE(decoded_.empty());
+  EXPECT_EQ(jitter_buffer_->stats().num_hops_buffering, 2);
+
+  ASSERT_TRUE(Insert(1));
+  Playout(1);
+  EXPECT_THAT(decoded_, testing::ElementsAre(0));
+}
+
+TEST_F(JitterBufferTest, WrongNumberOfSamplesFails) {
+  CreateJitterBuffer(1, 1);
+  std::vector<int16_t> samples(kNumSamplesPerHop + 1);
+  EXPECT_FALSE(jitter_buffer_->Playout(absl::MakeSpan(samples)));
+}
+
+TEST_F(JitterBufferTest, ReordersPackets) {
+  CreateJitterBuffer(3, 3);
+  for (uint16_t sequence_number : {0, 2, 1}) {
+    ASSERT_TRUE(Insert(sequence_number));
+  }
+  Playout(3);
+  EXPECT_THAT(decoded_, testing::ElementsAre(0, 1, 2));
+}
+
+TEST_F(JitterBufferTest, ConcealsLostPacketAndDropsItWhenLate) {
+  CreateJitterBuffer(1, 1);
+  ASSERT_TRUE(Insert(0));
+  Playout(1);
+  ASSERT_TRUE(Insert(2));
+  // Packet 1 is missing but packet 2 shows it is overdue.
+  Playout(2);
+  EXPECT_THAT(decoded_, testing::ElementsAre(0, 2));
+  EXPECT_EQ(jitter_buffer_->stats().num_hops_concealed, 1);
+
+  EXPECT_FALSE(Insert(1));
+  EXPECT_EQ(jitter_buffer_->stats().num_packets_late, 1);
+}
+
+TEST_F(JitterBufferTest, ExpandsWhileWaitingForNextPacket) {
+  CreateJitterBuffer(1, 1);
+  ASSERT_TRUE(Insert(0));
+  Playout(3);
+  EXPECT_EQ(jitter_buffer_->stats().num_hops_expanded, 2);
+
+  // Nothing newer arrived, so packet 1 is still on time.
+  ASSERT_TRUE(Insert(1));
+  Playout(1);
+  EXPECT_THAT(decoded_, testing::ElementsAre(0, 1));
+}
+
+TEST_F(JitterBufferTest, RejectsDuplicates) {
+  CreateJitterBuffer(2, 2);
+  ASSERT_TRUE(Insert(0));
+  EXPECT_FALSE(Insert(0));
+  EXPECT_EQ(jitter_buffer_->stats().num_packets_duplicate, 1);
+}
+
+TEST_F(JitterBufferTest, HandlesSequenceNumberWrapAround) {
+  CreateJitterBuffer(4, 4);
+  for (uint16_t sequence_number : {65534, 0, 65535, 1}) {
+    ASSERT_TRUE(Insert(sequence_number));
+  }
+  Playout(4);
+  EXPECT_THAT(decoded_, testing::ElementsAre(65534, 65535, 0, 1));
+}
+
+TEST_F(JitterBufferTest, DiscardsOldPacketsAboveTargetDelay) {
+  CreateJitterBuffer(1, 1);
+  for (uint16_t sequence_number = 0; sequence_number < 6; ++sequence_number) {
+    ASSERT_TRUE(Insert(sequence_number));
+  }
+  Playout(1);
+  EXPECT_THAT(decoded_, testing::ElementsAre(5));
+  EXPECT_EQ(jitter_buffer_->stats().num_packets_discarded, 5);
+}
+
+struct SimulationResult {
+  JitterBufferStats stats;
+  int target_delay_hops;
+  int num_received;
+};
+
+// Sends |num_packets| packets, one per hop, over a channel that loses them
+// according to a Gilbert model and delays them by a fixed 30 ms plus an
+// exponentially distributed jitter with a mean of |mean_jitter|. Playout runs
+// on the same 20 ms clock as the sender.
+SimulationResult Simulate(int num_packets, absl::Duration mean_jitter,
+                          int min_delay_hops, int max_delay_hops) {
+  auto gilbert_model = GilbertModel::Create(
+      /*packet_loss_rate=*/0.05f, /*average_burst_length=*/2.f,
+      /*random_seed=*/false);
+  std::mt19937 gen(1234);
+  std::exponential_distribution<double> jitter(
+      1.0 / absl::ToDoubleMilliseconds(mean_jitter));
+
+  std::vector<std::pair<absl::Time, uint16_t>> arrivals;
+  for (int i = 0; i < num_packets; ++i) {
+    if (!gilbert_model->IsPacketReceived()) {
+      continue;
+    }
+    const absl::Duration delay =
+        absl::Milliseconds(30) + absl::Milliseconds(jitter(gen));
+    arrivals.emplace_back(absl::UnixEpoch() + i * kHopDuration + delay,
+                          static_cast<uint16_t>(i));
+  }
+  std::sort(arrivals.begin(), arrivals.end());
+
+  std::vector<int> decoded;
+  auto jitter_buffer = JitterBuffer::Create(CreateRecordingDecoder(&decoded),
+                                            min_delay_hops, max_delay_hops);
+  std::vector<int16_t> samples(kNumSamplesPerHop);
+  auto next_arrival = arrivals.begin();
+  // Plays at least until every packet has arrived.
+  int num_hops = 0;
+  for (; num_hops < num_packets + 2 * max_delay_hops ||
+         next_arrival != arrivals.end();
+       ++num_hops) {
+    const absl::Time now = absl::UnixEpoch() + num_hops * kHopDuration;
+    for (; next_arrival != arrivals.end() && next_arrival->first <= now;
+         ++next_arrival) {
+      jitter_buffer->InsertPacket(next_arrival->second,
+                                  MakePacket(next_arrival->second),
+                                  next_arrival->first);
+    }
+    EXPECT_TRUE(jitter_buffer->Playout(absl::MakeSpan(samples)));
+  }
+
+  // Packets are played in order, and every hop is accounted for.
+  EXPECT_TRUE(std::is_sorted(decoded.begin(), decoded.end()));
+  EXPECT_EQ(std::adjacent_find(decoded.begin(), decoded.end()),
+            decoded.end());
+  const JitterBufferStats& stats = jitter_buffer->stats();
+  EXPECT_EQ(stats.num_hops_buffering + stats.num_hops_decoded +
+                stats.num_hops_concealed + stats.num_hops_expanded,
+            num_hops);
+  EXPECT_EQ(stats.num_packets_inserted + stats.num_packets_late,
+            arrivals.size());
+  EXPECT_EQ(stats.num_hops_decoded, decoded.size());
+  return {stats, jitter_buffer->target_delay_hops(),
+          static_cast<int>(arrivals.size())};
+}
+
+TEST(JitterBufferSimulationTest, AdaptsDelayToJitter) {
+  constexpr int kNumPackets = 5000;
+  const SimulationResult low_jitter =
+      Simulate(kNumPackets, absl::Milliseconds(2), 1, 10);
+  const SimulationResult high_jitter =
+      Simulate(kNumPackets, absl::Milliseconds(30), 1, 10);
+
+  EXPECT_LE(low_jitter.target_delay_hops, 2);
+  EXPECT_GT(high_jitter.target_delay_hops, low_jitter.target_delay_hops);
+
+  // With a delay adapted to the jitter, few received packets miss playout.
+  for (const SimulationResult& result : {low_jitter, high_jitter}) {
+    EXPECT_LT(
+        result.stats.num_packets_late + result.stats.num_packets_discarded,
+        0.02 * result.num_received);
+    EXPECT_GT(result.stats.num_hops_decoded, 0.9 * result.num_received);
+  }
+}
+
+TEST(JitterBufferSimulationTest, FixedShortDelayLosesLatePackets) {
+  constexpr int kNumPackets = 5000;
+  const SimulationResult fixed =
+      Simulate(kNumPackets, absl::Milliseconds(30), 1, 1);
+  const SimulationResult adaptive =
+      Simulate(kNumPackets, absl::Milliseconds(30), 1, 10);
+
+  EXPECT_GT(fixed.stats.num_packets_late + fixed.stats.num_packets_discarded,
+            2 * (adaptive.stats.num_packets_late +
+                 adaptive.stats.num_packets_discarded));
+}
+
+}  // namespace
+}  // namespace codec
+}  // namespace chromemedia
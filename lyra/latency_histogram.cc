@@ -0,0 +1,146 @@
+// Copyright 2022 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "lyra/latency_histogram.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+
+#include "absl/numeric/bits.h"
+
+namespace chromemedia {
+namespace codec {
+namespace {
+
+// Values below 2^kSubBucketBits are exact. Above that, each power of two is
+// split into 2^(kSubBucketBits - 1) buckets.
+constexpr int kSubBucketBits = 7;
+constexpr int kSubBucketCount = 1 << kSubBucketBits;
+constexpr int kSubBucketHalfCount = kSubBucketCount / 2;
+
+}  // namespace
+
+LatencyHistogram::LatencyHistogram()
+    : num_values_(0),
+      min_(0),
+      max_(0),
+      mean_(0.0),
+      sum_of_squared_deviations_(0.0) {}
+
+LatencyHistogram::LatencyHistogram(int64_t max_expected_value)
+    : LatencyHistogram() {
+  counts_.resize(BucketIndex(std::max<int64_t>(max_expected_value, 0)) + 1,
+                 0);
+}
+
+void LatencyHistogram::Record(int64_t value) {
+  value = std::max<int64_t>(value, 0);
+  const int index = BucketIndex(value);
+  if (index >= counts_.size()) {
+    counts_.resize(index + 1, 0);
+  }
+  ++counts_[index];
+  min_ = num_values_ == 0 ? value : std::min(min_, value);
+  max_ = num_values_ == 0 ? value : std::max(max_, value);
+  ++num_values_;
+  const double delta = value - mean_;
+  mean_ += delta / num_values_;
+  sum_of_squared_deviations_ += delta * (value - mean_);
+}
+
+void LatencyHistogram::Merge(const LatencyHistogram& other) {
+  if (other.num_values_ == 0) {
+    return;
+  }
+  if (num_values_ == 0) {
+    *this = other;
+    return;
+  }
+  if (other.counts_.size() > counts_.size()) {
+    counts_.resize(other.counts_.size(), 0);
+  }
+  for (int i = 0; i < other.counts_.size(); ++i) {
+    counts_[i] += other.counts_[i];
+  }
+  min_ = std::min(min_, other.min_);
+  max_ = std::max(max_, other.max_);
+  // Combines the moments of both halves (Chan et al.).
+  const int64_t num_values = num_values_ + other.num_values_;
+  const double delta = other.mean_ - mean_;
+  sum_of_squared_deviations_ += other.sum_of_squared_deviations_ +
+                                delta * delta * num_values_ *
+                                    other.num_values_ / num_values;
+  mean_ += delta * other.num_values_ / num_values;
+  num_values_ = num_values;
+}
+
+void LatencyHistogram::Clear() {
+  std::fill(counts_.begin(), counts_.end(), 0);
+  num_values_ = 0;
+  min_ = 0;
+  max_ = 0;
+  mean_ = 0.0;
+  sum_of_squared_deviations_ = 0.0;
+}
+
+int64_t LatencyHistogram::Percentile(double percentile) const {
+  if (num_values_ == 0) {
+    return 0;
+  }
+  const double fraction = std::clamp(percentile, 0.0, 100.0) / 100.0;
+  const int64_t rank = std::max<int64_t>(
+      1, static_cast<int64_t>(std::ceil(fraction * num_values_)));
+  int64_t num_values_so_far = 0;
+  for (int i = 0; i < counts_.size(); ++i) {
+    num_values_so_far += counts_[i];
+    if (num_values_so_far >= rank) {
+      return std::clamp(BucketUpperBound(i), min_, max_);
+    }
+  }
+  return max_;
+}
+
+double LatencyHistogram::standard_deviation() const {
+  return num_values_ == 0 ? 0.0
+                          : std::sqrt(sum_of_squared_deviations_ / num_values_);
+}
+
+int LatencyHistogram::BucketIndex(int64_t value) {
+  if (value < kSubBucketCount) {
+    return value;
+  }
+  // The top kSubBucketBits bits of |value| select the bucket within its power
+  // of two, whose top bit is always set.
+  const int shift =
+      absl::bit_width(static_cast<uint64_t>(value)) - kSubBucketBits;
+  return kSubBucketCount + (shift - 1) * kSubBucketHalfCount +
+         static_cast<int>((value >> shift) - kSubBucketHalfCount);
+}
+
+int64_t LatencyHistogram::BucketUpperBound(int index) {
+  if (index < kSubBucketCount) {
+    return index;
+  }
+  const int shift = (index - kSubBucketCount) / kSubBucketHalfCount + 1;
+  const uint64_t top =
+      (index - kSubBucketCount) % kSubBucketHalfCount + kSubBucketHalfCount;
+  const uint64_t upper_bound = ((top + 1) << shift) - 1;
+  return static_cast<int64_t>(std::min<uint64_t>(
+      upper_bound, std::numeric_limits<int64_t>::max()));
+}
+
+}  // namespace codec
+}  // namespace chromemedia
@@ -0,0 +1,81 @@
+/*
+ * Copyright 2022 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LYRA_LATENCY_HISTOGRAM_H_
+#define LYRA_LATENCY_HISTOGRAM_H_
+
+#include <cstdint>
+#include <vector>
+
+namespace chromemedia {
+namespace codec {
+
+// A histogram of non-negative latencies in the style of HdrHistogram. Values
+// below 128 have a bucket each, larger ones share log-linear buckets with 64
+// buckets per power of two, so percentiles are within 1/64 of the true value
+// whatever the range. Memory grows with the log of the largest value, not
+// with the number of values. Min, max, mean and standard deviation are exact.
+class LatencyHistogram {
+ public:
+  LatencyHistogram();
+
+  // Allocates the buckets for values up to |max_expected_value| up front, so
+  // that recording them never allocates. Larger values still grow the
+  // histogram.
+  explicit LatencyHistogram(int64_t max_expected_value);
+
+  // Negative values are recorded as 0.
+  void Record(int64_t value);
+
+  // Adds the values recorded by |other|, for example by another thread.
+  void Merge(const LatencyHistogram& other);
+
+  // Drops the recorded values but keeps the buckets allocated.
+  void Clear();
+
+  // The smallest value that at least |percentile| percent of the recorded
+  // values do not exceed, like 99 for p99, rounded up to its bucket. Returns 0
+  // if no values were recorded.
+  int64_t Percentile(double percentile) const;
+
+  int64_t num_values() const { return num_values_; }
+  int64_t min() const { return min_; }
+  int64_t max() const { return max_; }
+  double mean() const { return mean_; }
+
+  // The population standard deviation.
+  double standard_deviation() const;
+
+ private:
+  static int BucketIndex(int64_t value);
+
+  // The largest value which falls into the bucket of |index|.
+  static int64_t BucketUpperBound(int index);
+
+  std::vector<int64_t> counts_;
+  int64_t num_values_;
+  int64_t min_;
+  int64_t max_;
+  // Running mean and sum of squared differences from it, as in Welford's
+  // algorithm, which does not lose precision to cancellation.
+  double mean_;
+  double sum_of_squared_deviations_;
+};
+
+}  // namespace codec
+}  // namespace chromemedia
+
+#endif  // LYRA_LATENCY_HISTOGRAM_H_
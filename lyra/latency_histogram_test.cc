@@ -0,0 +1,139 @@
+// Copyright 2022 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "lyra/latency_histogram.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <random>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+namespace chromemedia {
+namespace codec {
+namespace {
+
+TEST(LatencyHistogramTest, EmptyHistogram) {
+  LatencyHistogram histogram;
+  EXPECT_EQ(histogram.num_values(), 0);
+  EXPECT_EQ(histogram.Percentile(50), 0);
+  EXPECT_EQ(histogram.standard_deviation(), 0.0);
+}
+
+TEST(LatencyHistogramTest, SmallValuesAreExact) {
+  LatencyHistogram histogram;
+  for (int value = 1; value <= 100; ++value) {
+    histogram.Record(value);
+  }
+  EXPECT_EQ(histogram.num_values(), 100);
+  EXPECT_EQ(histogram.min(), 1);
+  EXPECT_EQ(histogram.max(), 100);
+  EXPECT_DOUBLE_EQ(histogram.mean(), 50.5);
+  // The population standard deviation of 1..n is sqrt((n^2 - 1) / 12).
+  EXPECT_NEAR(histogram.standard_deviation(), std::sqrt(9999.0 / 12.0), 1e-9);
+  EXPECT_EQ(histogram.Percentile(0), 1);
+  EXPECT_EQ(histogram.Percentile(50), 50);
+  EXPECT_EQ(histogram.Percentile(95), 95);
+  EXPECT_EQ(histogram.Percentile(99), 99);
+  EXPECT_EQ(histogram.Percentile(99.9), 100);
+  EXPECT_EQ(histogram.Percentile(100), 100);
+}
+
+TEST(LatencyHistogramTest, LargeValuesAreWithinPrecision) {
+  std::mt19937_64 generator(5);
+  std::lognormal_distribution<double> distribution(8.0, 2.0);
+  std::vector<int64_t> values;
+  LatencyHistogram histogram;
+  for (int i = 0; i < 10000; ++i) {
+    values.push_back(static_cast<int64_t>(distribution(generator)));
+    histogram.Record(values.back());
+  }
+  std::sort(values.begin(), values.end());
+  for (const double percentile : {50.0, 95.0, 99.0, 99.9}) {
+    const int64_t exact = values[static_cast<int>(
+        std::ceil(percentile / 100.0 * values.size())) - 1];
+    const int64_t estimate = histogram.Percentile(percentile);
+    EXPECT_GE(estimate, exact) << percentile;
+    EXPECT_LE(estimate, exact + exact / 64 + 1) << percentile;
+  }
+  EXPECT_EQ(histogram.Percentile(100), values.back());
+}
+
+TEST(LatencyHistogramTest, ClampsNegativeAndHandlesExtremeValues) {
+  LatencyHistogram histogram;
+  histogram.Record(-5);
+  histogram.Record(std::numeric_limits<int64_t>::max());
+  EXPECT_EQ(histogram.min(), 0);
+  EXPECT_EQ(histogram.Percentile(50), 0);
+  EXPECT_EQ(histogram.Percentile(100), std::numeric_limits<int64_t>::max());
+}
+
+TEST(LatencyHistogramTest, MergeMatchesRecordingEverything) {
+  LatencyHistogram all;
+  LatencyHistogram first;
+  LatencyHistogram second;
+  for (int i = 0; i < 1000; ++i) {
+    const int64_t value = (i * 7919) % 5000;
+    all.Record(value);
+    (i % 3 == 0 ? first : second).Record(value);
+  }
+  LatencyHistogram merged;
+  merged.Merge(first);
+  merged.Merge(second);
+  merged.Merge(LatencyHistogram());
+  EXPECT_EQ(merged.num_values(), all.num_values());
+  EXPECT_EQ(merged.min(), all.min());
+  EXPECT_EQ(merged.max(), all.max());
+  EXPECT_NEAR(merged.mean(), all.mean(), 1e-9);
+  EXPECT_NEAR(merged.standard_deviation(), all.standard_deviation(), 1e-6);
+  for (const double percentile : {50.0, 95.0, 99.0, 99.9}) {
+    EXPECT_EQ(merged.Percentile(percentile), all.Percentile(percentile));
+  }
+}
+
+TEST(LatencyHistogramTest, PresizedMatchesDefault) {
+  LatencyHistogram presized(1'000'000);
+  LatencyHistogram growing;
+  for (const int64_t value : {0, 17, 4096, 999'999, 5'000'000}) {
+    presized.Record(value);
+    growing.Record(value);
+  }
+  EXPECT_EQ(presized.num_values(), growing.num_values());
+  EXPECT_EQ(presized.max(), growing.max());
+  for (const double percentile : {0.0, 50.0, 80.0, 100.0}) {
+    EXPECT_EQ(presized.Percentile(percentile),
+              growing.Percentile(percentile));
+  }
+}
+
+TEST(LatencyHistogramTest, ClearDropsValues) {
+  LatencyHistogram histogram(1000);
+  histogram.Record(10);
+  histogram.Record(500);
+  histogram.Clear();
+  EXPECT_EQ(histogram.num_values(), 0);
+  EXPECT_EQ(histogram.Percentile(50), 0);
+  histogram.Record(20);
+  EXPECT_EQ(histogram.num_values(), 1);
+  EXPECT_EQ(histogram.min(), 20);
+  EXPECT_EQ(histogram.max(), 20);
+  EXPECT_DOUBLE_EQ(histogram.mean(), 20.0);
+}
+
+}  // namespace
+}  // namespace codec
+}  // namespace chromemedia
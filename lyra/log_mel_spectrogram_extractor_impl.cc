@@ -26,9 +26,11 @@
 #include "absl/types/span.h"
 #include "audio/dsp/mfcc/mel_filterbank.h"
 #include "audio/dsp/number_util.h"
-#include "audio/dsp/spectrogram/spectrogram.h"
 #include "glog/logging.h"  // IWYU pragma: keep
 
+// Ooura's real discrete Fourier transform from fft2d.
+extern "C" void rdft(int n, int isgn, double* a, int* ip, double* w);
+
 namespace chromemedia {
 namespace codec {
 
@@ -42,13 +44,26 @@ static constexpr double kUpperFreqLimitFactor = 0.495;
 }  // namespace
 
 LogMelSpectrogramExtractorImpl::LogMelSpectrogramExtractorImpl(
-    std::unique_ptr<audio_dsp::Spectrogram> spectrogram,
     std::unique_ptr<audio_dsp::MelFilterbank> mel_filterbank,
-    int hop_length_samples)
-    : spectrogram_(std::move(spectrogram)),
-      mel_filterbank_(std::move(mel_filterbank)),
+    int hop_length_samples, int window_length_samples, int num_mel_bins)
+    : mel_filterbank_(std::move(mel_filterbank)),
       hop_length_samples_(hop_length_samples),
-      samples_(hop_length_samples, 0.0) {}
+      num_mel_bins_(num_mel_bins),
+      fft_length_(static_cast<int>(audio_dsp::NextPowerOfTwo(
+          static_cast<unsigned>(window_length_samples)))),
+      window_(window_length_samples),
+      samples_(window_length_samples, 0.0),
+      fft_input_output_(fft_length_ + 2, 0.0),
+      fft_integer_working_area_(
+          2 + static_cast<int>(std::sqrt(fft_length_ / 2)), 0),
+      fft_double_working_area_(fft_length_ / 2, 0.0),
+      power_spectrum_(fft_length_ / 2 + 1, 0.0),
+      mel_features_(num_mel_bins, 0.0) {
+  const double pi = std::atan(1) * 4;
+  for (int i = 0; i < window_length_samples; ++i) {
+    window_[i] = 0.5 - 0.5 * std::cos((2 * pi * i) / window_length_samples);
+  }
+}
 
 std::unique_ptr<LogMelSpectrogramExtractorImpl>
 LogMelSpectrogramExtractorImpl::Create(int sample_rate_hz,
@@ -61,20 +76,10 @@ LogMelSpectrogramExtractorImpl::Create(int sample_rate_hz,
                << hop_length_samples;
     return nullptr;
   }
-  auto spectrogram = std::make_unique<audio_dsp::Spectrogram>();
-  if (!spectrogram->Initialize(window_length_samples, hop_length_samples)) {
+  if (window_length_samples < 2 || hop_length_samples < 1) {
     LOG(ERROR) << "Could not initialize spectrogram for feature extraction.";
     return nullptr;
   }
-  // To get a spectrogram for the first audio of hop length samples we first
-  // calculate the spectrogram of an empty window to fill the internal queue.
-  std::vector<std::vector<double>> unused_spectrogram_slices;
-  if (!spectrogram->ComputeSpectrogram(
-          std::vector<double>(window_length_samples, 0.0),
-          &unused_spectrogram_slices)) {
-    LOG(ERROR) << "Error calculating spectrogram of empty window.";
-    return nullptr;
-  }
 
   // Compute the next power of two for FFT size.
   const int kFftSize = static_cast<int>(
@@ -90,39 +95,71 @@ LogMelSpectrogramExtractorImpl::Create(int sample_rate_hz,
   }
 
   return absl::WrapUnique(new LogMelSpectrogramExtractorImpl(
-      std::move(spectrogram), std::move(mel_filterbank), hop_length_samples));
+      std::move(mel_filterbank), hop_length_samples, window_length_samples,
+      num_mel_bins));
 }
 
 std::optional<std::vector<float>> LogMelSpectrogramExtractorImpl::Extract(
     const absl::Span<const int16_t> audio) {
-  if (audio.size() != hop_length_samples_) {
-    LOG(ERROR) << "Input audio should have " << hop_length_samples_
-               << " samples but instead had " << audio.size() << ".";
+  std::vector<float> mel_features(num_mel_bins_);
+  if (!ExtractInto(audio, absl::MakeSpan(mel_features))) {
     return std::nullopt;
   }
+  return mel_features;
+}
 
-  std::copy(audio.begin(), audio.end(), samples_.begin());
-
-  std::vector<std::vector<double>> spectrogram_slices;
-  if (!spectrogram_->ComputeSpectrogram(samples_, &spectrogram_slices)) {
-    LOG(ERROR) << "Could not compute spectrogram from audio.";
-    return std::nullopt;
+bool LogMelSpectrogramExtractorImpl::ExtractInto(
+    const absl::Span<const int16_t> audio, absl::Span<float> features) {
+  if (audio.size() != hop_length_samples_) {
+    LOG(ERROR) << "Input audio should have " << hop_length_samples_
+               << " samples but instead had " << audio.size() << ".";
+    return false;
   }
-  if (spectrogram_slices.size() != 1) {
-    LOG(ERROR) << "Spectrogram had unexpected number of output features.";
-    return std::nullopt;
+  if (features.size() != num_mel_bins_) {
+    LOG(ERROR) << "Output features should have " << num_mel_bins_
+               << " elements but instead had " << features.size() << ".";
+    return false;
   }
 
-  std::vector<double> temp_features;
-  mel_filterbank_->Compute(spectrogram_slices.at(0), &temp_features);
-  std::vector<float> mel_features(temp_features.begin(), temp_features.end());
+  ComputePowerSpectrum(audio);
+  mel_filterbank_->Compute(power_spectrum_, &mel_features_);
   // Compute the log, but disallow values below the floor, then
   // normalize the amplitude to avoid clipping in Wavenet.
-  for (auto& val : mel_features) {
-    val = std::log(std::max(val, kLogFloor)) / kNorm;
+  for (int i = 0; i < num_mel_bins_; ++i) {
+    features[i] =
+        std::log(std::max(static_cast<float>(mel_features_[i]), kLogFloor)) /
+        kNorm;
   }
+  return true;
+}
 
-  return mel_features;
+void LogMelSpectrogramExtractorImpl::ComputePowerSpectrum(
+    const absl::Span<const int16_t> audio) {
+  // Slide the window forward by one hop.
+  std::copy(samples_.begin() + hop_length_samples_, samples_.end(),
+            samples_.begin());
+  std::copy(audio.begin(), audio.end(), samples_.end() - hop_length_samples_);
+
+  const int window_length_samples = samples_.size();
+  for (int i = 0; i < window_length_samples; ++i) {
+    fft_input_output_[i] = samples_[i] * window_[i];
+  }
+  std::fill(fft_input_output_.begin() + window_length_samples,
+            fft_input_output_.end(), 0.0);
+
+  const int kForwardFft = 1;
+  rdft(fft_length_, kForwardFft, fft_input_output_.data(),
+       fft_integer_working_area_.data(), fft_double_working_area_.data());
+  // Move the packed Nyquist term out of the imaginary part of the DC bin.
+  fft_input_output_[fft_length_] = fft_input_output_[1];
+  fft_input_output_[fft_length_ + 1] = 0;
+  fft_input_output_[1] = 0;
+
+  for (int i = 0; i < power_spectrum_.size(); ++i) {
+    const double re = fft_input_output_[2 * i];
+    const double im = fft_input_output_[2 * i + 1];
+    power_spectrum_[i] = re * re + im * im;
+  }
 }
 
 double LogMelSpectrogramExtractorImpl::GetLowerFreqLimit() {
@@ -24,7 +24,6 @@
 
 #include "absl/types/span.h"
 #include "audio/dsp/mfcc/mel_filterbank.h"
-#include "audio/dsp/spectrogram/spectrogram.h"
 #include "lyra/feature_extractor_interface.h"
 
 namespace chromemedia {
@@ -46,6 +45,11 @@ class LogMelSpectrogramExtractorImpl : public FeatureExtractorInterface {
   std::optional<std::vector<float>> Extract(
       const absl::Span<const int16_t> audio) override;
 
+  // Same as |Extract|, but writes the features into |features|, which must
+  // have |num_mel_bins| elements. Does not allocate.
+  bool ExtractInto(const absl::Span<const int16_t> audio,
+                   absl::Span<float> features) override;
+
   // Returns the lower frequency limit used to initialize the MelFilterbank
   // class.
   static double GetLowerFreqLimit();
@@ -64,14 +68,28 @@ class LogMelSpectrogramExtractorImpl : public FeatureExtractorInterface {
  private:
   LogMelSpectrogramExtractorImpl() = delete;
   LogMelSpectrogramExtractorImpl(
-      std::unique_ptr<audio_dsp::Spectrogram> spectrogram,
       std::unique_ptr<audio_dsp::MelFilterbank> mel_filterbank,
-      int hop_length_samples);
+      int hop_length_samples, int window_length_samples, int num_mel_bins);
+
+  // Shifts |audio| into the analysis window and computes its squared-magnitude
+  // spectrum into |power_spectrum_|. Matches audio_dsp::Spectrogram, which
+  // reallocates its output on every call.
+  void ComputePowerSpectrum(const absl::Span<const int16_t> audio);
 
-  const std::unique_ptr<audio_dsp::Spectrogram> spectrogram_;
   const std::unique_ptr<const audio_dsp::MelFilterbank> mel_filterbank_;
   const int hop_length_samples_;
+  const int num_mel_bins_;
+  const int fft_length_;
+  // Periodic Hann window.
+  std::vector<double> window_;
+  // The most recent window of samples, initially silence.
   std::vector<double> samples_;
+  // Input and output of the in-place real FFT, with room for the Nyquist bin.
+  std::vector<double> fft_input_output_;
+  std::vector<int> fft_integer_working_area_;
+  std::vector<double> fft_double_working_area_;
+  std::vector<double> power_spectrum_;
+  std::vector<double> mel_features_;
 };
 
 }  // namespace codec
@@ -83,6 +83,26 @@ TEST_F(LogMelSpectrogramExtractorImplTest, ThreeFeaturesEqualExpected) {
   }
 }
 
+TEST_F(LogMelSpectrogramExtractorImplTest, ExtractIntoEqualsExpected) {
+  std::vector<float> features(kNumMelBins);
+  for (int i = 0; i < kNumOutputMelFeatures; ++i) {
+    const absl::Span<const int16_t> audio = absl::MakeConstSpan(
+        &kWavData[i * kHopLengthSamples], kHopLengthSamples);
+
+    ASSERT_TRUE(
+        feature_extractor_->ExtractInto(audio, absl::MakeSpan(features)));
+    EXPECT_THAT(features, testing::Pointwise(testing::FloatEq(), kMelBins[i]));
+  }
+}
+
+TEST_F(LogMelSpectrogramExtractorImplTest, ExtractIntoWrongFeatureSizeFails) {
+  std::vector<float> features(kNumMelBins - 1);
+
+  EXPECT_FALSE(feature_extractor_->ExtractInto(
+      absl::MakeConstSpan(kWavData, kHopLengthSamples),
+      absl::MakeSpan(features)));
+}
+
 TEST_F(LogMelSpectrogramExtractorImplTest, SamplesLongerThanExpected) {
   std::vector<int16_t> audio(kHopLengthSamples + 1);
 
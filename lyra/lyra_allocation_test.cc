@@ -0,0 +1,228 @@
+// Copyright 2022 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <atomic>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+#include <new>
+#include <optional>
+#include <random>
+#include <string>
+#include <tuple>
+#include <vector>
+
+// Placeholder for get runfiles header.
+#include "absl/types/span.h"
+#include "gtest/gtest.h"
+#include "include/ghc/filesystem.hpp"
+#include "lyra/codec_stats.h"
+#include "lyra/lyra_config.h"
+#include "lyra/lyra_decoder.h"
+#include "lyra/lyra_encoder.h"
+
+namespace {
+
+// Allocations through operator new are counted while this is set.
+std::atomic<bool> count_allocations{false};
+std::atomic<int64_t> num_allocations{0};
+
+void* CountedAllocate(std::size_t size, std::size_t alignment) {
+  if (count_allocations.load(std::memory_order_relaxed)) {
+    num_allocations.fetch_add(1, std::memory_order_relaxed);
+  }
+  if (size == 0) {
+    size = 1;
+  }
+  if (alignment <= alignof(std::max_align_t)) {
+    return std::malloc(size);
+  }
+  // aligned_alloc requires the size to be a multiple of the alignment.
+  return std::aligned_alloc(alignment,
+                            (size + alignment - 1) / alignment * alignment);
+}
+
+void* CountedAllocateOrThrow(std::size_t size, std::size_t alignment) {
+  void* ptr = CountedAllocate(size, alignment);
+  if (ptr == nullptr) {
+    throw std::bad_alloc();
+  }
+  return ptr;
+}
+
+}  // namespace
+
+void* operator new(std::size_t size) {
+  return CountedAllocateOrThrow(size, alignof(std::max_align_t));
+}
+void* operator new[](std::size_t size) {
+  return CountedAllocateOrThrow(size, alignof(std::max_align_t));
+}
+void* operator new(std::size_t size, std::align_val_t alignment) {
+  return CountedAllocateOrThrow(size, static_cast<std::size_t>(alignment));
+}
+void* operator new[](std::size_t size, std::align_val_t alignment) {
+  return CountedAllocateOrThrow(size, static_cast<std::size_t>(alignment));
+}
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept {
+  return CountedAllocate(size, alignof(std::max_align_t));
+}
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept {
+  return CountedAllocate(size, alignof(std::max_align_t));
+}
+void operator delete(void* ptr) noexcept { std::free(ptr); }
+void operator delete[](void* ptr) noexcept { std::free(ptr); }
+void operator delete(void* ptr, std::size_t) noexcept { std::free(ptr); }
+void operator delete[](void* ptr, std::size_t) noexcept { std::free(ptr); }
+void operator delete(void* ptr, std::align_val_t) noexcept { std::free(ptr); }
+void operator delete[](void* ptr, std::align_val_t) noexcept {
+  std::free(ptr);
+}
+void operator delete(void* ptr, std::size_t, std::align_val_t) noexcept {
+  std::free(ptr);
+}
+void operator delete[](void* ptr, std::size_t, std::align_val_t) noexcept {
+  std::free(ptr);
+}
+
+namespace chromemedia {
+namespace codec {
+namespace {
+
+// Enough hops for every buffer to reach its steady-state size, including both
+// tone and noise hops for discontinuous transmission.
+static constexpr int kNumWarmUpHops = 100;
+static constexpr int kNumCountedHops = 100;
+
+// Counts the allocations made while in scope.
+class ScopedAllocationCounter {
+ public:
+  ScopedAllocationCounter() {
+    num_allocations.store(0);
+    count_allocations.store(true);
+  }
+  ~ScopedAllocationCounter() { count_allocations.store(false); }
+
+  int64_t count() const { return num_allocations.load(); }
+};
+
+// Alternates half-second bursts of a tone with low-level noise, so that
+// discontinuous transmission sends both full and empty packets.
+std::vector<int16_t> GenerateAudio(int sample_rate_hz, int num_samples) {
+  std::mt19937 gen(5489);
+  std::normal_distribution<float> noise(0.f, 30.f);
+  std::vector<int16_t> audio(num_samples);
+  for (int i = 0; i < num_samples; ++i) {
+    const bool is_tone = (i / (sample_rate_hz / 2)) % 2 == 0;
+    const float tone =
+        is_tone ? 8000.f * std::sin(2.f * M_PI * 440.f * i / sample_rate_hz)
+                : 0.f;
+    audio[i] = static_cast<int16_t>(tone + noise(gen));
+  }
+  return audio;
+}
+
+// Encodes |hop| and decodes the packet, if one was sent, into |decoded|.
+bool EncodeAndDecodeHop(LyraEncoder& encoder, LyraDecoder& decoder,
+                        absl::Span<const int16_t> hop,
+                        absl::Span<uint8_t> packet,
+                        absl::Span<int16_t> decoded) {
+  const std::optional<int> num_bytes = encoder.Encode(hop, packet);
+  if (!num_bytes.has_value()) {
+    return false;
+  }
+  // Empty packets would make the decoder conceal and generate comfort noise,
+  // which is not allocation-free.
+  if (num_bytes.value() == 0) {
+    return true;
+  }
+  return decoder.SetEncodedPacket(packet.first(num_bytes.value())) &&
+         decoder.DecodeSamples(decoded);
+}
+
+class LyraAllocationTest
+    : public testing::TestWithParam<std::tuple<int, int, bool>> {
+ protected:
+  LyraAllocationTest()
+      : sample_rate_hz_(std::get<0>(GetParam())),
+        num_quantized_bits_(std::get<1>(GetParam())),
+        enable_dtx_(std::get<2>(GetParam())),
+        model_path_(ghc::filesystem::current_path() /
+                    std::string("lyra/model_coeffs")) {}
+
+  const int sample_rate_hz_;
+  const int num_quantized_bits_;
+  const bool enable_dtx_;
+  const ghc::filesystem::path model_path_;
+};
+
+TEST_P(LyraAllocationTest, SteadyStateEncodeAndDecodeDoNotAllocate) {
+  auto encoder = LyraEncoder::Create(sample_rate_hz_, kNumChannels,
+                                     GetBitrate(num_quantized_bits_),
+                                     enable_dtx_, model_path_);
+  ASSERT_NE(encoder, nullptr);
+  auto decoder = LyraDecoder::Create(sample_rate_hz_, kNumChannels,
+                                     model_path_);
+  ASSERT_NE(decoder, nullptr);
+
+  const int num_samples_per_hop = GetNumSamplesPerHop(sample_rate_hz_);
+  const std::vector<int16_t> audio =
+      GenerateAudio(sample_rate_hz_,
+                    (kNumWarmUpHops + kNumCountedHops) * num_samples_per_hop);
+  std::vector<uint8_t> packet(GetPacketSize(num_quantized_bits_));
+  std::vector<int16_t> decoded(num_samples_per_hop);
+  const auto hop = [&](int i) {
+    return absl::MakeConstSpan(audio).subspan(i * num_samples_per_hop,
+                                              num_samples_per_hop);
+  };
+
+  for (int i = 0; i < kNumWarmUpHops; ++i) {
+    ASSERT_TRUE(EncodeAndDecodeHop(*encoder, *decoder, hop(i),
+                                   absl::MakeSpan(packet),
+                                   absl::MakeSpan(decoded)));
+  }
+
+  // Attached only now, so that any growth of their histograms would be
+  // counted.
+  CodecStats encoder_stats;
+  CodecStats decoder_stats;
+  encoder->set_stats_sink(&encoder_stats);
+  decoder->set_stats_sink(&decoder_stats);
+
+  bool success = true;
+  int64_t num_counted_allocations;
+  {
+    ScopedAllocationCounter counter;
+    for (int i = kNumWarmUpHops; i < kNumWarmUpHops + kNumCountedHops; ++i) {
+      success &= EncodeAndDecodeHop(*encoder, *decoder, hop(i),
+                                    absl::MakeSpan(packet),
+                                    absl::MakeSpan(decoded));
+    }
+    num_counted_allocations = counter.count();
+  }
+  EXPECT_TRUE(success);
+  EXPECT_EQ(num_counted_allocations, 0);
+}
+
+INSTANTIATE_TEST_SUITE_P(
+    SampleRatesBitratesAndDtx, LyraAllocationTest,
+    testing::Combine(testing::ValuesIn(kSupportedSampleRates),
+                     testing::ValuesIn(GetSupportedQuantizedBits()),
+                     testing::Bool()));
+
+}  // namespace
+}  // namespace codec
+}  // namespace chromemedia
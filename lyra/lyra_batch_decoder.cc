@@ -0,0 +1,112 @@
+// Copyright 2022 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "lyra/lyra_batch_decoder.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <utility>
+#include <vector>
+
+#include "absl/memory/memory.h"
+#include "absl/types/span.h"
+#include "glog/logging.h"  // IWYU pragma: keep
+#include "include/ghc/filesystem.hpp"
+#include "lyra/lyra_decoder.h"
+#include "lyra/thread_pool.h"
+
+namespace chromemedia {
+namespace codec {
+
+std::unique_ptr<LyraBatchDecoder> LyraBatchDecoder::Create(
+    int sample_rate_hz, int num_channels, int num_streams, int num_threads,
+    const ghc::filesystem::path& model_path) {
+  if (num_streams < 1) {
+    LOG(ERROR) << "Number of streams must be at least 1 but was "
+               << num_streams << ".";
+    return nullptr;
+  }
+  auto thread_pool = ThreadPool::Create(std::min(num_threads, num_streams));
+  if (thread_pool == nullptr) {
+    LOG(ERROR) << "Could not create thread pool.";
+    return nullptr;
+  }
+  // Model weights are loaded and packed by the first decoder only; the rest
+  // share them through |TfLiteModelRegistry|.
+  std::vector<std::unique_ptr<LyraDecoderInterface>> decoders;
+  decoders.reserve(num_streams);
+  for (int i = 0; i < num_streams; ++i) {
+    auto decoder =
+        LyraDecoder::Create(sample_rate_hz, num_channels, model_path);
+    if (decoder == nullptr) {
+      LOG(ERROR) << "Could not create decoder for stream " << i << ".";
+      return nullptr;
+    }
+    decoders.push_back(std::move(decoder));
+  }
+
+  // WrapUnique is used because of private c'tor.
+  return absl::WrapUnique(
+      new LyraBatchDecoder(std::move(decoders), std::move(thread_pool)));
+}
+
+LyraBatchDecoder::LyraBatchDecoder(
+    std::vector<std::unique_ptr<LyraDecoderInterface>> decoders,
+    std::unique_ptr<ThreadPool> thread_pool)
+    : decoders_(std::move(decoders)), thread_pool_(std::move(thread_pool)) {}
+
+bool LyraBatchDecoder::SetEncodedPacket(int stream,
+                                        absl::Span<const uint8_t> encoded) {
+  if (stream < 0 || stream >= num_streams()) {
+    LOG(ERROR) << "Stream " << stream << " is out of range [0, "
+               << num_streams() << ").";
+    return false;
+  }
+  return decoders_[stream]->SetEncodedPacket(encoded);
+}
+
+std::optional<std::vector<std::vector<int16_t>>>
+LyraBatchDecoder::DecodeSamples(int num_samples) {
+  std::vector<std::vector<int16_t>> result(num_streams());
+  std::atomic<bool> success(true);
+  thread_pool_->ParallelFor(num_streams(), [&](int stream) {
+    auto samples = decoders_[stream]->DecodeSamples(num_samples);
+    if (!samples.has_value()) {
+      LOG(ERROR) << "Could not decode samples of stream " << stream << ".";
+      success.store(false, std::memory_order_relaxed);
+      return;
+    }
+    result[stream] = std::move(samples.value());
+  });
+  if (!success.load(std::memory_order_relaxed)) {
+    return std::nullopt;
+  }
+  return result;
+}
+
+bool LyraBatchDecoder::is_comfort_noise(int stream) const {
+  return decoders_.at(stream)->is_comfort_noise();
+}
+
+int LyraBatchDecoder::num_streams() const { return decoders_.size(); }
+
+int LyraBatchDecoder::sample_rate_hz() const {
+  return decoders_.front()->sample_rate_hz();
+}
+
+}  // namespace codec
+}  // namespace chromemedia
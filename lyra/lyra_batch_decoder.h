@@ -0,0 +1,106 @@
+/*
+ * Copyright 2022 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LYRA_LYRA_BATCH_DECODER_H_
+#define LYRA_LYRA_BATCH_DECODER_H_
+
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <vector>
+
+#include "absl/types/span.h"
+#include "include/ghc/filesystem.hpp"
+#include "lyra/lyra_decoder_interface.h"
+#include "lyra/thread_pool.h"
+
+namespace chromemedia {
+namespace codec {
+
+/// Decodes many independent Lyra streams in lock step.
+///
+/// Every stream owns a full |LyraDecoder|, so packet loss concealment and
+/// comfort noise state stay separate per stream. All streams share the model
+/// weights and XNNPack packed weights, and each call decodes the streams in
+/// parallel over a fixed pool of threads.
+class LyraBatchDecoder {
+ public:
+  /// Static method to create a LyraBatchDecoder.
+  ///
+  /// @param sample_rate_hz Desired sample rate in Hertz of every stream. The
+  ///                       supported sample rates are 8000, 16000, 32000 and
+  ///                       48000.
+  /// @param num_channels Desired number of channels. Currently only 1 is
+  ///                     supported.
+  /// @param num_streams Number of independent streams to decode.
+  /// @param num_threads Number of threads, including the calling one, used to
+  ///                    decode the streams.
+  /// @param model_path Path to the model weights.
+  /// @return A unique_ptr to a |LyraBatchDecoder| if all desired params are
+  ///         supported. Else it returns a nullptr.
+  static std::unique_ptr<LyraBatchDecoder> Create(
+      int sample_rate_hz, int num_channels, int num_streams, int num_threads,
+      const ghc::filesystem::path& model_path);
+
+  /// Parses a packet of one stream and prepares to decode samples from it.
+  ///
+  /// @param stream Index of the stream in [0, num_streams()).
+  /// @param encoded Encoded packet as a span of bytes.
+  /// @return True if |stream| exists and the packet is a valid Lyra packet.
+  bool SetEncodedPacket(int stream, absl::Span<const uint8_t> encoded);
+
+  /// Decodes the same number of samples from every stream.
+  ///
+  /// Streams without enough received packets conceal the loss and fade to
+  /// comfort noise exactly like |LyraDecoder::DecodeSamples|.
+  ///
+  /// @param num_samples Number of samples to decode per stream.
+  /// @return One vector of int16-formatted samples per stream, or nullopt if
+  ///         any stream failed.
+  std::optional<std::vector<std::vector<int16_t>>> DecodeSamples(
+      int num_samples);
+
+  /// Checks if one stream is in comfort noise generation mode.
+  ///
+  /// @param stream Index of the stream in [0, num_streams()).
+  /// @return True if the stream is in comfort noise generation mode.
+  bool is_comfort_noise(int stream) const;
+
+  /// Getter for the number of streams.
+  ///
+  /// @return Number of streams.
+  int num_streams() const;
+
+  /// Getter for the sample rate in Hertz.
+  ///
+  /// @return Sample rate in Hertz.
+  int sample_rate_hz() const;
+
+ private:
+  LyraBatchDecoder() = delete;
+  LyraBatchDecoder(std::vector<std::unique_ptr<LyraDecoderInterface>> decoders,
+                   std::unique_ptr<ThreadPool> thread_pool);
+
+  std::vector<std::unique_ptr<LyraDecoderInterface>> decoders_;
+  std::unique_ptr<ThreadPool> thread_pool_;
+
+  friend class LyraBatchDecoderPeer;
+};
+
+}  // namespace codec
+}  // namespace chromemedia
+
+#endif  // LYRA_LYRA_BATCH_DECODER_H_
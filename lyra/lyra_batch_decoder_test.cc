@@ -0,0 +1,190 @@
+// Copyright 2022 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "lyra/lyra_batch_decoder.h"
+
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Placeholder for get runfiles header.
+#include "absl/memory/memory.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/span.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "include/ghc/filesystem.hpp"
+#include "lyra/lyra_components.h"
+#include "lyra/lyra_config.h"
+#include "lyra/lyra_decoder.h"
+#include "lyra/lyra_decoder_interface.h"
+#include "lyra/testing/mock_lyra_decoder.h"
+#include "lyra/thread_pool.h"
+
+namespace chromemedia {
+namespace codec {
+
+// Use a test peer to access the private constructor of LyraBatchDecoder in
+// order to inject MockLyraDecoders.
+class LyraBatchDecoderPeer {
+ public:
+  static std::unique_ptr<LyraBatchDecoder> Create(
+      std::vector<std::unique_ptr<LyraDecoderInterface>> decoders,
+      int num_threads) {
+    return absl::WrapUnique(new LyraBatchDecoder(
+        std::move(decoders), ThreadPool::Create(num_threads)));
+  }
+};
+
+namespace {
+
+using testing::_;
+using testing::An;
+using testing::Return;
+
+static constexpr absl::string_view kExportedModelPath = "lyra/model_coeffs";
+
+TEST(LyraBatchDecoderTest, CreateFailsWithoutStreams) {
+  EXPECT_EQ(LyraBatchDecoder::Create(16000, kNumChannels, 0, 1,
+                                     ghc::filesystem::current_path() /
+                                         kExportedModelPath),
+            nullptr);
+}
+
+TEST(LyraBatchDecoderTest, CreateFailsWithUnsupportedSampleRate) {
+  EXPECT_EQ(LyraBatchDecoder::Create(100, kNumChannels, 2, 1,
+                                     ghc::filesystem::current_path() /
+                                         kExportedModelPath),
+            nullptr);
+}
+
+TEST(LyraBatchDecoderTest, PacketsAreRoutedToTheirStream) {
+  const std::vector<uint8_t> packet(
+      GetPacketSize(GetSupportedQuantizedBits().front()));
+  auto first = std::make_unique<MockLyraDecoder>();
+  auto second = std::make_unique<MockLyraDecoder>();
+  EXPECT_CALL(*first, SetEncodedPacket(_)).Times(0);
+  EXPECT_CALL(*second, SetEncodedPacket(_)).WillOnce(Return(true));
+  std::vector<std::unique_ptr<LyraDecoderInterface>> decoders;
+  decoders.push_back(std::move(first));
+  decoders.push_back(std::move(second));
+  auto batch_decoder = LyraBatchDecoderPeer::Create(std::move(decoders), 2);
+
+  EXPECT_TRUE(batch_decoder->SetEncodedPacket(1, packet));
+  EXPECT_FALSE(batch_decoder->SetEncodedPacket(2, packet));
+  EXPECT_FALSE(batch_decoder->SetEncodedPacket(-1, packet));
+}
+
+TEST(LyraBatchDecoderTest, DecodeSamplesScattersEveryStream) {
+  constexpr int kNumStreams = 5;
+  constexpr int kNumSamples = 320;
+  std::vector<std::unique_ptr<LyraDecoderInterface>> decoders;
+  for (int i = 0; i < kNumStreams; ++i) {
+    auto decoder = std::make_unique<MockLyraDecoder>();
+    EXPECT_CALL(*decoder, DecodeSamples(kNumSamples))
+        .WillOnce(Return(std::vector<int16_t>(kNumSamples, i)));
+    decoders.push_back(std::move(decoder));
+  }
+  auto batch_decoder = LyraBatchDecoderPeer::Create(std::move(decoders), 3);
+
+  const auto samples = batch_decoder->DecodeSamples(kNumSamples);
+  ASSERT_TRUE(samples.has_value());
+  ASSERT_EQ(samples->size(), kNumStreams);
+  for (int i = 0; i < kNumStreams; ++i) {
+    EXPECT_EQ(samples->at(i), std::vector<int16_t>(kNumSamples, i));
+  }
+}
+
+TEST(LyraBatchDecoderTest, DecodeSamplesFailsIfAnyStreamFails) {
+  std::vector<std::unique_ptr<LyraDecoderInterface>> decoders;
+  for (bool fails : {false, true, false}) {
+    auto decoder = std::make_unique<MockLyraDecoder>();
+    EXPECT_CALL(*decoder, DecodeSamples(An<int>()))
+        .WillOnce(Return(fails ? std::nullopt
+                               : std::optional<std::vector<int16_t>>(
+                                     std::vector<int16_t>(320))));
+    decoders.push_back(std::move(decoder));
+  }
+  auto batch_decoder = LyraBatchDecoderPeer::Create(std::move(decoders), 2);
+
+  EXPECT_FALSE(batch_decoder->DecodeSamples(320).has_value());
+}
+
+class LyraBatchDecoderMatchesDecoderTest
+    : public testing::TestWithParam<int> {};
+
+// Every stream of a batch must decode exactly like a stand-alone
+// |LyraDecoder| fed the same packets, including across packet loss.
+TEST_P(LyraBatchDecoderMatchesDecoderTest, OutputMatchesLyraDecoder) {
+  constexpr int kNumStreams = 3;
+  constexpr int kNumHops = 30;
+  const int sample_rate_hz = GetParam();
+  const ghc::filesystem::path model_path =
+      ghc::filesystem::current_path() / kExportedModelPath;
+  const int num_samples_per_hop = GetNumSamplesPerHop(sample_rate_hz);
+  const int num_quantized_bits = GetSupportedQuantizedBits()[1];
+  auto packet = CreatePacket(kNumHeaderBits, num_quantized_bits);
+
+  auto batch_decoder = LyraBatchDecoder::Create(sample_rate_hz, kNumChannels,
+                                                kNumStreams, 2, model_path);
+  ASSERT_NE(batch_decoder, nullptr);
+  std::vector<std::unique_ptr<LyraDecoder>> decoders;
+  for (int i = 0; i < kNumStreams; ++i) {
+    decoders.push_back(
+        LyraDecoder::Create(sample_rate_hz, kNumChannels, model_path));
+    ASSERT_NE(decoders.back(), nullptr);
+  }
+
+  std::mt19937 gen(5489);
+  std::bernoulli_distribution bit(0.5);
+  std::bernoulli_distribution lost(0.3);
+  for (int hop = 0; hop < kNumHops; ++hop) {
+    for (int stream = 0; stream < kNumStreams; ++stream) {
+      // Stream 0 never loses packets so at least one stream stays active.
+      if (stream > 0 && lost(gen)) {
+        continue;
+      }
+      std::string quantized(num_quantized_bits, '0');
+      for (char& c : quantized) {
+        c = bit(gen) ? '1' : '0';
+      }
+      const std::vector<uint8_t> encoded = packet->PackQuantized(quantized);
+      ASSERT_TRUE(batch_decoder->SetEncodedPacket(stream, encoded));
+      ASSERT_TRUE(decoders[stream]->SetEncodedPacket(encoded));
+    }
+
+    const auto batch_samples =
+        batch_decoder->DecodeSamples(num_samples_per_hop);
+    ASSERT_TRUE(batch_samples.has_value());
+    for (int stream = 0; stream < kNumStreams; ++stream) {
+      const auto samples = decoders[stream]->DecodeSamples(num_samples_per_hop);
+      ASSERT_TRUE(samples.has_value());
+      EXPECT_EQ(batch_samples->at(stream), samples.value())
+          << "stream " << stream << " hop " << hop;
+      EXPECT_EQ(batch_decoder->is_comfort_noise(stream),
+                decoders[stream]->is_comfort_noise());
+    }
+  }
+}
+
+INSTANTIATE_TEST_SUITE_P(SampleRates, LyraBatchDecoderMatchesDecoderTest,
+                         testing::ValuesIn(kSupportedSampleRates));
+
+}  // namespace
+}  // namespace codec
+}  // namespace chromemedia
@@ -0,0 +1,113 @@
+// Copyright 2022 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "lyra/lyra_batch_encoder.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <utility>
+#include <vector>
+
+#include "absl/memory/memory.h"
+#include "absl/types/span.h"
+#include "glog/logging.h"  // IWYU pragma: keep
+#include "include/ghc/filesystem.hpp"
+#include "lyra/lyra_encoder.h"
+#include "lyra/thread_pool.h"
+
+namespace chromemedia {
+namespace codec {
+
+std::unique_ptr<LyraBatchEncoder> LyraBatchEncoder::Create(
+    int sample_rate_hz, int num_channels, int bitrate, bool enable_dtx,
+    int num_streams, int num_threads,
+    const ghc::filesystem::path& model_path) {
+  if (num_streams < 1) {
+    LOG(ERROR) << "Number of streams must be at least 1 but was "
+               << num_streams << ".";
+    return nullptr;
+  }
+  auto thread_pool = ThreadPool::Create(std::min(num_threads, num_streams));
+  if (thread_pool == nullptr) {
+    LOG(ERROR) << "Could not create thread pool.";
+    return nullptr;
+  }
+  // Model weights are loaded and packed by the first encoder only; the rest
+  // share them through |TfLiteModelRegistry|.
+  std::vector<std::unique_ptr<LyraEncoderInterface>> encoders;
+  encoders.reserve(num_streams);
+  for (int i = 0; i < num_streams; ++i) {
+    auto encoder = LyraEncoder::Create(sample_rate_hz, num_channels, bitrate,
+                                       enable_dtx, model_path);
+    if (encoder == nullptr) {
+      LOG(ERROR) << "Could not create encoder for stream " << i << ".";
+      return nullptr;
+    }
+    encoders.push_back(std::move(encoder));
+  }
+
+  // WrapUnique is used because of private c'tor.
+  return absl::WrapUnique(
+      new LyraBatchEncoder(std::move(encoders), std::move(thread_pool)));
+}
+
+LyraBatchEncoder::LyraBatchEncoder(
+    std::vector<std::unique_ptr<LyraEncoderInterface>> encoders,
+    std::unique_ptr<ThreadPool> thread_pool)
+    : encoders_(std::move(encoders)), thread_pool_(std::move(thread_pool)) {}
+
+std::optional<std::vector<std::vector<uint8_t>>> LyraBatchEncoder::Encode(
+    const std::vector<absl::Span<const int16_t>>& audio) {
+  if (audio.size() != encoders_.size()) {
+    LOG(ERROR) << "Expected audio for " << num_streams()
+               << " streams but got " << audio.size() << ".";
+    return std::nullopt;
+  }
+  std::vector<std::vector<uint8_t>> result(num_streams());
+  std::atomic<bool> success(true);
+  thread_pool_->ParallelFor(num_streams(), [&](int stream) {
+    auto packet = encoders_[stream]->Encode(audio[stream]);
+    if (!packet.has_value()) {
+      LOG(ERROR) << "Could not encode audio of stream " << stream << ".";
+      success.store(false, std::memory_order_relaxed);
+      return;
+    }
+    result[stream] = std::move(packet.value());
+  });
+  if (!success.load(std::memory_order_relaxed)) {
+    return std::nullopt;
+  }
+  return result;
+}
+
+bool LyraBatchEncoder::set_bitrate(int stream, int bitrate) {
+  if (stream < 0 || stream >= num_streams()) {
+    LOG(ERROR) << "Stream " << stream << " is out of range [0, "
+               << num_streams() << ").";
+    return false;
+  }
+  return encoders_[stream]->set_bitrate(bitrate);
+}
+
+int LyraBatchEncoder::num_streams() const { return encoders_.size(); }
+
+int LyraBatchEncoder::sample_rate_hz() const {
+  return encoders_.front()->sample_rate_hz();
+}
+
+}  // namespace codec
+}  // namespace chromemedia
@@ -0,0 +1,106 @@
+/*
+ * Copyright 2022 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LYRA_LYRA_BATCH_ENCODER_H_
+#define LYRA_LYRA_BATCH_ENCODER_H_
+
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <vector>
+
+#include "absl/types/span.h"
+#include "include/ghc/filesystem.hpp"
+#include "lyra/lyra_encoder_interface.h"
+#include "lyra/thread_pool.h"
+
+namespace chromemedia {
+namespace codec {
+
+/// Encodes many independent Lyra streams in lock step.
+///
+/// Every stream owns a full |LyraEncoder|, so resampler, noise estimator and
+/// DTX state stay separate per stream. All streams share the model weights
+/// and XNNPack packed weights, and each call encodes the streams in parallel
+/// over a fixed pool of threads.
+class LyraBatchEncoder {
+ public:
+  /// Static method to create a LyraBatchEncoder.
+  ///
+  /// @param sample_rate_hz Desired sample rate in Hertz of every stream. The
+  ///                       supported sample rates are 8000, 16000, 32000 and
+  ///                       48000.
+  /// @param num_channels Desired number of channels. Currently only 1 is
+  ///                     supported.
+  /// @param bitrate Desired bit rate of every stream. The supported bit rates
+  ///                are 3200, 6000 and 9200.
+  /// @param enable_dtx Set to true if discontinuous transmission should be
+  ///                   enabled.
+  /// @param num_streams Number of independent streams to encode.
+  /// @param num_threads Number of threads, including the calling one, used to
+  ///                    encode the streams.
+  /// @param model_path Path to the model weights.
+  /// @return A unique_ptr to a |LyraBatchEncoder| if all desired params are
+  ///         supported. Else it returns a nullptr.
+  static std::unique_ptr<LyraBatchEncoder> Create(
+      int sample_rate_hz, int num_channels, int bitrate, bool enable_dtx,
+      int num_streams, int num_threads,
+      const ghc::filesystem::path& model_path);
+
+  /// Encodes one hop of every stream.
+  ///
+  /// @param audio One span of int16-formatted samples per stream, each
+  ///              containing 20ms of data at the sample rate chosen at Create
+  ///              time.
+  /// @return One encoded packet per stream, or nullopt if the number of
+  ///         spans does not match the number of streams or any stream failed.
+  ///         A packet is empty if DTX is enabled and its hop contains
+  ///         background noise.
+  std::optional<std::vector<std::vector<uint8_t>>> Encode(
+      const std::vector<absl::Span<const int16_t>>& audio);
+
+  /// Setter for the bitrate of one stream.
+  ///
+  /// @param stream Index of the stream in [0, num_streams()).
+  /// @param bitrate Desired bitrate in bps.
+  /// @return True if |stream| exists and the bitrate is supported.
+  bool set_bitrate(int stream, int bitrate);
+
+  /// Getter for the number of streams.
+  ///
+  /// @return Number of streams.
+  int num_streams() const;
+
+  /// Getter for the sample rate in Hertz.
+  ///
+  /// @return Sample rate in Hertz.
+  int sample_rate_hz() const;
+
+ private:
+  LyraBatchEncoder() = delete;
+  LyraBatchEncoder(std::vector<std::unique_ptr<LyraEncoderInterface>> encoders,
+                   std::unique_ptr<ThreadPool> thread_pool);
+
+  std::vector<std::unique_ptr<LyraEncoderInterface>> encoders_;
+  std::unique_ptr<ThreadPool> thread_pool_;
+
+  friend class LyraBatchEncoderPeer;
+};
+
+}  // namespace codec
+}  // namespace chromemedia
+
+#endif  // LYRA_LYRA_BATCH_ENCODER_H_
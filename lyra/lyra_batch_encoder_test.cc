@@ -0,0 +1,197 @@
+// Copyright 2022 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "lyra/lyra_batch_encoder.h"
+
+#include <cmath>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <random>
+#include <utility>
+#include <vector>
+
+// Placeholder for get runfiles header.
+#include "absl/memory/memory.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/span.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "include/ghc/filesystem.hpp"
+#include "lyra/lyra_config.h"
+#include "lyra/lyra_encoder.h"
+#include "lyra/lyra_encoder_interface.h"
+#include "lyra/testing/mock_lyra_encoder.h"
+#include "lyra/thread_pool.h"
+
+namespace chromemedia {
+namespace codec {
+
+// Use a test peer to access the private constructor of LyraBatchEncoder in
+// order to inject MockLyraEncoders.
+class LyraBatchEncoderPeer {
+ public:
+  static std::unique_ptr<LyraBatchEncoder> Create(
+      std::vector<std::unique_ptr<LyraEncoderInterface>> encoders,
+      int num_threads) {
+    return absl::WrapUnique(new LyraBatchEncoder(
+        std::move(encoders), ThreadPool::Create(num_threads)));
+  }
+};
+
+namespace {
+
+using testing::_;
+using testing::Return;
+
+static constexpr absl::string_view kExportedModelPath = "lyra/model_coeffs";
+
+TEST(LyraBatchEncoderTest, CreateFailsWithoutStreams) {
+  EXPECT_EQ(LyraBatchEncoder::Create(16000, kNumChannels, 3200, false, 0, 1,
+                                     ghc::filesystem::current_path() /
+                                         kExportedModelPath),
+            nullptr);
+}
+
+TEST(LyraBatchEncoderTest, CreateFailsWithUnsupportedBitrate) {
+  EXPECT_EQ(LyraBatchEncoder::Create(16000, kNumChannels, 1, false, 2, 1,
+                                     ghc::filesystem::current_path() /
+                                         kExportedModelPath),
+            nullptr);
+}
+
+TEST(LyraBatchEncoderTest, EncodeScattersEveryStream) {
+  constexpr int kNumStreams = 4;
+  const std::vector<int16_t> hop(320);
+  std::vector<std::unique_ptr<LyraEncoderInterface>> encoders;
+  for (int i = 0; i < kNumStreams; ++i) {
+    auto encoder = std::make_unique<MockLyraEncoder>();
+    EXPECT_CALL(*encoder, Encode(_))
+        .WillOnce(Return(std::vector<uint8_t>(i, i)));
+    encoders.push_back(std::move(encoder));
+  }
+  auto batch_encoder = LyraBatchEncoderPeer::Create(std::move(encoders), 2);
+
+  const auto packets = batch_encoder->Encode(
+      std::vector<absl::Span<const int16_t>>(kNumStreams, hop));
+  ASSERT_TRUE(packets.has_value());
+  ASSERT_EQ(packets->size(), kNumStreams);
+  for (int i = 0; i < kNumStreams; ++i) {
+    EXPECT_EQ(packets->at(i), std::vector<uint8_t>(i, i));
+  }
+}
+
+TEST(LyraBatchEncoderTest, EncodeFailsWithWrongNumberOfStreams) {
+  const std::vector<int16_t> hop(320);
+  std::vector<std::unique_ptr<LyraEncoderInterface>> encoders;
+  for (int i = 0; i < 2; ++i) {
+    auto encoder = std::make_unique<MockLyraEncoder>();
+    EXPECT_CALL(*encoder, Encode(_)).Times(0);
+    encoders.push_back(std::move(encoder));
+  }
+  auto batch_encoder = LyraBatchEncoderPeer::Create(std::move(encoders), 2);
+
+  EXPECT_FALSE(batch_encoder
+                   ->Encode(std::vector<absl::Span<const int16_t>>(3, hop))
+                   .has_value());
+}
+
+TEST(LyraBatchEncoderTest, EncodeFailsIfAnyStreamFails) {
+  const std::vector<int16_t> hop(320);
+  std::vector<std::unique_ptr<LyraEncoderInterface>> encoders;
+  for (bool fails : {true, false}) {
+    auto encoder = std::make_unique<MockLyraEncoder>();
+    EXPECT_CALL(*encoder, Encode(_))
+        .WillOnce(Return(fails ? std::nullopt
+                               : std::optional<std::vector<uint8_t>>(
+                                     std::vector<uint8_t>(8))));
+    encoders.push_back(std::move(encoder));
+  }
+  auto batch_encoder = LyraBatchEncoderPeer::Create(std::move(encoders), 2);
+
+  EXPECT_FALSE(batch_encoder
+                   ->Encode(std::vector<absl::Span<const int16_t>>(2, hop))
+                   .has_value());
+}
+
+TEST(LyraBatchEncoderTest, SetBitrateChecksStream) {
+  auto encoder = std::make_unique<MockLyraEncoder>();
+  EXPECT_CALL(*encoder, set_bitrate(6000)).WillOnce(Return(true));
+  std::vector<std::unique_ptr<LyraEncoderInterface>> encoders;
+  encoders.push_back(std::move(encoder));
+  auto batch_encoder = LyraBatchEncoderPeer::Create(std::move(encoders), 1);
+
+  EXPECT_TRUE(batch_encoder->set_bitrate(0, 6000));
+  EXPECT_FALSE(batch_encoder->set_bitrate(1, 6000));
+}
+
+class LyraBatchEncoderMatchesEncoderTest
+    : public testing::TestWithParam<int> {};
+
+// Every stream of a batch must encode exactly like a stand-alone
+// |LyraEncoder|, including the per-stream DTX decisions.
+TEST_P(LyraBatchEncoderMatchesEncoderTest, PacketsMatchLyraEncoder) {
+  constexpr int kNumStreams = 3;
+  constexpr int kNumHops = 25;
+  const int sample_rate_hz = GetParam();
+  const ghc::filesystem::path model_path =
+      ghc::filesystem::current_path() / kExportedModelPath;
+  const int num_samples_per_hop = GetNumSamplesPerHop(sample_rate_hz);
+
+  auto batch_encoder =
+      LyraBatchEncoder::Create(sample_rate_hz, kNumChannels, 3200,
+                               /*enable_dtx=*/true, kNumStreams, 2, model_path);
+  ASSERT_NE(batch_encoder, nullptr);
+  std::vector<std::unique_ptr<LyraEncoder>> encoders;
+  for (int i = 0; i < kNumStreams; ++i) {
+    encoders.push_back(LyraEncoder::Create(sample_rate_hz, kNumChannels, 3200,
+                                           /*enable_dtx=*/true, model_path));
+    ASSERT_NE(encoders.back(), nullptr);
+  }
+
+  // Each stream gets a tone of a different level over low noise, so that
+  // streams drift in and out of DTX independently.
+  std::mt19937 gen(5489);
+  std::normal_distribution<float> noise(0.f, 30.f);
+  for (int hop = 0; hop < kNumHops; ++hop) {
+    std::vector<std::vector<int16_t>> audio(kNumStreams);
+    for (int stream = 0; stream < kNumStreams; ++stream) {
+      const bool is_active = (hop / (stream + 2)) % 2 == 0;
+      for (int i = 0; i < num_samples_per_hop; ++i) {
+        const float tone =
+            is_active ? 3000.f * std::sin(0.05f * (hop * num_samples_per_hop +
+                                                   i) * (stream + 1))
+                      : 0.f;
+        audio[stream].push_back(static_cast<int16_t>(tone + noise(gen)));
+      }
+    }
+
+    const auto batch_packets = batch_encoder->Encode(
+        std::vector<absl::Span<const int16_t>>(audio.begin(), audio.end()));
+    ASSERT_TRUE(batch_packets.has_value());
+    for (int stream = 0; stream < kNumStreams; ++stream) {
+      const auto packet = encoders[stream]->Encode(audio[stream]);
+      ASSERT_TRUE(packet.has_value());
+      EXPECT_EQ(batch_packets->at(stream), packet.value())
+          << "stream " << stream << " hop " << hop;
+    }
+  }
+}
+
+INSTANTIATE_TEST_SUITE_P(SampleRates, LyraBatchEncoderMatchesEncoderTest,
+                         testing::ValuesIn(kSupportedSampleRates));
+
+}  // namespace
+}  // namespace codec
+}  // namespace chromemedia
@@ -40,6 +40,16 @@ ABSL_FLAG(bool, benchmark_quantizer, true,
 ABSL_FLAG(bool, benchmark_generative_model, true,
           "Whether to benchmark the generative model.");
 
+ABSL_FLAG(std::string, output_dir, "/tmp/benchmarks",
+          "Directory for a CSV file with the timings of each stage and a "
+          "lyra_benchmark.json report with their percentiles and the host. "
+          "Created if it does not exist. Empty only logs the stats.");
+
+ABSL_FLAG(bool, profile_tflite_ops, false,
+          "Whether to log the time spent in each TFLite op, and which ops "
+          "ran on XNNPack and which on the builtin kernels. Also written to "
+          "tflite_ops.txt in --output_dir. Adds overhead to the timings.");
+
 int main(int argc, char** argv) {
   absl::SetProgramUsageMessage(argv[0]);
   absl::ParseCommandLine(argc, argv);
@@ -48,5 +58,7 @@ int main(int argc, char** argv) {
       absl::GetFlag(FLAGS_num_cond_vectors), absl::GetFlag(FLAGS_model_path),
       absl::GetFlag(FLAGS_benchmark_feature_extraction),
       absl::GetFlag(FLAGS_benchmark_quantizer),
-      absl::GetFlag(FLAGS_benchmark_generative_model));
+      absl::GetFlag(FLAGS_benchmark_generative_model),
+      absl::GetFlag(FLAGS_output_dir),
+      absl::GetFlag(FLAGS_profile_tflite_ops));
 }
@@ -20,7 +20,6 @@
 #include <cstdint>
 #include <fstream>  // IWYU pragma: keep // b/24696850
 #include <memory>
-#include <numeric>
 #include <optional>
 #include <random>
 #include <string>
@@ -36,15 +35,17 @@
 #include "absl/strings/string_view.h"
 #include "absl/strings/substitute.h"
 #include "absl/types/span.h"
-#include "audio/dsp/signal_vector_util.h"
 #include "glog/logging.h"  // IWYU pragma: keep
 #include "include/ghc/filesystem.hpp"
 #include "lyra/architecture_utils.h"
+#include "lyra/benchmark_report.h"
 #include "lyra/dsp_utils.h"
 #include "lyra/feature_extractor_interface.h"
 #include "lyra/generative_model_interface.h"
+#include "lyra/latency_histogram.h"
 #include "lyra/lyra_components.h"
 #include "lyra/lyra_config.h"
+#include "lyra/tflite_op_profile.h"
 
 #ifdef BENCHMARK
 #include "absl/base/thread_annotations.h"
@@ -57,28 +58,20 @@ namespace codec {
 
 const int kNumQuantizedBits = 120;
 
-// Given an array of ints, computes the max, min, mean, and standard deviation.
-// Returns the results as a string.
-TimingStats GetTimingStats(const std::vector<int64_t>& timings_microsecs) {
+// Computes the max, min, mean, standard deviation and percentiles of the
+// timings in |histogram|.
+TimingStats GetTimingStats(const LatencyHistogram& histogram) {
   TimingStats timing_stats;
-  timing_stats.num_calls = static_cast<int64_t>(timings_microsecs.size());
-  timing_stats.mean_microsecs =
-      std::accumulate(timings_microsecs.begin(), timings_microsecs.end(), 0l) /
-      timing_stats.num_calls;
-  timing_stats.max_microsecs =
-      *std::max_element(timings_microsecs.begin(), timings_microsecs.end());
-  timing_stats.min_microsecs =
-      *std::min_element(timings_microsecs.begin(), timings_microsecs.end());
-  std::vector<float> variances(timings_microsecs.size());
-  std::transform(timings_microsecs.begin() + 1, timings_microsecs.end(),
-                 variances.begin(), [&](int64_t timings_microsecs) {
-                   return audio_dsp::Square(timings_microsecs -
-                                            timing_stats.mean_microsecs) /
-                          timing_stats.num_calls;
-                 });
-  timing_stats.standard_deviation =
-      std::sqrt(std::accumulate(variances.begin(), variances.end(), 0.f));
-
+  timing_stats.num_calls = histogram.num_values();
+  timing_stats.mean_microsecs = std::llround(histogram.mean());
+  timing_stats.max_microsecs = histogram.max();
+  timing_stats.min_microsecs = histogram.min();
+  // Over every call, as a population rather than a sample.
+  timing_stats.standard_deviation = histogram.standard_deviation();
+  timing_stats.p50_microsecs = histogram.Percentile(50);
+  timing_stats.p95_microsecs = histogram.Percentile(95);
+  timing_stats.p99_microsecs = histogram.Percentile(99);
+  timing_stats.p999_microsecs = histogram.Percentile(99.9);
   return timing_stats;
 }
 
@@ -159,13 +152,22 @@ std::optional<std::vector<int16_t>> MaybeRunGenerativeModel(
   return decoded;
 }
 
-// Prints stats for the runtime information in |timings|. For desktop, also
-// writes to CSV files under /tmp/benchmark/.
+// Prints stats for the runtime information in |timings| and adds them to
+// |report|. If |output_dir| is not empty, also writes the timings to a CSV
+// file there.
 void PrintStatsAndWriteCSV(const std::vector<int64_t>& timings,
-                           const absl::string_view title) {
+                           const absl::string_view title,
+                           const ghc::filesystem::path& output_dir,
+                           BenchmarkReport* report) {
   constexpr absl::string_view stats_template =
-      "%18s:  max: %5.3f ms  min: %5.3f ms  mean: %5.3f ms  stdev: %5.3f ms";
-  auto stats = GetTimingStats(timings);
+      "%18s:  max: %5.3f ms  min: %5.3f ms  mean: %5.3f ms  stdev: %5.3f ms  "
+      "p50: %5.3f ms  p95: %5.3f ms  p99: %5.3f ms  p99.9: %5.3f ms";
+  LatencyHistogram histogram;
+  for (const int64_t timing : timings) {
+    histogram.Record(timing);
+  }
+  report->AddStage(title, histogram);
+  auto stats = GetTimingStats(histogram);
 
   // Because benchmarks are performed on a per-hop basis internally, translate
   // the numbers to per-packet (per-frame) ones, which users care more about.
@@ -173,7 +175,11 @@ void PrintStatsAndWriteCSV(const std::vector<int64_t>& timings,
       stats_template, title, static_cast<float>(stats.max_microsecs) / 1000.0f,
       static_cast<float>(stats.min_microsecs) / 1000.0f,
       static_cast<float>(stats.mean_microsecs) / 1000.0f,
-      static_cast<float>(stats.standard_deviation) / 1000.0f);
+      static_cast<float>(stats.standard_deviation) / 1000.0f,
+      static_cast<float>(stats.p50_microsecs) / 1000.0f,
+      static_cast<float>(stats.p95_microsecs) / 1000.0f,
+      static_cast<float>(stats.p99_microsecs) / 1000.0f,
+      static_cast<float>(stats.p999_microsecs) / 1000.0f);
 #ifdef __ANDROID__
   __android_log_print(ANDROID_LOG_DEBUG, "lyra_benchmark", "%s",
                       stats_string.c_str());
@@ -181,11 +187,8 @@ void PrintStatsAndWriteCSV(const std::vector<int64_t>& timings,
   LOG(INFO) << stats_string;
 #endif
 
-#if !defined __arm__ && !defined __aarch64__
-  const ghc::filesystem::path output_dir("/tmp/benchmarks/");
-  std::error_code error_code;
-  if (!ghc::filesystem::is_directory(output_dir, error_code)) {
-    CHECK(ghc::filesystem::create_directories(output_dir, error_code));
+  if (output_dir.empty()) {
+    return;
   }
   const std::string filename = absl::Substitute("$0.csv", title);
   std::ofstream csv((output_dir / filename).string());
@@ -193,22 +196,37 @@ void PrintStatsAndWriteCSV(const std::vector<int64_t>& timings,
   for (const auto element : timings) {
     csv << element << std::endl;
   }
-#endif  // !defined __arm__ && !defined __aarch64__
 }
 
 int lyra_benchmark(const int num_cond_vectors,
                    const std::string& model_base_path,
                    const bool benchmark_feature_extraction,
                    const bool benchmark_quantizer,
-                   const bool benchmark_generative_model) {
+                   const bool benchmark_generative_model,
+                   const std::string& output_dir,
+                   const bool profile_tflite_ops) {
   if (num_cond_vectors <= 0) {
     LOG(ERROR) << "The number of conditioning vectors has to be positive.";
     return -1;
   }
+  if (!output_dir.empty()) {
+    std::error_code error_code;
+    if (!ghc::filesystem::is_directory(output_dir, error_code) &&
+        !ghc::filesystem::create_directories(output_dir, error_code)) {
+      LOG(ERROR) << "Could not create output dir " << output_dir << ": "
+                 << error_code.message();
+      return -1;
+    }
+  }
 
   const int num_samples_per_hop = GetNumSamplesPerHop(kInternalSampleRateHz);
   const std::string model_path = GetCompleteArchitecturePath(model_base_path);
 
+  // Only models created while profiling is enabled are profiled.
+  TfLiteOpProfileRegistry& op_profiles = TfLiteOpProfileRegistry::Get();
+  op_profiles.Clear();
+  op_profiles.set_enabled(profile_tflite_ops);
+
   std::unique_ptr<FeatureExtractorInterface> feature_extractor =
       benchmark_feature_extraction ? CreateFeatureExtractor(model_path)
                                    : nullptr;
@@ -220,6 +238,7 @@ int lyra_benchmark(const int num_cond_vectors,
       benchmark_generative_model
           ? CreateGenerativeModel(kNumFeatures, model_path)
           : nullptr;
+  op_profiles.set_enabled(false);
 
   std::vector<int64_t> feature_extractor_timings;
   std::vector<int64_t> quantizer_quantize_timings;
@@ -282,13 +301,46 @@ int lyra_benchmark(const int num_cond_vectors,
         quantizer_decode_timings[i] + model_decode_timings[i]);
   }
 
+  BenchmarkReport report("lyra_benchmark");
+  report.AddParameter("num_cond_vectors", num_cond_vectors);
+  report.AddParameter("benchmark_feature_extraction",
+                      benchmark_feature_extraction);
+  report.AddParameter("benchmark_quantizer", benchmark_quantizer);
+  report.AddParameter("benchmark_generative_model",
+                      benchmark_generative_model);
+  // Profiling adds to the latencies.
+  report.AddParameter("profile_tflite_ops", profile_tflite_ops);
   LOG(INFO) << "For generating " << num_cond_vectors << " frames of audio:";
-  PrintStatsAndWriteCSV(feature_extractor_timings, "feature_extractor");
-  PrintStatsAndWriteCSV(quantizer_quantize_timings, "quantizer_quantize");
-  PrintStatsAndWriteCSV(quantizer_decode_timings, "quantizer_decode");
-  PrintStatsAndWriteCSV(model_decode_timings, "model_decode");
-  PrintStatsAndWriteCSV(total_timings, "total");
+  PrintStatsAndWriteCSV(feature_extractor_timings, "feature_extractor",
+                        output_dir, &report);
+  PrintStatsAndWriteCSV(quantizer_quantize_timings, "quantizer_quantize",
+                        output_dir, &report);
+  PrintStatsAndWriteCSV(quantizer_decode_timings, "quantizer_decode",
+                        output_dir, &report);
+  PrintStatsAndWriteCSV(model_decode_timings, "model_decode", output_dir,
+                        &report);
+  PrintStatsAndWriteCSV(total_timings, "total", output_dir, &report);
+  if (!output_dir.empty() &&
+      !report.WriteJson(ghc::filesystem::path(output_dir) /
+                        "lyra_benchmark.json")) {
+    return -1;
+  }
 #endif  // BENCHMARK
+
+  if (profile_tflite_ops) {
+    const std::string op_table = op_profiles.ToString();
+#ifdef __ANDROID__
+    __android_log_print(ANDROID_LOG_DEBUG, "lyra_benchmark", "%s",
+                        op_table.c_str());
+#else
+    LOG(INFO) << "Time spent in each TFLite op:\n" << op_table;
+#endif
+    if (!output_dir.empty()) {
+      std::ofstream op_file(
+          (ghc::filesystem::path(output_dir) / "tflite_ops.txt").string());
+      op_file << op_table;
+    }
+  }
   return 0;
 }
 
@@ -20,6 +20,8 @@
 #include <cstdint>
 #include <string>
 
+#include "lyra/latency_histogram.h"
+
 namespace chromemedia {
 namespace codec {
 
@@ -29,11 +31,25 @@ struct TimingStats {
   int64_t min_microsecs;
   int64_t num_calls;
   float standard_deviation;
+  int64_t p50_microsecs;
+  int64_t p95_microsecs;
+  int64_t p99_microsecs;
+  int64_t p999_microsecs;
 };
 
+TimingStats GetTimingStats(const LatencyHistogram& histogram);
+
+// Runs the benchmark and logs per-stage latency stats. If |output_dir| is not
+// empty, it is created if needed, the timings of each stage are written to a
+// CSV file there and all stats to lyra_benchmark.json, together with a
+// description of the host. If |profile_tflite_ops| is set, also logs the time
+// spent in each TFLite op and which ops were delegated to XNNPack, and writes
+// it to tflite_ops.txt in |output_dir|.
 int lyra_benchmark(int num_cond_vectors, const std::string& model_base_path,
                    bool benchmark_feature_extraction, bool benchmark_quantizer,
-                   bool benchmark_generative_model);
+                   bool benchmark_generative_model,
+                   const std::string& output_dir,
+                   bool profile_tflite_ops = false);
 
 }  // namespace codec
 }  // namespace chromemedia
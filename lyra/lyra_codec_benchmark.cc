@@ -0,0 +1,95 @@
+// Copyright 2022 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <string>
+#include <vector>
+
+#include "absl/flags/flag.h"
+#include "absl/flags/parse.h"
+#include "absl/flags/usage.h"
+#include "absl/strings/numbers.h"
+#include "glog/logging.h"  // IWYU pragma: keep
+#include "lyra/lyra_codec_benchmark_lib.h"
+
+ABSL_FLAG(std::vector<std::string>, sample_rates_hz, {},
+          "Comma separated sample rates to benchmark. Empty runs every "
+          "supported sample rate.");
+
+ABSL_FLAG(std::vector<std::string>, bitrates, {},
+          "Comma separated bitrates in bps to benchmark. Empty runs every "
+          "supported bitrate.");
+
+ABSL_FLAG(std::string, testdata_dir, "lyra/testdata",
+          "Directory with the speech samples sample1_<rate>kHz.wav and "
+          "sample2_<rate>kHz.wav of every sample rate.");
+
+ABSL_FLAG(int, num_repetitions, 10,
+          "How often the speech is repeated, for more stable numbers.");
+
+ABSL_FLAG(bool, enable_dtx, false,
+          "Enables discontinuous transmission (DTX) in the encoder.");
+
+ABSL_FLAG(double, packet_loss_rate, 0.0,
+          "Rate of packets lost between encoder and decoder, simulated with "
+          "a Gilbert model. Lost packets are concealed by the decoder.");
+
+ABSL_FLAG(double, average_burst_length, 1.0,
+          "Average number of packets lost in a row.");
+
+ABSL_FLAG(std::string, model_path, "lyra/model_coeffs",
+          "Path to directory containing TFLite files. For mobile this is the "
+          "absolute path, like "
+          "'/data/local/tmp/lyra/model_coeffs/'."
+          " For desktop this is the path relative to the binary.");
+
+ABSL_FLAG(std::string, output_dir, "/tmp/benchmarks",
+          "Directory for a lyra_codec_benchmark.json report. Created if it "
+          "does not exist. Empty only logs the results.");
+
+namespace {
+
+bool ParseInts(const std::vector<std::string>& texts, std::vector<int>* ints) {
+  for (const std::string& text : texts) {
+    int value;
+    if (!absl::SimpleAtoi(text, &value)) {
+      LOG(ERROR) << "'" << text << "' is not a number.";
+      return false;
+    }
+    ints->push_back(value);
+  }
+  return true;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  absl::SetProgramUsageMessage(argv[0]);
+  absl::ParseCommandLine(argc, argv);
+
+  chromemedia::codec::CodecBenchmarkOptions options;
+  if (!ParseInts(absl::GetFlag(FLAGS_sample_rates_hz),
+                 &options.sample_rates_hz) ||
+      !ParseInts(absl::GetFlag(FLAGS_bitrates), &options.bitrates)) {
+    return -1;
+  }
+  options.testdata_dir = absl::GetFlag(FLAGS_testdata_dir);
+  options.num_repetitions = absl::GetFlag(FLAGS_num_repetitions);
+  options.enable_dtx = absl::GetFlag(FLAGS_enable_dtx);
+  options.packet_loss_rate = absl::GetFlag(FLAGS_packet_loss_rate);
+  options.average_burst_length = absl::GetFlag(FLAGS_average_burst_length);
+  options.model_base_path = absl::GetFlag(FLAGS_model_path);
+  options.output_dir = absl::GetFlag(FLAGS_output_dir);
+
+  return chromemedia::codec::lyra_codec_benchmark(options);
+}
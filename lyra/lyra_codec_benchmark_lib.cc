@@ -0,0 +1,241 @@
+// Copyright 2022 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "lyra/lyra_codec_benchmark_lib.h"
+
+#include <cstdint>
+#include <iterator>
+#include <memory>
+#include <optional>
+#include <string>
+#include <system_error>  // NOLINT(build/c++11)
+#include <vector>
+
+#include "absl/status/statusor.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_format.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "absl/types/span.h"
+#include "glog/logging.h"  // IWYU pragma: keep
+#include "include/ghc/filesystem.hpp"
+#include "lyra/architecture_utils.h"
+#include "lyra/benchmark_report.h"
+#include "lyra/gilbert_model.h"
+#include "lyra/latency_histogram.h"
+#include "lyra/lyra_config.h"
+#include "lyra/lyra_decoder.h"
+#include "lyra/lyra_encoder.h"
+#include "lyra/packet_loss_model_interface.h"
+#include "lyra/wav_utils.h"
+
+namespace chromemedia {
+namespace codec {
+namespace {
+
+// Reads the speech samples of |sample_rate_hz| in |testdata_dir| and repeats
+// them |num_repetitions| times.
+std::optional<std::vector<int16_t>> ReadSpeech(
+    const ghc::filesystem::path& testdata_dir, int sample_rate_hz,
+    int num_repetitions) {
+  std::vector<int16_t> speech;
+  for (const int sample : {1, 2}) {
+    const ghc::filesystem::path wav_path =
+        testdata_dir /
+        absl::StrCat("sample", sample, "_", sample_rate_hz / 1000, "kHz.wav");
+    absl::StatusOr<ReadWavResult> read_wav_result =
+        Read16BitWavFileToVector(wav_path.string());
+    if (!read_wav_result.ok()) {
+      LOG(ERROR) << read_wav_result.status();
+      return std::nullopt;
+    }
+    if (read_wav_result->sample_rate_hz != sample_rate_hz ||
+        read_wav_result->num_channels != kNumChannels) {
+      LOG(ERROR) << wav_path << " is not mono at " << sample_rate_hz
+                 << " Hz.";
+      return std::nullopt;
+    }
+    speech.insert(speech.end(), read_wav_result->samples.begin(),
+                  read_wav_result->samples.end());
+  }
+  std::vector<int16_t> audio;
+  audio.reserve(speech.size() * num_repetitions);
+  for (int i = 0; i < num_repetitions; ++i) {
+    audio.insert(audio.end(), speech.begin(), speech.end());
+  }
+  return audio;
+}
+
+}  // namespace
+
+double CodecBenchmarkResult::encode_realtime_factor() const {
+  return absl::FDivDuration(audio_duration, encode_time);
+}
+
+double CodecBenchmarkResult::decode_realtime_factor() const {
+  return absl::FDivDuration(audio_duration, decode_time);
+}
+
+std::optional<CodecBenchmarkResult> BenchmarkCodec(
+    const std::vector<int16_t>& audio, int sample_rate_hz, int bitrate,
+    bool enable_dtx, PacketLossModelInterface* packet_loss_model,
+    const ghc::filesystem::path& model_path) {
+  auto encoder = LyraEncoder::Create(sample_rate_hz, kNumChannels, bitrate,
+                                     enable_dtx, model_path);
+  if (encoder == nullptr) {
+    LOG(ERROR) << "Could not create lyra encoder.";
+    return std::nullopt;
+  }
+  auto decoder = LyraDecoder::Create(sample_rate_hz, kNumChannels, model_path);
+  if (decoder == nullptr) {
+    LOG(ERROR) << "Could not create lyra decoder.";
+    return std::nullopt;
+  }
+
+  const int num_samples_per_hop = GetNumSamplesPerHop(sample_rate_hz);
+  std::vector<uint8_t> packet(BitrateToPacketSize(bitrate));
+  std::vector<int16_t> decoded(num_samples_per_hop);
+  CodecBenchmarkResult result;
+  result.num_hops = audio.size() / num_samples_per_hop;
+  result.audio_duration =
+      absl::Seconds(result.num_hops) / decoder->frame_rate();
+  for (int64_t hop = 0; hop < result.num_hops; ++hop) {
+    const absl::Time encode_start = absl::Now();
+    const std::optional<int> packet_size = encoder->Encode(
+        absl::MakeConstSpan(audio).subspan(hop * num_samples_per_hop,
+                                           num_samples_per_hop),
+        absl::MakeSpan(packet));
+    const absl::Duration encode_time = absl::Now() - encode_start;
+    if (!packet_size.has_value()) {
+      LOG(ERROR) << "Could not encode hop " << hop << ".";
+      return std::nullopt;
+    }
+    result.encode_time += encode_time;
+    result.encode_latency.Record(absl::ToInt64Microseconds(encode_time));
+
+    // Consulted for every hop, so that the model sees the packet timing.
+    const bool received =
+        packet_loss_model == nullptr || packet_loss_model->IsPacketReceived();
+    if (*packet_size == 0) {
+      ++result.num_dtx_hops;
+    } else if (!received) {
+      ++result.num_lost_packets;
+    }
+    const absl::Time decode_start = absl::Now();
+    if (received && *packet_size > 0 &&
+        !decoder->SetEncodedPacket(
+            absl::MakeConstSpan(packet).first(*packet_size))) {
+      LOG(ERROR) << "Could not set the packet of hop " << hop << ".";
+      return std::nullopt;
+    }
+    if (!decoder->DecodeSamples(absl::MakeSpan(decoded))) {
+      LOG(ERROR) << "Could not decode hop " << hop << ".";
+      return std::nullopt;
+    }
+    const absl::Duration decode_time = absl::Now() - decode_start;
+    result.decode_time += decode_time;
+    result.decode_latency.Record(absl::ToInt64Microseconds(decode_time));
+  }
+  return result;
+}
+
+int lyra_codec_benchmark(const CodecBenchmarkOptions& options) {
+  std::vector<int> sample_rates_hz = options.sample_rates_hz;
+  if (sample_rates_hz.empty()) {
+    sample_rates_hz.assign(std::begin(kSupportedSampleRates),
+                           std::end(kSupportedSampleRates));
+  }
+  std::vector<int> bitrates = options.bitrates;
+  if (bitrates.empty()) {
+    for (const int num_quantized_bits : GetSupportedQuantizedBits()) {
+      bitrates.push_back(GetBitrate(num_quantized_bits));
+    }
+  }
+  if (options.num_repetitions < 1) {
+    LOG(ERROR) << "The speech has to be repeated at least once.";
+    return -1;
+  }
+  if (!options.output_dir.empty()) {
+    std::error_code error_code;
+    if (!ghc::filesystem::is_directory(options.output_dir, error_code) &&
+        !ghc::filesystem::create_directories(options.output_dir,
+                                             error_code)) {
+      LOG(ERROR) << "Could not create output dir " << options.output_dir
+                 << ": " << error_code.message();
+      return -1;
+    }
+  }
+  const ghc::filesystem::path model_path =
+      GetCompleteArchitecturePath(options.model_base_path);
+
+  BenchmarkReport report("lyra_codec_benchmark");
+  report.AddParameter("num_repetitions", options.num_repetitions);
+  report.AddParameter("enable_dtx", options.enable_dtx);
+  report.AddMetric("packet_loss_rate", options.packet_loss_rate);
+  report.AddMetric("average_burst_length", options.average_burst_length);
+  for (const int sample_rate_hz : sample_rates_hz) {
+    const std::optional<std::vector<int16_t>> audio = ReadSpeech(
+        options.testdata_dir, sample_rate_hz, options.num_repetitions);
+    if (!audio.has_value()) {
+      return -1;
+    }
+    for (const int bitrate : bitrates) {
+      // A fixed seed makes every run lose the same packets.
+      std::unique_ptr<GilbertModel> packet_loss_model = GilbertModel::Create(
+          options.packet_loss_rate, options.average_burst_length,
+          /*random_seed=*/false);
+      if (packet_loss_model == nullptr) {
+        LOG(ERROR) << "Could not create packet loss simulator model.";
+        return -1;
+      }
+      const std::optional<CodecBenchmarkResult> result =
+          BenchmarkCodec(*audio, sample_rate_hz, bitrate, options.enable_dtx,
+                         packet_loss_model.get(), model_path);
+      if (!result.has_value()) {
+        return -1;
+      }
+      LOG(INFO) << absl::StrFormat(
+          "%5d Hz %5d bps:  encode: %7.1fx realtime  p50: %6.3f ms  "
+          "p99: %6.3f ms  decode: %7.1fx realtime  p50: %6.3f ms  "
+          "p99: %6.3f ms  lost: %d  dtx: %d of %d hops",
+          sample_rate_hz, bitrate, result->encode_realtime_factor(),
+          result->encode_latency.Percentile(50) / 1000.0,
+          result->encode_latency.Percentile(99) / 1000.0,
+          result->decode_realtime_factor(),
+          result->decode_latency.Percentile(50) / 1000.0,
+          result->decode_latency.Percentile(99) / 1000.0,
+          result->num_lost_packets, result->num_dtx_hops, result->num_hops);
+      const std::string name =
+          absl::StrCat(sample_rate_hz, "hz_", bitrate, "bps");
+      report.AddStage(absl::StrCat(name, "_encode"), result->encode_latency);
+      report.AddStage(absl::StrCat(name, "_decode"), result->decode_latency);
+      report.AddMetric(absl::StrCat(name, "_encode_realtime_factor"),
+                       result->encode_realtime_factor());
+      report.AddMetric(absl::StrCat(name, "_decode_realtime_factor"),
+                       result->decode_realtime_factor());
+      report.AddMetric(absl::StrCat(name, "_lost_packets"),
+                       result->num_lost_packets);
+      report.AddMetric(absl::StrCat(name, "_dtx_hops"), result->num_dtx_hops);
+    }
+  }
+  if (!options.output_dir.empty() &&
+      !report.WriteJson(ghc::filesystem::path(options.output_dir) /
+                        "lyra_codec_benchmark.json")) {
+    return -1;
+  }
+  return 0;
+}
+
+}  // namespace codec
+}  // namespace chromemedia
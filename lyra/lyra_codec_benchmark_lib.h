@@ -0,0 +1,90 @@
+/*
+ * Copyright 2022 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LYRA_LYRA_CODEC_BENCHMARK_LIB_H_
+#define LYRA_LYRA_CODEC_BENCHMARK_LIB_H_
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "absl/time/time.h"
+#include "include/ghc/filesystem.hpp"
+#include "lyra/latency_histogram.h"
+#include "lyra/packet_loss_model_interface.h"
+
+namespace chromemedia {
+namespace codec {
+
+struct CodecBenchmarkResult {
+  absl::Duration audio_duration = absl::ZeroDuration();
+  absl::Duration encode_time = absl::ZeroDuration();
+  absl::Duration decode_time = absl::ZeroDuration();
+  // Microseconds per |LyraEncoder::Encode| call.
+  LatencyHistogram encode_latency;
+  // Microseconds per hop decoded, including |LyraDecoder::SetEncodedPacket|
+  // if the packet arrived.
+  LatencyHistogram decode_latency;
+  int64_t num_hops = 0;
+  // Packets that DTX did not send.
+  int64_t num_dtx_hops = 0;
+  // Packets lost by the packet loss model.
+  int64_t num_lost_packets = 0;
+
+  // Seconds of audio processed per second.
+  double encode_realtime_factor() const;
+  double decode_realtime_factor() const;
+};
+
+// Runs |audio| through a new |LyraEncoder| and |LyraDecoder| hop by hop, like
+// a call between two endpoints, and times every call. Packets that DTX does
+// not send or |packet_loss_model| loses are concealed by the decoder. A
+// trailing partial hop is dropped. If |packet_loss_model| is nullptr no
+// packets are lost. Returns nullopt on failure.
+std::optional<CodecBenchmarkResult> BenchmarkCodec(
+    const std::vector<int16_t>& audio, int sample_rate_hz, int bitrate,
+    bool enable_dtx, PacketLossModelInterface* packet_loss_model,
+    const ghc::filesystem::path& model_path);
+
+struct CodecBenchmarkOptions {
+  // Empty runs every supported sample rate.
+  std::vector<int> sample_rates_hz;
+  // Empty runs every supported bitrate.
+  std::vector<int> bitrates;
+  // Holds the speech samples sample1_<rate>kHz.wav and sample2_<rate>kHz.wav
+  // of every sample rate.
+  std::string testdata_dir = "lyra/testdata";
+  // How often the speech is repeated, for more stable numbers.
+  int num_repetitions = 10;
+  bool enable_dtx = false;
+  float packet_loss_rate = 0.0f;
+  float average_burst_length = 1.0f;
+  std::string model_base_path = "lyra/model_coeffs";
+  // If not empty, a lyra_codec_benchmark.json report is written here.
+  std::string output_dir;
+};
+
+// Benchmarks the public encoder and decoder end to end, including resampling,
+// DTX, packet handling and concealment, at every combination of the sample
+// rates and bitrates of |options|, and logs realtime factors and per-call
+// latencies. Returns 0 on success.
+int lyra_codec_benchmark(const CodecBenchmarkOptions& options);
+
+}  // namespace codec
+}  // namespace chromemedia
+
+#endif  // LYRA_LYRA_CODEC_BENCHMARK_LIB_H_
@@ -0,0 +1,91 @@
+// Copyright 2022 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "lyra/lyra_codec_benchmark_lib.h"
+
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <vector>
+
+#include "absl/status/statusor.h"
+#include "absl/time/time.h"
+#include "gtest/gtest.h"
+#include "include/ghc/filesystem.hpp"
+#include "lyra/gilbert_model.h"
+#include "lyra/wav_utils.h"
+
+namespace chromemedia {
+namespace codec {
+namespace {
+
+class LyraCodecBenchmarkTest : public testing::Test {
+ protected:
+  LyraCodecBenchmarkTest()
+      : model_path_(ghc::filesystem::current_path() / "lyra/model_coeffs") {}
+
+  void SetUp() override {
+    absl::StatusOr<ReadWavResult> read_wav_result = Read16BitWavFileToVector(
+        (ghc::filesystem::current_path() / "lyra/testdata/sample1_16kHz.wav")
+            .string());
+    ASSERT_TRUE(read_wav_result.ok()) << read_wav_result.status();
+    // One second and a partial hop.
+    audio_.assign(read_wav_result->samples.begin(),
+                  read_wav_result->samples.begin() + 16000 + 100);
+  }
+
+  const ghc::filesystem::path model_path_;
+  std::vector<int16_t> audio_;
+};
+
+TEST_F(LyraCodecBenchmarkTest, TimesEveryHop) {
+  const std::optional<CodecBenchmarkResult> result =
+      BenchmarkCodec(audio_, 16000, 3200, /*enable_dtx=*/false,
+                     /*packet_loss_model=*/nullptr, model_path_);
+  ASSERT_TRUE(result.has_value());
+  EXPECT_EQ(result->num_hops, 50);
+  EXPECT_EQ(result->audio_duration, absl::Seconds(1));
+  EXPECT_EQ(result->encode_latency.num_values(), 50);
+  EXPECT_EQ(result->decode_latency.num_values(), 50);
+  EXPECT_EQ(result->num_lost_packets, 0);
+  EXPECT_EQ(result->num_dtx_hops, 0);
+  EXPECT_GT(result->encode_realtime_factor(), 0.0);
+  EXPECT_GT(result->decode_realtime_factor(), 0.0);
+}
+
+TEST_F(LyraCodecBenchmarkTest, ConcealsLostPackets) {
+  std::unique_ptr<GilbertModel> packet_loss_model =
+      GilbertModel::Create(0.5f, 2.0f, /*random_seed=*/false);
+  ASSERT_NE(packet_loss_model, nullptr);
+  const std::optional<CodecBenchmarkResult> result =
+      BenchmarkCodec(audio_, 16000, 6000, /*enable_dtx=*/false,
+                     packet_loss_model.get(), model_path_);
+  ASSERT_TRUE(result.has_value());
+  EXPECT_GT(result->num_lost_packets, 0);
+  EXPECT_LT(result->num_lost_packets, result->num_hops);
+  EXPECT_EQ(result->decode_latency.num_values(), 50);
+}
+
+TEST_F(LyraCodecBenchmarkTest, FailsWithInvalidParams) {
+  EXPECT_FALSE(BenchmarkCodec(audio_, 16000, 1234, /*enable_dtx=*/false,
+                              /*packet_loss_model=*/nullptr, model_path_)
+                   .has_value());
+  EXPECT_FALSE(BenchmarkCodec(audio_, 16001, 3200, /*enable_dtx=*/false,
+                              /*packet_loss_model=*/nullptr, model_path_)
+                   .has_value());
+}
+
+}  // namespace
+}  // namespace codec
+}  // namespace chromemedia
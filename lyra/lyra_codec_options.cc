@@ -0,0 +1,262 @@
+// Copyright 2022 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "lyra/lyra_codec_options.h"
+
+#include <cstdint>
+#include <limits>
+
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/str_format.h"
+#include "absl/strings/string_view.h"
+#include "absl/time/time.h"
+#include "glog/logging.h"  // IWYU pragma: keep
+#include "include/ghc/filesystem.hpp"
+#include "lyra/codec_stats_sink_interface.h"
+#include "lyra/lyra_config.h"
+#include "lyra/quantizer_type.h"
+#include "lyra/tflite_model_options.h"
+
+namespace chromemedia {
+namespace codec {
+namespace {
+
+absl::Duration HopDuration() { return absl::Seconds(1) / kFrameRate; }
+
+absl::Status ValidateModelOptions(const TfLiteModelOptions& model_options) {
+  if (model_options.threading.num_threads < 1) {
+    return absl::InvalidArgumentError(
+        absl::StrFormat("The number of threads has to be positive, but is %d.",
+                        model_options.threading.num_threads));
+  }
+  return absl::OkStatus();
+}
+
+absl::Status ValidateHopMultiple(absl::string_view name,
+                                 absl::Duration duration) {
+  if (duration <= absl::ZeroDuration() ||
+      duration % HopDuration() != absl::ZeroDuration()) {
+    return absl::InvalidArgumentError(absl::StrFormat(
+        "The %s has to be a positive multiple of %s, but is %s.", name,
+        absl::FormatDuration(HopDuration()), absl::FormatDuration(duration)));
+  }
+  if (duration > kMaxDecoderOptionsDuration) {
+    return absl::InvalidArgumentError(absl::StrFormat(
+        "The %s can be at most %s, but is %s.", name,
+        absl::FormatDuration(kMaxDecoderOptionsDuration),
+        absl::FormatDuration(duration)));
+  }
+  return absl::OkStatus();
+}
+
+}  // namespace
+
+absl::Status ValidateLyraEncoderOptions(const LyraEncoderOptions& options) {
+  absl::Status status = AreParamsSupported(
+      options.sample_rate_hz, options.num_channels, options.model_path);
+  if (!status.ok()) {
+    return status;
+  }
+  if (BitrateToNumQuantizedBits(options.bitrate) < 0) {
+    return absl::InvalidArgumentError(absl::StrFormat(
+        "Bitrate %d bps is not supported by codec.", options.bitrate));
+  }
+  return ValidateModelOptions(options.model_options);
+}
+
+absl::Status ValidateLyraDecoderOptions(const LyraDecoderOptions& options) {
+  absl::Status status = AreParamsSupported(
+      options.sample_rate_hz, options.num_channels, options.model_path);
+  if (!status.ok()) {
+    return status;
+  }
+  status = ValidateModelOptions(options.model_options);
+  if (!status.ok()) {
+    return status;
+  }
+  status = ValidateHopMultiple("concealment duration",
+                               options.concealment_duration);
+  if (!status.ok()) {
+    return status;
+  }
+  return ValidateHopMultiple("fade duration", options.fade_duration);
+}
+
+int DurationToInternalSamples(absl::Duration duration) {
+  const int64_t num_samples =
+      absl::IDivDuration(duration, HopDuration(), &duration) *
+      GetNumSamplesPerHop(kInternalSampleRateHz);
+  CHECK_LE(num_samples, std::numeric_limits<int>::max());
+  CHECK_GE(num_samples, std::numeric_limits<int>::min());
+  return static_cast<int>(num_samples);
+}
+
+LyraEncoderOptionsBuilder::LyraEncoderOptionsBuilder(
+    const ghc::filesystem::path& model_path) {
+  options_.model_path = model_path;
+}
+
+LyraEncoderOptionsBuilder& LyraEncoderOptionsBuilder::SetSampleRateHz(
+    int sample_rate_hz) {
+  options_.sample_rate_hz = sample_rate_hz;
+  return *this;
+}
+
+LyraEncoderOptionsBuilder& LyraEncoderOptionsBuilder::SetNumChannels(
+    int num_channels) {
+  options_.num_channels = num_channels;
+  return *this;
+}
+
+LyraEncoderOptionsBuilder& LyraEncoderOptionsBuilder::SetBitrate(int bitrate) {
+  options_.bitrate = bitrate;
+  return *this;
+}
+
+LyraEncoderOptionsBuilder& LyraEncoderOptionsBuilder::SetEnableDtx(
+    bool enable_dtx) {
+  options_.enable_dtx = enable_dtx;
+  return *this;
+}
+
+LyraEncoderOptionsBuilder& LyraEncoderOptionsBuilder::SetModelOptions(
+    const TfLiteModelOptions& model_options) {
+  options_.model_options = model_options;
+  return *this;
+}
+
+LyraEncoderOptionsBuilder& LyraEncoderOptionsBuilder::SetNumThreads(
+    int num_threads) {
+  options_.model_options.threading.num_threads = num_threads;
+  return *this;
+}
+
+LyraEncoderOptionsBuilder& LyraEncoderOptionsBuilder::SetUseXnnpack(
+    bool use_xnnpack) {
+  options_.model_options.use_xnnpack = use_xnnpack;
+  return *this;
+}
+
+LyraEncoderOptionsBuilder& LyraEncoderOptionsBuilder::SetUseWeightsCache(
+    bool use_weights_cache) {
+  options_.model_options.use_weights_cache = use_weights_cache;
+  return *this;
+}
+
+LyraEncoderOptionsBuilder& LyraEncoderOptionsBuilder::SetWarmUp(bool warm_up) {
+  options_.model_options.warm_up = warm_up;
+  return *this;
+}
+
+LyraEncoderOptionsBuilder& LyraEncoderOptionsBuilder::SetQuantizerType(
+    QuantizerType quantizer_type) {
+  options_.quantizer_type = quantizer_type;
+  return *this;
+}
+
+LyraEncoderOptionsBuilder& LyraEncoderOptionsBuilder::SetStatsSink(
+    CodecStatsSinkInterface* stats_sink) {
+  options_.stats_sink = stats_sink;
+  return *this;
+}
+
+absl::StatusOr<LyraEncoderOptions> LyraEncoderOptionsBuilder::Build() const {
+  const absl::Status status = ValidateLyraEncoderOptions(options_);
+  if (!status.ok()) {
+    return status;
+  }
+  return options_;
+}
+
+LyraDecoderOptionsBuilder::LyraDecoderOptionsBuilder(
+    const ghc::filesystem::path& model_path) {
+  options_.model_path = model_path;
+}
+
+LyraDecoderOptionsBuilder& LyraDecoderOptionsBuilder::SetSampleRateHz(
+    int sample_rate_hz) {
+  options_.sample_rate_hz = sample_rate_hz;
+  return *this;
+}
+
+LyraDecoderOptionsBuilder& LyraDecoderOptionsBuilder::SetNumChannels(
+    int num_channels) {
+  options_.num_channels = num_channels;
+  return *this;
+}
+
+LyraDecoderOptionsBuilder& LyraDecoderOptionsBuilder::SetModelOptions(
+    const TfLiteModelOptions& model_options) {
+  options_.model_options = model_options;
+  return *this;
+}
+
+LyraDecoderOptionsBuilder& LyraDecoderOptionsBuilder::SetNumThreads(
+    int num_threads) {
+  options_.model_options.threading.num_threads = num_threads;
+  return *this;
+}
+
+LyraDecoderOptionsBuilder& LyraDecoderOptionsBuilder::SetUseXnnpack(
+    bool use_xnnpack) {
+  options_.model_options.use_xnnpack = use_xnnpack;
+  return *this;
+}
+
+LyraDecoderOptionsBuilder& LyraDecoderOptionsBuilder::SetUseWeightsCache(
+    bool use_weights_cache) {
+  options_.model_options.use_weights_cache = use_weights_cache;
+  return *this;
+}
+
+LyraDecoderOptionsBuilder& LyraDecoderOptionsBuilder::SetWarmUp(bool warm_up) {
+  options_.model_options.warm_up = warm_up;
+  return *this;
+}
+
+LyraDecoderOptionsBuilder& LyraDecoderOptionsBuilder::SetQuantizerType(
+    QuantizerType quantizer_type) {
+  options_.quantizer_type = quantizer_type;
+  return *this;
+}
+
+LyraDecoderOptionsBuilder& LyraDecoderOptionsBuilder::SetStatsSink(
+    CodecStatsSinkInterface* stats_sink) {
+  options_.stats_sink = stats_sink;
+  return *this;
+}
+
+LyraDecoderOptionsBuilder& LyraDecoderOptionsBuilder::SetConcealmentDuration(
+    absl::Duration concealment_duration) {
+  options_.concealment_duration = concealment_duration;
+  return *this;
+}
+
+LyraDecoderOptionsBuilder& LyraDecoderOptionsBuilder::SetFadeDuration(
+    absl::Duration fade_duration) {
+  options_.fade_duration = fade_duration;
+  return *this;
+}
+
+absl::StatusOr<LyraDecoderOptions> LyraDecoderOptionsBuilder::Build() const {
+  const absl::Status status = ValidateLyraDecoderOptions(options_);
+  if (!status.ok()) {
+    return status;
+  }
+  return options_;
+}
+
+}  // namespace codec
+}  // namespace chromemedia
@@ -0,0 +1,162 @@
+/*
+ * Copyright 2022 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LYRA_LYRA_CODEC_OPTIONS_H_
+#define LYRA_LYRA_CODEC_OPTIONS_H_
+
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/time/time.h"
+#include "include/ghc/filesystem.hpp"
+#include "lyra/codec_stats_sink_interface.h"
+#include "lyra/lyra_config.h"
+#include "lyra/quantizer_type.h"
+#include "lyra/tflite_model_options.h"
+
+namespace chromemedia {
+namespace codec {
+
+/// Everything needed to create a LyraEncoder.
+///
+/// Only |model_path| has to be given. The other fields default to a mono 16kHz
+/// stream at 3200 bps without DTX, run like by the positional
+/// |LyraEncoder::Create|.
+struct LyraEncoderOptions {
+  /// Sample rate in Hertz of the audio passed to |Encode|. The supported
+  /// sample rates are 8000, 16000, 32000 and 48000.
+  int sample_rate_hz = kInternalSampleRateHz;
+  /// Number of channels. Currently only 1 is supported.
+  int num_channels = 1;
+  /// Initial bitrate in bps. The supported bitrates are 3200, 6000 and 9200.
+  int bitrate = 3200;
+  /// Set to true if discontinuous transmission should be enabled.
+  bool enable_dtx = false;
+  /// Path to the model weights. Models already loaded from the same path by
+  /// another encoder or decoder of the process are shared instead of being
+  /// loaded again.
+  ghc::filesystem::path model_path;
+  /// How the TFLite models are run.
+  TfLiteModelOptions model_options;
+  /// How the features are quantized.
+  QuantizerType quantizer_type = QuantizerType::kTfLite;
+  /// Initial stats sink, see |LyraEncoder::set_stats_sink|. Not owned.
+  CodecStatsSinkInterface* stats_sink = nullptr;
+};
+
+/// Upper bound of the durations of |LyraDecoderOptions|.
+inline constexpr absl::Duration kMaxDecoderOptionsDuration = absl::Seconds(10);
+
+/// Everything needed to create a LyraDecoder.
+///
+/// Only |model_path| has to be given. The other fields default to a mono 16kHz
+/// stream, run and concealed like by the positional |LyraDecoder::Create|.
+struct LyraDecoderOptions {
+  /// Sample rate in Hertz of the decoded audio. The supported sample rates
+  /// are 8000, 16000, 32000 and 48000.
+  int sample_rate_hz = kInternalSampleRateHz;
+  /// Number of channels. Currently only 1 is supported.
+  int num_channels = 1;
+  /// Path to the model weights, shared like |LyraEncoderOptions::model_path|.
+  ghc::filesystem::path model_path;
+  /// How the TFLite models are run.
+  TfLiteModelOptions model_options;
+  /// How the features are dequantized.
+  QuantizerType quantizer_type = QuantizerType::kTfLite;
+  /// Initial stats sink, see |LyraDecoder::set_stats_sink|. Not owned.
+  CodecStatsSinkInterface* stats_sink = nullptr;
+  /// How long lost packets are concealed by the generative model before
+  /// comfort noise takes over. Has to be a positive multiple of 20ms of at
+  /// most |kMaxDecoderOptionsDuration|.
+  absl::Duration concealment_duration = absl::Milliseconds(80);
+  /// How long it takes to fade from concealment to comfort noise, and from
+  /// comfort noise back to received packets. Has to be a positive multiple of
+  /// 20ms of at most |kMaxDecoderOptionsDuration|.
+  absl::Duration fade_duration = absl::Milliseconds(40);
+};
+
+/// Returns an error describing the first unsupported field of |options|.
+absl::Status ValidateLyraEncoderOptions(const LyraEncoderOptions& options);
+absl::Status ValidateLyraDecoderOptions(const LyraDecoderOptions& options);
+
+/// Converts a duration of |LyraDecoderOptions| to a number of samples at the
+/// internal sample rate. |duration| has to be a multiple of 20ms whose number
+/// of samples fits into an int, which holds for every valid duration.
+int DurationToInternalSamples(absl::Duration duration);
+
+/// Collects LyraEncoderOptions and validates them once they are complete.
+///
+/// Usage:
+///   absl::StatusOr<LyraEncoderOptions> options =
+///       LyraEncoderOptionsBuilder(model_path)
+///           .SetSampleRateHz(48000)
+///           .SetNumThreads(2)
+///           .Build();
+///   if (!options.ok()) { ... }
+///   auto encoder = LyraEncoder::Create(*options);
+class LyraEncoderOptionsBuilder {
+ public:
+  explicit LyraEncoderOptionsBuilder(const ghc::filesystem::path& model_path);
+
+  LyraEncoderOptionsBuilder& SetSampleRateHz(int sample_rate_hz);
+  LyraEncoderOptionsBuilder& SetNumChannels(int num_channels);
+  LyraEncoderOptionsBuilder& SetBitrate(int bitrate);
+  LyraEncoderOptionsBuilder& SetEnableDtx(bool enable_dtx);
+  LyraEncoderOptionsBuilder& SetModelOptions(
+      const TfLiteModelOptions& model_options);
+  LyraEncoderOptionsBuilder& SetNumThreads(int num_threads);
+  LyraEncoderOptionsBuilder& SetUseXnnpack(bool use_xnnpack);
+  LyraEncoderOptionsBuilder& SetUseWeightsCache(bool use_weights_cache);
+  LyraEncoderOptionsBuilder& SetWarmUp(bool warm_up);
+  LyraEncoderOptionsBuilder& SetQuantizerType(QuantizerType quantizer_type);
+  LyraEncoderOptionsBuilder& SetStatsSink(CodecStatsSinkInterface* stats_sink);
+
+  /// Returns the options, or an error if any of them is not supported.
+  absl::StatusOr<LyraEncoderOptions> Build() const;
+
+ private:
+  LyraEncoderOptions options_;
+};
+
+/// Collects LyraDecoderOptions and validates them once they are complete.
+class LyraDecoderOptionsBuilder {
+ public:
+  explicit LyraDecoderOptionsBuilder(const ghc::filesystem::path& model_path);
+
+  LyraDecoderOptionsBuilder& SetSampleRateHz(int sample_rate_hz);
+  LyraDecoderOptionsBuilder& SetNumChannels(int num_channels);
+  LyraDecoderOptionsBuilder& SetModelOptions(
+      const TfLiteModelOptions& model_options);
+  LyraDecoderOptionsBuilder& SetNumThreads(int num_threads);
+  LyraDecoderOptionsBuilder& SetUseXnnpack(bool use_xnnpack);
+  LyraDecoderOptionsBuilder& SetUseWeightsCache(bool use_weights_cache);
+  LyraDecoderOptionsBuilder& SetWarmUp(bool warm_up);
+  LyraDecoderOptionsBuilder& SetQuantizerType(QuantizerType quantizer_type);
+  LyraDecoderOptionsBuilder& SetStatsSink(CodecStatsSinkInterface* stats_sink);
+  LyraDecoderOptionsBuilder& SetConcealmentDuration(
+      absl::Duration concealment_duration);
+  LyraDecoderOptionsBuilder& SetFadeDuration(absl::Duration fade_duration);
+
+  /// Returns the options, or an error if any of them is not supported.
+  absl::StatusOr<LyraDecoderOptions> Build() const;
+
+ private:
+  LyraDecoderOptions options_;
+};
+
+}  // namespace codec
+}  // namespace chromemedia
+
+#endif  // LYRA_LYRA_CODEC_OPTIONS_H_
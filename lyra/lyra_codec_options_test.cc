@@ -0,0 +1,208 @@
+// Copyright 2022 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "lyra/lyra_codec_options.h"
+
+// Placeholder for get runfiles header.
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/time/time.h"
+#include "gtest/gtest.h"
+#include "include/ghc/filesystem.hpp"
+#include "lyra/codec_stats.h"
+#include "lyra/lyra_config.h"
+#include "lyra/quantizer_type.h"
+#include "lyra/tflite_model_options.h"
+
+namespace chromemedia {
+namespace codec {
+namespace {
+
+class LyraCodecOptionsTest : public testing::Test {
+ protected:
+  const ghc::filesystem::path model_path_ =
+      ghc::filesystem::current_path() / "lyra/model_coeffs";
+};
+
+TEST_F(LyraCodecOptionsTest, EncoderDefaults) {
+  absl::StatusOr<LyraEncoderOptions> options =
+      LyraEncoderOptionsBuilder(model_path_).Build();
+  ASSERT_TRUE(options.ok()) << options.status();
+  EXPECT_EQ(options->sample_rate_hz, kInternalSampleRateHz);
+  EXPECT_EQ(options->num_channels, 1);
+  EXPECT_EQ(options->bitrate, 3200);
+  EXPECT_FALSE(options->enable_dtx);
+  EXPECT_EQ(options->model_path, model_path_);
+  EXPECT_TRUE(options->model_options.use_xnnpack);
+  EXPECT_TRUE(options->model_options.use_weights_cache);
+  EXPECT_FALSE(options->model_options.warm_up);
+  EXPECT_EQ(options->model_options.threading.num_threads, 1);
+  EXPECT_EQ(options->quantizer_type, QuantizerType::kTfLite);
+  EXPECT_EQ(options->stats_sink, nullptr);
+}
+
+TEST_F(LyraCodecOptionsTest, EncoderBuilderSetsEveryOption) {
+  CodecStats stats;
+  absl::StatusOr<LyraEncoderOptions> options =
+      LyraEncoderOptionsBuilder(model_path_)
+          .SetSampleRateHz(48000)
+          .SetBitrate(9200)
+          .SetEnableDtx(true)
+          .SetNumThreads(4)
+          .SetUseXnnpack(false)
+          .SetUseWeightsCache(false)
+          .SetWarmUp(true)
+          .SetQuantizerType(QuantizerType::kNative)
+          .SetStatsSink(&stats)
+          .Build();
+  ASSERT_TRUE(options.ok()) << options.status();
+  EXPECT_EQ(options->sample_rate_hz, 48000);
+  EXPECT_EQ(options->bitrate, 9200);
+  EXPECT_TRUE(options->enable_dtx);
+  EXPECT_EQ(options->model_options.threading.num_threads, 4);
+  EXPECT_FALSE(options->model_options.use_xnnpack);
+  EXPECT_FALSE(options->model_options.use_weights_cache);
+  EXPECT_TRUE(options->model_options.warm_up);
+  EXPECT_EQ(options->quantizer_type, QuantizerType::kNative);
+  EXPECT_EQ(options->stats_sink, &stats);
+}
+
+TEST_F(LyraCodecOptionsTest, EncoderBuilderRejectsInvalidOptions) {
+  EXPECT_FALSE(LyraEncoderOptionsBuilder(model_path_)
+                   .SetSampleRateHz(44100)
+                   .Build()
+                   .ok());
+  EXPECT_FALSE(
+      LyraEncoderOptionsBuilder(model_path_).SetNumChannels(2).Build().ok());
+  EXPECT_FALSE(
+      LyraEncoderOptionsBuilder(model_path_).SetBitrate(1000).Build().ok());
+  EXPECT_FALSE(
+      LyraEncoderOptionsBuilder(model_path_).SetNumThreads(0).Build().ok());
+  EXPECT_FALSE(LyraEncoderOptionsBuilder("/does/not/exist").Build().ok());
+}
+
+TEST_F(LyraCodecOptionsTest, DecoderDefaults) {
+  absl::StatusOr<LyraDecoderOptions> options =
+      LyraDecoderOptionsBuilder(model_path_).Build();
+  ASSERT_TRUE(options.ok()) << options.status();
+  EXPECT_EQ(options->sample_rate_hz, kInternalSampleRateHz);
+  EXPECT_EQ(options->num_channels, 1);
+  EXPECT_EQ(options->model_path, model_path_);
+  EXPECT_EQ(options->model_options.threading.num_threads, 1);
+  EXPECT_EQ(options->quantizer_type, QuantizerType::kTfLite);
+  EXPECT_EQ(options->stats_sink, nullptr);
+  EXPECT_EQ(options->concealment_duration, absl::Milliseconds(80));
+  EXPECT_EQ(options->fade_duration, absl::Milliseconds(40));
+}
+
+TEST_F(LyraCodecOptionsTest, DecoderBuilderSetsEveryOption) {
+  CodecStats stats;
+  TfLiteModelOptions model_options;
+  model_options.use_weights_cache = false;
+  model_options.threading.num_threads = 3;
+  absl::StatusOr<LyraDecoderOptions> options =
+      LyraDecoderOptionsBuilder(model_path_)
+          .SetSampleRateHz(8000)
+          .SetModelOptions(model_options)
+          .SetWarmUp(true)
+          .SetQuantizerType(QuantizerType::kNative)
+          .SetStatsSink(&stats)
+          .SetConcealmentDuration(absl::Milliseconds(200))
+          .SetFadeDuration(absl::Milliseconds(60))
+          .Build();
+  ASSERT_TRUE(options.ok()) << options.status();
+  EXPECT_EQ(options->sample_rate_hz, 8000);
+  EXPECT_FALSE(options->model_options.use_weights_cache);
+  EXPECT_EQ(options->model_options.threading.num_threads, 3);
+  EXPECT_TRUE(options->model_options.warm_up);
+  EXPECT_EQ(options->quantizer_type, QuantizerType::kNative);
+  EXPECT_EQ(options->stats_sink, &stats);
+  EXPECT_EQ(options->concealment_duration, absl::Milliseconds(200));
+  EXPECT_EQ(options->fade_duration, absl::Milliseconds(60));
+}
+
+TEST_F(LyraCodecOptionsTest, DecoderBuilderSetsModelKnobs) {
+  absl::StatusOr<LyraDecoderOptions> options =
+      LyraDecoderOptionsBuilder(model_path_)
+          .SetNumThreads(2)
+          .SetUseXnnpack(false)
+          .SetUseWeightsCache(false)
+          .Build();
+  ASSERT_TRUE(options.ok()) << options.status();
+  EXPECT_EQ(options->model_options.threading.num_threads, 2);
+  EXPECT_FALSE(options->model_options.use_xnnpack);
+  EXPECT_FALSE(options->model_options.use_weights_cache);
+  EXPECT_FALSE(options->model_options.warm_up);
+}
+
+TEST_F(LyraCodecOptionsTest, DecoderBuilderRejectsInvalidOptions) {
+  EXPECT_FALSE(
+      LyraDecoderOptionsBuilder(model_path_).SetSampleRateHz(0).Build().ok());
+  EXPECT_FALSE(
+      LyraDecoderOptionsBuilder(model_path_).SetNumChannels(0).Build().ok());
+  EXPECT_FALSE(
+      LyraDecoderOptionsBuilder(model_path_).SetNumThreads(-1).Build().ok());
+  EXPECT_FALSE(LyraDecoderOptionsBuilder("/does/not/exist").Build().ok());
+  for (const absl::Duration invalid_duration :
+       {absl::ZeroDuration(), absl::Milliseconds(-20), absl::Milliseconds(30),
+        absl::Microseconds(20001),
+        kMaxDecoderOptionsDuration + absl::Milliseconds(20),
+        absl::Hours(24 * 365)}) {
+    EXPECT_FALSE(LyraDecoderOptionsBuilder(model_path_)
+                     .SetConcealmentDuration(invalid_duration)
+                     .Build()
+                     .ok());
+    EXPECT_FALSE(LyraDecoderOptionsBuilder(model_path_)
+                     .SetFadeDuration(invalid_duration)
+                     .Build()
+                     .ok());
+  }
+}
+
+TEST_F(LyraCodecOptionsTest, ValidatesOptionsBuiltByHand) {
+  LyraDecoderOptions options;
+  EXPECT_FALSE(ValidateLyraDecoderOptions(options).ok());
+  options.model_path = model_path_;
+  EXPECT_TRUE(ValidateLyraDecoderOptions(options).ok());
+
+  LyraEncoderOptions encoder_options;
+  encoder_options.model_path = model_path_;
+  EXPECT_TRUE(ValidateLyraEncoderOptions(encoder_options).ok());
+  encoder_options.bitrate = 0;
+  EXPECT_EQ(ValidateLyraEncoderOptions(encoder_options).code(),
+            absl::StatusCode::kInvalidArgument);
+}
+
+TEST(DurationToInternalSamplesTest, CountsSamplesAtInternalRate) {
+  EXPECT_EQ(DurationToInternalSamples(absl::Milliseconds(20)),
+            GetNumSamplesPerHop(kInternalSampleRateHz));
+  EXPECT_EQ(DurationToInternalSamples(absl::Milliseconds(80)),
+            kInternalSampleRateHz * 80 / 1000);
+}
+
+TEST_F(LyraCodecOptionsTest, AcceptsLongestDurations) {
+  absl::StatusOr<LyraDecoderOptions> options =
+      LyraDecoderOptionsBuilder(model_path_)
+          .SetConcealmentDuration(kMaxDecoderOptionsDuration)
+          .SetFadeDuration(kMaxDecoderOptionsDuration)
+          .Build();
+  ASSERT_TRUE(options.ok()) << options.status();
+  EXPECT_EQ(DurationToInternalSamples(kMaxDecoderOptionsDuration),
+            kInternalSampleRateHz *
+                absl::ToInt64Seconds(kMaxDecoderOptionsDuration));
+}
+
+}  // namespace
+}  // namespace codec
+}  // namespace chromemedia
@@ -16,13 +16,18 @@
 
 #include <memory>
 
+#include "glog/logging.h"  // IWYU pragma: keep
+#include "include/ghc/filesystem.hpp"
 #include "lyra/feature_extractor_interface.h"
 #include "lyra/generative_model_interface.h"
 #include "lyra/lyra_gan_model.h"
+#include "lyra/native_residual_vector_quantizer.h"
 #include "lyra/packet.h"
 #include "lyra/packet_interface.h"
+#include "lyra/quantizer_type.h"
 #include "lyra/residual_vector_quantizer.h"
 #include "lyra/soundstream_encoder.h"
+#include "lyra/tflite_model_options.h"
 #include "lyra/vector_quantizer_interface.h"
 #include "lyra/zero_feature_estimator.h"
 
@@ -34,24 +39,36 @@ namespace {
 constexpr int kMaxNumPacketBits = 184;
 // LINT.ThenChange(
 // lyra_config.cc,
+// native_residual_vector_quantizer.h,
 // residual_vector_quantizer.h,
 // )
 
 }  // namespace
 
 std::unique_ptr<VectorQuantizerInterface> CreateQuantizer(
-    const ghc::filesystem::path& model_path) {
-  return ResidualVectorQuantizer::Create(model_path);
+    const ghc::filesystem::path& model_path, QuantizerType quantizer_type,
+    const TfLiteModelOptions& model_options) {
+  if (quantizer_type == QuantizerType::kNative) {
+    auto native_quantizer = NativeResidualVectorQuantizer::Create(model_path);
+    if (native_quantizer != nullptr) {
+      return native_quantizer;
+    }
+    LOG(WARNING) << "Falling back to the TFLite residual vector quantizer.";
+  }
+  return ResidualVectorQuantizer::Create(model_path, model_options);
 }
 
 std::unique_ptr<GenerativeModelInterface> CreateGenerativeModel(
-    int num_output_features, const ghc::filesystem::path& model_path) {
-  return LyraGanModel::Create(model_path, num_output_features);
+    int num_output_features, const ghc::filesystem::path& model_path,
+    const TfLiteModelOptions& model_options) {
+  return LyraGanModel::Create(model_path, num_output_features,
+                              model_options);
 }
 
 std::unique_ptr<FeatureExtractorInterface> CreateFeatureExtractor(
-    const ghc::filesystem::path& model_path) {
-  return SoundStreamEncoder::Create(model_path);
+    const ghc::filesystem::path& model_path,
+    const TfLiteModelOptions& model_options) {
+  return SoundStreamEncoder::Create(model_path, model_options);
 }
 
 std::unique_ptr<PacketInterface> CreatePacket(int num_header_bits,
@@ -24,19 +24,25 @@
 #include "lyra/feature_extractor_interface.h"
 #include "lyra/generative_model_interface.h"
 #include "lyra/packet_interface.h"
+#include "lyra/quantizer_type.h"
+#include "lyra/tflite_model_options.h"
 #include "lyra/vector_quantizer_interface.h"
 
 namespace chromemedia {
 namespace codec {
 
 std::unique_ptr<VectorQuantizerInterface> CreateQuantizer(
-    const ghc::filesystem::path& model_path);
+    const ghc::filesystem::path& model_path,
+    QuantizerType quantizer_type = QuantizerType::kTfLite,
+    const TfLiteModelOptions& model_options = TfLiteModelOptions());
 
 std::unique_ptr<GenerativeModelInterface> CreateGenerativeModel(
-    int num_output_features, const ghc::filesystem::path& model_path);
+    int num_output_features, const ghc::filesystem::path& model_path,
+    const TfLiteModelOptions& model_options = TfLiteModelOptions());
 
 std::unique_ptr<FeatureExtractorInterface> CreateFeatureExtractor(
-    const ghc::filesystem::path& model_path);
+    const ghc::filesystem::path& model_path,
+    const TfLiteModelOptions& model_options = TfLiteModelOptions());
 
 std::unique_ptr<PacketInterface> CreatePacket(int num_header_bits,
                                               int num_quantized_bits);
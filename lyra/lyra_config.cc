@@ -49,6 +49,7 @@ const std::vector<int>& GetSupportedQuantizedBits() {
 // LINT.ThenChange(
 // lyra_components.cc,
 // lyra_encoder.h,
+// native_residual_vector_quantizer.h,
 // residual_vector_quantizer.h,
 // )
 
@@ -0,0 +1,445 @@
+// Copyright 2022 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "lyra/lyra_container.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <optional>
+#include <utility>
+#include <vector>
+
+#include "absl/memory/memory.h"
+#include "absl/time/time.h"
+#include "absl/types/span.h"
+#include "glog/logging.h"  // IWYU pragma: keep
+#include "include/ghc/filesystem.hpp"
+#include "lyra/lyra_config.h"
+#include "lyra/lyra_decoder_interface.h"
+
+namespace chromemedia {
+namespace codec {
+namespace {
+
+constexpr char kMagic[4] = {'L', 'Y', 'R', 'A'};
+constexpr int kVersion = 1;
+constexpr int kHeaderSize = 48;
+constexpr int kMaxNumFrameSizes = 15;
+constexpr int kMaxFramesPerBlock = 1 << 20;
+constexpr int kIndexEntrySize = 8;
+
+// Byte offsets of the header fields.
+constexpr int kVersionOffset = 4;
+constexpr int kSampleRateOffset = 8;
+constexpr int kFramesPerBlockOffset = 12;
+constexpr int kNumFramesOffset = 16;
+constexpr int kIndexOffsetOffset = 24;
+constexpr int kNumFrameSizesOffset = 32;
+constexpr int kFrameSizesOffset = 33;
+
+void PutLittleEndian(uint64_t value, int num_bytes, uint8_t* bytes) {
+  for (int i = 0; i < num_bytes; ++i) {
+    bytes[i] = (value >> (8 * i)) & 0xFF;
+  }
+}
+
+uint64_t GetLittleEndian(const uint8_t* bytes, int num_bytes) {
+  uint64_t value = 0;
+  for (int i = 0; i < num_bytes; ++i) {
+    value |= static_cast<uint64_t>(bytes[i]) << (8 * i);
+  }
+  return value;
+}
+
+std::vector<int> GetFrameSizes() {
+  std::vector<int> frame_sizes;
+  for (int num_quantized_bits : GetSupportedQuantizedBits()) {
+    frame_sizes.push_back(GetPacketSize(num_quantized_bits));
+  }
+  return frame_sizes;
+}
+
+}  // namespace
+
+std::unique_ptr<LyraContainerWriter> LyraContainerWriter::Create(
+    const ghc::filesystem::path& path, int sample_rate_hz,
+    int frames_per_block) {
+  if (!IsSampleRateSupported(sample_rate_hz)) {
+    LOG(ERROR) << "Sample rate " << sample_rate_hz << " Hz is not supported.";
+    return nullptr;
+  }
+  if (frames_per_block < 1 || frames_per_block > kMaxFramesPerBlock) {
+    LOG(ERROR) << "Frames per block must be in [1, " << kMaxFramesPerBlock
+               << "] but was " << frames_per_block << ".";
+    return nullptr;
+  }
+  if (GetSupportedQuantizedBits().size() > kMaxNumFrameSizes) {
+    LOG(ERROR) << "Too many bitrates for a 4 bit frame type.";
+    return nullptr;
+  }
+  std::ofstream output(path.string(),
+                       std::ios_base::binary | std::ios_base::trunc);
+  if (!output.is_open()) {
+    LOG(ERROR) << "Could not open output file " << path;
+    return nullptr;
+  }
+
+  // WrapUnique is used because of private c'tor.
+  auto writer = absl::WrapUnique(new LyraContainerWriter(
+      std::move(output), sample_rate_hz, frames_per_block));
+  // Reserves room for the header, which is rewritten with the final frame
+  // count and index offset on |Close|.
+  if (!writer->WriteHeader()) {
+    LOG(ERROR) << "Could not write to " << path;
+    return nullptr;
+  }
+  return writer;
+}
+
+LyraContainerWriter::LyraContainerWriter(std::ofstream output,
+                                         int sample_rate_hz,
+                                         int frames_per_block)
+    : output_(std::move(output)),
+      sample_rate_hz_(sample_rate_hz),
+      frames_per_block_(frames_per_block),
+      frame_sizes_(GetFrameSizes()),
+      closed_(false),
+      num_frames_(0),
+      offset_(kHeaderSize) {
+  frame_types_.reserve(frames_per_block);
+  frame_data_.reserve(frames_per_block *
+                      *std::max_element(frame_sizes_.begin(),
+                                        frame_sizes_.end()));
+}
+
+LyraContainerWriter::~LyraContainerWriter() {
+  if (!closed_ && !Close()) {
+    LOG(ERROR) << "Could not close container file.";
+  }
+}
+
+bool LyraContainerWriter::AddFrame(absl::Span<const uint8_t> packet) {
+  if (closed_) {
+    LOG(ERROR) << "Cannot add frames to a closed container.";
+    return false;
+  }
+  uint8_t frame_type = 0;
+  if (!packet.empty()) {
+    const auto frame_size =
+        std::find(frame_sizes_.begin(), frame_sizes_.end(), packet.size());
+    if (frame_size == frame_sizes_.end()) {
+      LOG(ERROR) << "Packet of " << packet.size()
+                 << " bytes is not a Lyra packet.";
+      return false;
+    }
+    frame_type = 1 + (frame_size - frame_sizes_.begin());
+  }
+  frame_types_.push_back(frame_type);
+  frame_data_.insert(frame_data_.end(), packet.begin(), packet.end());
+  ++num_frames_;
+  if (frame_types_.size() == frames_per_block_) {
+    return WriteBlock();
+  }
+  return true;
+}
+
+bool LyraContainerWriter::Close() {
+  if (closed_) {
+    return true;
+  }
+  closed_ = true;
+  if (!WriteBlock()) {
+    return false;
+  }
+  std::vector<uint8_t> index(block_offsets_.size() * kIndexEntrySize);
+  for (int i = 0; i < block_offsets_.size(); ++i) {
+    PutLittleEndian(block_offsets_[i], kIndexEntrySize,
+                    &index[i * kIndexEntrySize]);
+  }
+  output_.write(reinterpret_cast<const char*>(index.data()), index.size());
+  output_.seekp(0);
+  if (!WriteHeader()) {
+    return false;
+  }
+  output_.close();
+  return !output_.fail();
+}
+
+int64_t LyraContainerWriter::num_frames() const { return num_frames_; }
+
+bool LyraContainerWriter::WriteBlock() {
+  if (frame_types_.empty()) {
+    return true;
+  }
+  std::vector<uint8_t> frame_types((frame_types_.size() + 1) / 2);
+  for (int i = 0; i < frame_types_.size(); ++i) {
+    frame_types[i / 2] |= frame_types_[i] << (4 * (i % 2));
+  }
+  output_.write(reinterpret_cast<const char*>(frame_types.data()),
+                frame_types.size());
+  output_.write(reinterpret_cast<const char*>(frame_data_.data()),
+                frame_data_.size());
+  block_offsets_.push_back(offset_);
+  offset_ += frame_types.size() + frame_data_.size();
+  frame_types_.clear();
+  frame_data_.clear();
+  if (!output_.good()) {
+    LOG(ERROR) << "Could not write block to container.";
+    return false;
+  }
+  return true;
+}
+
+bool LyraContainerWriter::WriteHeader() {
+  uint8_t header[kHeaderSize] = {};
+  std::memcpy(header, kMagic, sizeof(kMagic));
+  PutLittleEndian(kVersion, 2, &header[kVersionOffset]);
+  PutLittleEndian(sample_rate_hz_, 4, &header[kSampleRateOffset]);
+  PutLittleEndian(frames_per_block_, 4, &header[kFramesPerBlockOffset]);
+  PutLittleEndian(num_frames_, 8, &header[kNumFramesOffset]);
+  // Only known once the blocks are written.
+  PutLittleEndian(closed_ ? offset_ : 0, 8, &header[kIndexOffsetOffset]);
+  header[kNumFrameSizesOffset] = frame_sizes_.size();
+  for (int i = 0; i < frame_sizes_.size(); ++i) {
+    header[kFrameSizesOffset + i] = frame_sizes_[i];
+  }
+  output_.write(reinterpret_cast<const char*>(header), kHeaderSize);
+  return output_.good();
+}
+
+std::unique_ptr<LyraContainerReader> LyraContainerReader::Open(
+    const ghc::filesystem::path& path) {
+  const int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    LOG(ERROR) << "Could not open " << path;
+    return nullptr;
+  }
+  struct stat file_stat;
+  if (fstat(fd, &file_stat) != 0 || file_stat.st_size < kHeaderSize) {
+    LOG(ERROR) << path << " is too short for a container header.";
+    close(fd);
+    return nullptr;
+  }
+  const size_t size = file_stat.st_size;
+  void* mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  // The mapping keeps the file alive.
+  close(fd);
+  if (mapped == MAP_FAILED) {
+    LOG(ERROR) << "Could not map " << path;
+    return nullptr;
+  }
+  // Clips are read from anywhere in the file, so read-ahead beyond the
+  // requested blocks would be wasted.
+  madvise(mapped, size, MADV_RANDOM);
+  const uint8_t* data = static_cast<const uint8_t*>(mapped);
+  const auto fail = [path, mapped, size](const char* reason) {
+    LOG(ERROR) << path << " is not a valid container: " << reason;
+    munmap(mapped, size);
+    return nullptr;
+  };
+
+  if (std::memcmp(data, kMagic, sizeof(kMagic)) != 0) {
+    return fail("bad magic");
+  }
+  if (GetLittleEndian(&data[kVersionOffset], 2) != kVersion) {
+    return fail("unsupported version");
+  }
+  const uint64_t sample_rate_hz = GetLittleEndian(&data[kSampleRateOffset], 4);
+  if (!IsSampleRateSupported(sample_rate_hz)) {
+    return fail("unsupported sample rate");
+  }
+  const uint64_t frames_per_block =
+      GetLittleEndian(&data[kFramesPerBlockOffset], 4);
+  if (frames_per_block < 1 || frames_per_block > kMaxFramesPerBlock) {
+    return fail("invalid block size");
+  }
+  const int num_frame_sizes = data[kNumFrameSizesOffset];
+  if (num_frame_sizes > kMaxNumFrameSizes) {
+    return fail("too many frame sizes");
+  }
+  std::vector<int> frame_sizes(&data[kFrameSizesOffset],
+                               &data[kFrameSizesOffset + num_frame_sizes]);
+  if (std::find(frame_sizes.begin(), frame_sizes.end(), 0) !=
+      frame_sizes.end()) {
+    return fail("empty frame size");
+  }
+
+  // Checks the index, so that block offsets can be trusted later.
+  const uint64_t num_frames = GetLittleEndian(&data[kNumFramesOffset], 8);
+  const uint64_t index_offset = GetLittleEndian(&data[kIndexOffsetOffset], 8);
+  if (index_offset < kHeaderSize || index_offset > size) {
+    return fail("index out of bounds");
+  }
+  const uint64_t num_blocks =
+      num_frames / frames_per_block + (num_frames % frames_per_block != 0);
+  if (num_blocks > (size - index_offset) / kIndexEntrySize) {
+    return fail("index is truncated");
+  }
+  uint64_t previous_offset = kHeaderSize;
+  for (uint64_t block = 0; block < num_blocks; ++block) {
+    const uint64_t offset = GetLittleEndian(
+        &data[index_offset + block * kIndexEntrySize], kIndexEntrySize);
+    if (offset < previous_offset || offset > index_offset) {
+      return fail("block offsets out of order");
+    }
+    previous_offset = offset;
+  }
+
+  // WrapUnique is used because of private c'tor.
+  return absl::WrapUnique(new LyraContainerReader(
+      data, size, sample_rate_hz, frames_per_block, num_frames, index_offset,
+      std::move(frame_sizes)));
+}
+
+bool LyraContainerReader::IsContainerFile(const ghc::filesystem::path& path) {
+  std::ifstream input(path.string(), std::ios_base::binary);
+  char magic[sizeof(kMagic)];
+  return input.read(magic, sizeof(magic)) &&
+         std::memcmp(magic, kMagic, sizeof(kMagic)) == 0;
+}
+
+LyraContainerReader::LyraContainerReader(const uint8_t* data, size_t size,
+                                         int sample_rate_hz,
+                                         int frames_per_block,
+                                         int64_t num_frames,
+                                         uint64_t index_offset,
+                                         std::vector<int> frame_sizes)
+    : data_(data),
+      size_(size),
+      sample_rate_hz_(sample_rate_hz),
+      frames_per_block_(frames_per_block),
+      num_frames_(num_frames),
+      index_offset_(index_offset),
+      frame_sizes_(std::move(frame_sizes)) {}
+
+LyraContainerReader::~LyraContainerReader() {
+  munmap(const_cast<uint8_t*>(data_), size_);
+}
+
+bool LyraContainerReader::ReadFrames(int64_t begin_frame, int64_t end_frame,
+                                     const FrameCallback& callback) const {
+  if (begin_frame < 0 || begin_frame > end_frame || end_frame > num_frames_) {
+    LOG(ERROR) << "Frames [" << begin_frame << ", " << end_frame
+               << ") are out of bounds of " << num_frames_ << " frames.";
+    return false;
+  }
+  for (int64_t block = begin_frame / frames_per_block_;
+       block * frames_per_block_ < end_frame; ++block) {
+    const int64_t first_frame = block * frames_per_block_;
+    const int num_block_frames =
+        std::min<int64_t>(frames_per_block_, num_frames_ - first_frame);
+    const uint64_t block_end = BlockEnd(block);
+    uint64_t offset = BlockBegin(block) + (num_block_frames + 1) / 2;
+    if (offset > block_end) {
+      LOG(ERROR) << "Block " << block << " is truncated.";
+      return false;
+    }
+    const uint8_t* frame_types = data_ + BlockBegin(block);
+    for (int i = 0; i < num_block_frames && first_frame + i < end_frame; ++i) {
+      const int frame_type = (frame_types[i / 2] >> (4 * (i % 2))) & 0x0F;
+      if (frame_type > frame_sizes_.size()) {
+        LOG(ERROR) << "Frame " << first_frame + i << " has invalid type "
+                   << frame_type << ".";
+        return false;
+      }
+      const int frame_size = frame_type == 0 ? 0 : frame_sizes_[frame_type - 1];
+      if (offset + frame_size > block_end) {
+        LOG(ERROR) << "Block " << block << " is truncated.";
+        return false;
+      }
+      if (first_frame + i >= begin_frame) {
+        callback(absl::MakeConstSpan(data_ + offset, frame_size));
+      }
+      offset += frame_size;
+    }
+  }
+  return true;
+}
+
+std::optional<std::vector<int16_t>> LyraContainerReader::Decode(
+    absl::Duration begin, absl::Duration end,
+    LyraDecoderInterface* decoder) const {
+  const absl::Duration hop_duration = absl::Seconds(1) / kFrameRate;
+  // Clamping first keeps infinite or huge ends, like an open-ended range,
+  // from overflowing the conversion to frames.
+  begin = std::clamp(begin, absl::ZeroDuration(), duration());
+  end = std::clamp(end, begin, duration());
+  absl::Duration remainder;
+  const int64_t begin_frame =
+      absl::IDivDuration(begin, hop_duration, &remainder);
+  const int64_t end_frame = std::min<int64_t>(
+      std::ceil(absl::FDivDuration(end, hop_duration)), num_frames_);
+  const int64_t pre_roll_frame =
+      std::max<int64_t>(0, begin_frame - kNumPreRollFrames);
+
+  const int num_samples_per_hop =
+      GetNumSamplesPerHop(decoder->sample_rate_hz());
+  std::vector<int16_t> decoded((end_frame - begin_frame) * num_samples_per_hop);
+  std::vector<int16_t> pre_roll(num_samples_per_hop);
+  int64_t frame = pre_roll_frame;
+  bool ok = true;
+  const bool read = ReadFrames(
+      pre_roll_frame, end_frame, [&](absl::Span<const uint8_t> packet) {
+        const absl::Span<int16_t> samples =
+            frame < begin_frame
+                ? absl::MakeSpan(pre_roll)
+                : absl::MakeSpan(decoded).subspan(
+                      (frame - begin_frame) * num_samples_per_hop,
+                      num_samples_per_hop);
+        ++frame;
+        // Hops skipped by DTX are concealed by the decoder, which fades to
+        // comfort noise.
+        ok = ok && (packet.empty() || decoder->SetEncodedPacket(packet)) &&
+             decoder->DecodeSamples(samples);
+      });
+  if (!read || !ok) {
+    LOG(ERROR) << "Could not decode frames [" << begin_frame << ", "
+               << end_frame << ").";
+    return std::nullopt;
+  }
+  return decoded;
+}
+
+int LyraContainerReader::sample_rate_hz() const { return sample_rate_hz_; }
+
+int LyraContainerReader::frames_per_block() const { return frames_per_block_; }
+
+int64_t LyraContainerReader::num_frames() const { return num_frames_; }
+
+absl::Duration LyraContainerReader::duration() const {
+  return num_frames_ * (absl::Seconds(1) / kFrameRate);
+}
+
+uint64_t LyraContainerReader::BlockBegin(int64_t block) const {
+  return GetLittleEndian(&data_[index_offset_ + block * kIndexEntrySize],
+                         kIndexEntrySize);
+}
+
+uint64_t LyraContainerReader::BlockEnd(int64_t block) const {
+  const int64_t num_blocks =
+      (num_frames_ + frames_per_block_ - 1) / frames_per_block_;
+  return block + 1 < num_blocks ? BlockBegin(block + 1) : index_offset_;
+}
+
+}  // namespace codec
+}  // namespace chromemedia
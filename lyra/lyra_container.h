@@ -0,0 +1,176 @@
+/*
+ * Copyright 2022 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LYRA_LYRA_CONTAINER_H_
+#define LYRA_LYRA_CONTAINER_H_
+
+#include <cstdint>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <vector>
+
+#include "absl/time/time.h"
+#include "absl/types/span.h"
+#include "include/ghc/filesystem.hpp"
+#include "lyra/lyra_decoder_interface.h"
+
+namespace chromemedia {
+namespace codec {
+
+// A seekable file format for Lyra packets.
+//
+// Raw concatenated packets need the bitrate out of band, cannot mix bitrates,
+// lose the timing of hops skipped by discontinuous transmission (DTX) and can
+// only be decoded from the start. A container file instead holds, with all
+// integers little-endian:
+//
+//   Header, 48 bytes:
+//      0  "LYRA"
+//      4  uint16 version, currently 1
+//      6  uint16 reserved, 0
+//      8  uint32 sample rate of the encoded audio in Hertz
+//     12  uint32 frames per block
+//     16  uint64 number of frames, one per hop
+//     24  uint64 byte offset of the block index
+//     32  uint8  number of frame sizes, at most 15
+//     33  uint8  frame sizes in bytes, one per bitrate, padded to 15
+//   Blocks, each of up to |frames per block| frames:
+//     One 4 bit frame type per frame, low nibble first, padded to a byte. 0
+//     is a hop skipped by DTX, which has no data, and i > 0 a packet of the
+//     i-th frame size. Then the packets of the frames, in order.
+//   Block index:
+//     uint64 byte offset of each block. A block ends where the next one, or
+//     the index, begins.
+//
+// The index lets a reader find the block of any hop and only touch that part
+// of the file.
+
+// Writes a container file. Frames are buffered per block, so memory use does
+// not grow with the length of the recording.
+class LyraContainerWriter {
+ public:
+  static constexpr int kDefaultFramesPerBlock = 250;
+
+  // Returns nullptr if |path| cannot be opened for writing or if the
+  // parameters are invalid.
+  static std::unique_ptr<LyraContainerWriter> Create(
+      const ghc::filesystem::path& path, int sample_rate_hz,
+      int frames_per_block = kDefaultFramesPerBlock);
+
+  // Closes the file if |Close| was not called.
+  ~LyraContainerWriter();
+
+  // Appends the packet of the next hop. An empty |packet| marks a hop skipped
+  // by discontinuous transmission. Returns false if |packet| is not the size
+  // of a packet at a supported bitrate, or if writing failed.
+  bool AddFrame(absl::Span<const uint8_t> packet);
+
+  // Writes the last block, the index and the final header. Returns false if
+  // writing failed. No frames can be added afterwards.
+  bool Close();
+
+  int64_t num_frames() const;
+
+ private:
+  LyraContainerWriter(std::ofstream output, int sample_rate_hz,
+                      int frames_per_block);
+
+  bool WriteBlock();
+  bool WriteHeader();
+
+  std::ofstream output_;
+  const int sample_rate_hz_;
+  const int frames_per_block_;
+  const std::vector<int> frame_sizes_;
+  bool closed_;
+
+  int64_t num_frames_;
+  std::vector<uint64_t> block_offsets_;
+  uint64_t offset_;
+  // Frame types and packets of the current block.
+  std::vector<uint8_t> frame_types_;
+  std::vector<uint8_t> frame_data_;
+};
+
+// Reads a memory-mapped container file. Only the header and index are read
+// when opening, and only the blocks covering a requested range afterwards.
+class LyraContainerReader {
+ public:
+  // Called once per frame with its packet, which points into the mapped file
+  // and is empty for a hop skipped by discontinuous transmission.
+  using FrameCallback = std::function<void(absl::Span<const uint8_t> packet)>;
+
+  // Hops decoded and discarded before a requested range, so that the decoder
+  // state has settled when the range starts.
+  static constexpr int kNumPreRollFrames = 5;
+
+  // Returns nullptr if |path| cannot be mapped or is not a valid container.
+  static std::unique_ptr<LyraContainerReader> Open(
+      const ghc::filesystem::path& path);
+
+  // Returns whether |path| starts like a container file. Used to tell
+  // containers apart from files of raw packets.
+  static bool IsContainerFile(const ghc::filesystem::path& path);
+
+  ~LyraContainerReader();
+
+  // Calls |callback| for each frame in [|begin_frame|, |end_frame|). Returns
+  // false if the range is out of bounds or a block is malformed, in which
+  // case |callback| may have been called for some of the frames.
+  bool ReadFrames(int64_t begin_frame, int64_t end_frame,
+                  const FrameCallback& callback) const;
+
+  // Decodes the audio from |begin| to |end|, rounded out to whole hops and
+  // clamped to the length of the file, at the sample rate of |decoder|. Hops
+  // skipped by discontinuous transmission are decoded as comfort noise.
+  // |decoder| should be freshly created, since its state carries over into
+  // the pre-roll. Returns nullopt if reading or decoding failed.
+  std::optional<std::vector<int16_t>> Decode(
+      absl::Duration begin, absl::Duration end,
+      LyraDecoderInterface* decoder) const;
+
+  int sample_rate_hz() const;
+
+  int frames_per_block() const;
+
+  int64_t num_frames() const;
+
+  absl::Duration duration() const;
+
+ private:
+  LyraContainerReader(const uint8_t* data, size_t size, int sample_rate_hz,
+                      int frames_per_block, int64_t num_frames,
+                      uint64_t index_offset, std::vector<int> frame_sizes);
+
+  // Byte offsets of the start and end of |block|.
+  uint64_t BlockBegin(int64_t block) const;
+  uint64_t BlockEnd(int64_t block) const;
+
+  const uint8_t* const data_;
+  const size_t size_;
+  const int sample_rate_hz_;
+  const int frames_per_block_;
+  const int64_t num_frames_;
+  const uint64_t index_offset_;
+  const std::vector<int> frame_sizes_;
+};
+
+}  // namespace codec
+}  // namespace chromemedia
+
+#endif  // LYRA_LYRA_CONTAINER_H_
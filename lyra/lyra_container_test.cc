@@ -0,0 +1,258 @@
+// Copyright 2022 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "lyra/lyra_container.h"
+
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/time/time.h"
+#include "absl/types/span.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "include/ghc/filesystem.hpp"
+#include "lyra/lyra_config.h"
+#include "lyra/testing/mock_lyra_decoder.h"
+
+namespace chromemedia {
+namespace codec {
+namespace {
+
+using testing::_;
+using testing::Invoke;
+using testing::NiceMock;
+using testing::Return;
+
+static constexpr int kSampleRateHz = 16000;
+static constexpr int kNumSamplesPerHop = 320;
+
+// Returns the packet of |frame|: every fifth hop is skipped by DTX, and the
+// others cycle through the bitrates and are filled with the frame index.
+std::vector<uint8_t> MakePacket(int frame) {
+  if (frame % 5 == 4) {
+    return {};
+  }
+  const std::vector<int>& quantized_bits = GetSupportedQuantizedBits();
+  return std::vector<uint8_t>(
+      GetPacketSize(quantized_bits[frame % quantized_bits.size()]),
+      frame & 0xFF);
+}
+
+class LyraContainerTest : public testing::Test {
+ protected:
+  LyraContainerTest()
+      : path_(ghc::filesystem::path(testing::TempDir()) / "test.lyra") {}
+
+  void WriteContainer(int num_frames, int frames_per_block) {
+    auto writer =
+        LyraContainerWriter::Create(path_, kSampleRateHz, frames_per_block);
+    ASSERT_NE(writer, nullptr);
+    for (int frame = 0; frame < num_frames; ++frame) {
+      ASSERT_TRUE(writer->AddFrame(MakePacket(frame)));
+    }
+    ASSERT_TRUE(writer->Close());
+  }
+
+  std::vector<std::vector<uint8_t>> ReadFrames(
+      const LyraContainerReader& reader, int64_t begin_frame,
+      int64_t end_frame) {
+    std::vector<std::vector<uint8_t>> packets;
+    EXPECT_TRUE(reader.ReadFrames(begin_frame, end_frame,
+                                  [&packets](absl::Span<const uint8_t> packet) {
+                                    packets.emplace_back(packet.begin(),
+                                                         packet.end());
+                                  }));
+    return packets;
+  }
+
+  const ghc::filesystem::path path_;
+};
+
+TEST_F(LyraContainerTest, WriterFailsWithInvalidArguments) {
+  EXPECT_EQ(LyraContainerWriter::Create(path_, 44100), nullptr);
+  EXPECT_EQ(LyraContainerWriter::Create(path_, kSampleRateHz, 0), nullptr);
+  EXPECT_EQ(LyraContainerWriter::Create(
+                ghc::filesystem::path(testing::TempDir()) / "missing/x.lyra",
+                kSampleRateHz),
+            nullptr);
+
+  auto writer = LyraContainerWriter::Create(path_, kSampleRateHz);
+  ASSERT_NE(writer, nullptr);
+  EXPECT_FALSE(writer->AddFrame(std::vector<uint8_t>(1)));
+  ASSERT_TRUE(writer->Close());
+  EXPECT_FALSE(writer->AddFrame(MakePacket(0)));
+}
+
+TEST_F(LyraContainerTest, RoundTripsMixedBitratesAndDtx) {
+  constexpr int kNumFrames = 1000;
+  // A block size that does not divide the number of frames and is odd, so
+  // that both the last block and its frame types are partial.
+  WriteContainer(kNumFrames, 7);
+
+  auto reader = LyraContainerReader::Open(path_);
+  ASSERT_NE(reader, nullptr);
+  EXPECT_EQ(reader->sample_rate_hz(), kSampleRateHz);
+  EXPECT_EQ(reader->frames_per_block(), 7);
+  EXPECT_EQ(reader->num_frames(), kNumFrames);
+  EXPECT_EQ(reader->duration(), absl::Seconds(20));
+
+  const auto packets = ReadFrames(*reader, 0, kNumFrames);
+  ASSERT_EQ(packets.size(), kNumFrames);
+  for (int frame = 0; frame < kNumFrames; ++frame) {
+    EXPECT_EQ(packets[frame], MakePacket(frame)) << "frame " << frame;
+  }
+}
+
+TEST_F(LyraContainerTest, ReadsArbitraryRanges) {
+  constexpr int kNumFrames = 500;
+  WriteContainer(kNumFrames, 16);
+  auto reader = LyraContainerReader::Open(path_);
+  ASSERT_NE(reader, nullptr);
+
+  for (const auto& [begin, end] : std::vector<std::pair<int, int>>{
+           {0, 0}, {0, 1}, {15, 17}, {16, 32}, {100, 333}, {499, 500}}) {
+    const auto packets = ReadFrames(*reader, begin, end);
+    ASSERT_EQ(packets.size(), end - begin);
+    for (int frame = begin; frame < end; ++frame) {
+      EXPECT_EQ(packets[frame - begin], MakePacket(frame));
+    }
+  }
+  const auto ignore = [](absl::Span<const uint8_t>) {};
+  EXPECT_FALSE(reader->ReadFrames(-1, 10, ignore));
+  EXPECT_FALSE(reader->ReadFrames(10, 9, ignore));
+  EXPECT_FALSE(reader->ReadFrames(0, kNumFrames + 1, ignore));
+}
+
+TEST_F(LyraContainerTest, WriterClosesOnDestruction) {
+  {
+    auto writer = LyraContainerWriter::Create(path_, kSampleRateHz);
+    ASSERT_NE(writer, nullptr);
+    ASSERT_TRUE(writer->AddFrame(MakePacket(0)));
+  }
+  auto reader = LyraContainerReader::Open(path_);
+  ASSERT_NE(reader, nullptr);
+  EXPECT_EQ(reader->num_frames(), 1);
+}
+
+TEST_F(LyraContainerTest, OpensEmptyContainer) {
+  WriteContainer(0, 16);
+  auto reader = LyraContainerReader::Open(path_);
+  ASSERT_NE(reader, nullptr);
+  EXPECT_EQ(reader->num_frames(), 0);
+  EXPECT_TRUE(ReadFrames(*reader, 0, 0).empty());
+}
+
+TEST_F(LyraContainerTest, RejectsInvalidFiles) {
+  EXPECT_EQ(LyraContainerReader::Open(path_ / "missing.lyra"), nullptr);
+  EXPECT_FALSE(LyraContainerReader::IsContainerFile(path_ / "missing.lyra"));
+
+  // Raw concatenated packets.
+  {
+    std::ofstream raw(path_.string(), std::ios_base::binary);
+    raw << std::string(100, '\x17');
+  }
+  EXPECT_FALSE(LyraContainerReader::IsContainerFile(path_));
+  EXPECT_EQ(LyraContainerReader::Open(path_), nullptr);
+
+  // A container whose index was cut off.
+  WriteContainer(100, 10);
+  EXPECT_TRUE(LyraContainerReader::IsContainerFile(path_));
+  ghc::filesystem::resize_file(path_, ghc::filesystem::file_size(path_) - 1);
+  EXPECT_EQ(LyraContainerReader::Open(path_), nullptr);
+}
+
+TEST_F(LyraContainerTest, DecodesRangeAfterPreRoll) {
+  constexpr int kNumFrames = 200;
+  WriteContainer(kNumFrames, 16);
+  auto reader = LyraContainerReader::Open(path_);
+  ASSERT_NE(reader, nullptr);
+
+  std::vector<int> set_frames;
+  NiceMock<MockLyraDecoder> decoder;
+  ON_CALL(decoder, sample_rate_hz()).WillByDefault(Return(kSampleRateHz));
+  ON_CALL(decoder, SetEncodedPacket(_))
+      .WillByDefault(Invoke([&set_frames](absl::Span<const uint8_t> packet) {
+        set_frames.push_back(packet[0]);
+        return true;
+      }));
+  // Every hop, whether it has a packet or not, is decoded.
+  EXPECT_CALL(decoder, DecodeSamples(testing::An<absl::Span<int16_t>>()))
+      .Times(50 + LyraContainerReader::kNumPreRollFrames)
+      .WillRepeatedly(Return(true));
+
+  // From 1.01 s to 1.99 s, rounded out to hops 50 to 100.
+  const std::optional<std::vector<int16_t>> decoded = reader->Decode(
+      absl::Milliseconds(1010), absl::Milliseconds(1990), &decoder);
+  ASSERT_TRUE(decoded.has_value());
+  EXPECT_EQ(decoded->size(), 50 * kNumSamplesPerHop);
+
+  std::vector<int> expected_frames;
+  for (int frame = 50 - LyraContainerReader::kNumPreRollFrames; frame < 100;
+       ++frame) {
+    if (!MakePacket(frame).empty()) {
+      expected_frames.push_back(frame);
+    }
+  }
+  EXPECT_EQ(set_frames, expected_frames);
+}
+
+TEST_F(LyraContainerTest, DecodeClampsToFile) {
+  constexpr int kNumFrames = 20;
+  WriteContainer(kNumFrames, 16);
+  auto reader = LyraContainerReader::Open(path_);
+  ASSERT_NE(reader, nullptr);
+
+  NiceMock<MockLyraDecoder> decoder;
+  ON_CALL(decoder, sample_rate_hz()).WillByDefault(Return(kSampleRateHz));
+  ON_CALL(decoder, SetEncodedPacket(_)).WillByDefault(Return(true));
+  ON_CALL(decoder, DecodeSamples(testing::An<absl::Span<int16_t>>()))
+      .WillByDefault(Return(true));
+  const std::optional<std::vector<int16_t>> decoded =
+      reader->Decode(absl::Seconds(-1), absl::Seconds(10), &decoder);
+  ASSERT_TRUE(decoded.has_value());
+  EXPECT_EQ(decoded->size(), kNumFrames * kNumSamplesPerHop);
+
+  // Open-ended and inverted ranges.
+  const std::optional<std::vector<int16_t>> tail = reader->Decode(
+      absl::Milliseconds(100), absl::InfiniteDuration(), &decoder);
+  ASSERT_TRUE(tail.has_value());
+  EXPECT_EQ(tail->size(), (kNumFrames - 5) * kNumSamplesPerHop);
+  const std::optional<std::vector<int16_t>> whole = reader->Decode(
+      -absl::InfiniteDuration(), absl::InfiniteDuration(), &decoder);
+  ASSERT_TRUE(whole.has_value());
+  EXPECT_EQ(whole->size(), kNumFrames * kNumSamplesPerHop);
+  const std::optional<std::vector<int16_t>> past_end = reader->Decode(
+      absl::InfiniteDuration(), absl::InfiniteDuration(), &decoder);
+  ASSERT_TRUE(past_end.has_value());
+  EXPECT_TRUE(past_end->empty());
+  const std::optional<std::vector<int16_t>> inverted = reader->Decode(
+      absl::Milliseconds(200), absl::Milliseconds(100), &decoder);
+  ASSERT_TRUE(inverted.has_value());
+  EXPECT_TRUE(inverted->empty());
+
+  ON_CALL(decoder, DecodeSamples(testing::An<absl::Span<int16_t>>()))
+      .WillByDefault(Return(false));
+  EXPECT_FALSE(
+      reader->Decode(absl::ZeroDuration(), absl::Seconds(1), &decoder)
+          .has_value());
+}
+
+}  // namespace
+}  // namespace codec
+}  // namespace chromemedia
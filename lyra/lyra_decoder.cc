@@ -15,6 +15,7 @@
 #include "lyra/lyra_decoder.h"
 
 #include <algorithm>
+#include <chrono>  // NOLINT(build/c++11)
 #include <cmath>
 #include <cstdint>
 #include <functional>
@@ -29,49 +30,31 @@
 #include "glog/logging.h"  // IWYU pragma: keep
 #include "include/ghc/filesystem.hpp"
 #include "lyra/buffered_resampler.h"
+#include "lyra/codec_stats_sink_interface.h"
 #include "lyra/comfort_noise_generator.h"
+#include "lyra/lyra_codec_options.h"
 #include "lyra/lyra_components.h"
 #include "lyra/lyra_config.h"
 #include "lyra/noise_estimator.h"
+#include "lyra/tracing.h"
 
 namespace chromemedia {
 namespace codec {
 namespace {
 
-// Duration of pure packet loss concealment.
-inline int GetConcealmentDurationSamples() {
-  static constexpr float kConcealmentDurationSeconds = 0.08;
-  static constexpr int kConcealmentDurationSamples =
-      kConcealmentDurationSeconds * kInternalSampleRateHz;
-  CHECK_EQ(
-      kConcealmentDurationSamples % GetNumSamplesPerHop(kInternalSampleRateHz),
-      0);
-  return kConcealmentDurationSamples;
-}
-
-// Duration it takes to fade from concealment to comfort noise, and from
-// comfort noise to received packets.
-inline int GetFadeDurationSamples() {
-  static constexpr float kFadeDurationSeconds = 0.04;
-  static constexpr int kFadeDurationSamples =
-      kFadeDurationSeconds * kInternalSampleRateHz;
-  CHECK_EQ(kFadeDurationSamples % GetNumSamplesPerHop(kInternalSampleRateHz),
-           0);
-  return kFadeDurationSamples;
-}
-
 // Reconciles the number of samples requested with the number we should
 // decode within one iteration of the |DecodeSamples| while loop.
 int GetNumSamplesToGenerate(int num_samples_requested,
                             int samples_generated_so_far,
                             int concealment_progress,
+                            int concealment_duration_samples,
                             int model_samples_available,
                             int cng_samples_available) {
   int samples_remaining_packet;
   if (concealment_progress < 0) {
     // Finish playing out the remainder of the last fake packet.
     samples_remaining_packet = std::abs(concealment_progress);
-  } else if (concealment_progress < GetConcealmentDurationSamples()) {
+  } else if (concealment_progress < concealment_duration_samples) {
     // If we have not yet maxed out concealment progress, the
     // |generative_model_| will be used.
     samples_remaining_packet =
@@ -95,10 +78,18 @@ int GetNumSamplesToGenerate(int num_samples_requested,
 std::unique_ptr<LyraDecoder> LyraDecoder::Create(
     int sample_rate_hz, int num_channels,
     const ghc::filesystem::path& model_path) {
-  absl::Status are_params_supported =
-      AreParamsSupported(sample_rate_hz, num_channels, model_path);
-  if (!are_params_supported.ok()) {
-    LOG(ERROR) << are_params_supported;
+  LyraDecoderOptions options;
+  options.sample_rate_hz = sample_rate_hz;
+  options.num_channels = num_channels;
+  options.model_path = model_path;
+  return Create(options);
+}
+
+std::unique_ptr<LyraDecoder> LyraDecoder::Create(
+    const LyraDecoderOptions& options) {
+  absl::Status are_options_supported = ValidateLyraDecoderOptions(options);
+  if (!are_options_supported.ok()) {
+    LOG(ERROR) << are_options_supported;
     return nullptr;
   }
   const int kNumSamplesPerHop = GetNumSamplesPerHop(kInternalSampleRateHz);
@@ -108,13 +99,14 @@ std::unique_ptr<LyraDecoder> LyraDecoder::Create(
   // The resampler always resamples from |kInternalSampleRateHz| to the
   // requested |sample_rate_hz|.
   auto resampler =
-      BufferedResampler::Create(kInternalSampleRateHz, sample_rate_hz);
+      BufferedResampler::Create(kInternalSampleRateHz, options.sample_rate_hz);
   if (resampler == nullptr) {
     LOG(ERROR) << "Could not create Buffered Resampler.";
     return nullptr;
   }
   // All internal components operate at |kInternalSampleRateHz|.
-  auto model = CreateGenerativeModel(kNumFeatures, model_path);
+  auto model = CreateGenerativeModel(kNumFeatures, options.model_path,
+                                     options.model_options);
   if (model == nullptr) {
     LOG(ERROR) << "New model could not be instantiated.";
     return nullptr;
@@ -133,7 +125,8 @@ std::unique_ptr<LyraDecoder> LyraDecoder::Create(
     LOG(ERROR) << "Could not create Noise Estimator.";
     return nullptr;
   }
-  auto vector_quantizer = CreateQuantizer(model_path);
+  auto vector_quantizer = CreateQuantizer(
+      options.model_path, options.quantizer_type, options.model_options);
   if (vector_quantizer == nullptr) {
     LOG(ERROR) << "Could not create Vector Quantizer.";
     return nullptr;
@@ -141,12 +134,16 @@ std::unique_ptr<LyraDecoder> LyraDecoder::Create(
   auto feature_estimator = CreateFeatureEstimator(kNumFeatures);
 
   // WrapUnique is used because of private c'tor.
-  return absl::WrapUnique(
-      new LyraDecoder(std::move(model), std::move(comfort_noise_generator),
-                      std::move(vector_quantizer), std::move(noise_estimator),
-                      std::move(feature_estimator), std::move(resampler),
-                      /*external_sample_rate_hz=*/sample_rate_hz,
-                      /*num_channels=*/num_channels));
+  auto decoder = absl::WrapUnique(new LyraDecoder(
+      std::move(model), std::move(comfort_noise_generator),
+      std::move(vector_quantizer), std::move(noise_estimator),
+      std::move(feature_estimator), std::move(resampler),
+      /*external_sample_rate_hz=*/options.sample_rate_hz,
+      /*num_channels=*/options.num_channels,
+      DurationToInternalSamples(options.concealment_duration),
+      DurationToInternalSamples(options.fade_duration)));
+  decoder->set_stats_sink(options.stats_sink);
+  return decoder;
 }
 
 LyraDecoder::LyraDecoder(
@@ -156,7 +153,8 @@ LyraDecoder::LyraDecoder(
     std::unique_ptr<NoiseEstimatorInterface> noise_estimator,
     std::unique_ptr<FeatureEstimatorInterface> feature_estimator,
     std::unique_ptr<BufferedFilterInterface> resampler,
-    int external_sample_rate_hz, int num_channels)
+    int external_sample_rate_hz, int num_channels,
+    int concealment_duration_samples, int fade_duration_samples)
     : generative_model_(std::move(generative_model)),
       comfort_noise_generator_(std::move(comfort_noise_generator)),
       vector_quantizer_(std::move(vector_quantizer)),
@@ -167,25 +165,39 @@ LyraDecoder::LyraDecoder(
       fade_progress_(0),
       fade_direction_(FadeDirection::kFadeFromCNG),
       external_sample_rate_hz_(external_sample_rate_hz),
-      num_channels_(num_channels) {}
+      num_channels_(num_channels),
+      concealment_duration_samples_(concealment_duration_samples),
+      fade_duration_samples_(fade_duration_samples),
+      features_(kNumFeatures),
+      generative_model_hop_(GetNumSamplesPerHop(kInternalSampleRateHz)),
+      comfort_noise_hop_(GetNumSamplesPerHop(kInternalSampleRateHz)),
+      stats_sink_(nullptr) {}
 
 bool LyraDecoder::SetEncodedPacket(absl::Span<const uint8_t> encoded) {
+  LYRA_TRACE_SCOPE("LyraDecoder::SetEncodedPacket");
   const int num_quantized_bits = PacketSizeToNumQuantizedBits(encoded.size());
   if (num_quantized_bits < 0) {
     LOG(ERROR) << "The packet size (" << encoded.size()
                << " bytes) is not supported.";
     return false;
   }
-  auto packet = CreatePacket(kNumHeaderBits, num_quantized_bits);
-  const auto unpacked = packet->UnpackPacket(encoded);
-  if (!unpacked.has_value()) {
-    LOG(ERROR) << "Could not read Lyra packet for decoding.";
-    return false;
+  if (packet_ == nullptr || packet_->PacketSize() != encoded.size()) {
+    packet_ = CreatePacket(kNumHeaderBits, num_quantized_bits);
+  }
+  const int bits_per_quantizer = vector_quantizer_->bits_per_quantizer();
+  quantized_indices_.resize(num_quantized_bits / bits_per_quantizer);
+  {
+    ScopedStageTimer timer(stats_sink_, CodecStage::kUnpack);
+    if (!packet_->UnpackIndices(encoded, bits_per_quantizer,
+                               absl::MakeSpan(quantized_indices_))) {
+      LOG(ERROR) << "Could not read Lyra packet for decoding.";
+      return false;
+    }
   }
 
   // Finish playing out any concealment or comfort noise packets before
   // moving on to the packet we are receiving.
-  if (concealment_progress_ == GetConcealmentDurationSamples()) {
+  if (concealment_progress_ == concealment_duration_samples_) {
     concealment_progress_ = -comfort_noise_generator_->num_samples_available();
   } else if (concealment_progress_ > 0) {
     concealment_progress_ = -generative_model_->num_samples_available();
@@ -195,51 +207,87 @@ bool LyraDecoder::SetEncodedPacket(absl::Span<const uint8_t> encoded) {
   // If less than zero we received than one packet while still decoding
   // concealment or comfort noise.
 
-  auto features = vector_quantizer_->DecodeToLossyFeatures(unpacked.value());
-  if (!features.has_value()) {
-    LOG(ERROR) << "Could not decode to lossy features.";
-    return false;
+  {
+    ScopedStageTimer timer(stats_sink_, CodecStage::kDequantize);
+    if (!vector_quantizer_->DecodeIndicesToLossyFeaturesInto(
+            quantized_indices_, absl::MakeSpan(features_))) {
+      LOG(ERROR) << "Could not decode to lossy features.";
+      return false;
+    }
   }
-  if (!generative_model_->AddFeatures(features.value())) {
+  if (!generative_model_->AddFeatures(features_)) {
     LOG(ERROR) << "Could not add received features to generative model.";
     return false;
   }
-  feature_estimator_->Update(features.value());
+  feature_estimator_->Update(features_);
   return true;
 }
 
 std::optional<std::vector<int16_t>> LyraDecoder::DecodeSamples(
     int num_samples) {
-  std::function<std::optional<std::vector<int16_t>>(int)> decode_function =
-      [this](int internal_num_samples_to_generate)
-      -> std::optional<std::vector<int16_t>> {
-    return DecodeSamplesInternal(internal_num_samples_to_generate);
-  };
-  auto external_samples =
-      resampler_->FilterAndBuffer(decode_function, num_samples);
-
-  if (!external_samples.has_value()) {
-    LOG(ERROR) << "Could not decode samples.";
+  if (num_samples < 0) {
+    LOG(ERROR) << "Number of samples must not be negative.";
+    return std::nullopt;
+  }
+  std::vector<int16_t> samples(num_samples);
+  if (!DecodeSamples(absl::MakeSpan(samples))) {
     return std::nullopt;
   }
-  return external_samples;
+  return samples;
+}
+
+bool LyraDecoder::DecodeSamples(absl::Span<int16_t> samples) {
+  LYRA_TRACE_SCOPE("LyraDecoder::DecodeSamples");
+  if (stats_sink_ == nullptr) {
+    return DecodeAndResample(samples);
+  }
+  // The resampler pulls samples from the other stages, so its own share is
+  // what remains of the total once their time is taken out.
+  const auto start = std::chrono::steady_clock::now();
+  std::chrono::steady_clock::duration internal_duration{0};
+  const bool success = DecodeAndResample(samples, &internal_duration);
+  stats_sink_->RecordStage(
+      CodecStage::kResample,
+      absl::FromChrono(std::chrono::steady_clock::now() - start -
+                       internal_duration));
+  return success;
+}
+
+bool LyraDecoder::DecodeAndResample(
+    absl::Span<int16_t> samples,
+    std::chrono::steady_clock::duration* internal_duration) {
+  const std::function<bool(absl::Span<int16_t>)> decode_function =
+      [this, internal_duration](absl::Span<int16_t> internal_samples) {
+        if (internal_duration == nullptr) {
+          return DecodeSamplesInternal(internal_samples);
+        }
+        const auto start = std::chrono::steady_clock::now();
+        const bool success = DecodeSamplesInternal(internal_samples);
+        *internal_duration += std::chrono::steady_clock::now() - start;
+        return success;
+      };
+  if (!resampler_->FilterAndBufferInto(decode_function, samples)) {
+    LOG(ERROR) << "Could not decode samples.";
+    return false;
+  }
+  return true;
 }
 
-std::optional<std::vector<int16_t>> LyraDecoder::DecodeSamplesInternal(
-    int internal_num_samples_to_generate) {
-  std::vector<int16_t> result;
-  result.reserve(internal_num_samples_to_generate);
-  while (result.size() < internal_num_samples_to_generate) {
+bool LyraDecoder::DecodeSamplesInternal(absl::Span<int16_t> result) {
+  const int internal_num_samples_to_generate = result.size();
+  int num_samples_generated = 0;
+  while (num_samples_generated < internal_num_samples_to_generate) {
     // Aligns the number of samples requested with the number of samples per
     // packet.
-    // |GetFadeDurationSamples()| and |GetConcealmentDurationSamples()| are also
+    // |fade_duration_samples_| and |concealment_duration_samples_| are also
     // multiples of the number of samples per packet, so
     // |num_samples_to_generate| will be aligned with fade and concealment
     // progress as well.
     const int num_samples_to_generate = GetNumSamplesToGenerate(
         /*num_samples_requested=*/internal_num_samples_to_generate,
-        /*samples_generated_so_far=*/result.size(),
+        /*samples_generated_so_far=*/num_samples_generated,
         /*concealment_progress=*/concealment_progress_,
+        /*concealment_duration_samples=*/concealment_duration_samples_,
         /*model_samples_available=*/
         generative_model_->num_samples_available(),
         /*cng_samples_available=*/
@@ -250,29 +298,34 @@ std::optional<std::vector<int16_t>> LyraDecoder::DecodeSamplesInternal(
         generative_model_->num_samples_available() > 0 &&
         concealment_progress_ == 0;
 
+    const FadeDirection previous_fade_direction = fade_direction_;
     if (is_packet_received) {
       // Decoding from a received packet triggers comfort noise, if there is
       // any, to fade out.
       fade_direction_ = kFadeFromCNG;
-    } else if (concealment_progress_ == GetConcealmentDurationSamples()) {
+    } else if (concealment_progress_ == concealment_duration_samples_) {
       // Comfort noise begins fading in again once we have lost
-      // |GetConcealmentDurationSamples()| samples in a row.
+      // |concealment_duration_samples_| samples in a row.
       fade_direction_ = kFadeToCNG;
     } else {
       // We are not decoding from a received packet and have not yet started
       // playing out pure comfort noise.
       concealment_progress_ += num_samples_to_generate;
     }
+    if (fade_direction_ != previous_fade_direction) {
+      RecordCodecEvent(stats_sink_, CodecEvent::kFadeTransition);
+      LYRA_TRACE_INSTANT("LyraDecoder fade transition");
+    }
 
     int cng_samples_to_generate = num_samples_to_generate;
     int generative_samples_to_generate = num_samples_to_generate;
     int next_fade_progress =
         fade_progress_ + fade_direction_ * num_samples_to_generate;
     if (fade_direction_ == kFadeToCNG &&
-        fade_progress_ == GetFadeDurationSamples()) {
-      // |fade_progress_| maxes out at |GetFadeDurationSamples()|. Once here
+        fade_progress_ == fade_duration_samples_) {
+      // |fade_progress_| maxes out at |fade_duration_samples_|. Once here
       // we only generate comfort noise until |fade_direction_| is reversed.
-      next_fade_progress = GetFadeDurationSamples();
+      next_fade_progress = fade_duration_samples_;
       generative_samples_to_generate = 0;
     } else if (fade_direction_ == kFadeFromCNG && fade_progress_ == 0) {
       // |fade_progress_| has a minimum at 0. Once here we only produce
@@ -281,77 +334,93 @@ std::optional<std::vector<int16_t>> LyraDecoder::DecodeSamplesInternal(
       cng_samples_to_generate = 0;
     }
 
-    auto audio = RunGenerativeModel(generative_samples_to_generate);
-    if (!audio.has_value()) {
+    const absl::Span<int16_t> audio =
+        absl::MakeSpan(generative_model_hop_)
+            .first(generative_samples_to_generate);
+    if (!RunGenerativeModel(audio)) {
       LOG(ERROR) << "Model could not be run on features.";
-      return std::nullopt;
+      return false;
     }
-    auto comfort_noise = RunComfortNoiseGenerator(cng_samples_to_generate);
-    if (!comfort_noise.has_value()) {
+    const absl::Span<int16_t> comfort_noise =
+        absl::MakeSpan(comfort_noise_hop_).first(cng_samples_to_generate);
+    if (!RunComfortNoiseGenerator(comfort_noise)) {
       LOG(ERROR) << "Could not generate comfort noise.";
-      return std::nullopt;
+      return false;
     }
 
     // Perform any necessary overlap and insert into |result|.
-    if (!MaybeOverlapAndInsert(fade_direction_, fade_progress_, audio.value(),
-                               comfort_noise.value(), result)) {
+    if (!MaybeOverlapAndInsert(
+            fade_direction_, fade_progress_, audio, comfort_noise,
+            result.subspan(num_samples_generated, num_samples_to_generate))) {
       LOG(ERROR) << "Could not overlap comfort noise.";
-      return std::nullopt;
+      return false;
     }
+    num_samples_generated += num_samples_to_generate;
 
     fade_progress_ = next_fade_progress;
 
     // Only update |noise_estimator_| if we are dealing with received packets.
     // Do not update with concealment.
     if (is_packet_received) {
-      if (!noise_estimator_->ReceiveSamples(audio.value())) {
+      ScopedStageTimer timer(stats_sink_, CodecStage::kNoiseEstimation);
+      if (!noise_estimator_->ReceiveSamples(audio)) {
         LOG(ERROR) << "Could not update noise estimator on decoder output.";
-        return std::nullopt;
+        return false;
       }
     }
   }
-  CHECK_EQ(result.size(), internal_num_samples_to_generate);
-  return result;
+  CHECK_EQ(num_samples_generated, internal_num_samples_to_generate);
+  return true;
 }
 
-std::optional<std::vector<int16_t>> LyraDecoder::RunGenerativeModel(
-    int num_samples) {
-  if (num_samples > 0 && generative_model_->num_samples_available() == 0) {
+bool LyraDecoder::RunGenerativeModel(absl::Span<int16_t> samples) {
+  if (samples.empty()) {
+    return generative_model_->GenerateSamplesInto(samples);
+  }
+  ScopedStageTimer timer(stats_sink_, CodecStage::kGenerativeModel);
+  if (generative_model_->num_samples_available() == 0) {
     if (!generative_model_->AddFeatures(feature_estimator_->Estimate())) {
       LOG(ERROR) << "Could not add estimated features to generative model.";
-      return std::nullopt;
+      return false;
     }
+    RecordCodecEvent(stats_sink_, CodecEvent::kConcealedHop);
+    LYRA_TRACE_INSTANT("LyraDecoder concealed hop");
   }
-  return generative_model_->GenerateSamples(num_samples);
+  return generative_model_->GenerateSamplesInto(samples);
 }
 
-std::optional<std::vector<int16_t>> LyraDecoder::RunComfortNoiseGenerator(
-    int num_samples) {
-  if (num_samples > 0 &&
-      comfort_noise_generator_->num_samples_available() == 0) {
+bool LyraDecoder::RunComfortNoiseGenerator(absl::Span<int16_t> samples) {
+  if (samples.empty()) {
+    return comfort_noise_generator_->GenerateSamplesInto(samples);
+  }
+  ScopedStageTimer timer(stats_sink_, CodecStage::kComfortNoise);
+  if (comfort_noise_generator_->num_samples_available() == 0) {
     if (!comfort_noise_generator_->AddFeatures(
             noise_estimator_->noise_estimate())) {
       LOG(ERROR)
           << "Could not add noise estimate features to comfort noise generator";
-      return std::nullopt;
+      return false;
     }
+    RecordCodecEvent(stats_sink_, CodecEvent::kComfortNoiseHop);
+    LYRA_TRACE_INSTANT("LyraDecoder comfort noise hop");
   }
-  return comfort_noise_generator_->GenerateSamples(num_samples);
+  return comfort_noise_generator_->GenerateSamplesInto(samples);
 }
 
 bool LyraDecoder::MaybeOverlapAndInsert(
     FadeDirection fade_direction, int fade_progress,
-    const std::vector<int16_t>& generative_model_hop,
-    const std::vector<int16_t>& comfort_noise_hop,
-    std::vector<int16_t>& result) {
+    absl::Span<const int16_t> generative_model_hop,
+    absl::Span<const int16_t> comfort_noise_hop, absl::Span<int16_t> result) {
   if (comfort_noise_hop.empty()) {
-    result.insert(result.end(), generative_model_hop.begin(),
-                  generative_model_hop.end());
+    CHECK_EQ(generative_model_hop.size(), result.size());
+    std::copy(generative_model_hop.begin(), generative_model_hop.end(),
+              result.begin());
     return true;
   }
   if (generative_model_hop.empty()) {
-    result.insert(result.end(), comfort_noise_hop.begin(),
-                  comfort_noise_hop.end());
+    CHECK_EQ(comfort_noise_hop.size(), result.size());
+    std::copy(comfort_noise_hop.begin(), comfort_noise_hop.end(),
+              result.begin());
     return true;
   }
   if (generative_model_hop.size() != comfort_noise_hop.size()) {
@@ -362,11 +431,12 @@ bool LyraDecoder::MaybeOverlapAndInsert(
     return false;
   }
 
+  CHECK_EQ(generative_model_hop.size(), result.size());
   for (int i = 0; i < generative_model_hop.size(); ++i) {
     const float overlap_weight =
-        (1.f + std::cos(fade_progress * M_PI / GetFadeDurationSamples())) / 2.f;
-    result.push_back(generative_model_hop.at(i) * overlap_weight +
-                     comfort_noise_hop.at(i) * (1.f - overlap_weight));
+        (1.f + std::cos(fade_progress * M_PI / fade_duration_samples_)) / 2.f;
+    result[i] = generative_model_hop.at(i) * overlap_weight +
+                comfort_noise_hop.at(i) * (1.f - overlap_weight);
     fade_progress += fade_direction;
   }
   return true;
@@ -379,7 +449,11 @@ int LyraDecoder::num_channels() const { return num_channels_; }
 int LyraDecoder::frame_rate() const { return kFrameRate; }
 
 bool LyraDecoder::is_comfort_noise() const {
-  return fade_progress_ == GetFadeDurationSamples();
+  return fade_progress_ == fade_duration_samples_;
+}
+
+void LyraDecoder::set_stats_sink(CodecStatsSinkInterface* stats_sink) {
+  stats_sink_ = stats_sink;
 }
 
 }  // namespace codec
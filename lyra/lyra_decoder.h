@@ -17,6 +17,7 @@
 #ifndef LYRA_LYRA_DECODER_H_
 #define LYRA_LYRA_DECODER_H_
 
+#include <chrono>  // NOLINT(build/c++11)
 #include <cstdint>
 #include <memory>
 #include <optional>
@@ -25,10 +26,13 @@
 #include "absl/types/span.h"
 #include "include/ghc/filesystem.hpp"
 #include "lyra/buffered_filter_interface.h"
+#include "lyra/codec_stats_sink_interface.h"
 #include "lyra/feature_estimator_interface.h"
 #include "lyra/generative_model_interface.h"
+#include "lyra/lyra_codec_options.h"
 #include "lyra/lyra_decoder_interface.h"
 #include "lyra/noise_estimator_interface.h"
+#include "lyra/packet_interface.h"
 #include "lyra/vector_quantizer_interface.h"
 
 namespace chromemedia {
@@ -55,6 +59,15 @@ class LyraDecoder : public LyraDecoderInterface {
       int sample_rate_hz, int num_channels,
       const ghc::filesystem::path& model_path);
 
+  /// Static method to create a LyraDecoder from options.
+  ///
+  /// @param options Parameters of the decoder and how it runs its models,
+  ///                for example built by |LyraDecoderOptionsBuilder|. Only
+  ///                |options.model_path| has no usable default.
+  /// @return A unique_ptr to a |LyraDecoder| if the options are valid. Else it
+  ///         returns a nullptr.
+  static std::unique_ptr<LyraDecoder> Create(const LyraDecoderOptions& options);
+
   /// Parses a packet and prepares to decode samples from the payload.
   ///
   /// @param encoded Encoded packet as a span of bytes.
@@ -73,6 +86,16 @@ class LyraDecoder : public LyraDecoderInterface {
   /// @return Vector of int16-formatted samples, or nullopt on failure.
   std::optional<std::vector<int16_t>> DecodeSamples(int num_samples) override;
 
+  /// Decodes samples into a caller-provided buffer.
+  ///
+  /// Behaves like |DecodeSamples(int)| but writes into |samples|. Once warmed
+  /// up, decoding received packets does not allocate on the heap.
+  ///
+  /// @param samples Buffer to fill with |samples.size()| decoded samples.
+  ///
+  /// @return True on success.
+  bool DecodeSamples(absl::Span<int16_t> samples) override;
+
   /// Getter for the sample rate in Hertz.
   ///
   /// @return Sample rate in Hertz.
@@ -93,6 +116,14 @@ class LyraDecoder : public LyraDecoderInterface {
   /// @return True if the decoder is in comfort noise generation mode.
   bool is_comfort_noise() const override;
 
+  /// Setter for the stats sink.
+  ///
+  /// @param stats_sink Receives the duration of each decoding stage and the
+  ///                   concealment, comfort noise and fade events of every
+  ///                   following call. It is not owned and has to outlive its
+  ///                   use. nullptr, the default, disables instrumentation.
+  void set_stats_sink(CodecStatsSinkInterface* stats_sink);
+
  private:
   // Tracks the direction we are moving along |fade_progress_|.
   enum FadeDirection {
@@ -107,24 +138,35 @@ class LyraDecoder : public LyraDecoderInterface {
               std::unique_ptr<NoiseEstimatorInterface> noise_estimator,
               std::unique_ptr<FeatureEstimatorInterface> feature_estimator,
               std::unique_ptr<BufferedFilterInterface> resampler,
-              int external_sample_rate_hz, int num_channels);
-
-  // Runs the while loop for generating samples at the internal sample rate.
-  std::optional<std::vector<int16_t>> DecodeSamplesInternal(
-      int internal_num_samples_to_generate);
-
-  // Overlaps hops using a cos^2 window.
+              int external_sample_rate_hz, int num_channels,
+              int concealment_duration_samples, int fade_duration_samples);
+
+  // Resamples the output of |DecodeSamplesInternal| into |samples|. If
+  // |internal_duration| is not nullptr, the time spent in
+  // |DecodeSamplesInternal| is added to it.
+  bool DecodeAndResample(
+      absl::Span<int16_t> samples,
+      std::chrono::steady_clock::duration* internal_duration = nullptr);
+
+  // Runs the while loop for generating |result.size()| samples at the
+  // internal sample rate into |result|.
+  bool DecodeSamplesInternal(absl::Span<int16_t> result);
+
+  // Overlaps hops using a cos^2 window and writes them to |result|, which must
+  // be as long as the non-empty hops.
   // Returns true on success, false on failure.
   bool MaybeOverlapAndInsert(FadeDirection fade_direction, int fade_progress,
-                             const std::vector<int16_t>& generative_model_hop,
-                             const std::vector<int16_t>& comfort_noise_hop,
-                             std::vector<int16_t>& result);
+                             absl::Span<const int16_t> generative_model_hop,
+                             absl::Span<const int16_t> comfort_noise_hop,
+                             absl::Span<int16_t> result);
 
-  // Runs the generative model and adds estimated features if needed.
-  std::optional<std::vector<int16_t>> RunGenerativeModel(int num_samples);
+  // Runs the generative model into |samples| and adds estimated features if
+  // needed.
+  bool RunGenerativeModel(absl::Span<int16_t> samples);
 
-  // Runs the comfort noise generator and adds estimated features if needed.
-  std::optional<std::vector<int16_t>> RunComfortNoiseGenerator(int num_samples);
+  // Runs the comfort noise generator into |samples| and adds estimated
+  // features if needed.
+  bool RunComfortNoiseGenerator(absl::Span<int16_t> samples);
 
   // Generates time domain samples from conditioning features.
   std::unique_ptr<GenerativeModelInterface> generative_model_;
@@ -150,7 +192,7 @@ class LyraDecoder : public LyraDecoderInterface {
   // Otherwise tracks samples since we last played out a received packet.
   int concealment_progress_;
   // Ranges from [0, fade_duration_samples_]. 0 indicates we are only generating
-  // model output. |fade_duration_samples| indicates we are only generating
+  // model output. |fade_duration_samples_| indicates we are only generating
   // comfort noise. Values in between indicate a fade is in progress.
   int fade_progress_;
   // Indicates if we are incrementing or decrementing |fade_progress|.
@@ -158,6 +200,23 @@ class LyraDecoder : public LyraDecoderInterface {
 
   const int external_sample_rate_hz_;
   const int num_channels_;
+  // Number of lost samples concealed by |generative_model_| before comfort
+  // noise takes over, and number of samples each fade lasts. Both are
+  // multiples of the number of samples per packet.
+  const int concealment_duration_samples_;
+  const int fade_duration_samples_;
+  // Code vector indices and features of the last received packet, kept to
+  // avoid reallocating them.
+  std::vector<int> quantized_indices_;
+  std::vector<float> features_;
+  // Packet layout of the last received packet size.
+  std::unique_ptr<PacketInterface> packet_;
+  // Hops of the generative model and comfort noise at the internal sample
+  // rate, reused between calls.
+  std::vector<int16_t> generative_model_hop_;
+  std::vector<int16_t> comfort_noise_hop_;
+  // Not owned, may be nullptr.
+  CodecStatsSinkInterface* stats_sink_;
 
   friend class LyraDecoderPeer;
 };
@@ -42,6 +42,10 @@ class LyraDecoderInterface {
   virtual std::optional<std::vector<int16_t>> DecodeSamples(
       int num_samples) = 0;
 
+  // Decodes |samples.size()| samples into |samples|.
+  // Returns false on failure.
+  virtual bool DecodeSamples(absl::Span<int16_t> samples) = 0;
+
   virtual int sample_rate_hz() const = 0;
 
   virtual int num_channels() const = 0;
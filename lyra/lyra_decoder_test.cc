@@ -26,18 +26,23 @@
 
 // Placeholder for get runfiles header.
 #include "absl/strings/string_view.h"
+#include "absl/time/time.h"
 #include "absl/types/span.h"
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
 #include "include/ghc/filesystem.hpp"
 #include "lyra/buffered_filter_interface.h"
 #include "lyra/buffered_resampler.h"
+#include "lyra/codec_stats.h"
+#include "lyra/codec_stats_sink_interface.h"
 #include "lyra/dsp_utils.h"
 #include "lyra/feature_estimator_interface.h"
 #include "lyra/generative_model_interface.h"
+#include "lyra/lyra_codec_options.h"
 #include "lyra/lyra_components.h"
 #include "lyra/lyra_config.h"
 #include "lyra/packet_interface.h"
+#include "lyra/quantizer_type.h"
 #include "lyra/resampler.h"
 #include "lyra/testing/mock_generative_model.h"
 #include "lyra/testing/mock_noise_estimator.h"
@@ -47,6 +52,28 @@
 namespace chromemedia {
 namespace codec {
 
+// Duration of pure packet loss concealment.
+inline int GetConcealmentDurationSamples() {
+  static constexpr float kConcealmentDurationSeconds = 0.08;
+  static constexpr int kConcealmentDurationSamples =
+      kConcealmentDurationSeconds * kInternalSampleRateHz;
+  CHECK_EQ(
+      kConcealmentDurationSamples % GetNumSamplesPerHop(kInternalSampleRateHz),
+      0);
+  return kConcealmentDurationSamples;
+}
+
+// Duration it takes to fade from concealment to comfort noise, and from
+// comfort noise to received packets.
+inline int GetFadeDurationSamples() {
+  static constexpr float kFadeDurationSeconds = 0.04;
+  static constexpr int kFadeDurationSamples =
+      kFadeDurationSeconds * kInternalSampleRateHz;
+  CHECK_EQ(kFadeDurationSamples % GetNumSamplesPerHop(kInternalSampleRateHz),
+           0);
+  return kFadeDurationSamples;
+}
+
 // Use a test peer to access the private constructor of LyraDecoder in order
 // to inject a MockGenerativeModel.
 class LyraDecoderPeer {
@@ -64,7 +91,8 @@ class LyraDecoderPeer {
                  std::move(mock_vector_quantizer),
                  std::move(mock_noise_estimator), std::move(feature_estimator),
                  std::move(buffered_resampler), external_sample_rate_hz,
-                 kNumChannels) {}
+                 kNumChannels, GetConcealmentDurationSamples(),
+                 GetFadeDurationSamples()) {}
 
   bool SetEncodedPacket(const absl::Span<const uint8_t> encoded) {
     return decoder_.SetEncodedPacket(encoded);
@@ -74,6 +102,10 @@ class LyraDecoderPeer {
     return decoder_.DecodeSamples(num_samples);
   }
 
+  bool DecodeSamples(absl::Span<int16_t> samples) {
+    return decoder_.DecodeSamples(samples);
+  }
+
   void SetConcealmentProgress(int samples) {
     decoder_.concealment_progress_ = samples;
   }
@@ -86,6 +118,10 @@ class LyraDecoderPeer {
     decoder_.fade_direction_ = LyraDecoder::kFadeFromCNG;
   }
 
+  void set_stats_sink(CodecStatsSinkInterface* stats_sink) {
+    decoder_.set_stats_sink(stats_sink);
+  }
+
  private:
   LyraDecoder decoder_;
 };
@@ -97,28 +133,6 @@ using testing::Return;
 
 static constexpr absl::string_view kExportedModelPath = "lyra/model_coeffs";
 
-// Duration of pure packet loss concealment.
-inline int GetConcealmentDurationSamples() {
-  static constexpr float kConcealmentDurationSeconds = 0.08;
-  static constexpr int kConcealmentDurationSamples =
-      kConcealmentDurationSeconds * kInternalSampleRateHz;
-  CHECK_EQ(
-      kConcealmentDurationSamples % GetNumSamplesPerHop(kInternalSampleRateHz),
-      0);
-  return kConcealmentDurationSamples;
-}
-
-// Duration it takes to fade from concealment to comfort noise, and from
-// comfort noise to received packets.
-inline int GetFadeDurationSamples() {
-  static constexpr float kFadeDurationSeconds = 0.04;
-  static constexpr int kFadeDurationSamples =
-      kFadeDurationSeconds * kInternalSampleRateHz;
-  CHECK_EQ(kFadeDurationSamples % GetNumSamplesPerHop(kInternalSampleRateHz),
-           0);
-  return kFadeDurationSamples;
-}
-
 class LyraDecoderTest
     : public testing::TestWithParam<testing::tuple<int, int>> {
  protected:
@@ -478,6 +492,62 @@ TEST_P(LyraDecoderTest, TestFinishDecoding_ConcealmentToComfortNoise) {
   }
 }
 
+// State 1: Normal decoding -> State 2 -> State 3 -> State 4, recorded by a
+// stats sink.
+TEST_P(LyraDecoderTest, StatsSinkRecordsStagesAndEvents) {
+  const int kNumComfortNoisePackets = 2;
+  const std::vector<int16_t> generative_samples(
+      internal_num_samples_per_hop_, ModelTypeSamples::kGenerative);
+  const std::vector<int16_t> fade_samples(internal_num_samples_per_hop_,
+                                          ModelTypeSamples::kFade);
+  const std::vector<int16_t> comfort_noise_samples(
+      internal_num_samples_per_hop_, ModelTypeSamples::kComfort);
+  {
+    ::testing::InSequence in;
+    ExpectSetEncodedPacket(1);
+    ExpectNormalDecoding(generative_samples);
+    for (int i = 0; i < concealment_duration_packets_; ++i) {
+      ExpectConcealment(generative_samples, /*expect_add_features=*/true);
+    }
+    for (int i = 0; i < fade_duration_packets_; ++i) {
+      ExpectFadeToComfortNoise(fade_samples, /*expect_add_features=*/true);
+    }
+    for (int i = 0; i < kNumComfortNoisePackets; ++i) {
+      ExpectComfortNoise(comfort_noise_samples, /*expect_add_features=*/true);
+    }
+  }
+
+  CreateDecoder();
+  CodecStats stats;
+  lyra_decoder_peer_->set_stats_sink(&stats);
+  ASSERT_TRUE(lyra_decoder_peer_->SetEncodedPacket(encoded_zeros_));
+  const int num_hops = 1 + concealment_duration_packets_ +
+                       fade_duration_packets_ + kNumComfortNoisePackets;
+  for (int i = 0; i < num_hops; ++i) {
+    ASSERT_TRUE(
+        lyra_decoder_peer_->DecodeSamples(external_num_samples_per_hop_)
+            .has_value());
+  }
+
+  EXPECT_EQ(stats.event_count(CodecEvent::kConcealedHop),
+            concealment_duration_packets_ + fade_duration_packets_);
+  EXPECT_EQ(stats.event_count(CodecEvent::kComfortNoiseHop),
+            fade_duration_packets_ + kNumComfortNoisePackets);
+  EXPECT_EQ(stats.event_count(CodecEvent::kFadeTransition), 1);
+  EXPECT_EQ(stats.event_count(CodecEvent::kDtxFrame), 0);
+  EXPECT_EQ(stats.stage_latency_ns(CodecStage::kUnpack).num_values(), 1);
+  EXPECT_EQ(stats.stage_latency_ns(CodecStage::kDequantize).num_values(), 1);
+  EXPECT_EQ(stats.stage_latency_ns(CodecStage::kResample).num_values(),
+            num_hops);
+  EXPECT_EQ(stats.stage_latency_ns(CodecStage::kGenerativeModel).num_values(),
+            1 + concealment_duration_packets_ + fade_duration_packets_);
+  EXPECT_EQ(stats.stage_latency_ns(CodecStage::kComfortNoise).num_values(),
+            fade_duration_packets_ + kNumComfortNoisePackets);
+  // Only the output of received packets updates the noise estimate.
+  EXPECT_EQ(stats.stage_latency_ns(CodecStage::kNoiseEstimation).num_values(),
+            1);
+}
+
 // State 4: Comfort noise -> SetEncodedPacket -> State 4: Comfort
 // noise -> State 5: Fade to normal.
 TEST_P(LyraDecoderTest, TestFinishDecoding_ComfortNoiseFadetoNormal) {
@@ -685,6 +755,30 @@ TEST_P(LyraDecoderTest, HopsAreOverlappedCorrectly) {
   }
 }
 
+TEST_P(LyraDecoderTest, MultipleHopsIntoBufferNormalDecode) {
+  const int kNumHopsToDecode = 4;
+  const int sample_request = ConvertNumSamplesBetweenSampleRate(
+      kNumHopsToDecode * internal_num_samples_per_hop_, kInternalSampleRateHz,
+      external_sample_rate_hz_);
+
+  ExpectSetEncodedPacket(/*num_calls=*/kNumHopsToDecode);
+  EXPECT_CALL(*mock_noise_estimator_, ReceiveSamples(::testing::_))
+      .Times(Exactly(kNumHopsToDecode))
+      .WillRepeatedly(Return(true));
+
+  CreateDecoder();
+
+  for (int i = 0; i < kNumHopsToDecode; ++i) {
+    ASSERT_TRUE(lyra_decoder_peer_->SetEncodedPacket(
+        absl::MakeConstSpan(encoded_zeros_)));
+  }
+  // Decode one hop at a time into the same buffer.
+  std::vector<int16_t> samples(sample_request / kNumHopsToDecode);
+  for (int i = 0; i < kNumHopsToDecode; ++i) {
+    ASSERT_TRUE(lyra_decoder_peer_->DecodeSamples(absl::MakeSpan(samples)));
+  }
+}
+
 TEST_P(LyraDecoderTest, ArbitraryNumSamplesNormalDecode) {
   ExpectSetEncodedPacket(external_num_samples_per_hop_);
   EXPECT_CALL(*mock_noise_estimator_, ReceiveSamples(::testing::_))
@@ -794,11 +888,63 @@ TEST_P(LyraDecoderTest, InvalidConfig) {
   }
 }
 
+TEST_P(LyraDecoderTest, ValidOptions) {
+  LyraDecoderOptions options;
+  options.sample_rate_hz = external_sample_rate_hz_;
+  options.model_path = model_path_;
+  options.model_options.threading.num_threads = 2;
+  options.model_options.warm_up = true;
+  options.quantizer_type = QuantizerType::kNative;
+  options.concealment_duration = absl::Milliseconds(120);
+  options.fade_duration = absl::Milliseconds(20);
+  EXPECT_NE(LyraDecoder::Create(options), nullptr);
+}
+
+TEST_P(LyraDecoderTest, InvalidOptions) {
+  LyraDecoderOptions options;
+  options.sample_rate_hz = external_sample_rate_hz_;
+  options.model_path = model_path_;
+  options.model_options.threading.num_threads = 0;
+  EXPECT_EQ(LyraDecoder::Create(options), nullptr);
+
+  options.model_options.threading.num_threads = 1;
+  options.fade_duration = absl::Milliseconds(30);
+  EXPECT_EQ(LyraDecoder::Create(options), nullptr);
+}
+
+
 INSTANTIATE_TEST_SUITE_P(
     SampleRateQuantizedBitsAndNumHopsPerPacket, LyraDecoderTest,
     testing::Combine(testing::ValuesIn(kSupportedSampleRates),
                      testing::ValuesIn(GetSupportedQuantizedBits())));
 
+TEST(LyraDecoderCreate, ConcealmentDurationFromOptions) {
+  const int concealment_duration_hops = 2;
+  auto decoder = LyraDecoder::Create(
+      *LyraDecoderOptionsBuilder(ghc::filesystem::current_path() /
+                                 kExportedModelPath)
+           .SetConcealmentDuration(concealment_duration_hops *
+                                   absl::Milliseconds(20))
+           .SetFadeDuration(absl::Milliseconds(20))
+           .Build());
+  ASSERT_NE(decoder, nullptr);
+  const int num_quantized_bits = GetSupportedQuantizedBits().front();
+  const std::vector<uint8_t> encoded_zeros =
+      CreatePacket(kNumHeaderBits, num_quantized_bits)
+          ->PackQuantized(std::string(num_quantized_bits, '0'));
+  const int num_samples_per_hop = GetNumSamplesPerHop(kInternalSampleRateHz);
+
+  ASSERT_TRUE(decoder->SetEncodedPacket(encoded_zeros));
+  ASSERT_TRUE(decoder->DecodeSamples(num_samples_per_hop).has_value());
+  for (int i = 0; i < concealment_duration_hops; ++i) {
+    ASSERT_TRUE(decoder->DecodeSamples(num_samples_per_hop).has_value());
+    EXPECT_FALSE(decoder->is_comfort_noise());
+  }
+  // The fade to comfort noise lasts a single hop.
+  ASSERT_TRUE(decoder->DecodeSamples(num_samples_per_hop).has_value());
+  EXPECT_TRUE(decoder->is_comfort_noise());
+}
+
 TEST(LyraDecoderCreate, InvalidCreateReturnsNullptr) {
   for (const auto& invalid_sample_rate : {0, -1, 16001}) {
     EXPECT_EQ(LyraDecoder::Create(invalid_sample_rate, kNumChannels,
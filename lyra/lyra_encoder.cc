@@ -14,7 +14,6 @@
 
 #include "lyra/lyra_encoder.h"
 
-#include <bitset>
 #include <cstdint>
 #include <memory>
 #include <optional>
@@ -26,15 +25,17 @@
 #include "absl/types/span.h"
 #include "glog/logging.h"  // IWYU pragma: keep
 #include "include/ghc/filesystem.hpp"
+#include "lyra/codec_stats_sink_interface.h"
 #include "lyra/feature_extractor_interface.h"
+#include "lyra/lyra_codec_options.h"
 #include "lyra/lyra_components.h"
 #include "lyra/lyra_config.h"
 #include "lyra/noise_estimator.h"
 #include "lyra/noise_estimator_interface.h"
-#include "lyra/packet.h"
 #include "lyra/packet_interface.h"
 #include "lyra/resampler.h"
 #include "lyra/resampler_interface.h"
+#include "lyra/tracing.h"
 #include "lyra/vector_quantizer_interface.h"
 
 namespace chromemedia {
@@ -43,43 +44,52 @@ namespace codec {
 std::unique_ptr<LyraEncoder> LyraEncoder::Create(
     int sample_rate_hz, int num_channels, int bitrate, bool enable_dtx,
     const ghc::filesystem::path& model_path) {
-  absl::Status are_params_supported =
-      AreParamsSupported(sample_rate_hz, num_channels, model_path);
-  if (!are_params_supported.ok()) {
-    LOG(ERROR) << are_params_supported;
-    return nullptr;
-  }
-  const int num_quantized_bits = BitrateToNumQuantizedBits(bitrate);
-  if (num_quantized_bits < 0) {
-    LOG(ERROR) << "Bitrate " << bitrate << " bps is not supported by codec.";
+  LyraEncoderOptions options;
+  options.sample_rate_hz = sample_rate_hz;
+  options.num_channels = num_channels;
+  options.bitrate = bitrate;
+  options.enable_dtx = enable_dtx;
+  options.model_path = model_path;
+  return Create(options);
+}
+
+std::unique_ptr<LyraEncoder> LyraEncoder::Create(
+    const LyraEncoderOptions& options) {
+  absl::Status are_options_supported = ValidateLyraEncoderOptions(options);
+  if (!are_options_supported.ok()) {
+    LOG(ERROR) << are_options_supported;
     return nullptr;
   }
+  const int num_quantized_bits = BitrateToNumQuantizedBits(options.bitrate);
 
   std::unique_ptr<Resampler> resampler = nullptr;
-  if (kInternalSampleRateHz != sample_rate_hz) {
-    resampler = Resampler::Create(sample_rate_hz, kInternalSampleRateHz);
+  if (kInternalSampleRateHz != options.sample_rate_hz) {
+    resampler =
+        Resampler::Create(options.sample_rate_hz, kInternalSampleRateHz);
     if (resampler == nullptr) {
       LOG(ERROR) << "Could not create Resampler.";
       return nullptr;
     }
   }
 
-  auto feature_extractor = CreateFeatureExtractor(model_path);
+  auto feature_extractor =
+      CreateFeatureExtractor(options.model_path, options.model_options);
   if (feature_extractor == nullptr) {
     LOG(ERROR) << "Could not create Features Extractor.";
     return nullptr;
   }
 
-  auto vector_quantizer = CreateQuantizer(model_path);
+  auto vector_quantizer = CreateQuantizer(
+      options.model_path, options.quantizer_type, options.model_options);
   if (vector_quantizer == nullptr) {
     LOG(ERROR) << "Could not create Vector Quantizer.";
     return nullptr;
   }
 
   std::unique_ptr<NoiseEstimatorInterface> noise_estimator = nullptr;
-  if (enable_dtx) {
+  if (options.enable_dtx) {
     noise_estimator = NoiseEstimator::Create(
-        sample_rate_hz, GetNumSamplesPerHop(kInternalSampleRateHz),
+        options.sample_rate_hz, GetNumSamplesPerHop(kInternalSampleRateHz),
         GetNumSamplesPerWindow(kInternalSampleRateHz), kNumMelBins);
     if (noise_estimator == nullptr) {
       LOG(ERROR) << "Could not create Noise Estimator.";
@@ -88,10 +98,13 @@ std::unique_ptr<LyraEncoder> LyraEncoder::Create(
   }
 
   // WrapUnique is used because of private c'tor.
-  return absl::WrapUnique(new LyraEncoder(
+  auto encoder = absl::WrapUnique(new LyraEncoder(
       std::move(resampler), std::move(feature_extractor),
-      std::move(noise_estimator), std::move(vector_quantizer), sample_rate_hz,
-      num_channels, num_quantized_bits, enable_dtx));
+      std::move(noise_estimator), std::move(vector_quantizer),
+      options.sample_rate_hz, options.num_channels, num_quantized_bits,
+      options.enable_dtx));
+  encoder->set_stats_sink(options.stats_sink);
+  return encoder;
 }
 
 LyraEncoder::LyraEncoder(
@@ -108,17 +121,34 @@ LyraEncoder::LyraEncoder(
       sample_rate_hz_(sample_rate_hz),
       num_channels_(num_channels),
       num_quantized_bits_(num_quantized_bits),
-      enable_dtx_(enable_dtx) {}
+      enable_dtx_(enable_dtx),
+      packet_(CreatePacket(kNumHeaderBits, num_quantized_bits)),
+      resampled_audio_(GetNumSamplesPerHop(kInternalSampleRateHz)),
+      features_(kNumFeatures),
+      stats_sink_(nullptr) {}
 
 std::optional<std::vector<uint8_t>> LyraEncoder::Encode(
     const absl::Span<const int16_t> audio) {
+  std::vector<uint8_t> encoded(packet_->PacketSize());
+  const auto num_bytes = Encode(audio, absl::MakeSpan(encoded));
+  if (!num_bytes.has_value()) {
+    return std::nullopt;
+  }
+  encoded.resize(num_bytes.value());
+  return encoded;
+}
+
+std::optional<int> LyraEncoder::Encode(const absl::Span<const int16_t> audio,
+                                       absl::Span<uint8_t> encoded) {
+  LYRA_TRACE_SCOPE("LyraEncoder::Encode");
   absl::Span<const int16_t> audio_for_encoding = audio;
 
-  // Space to store resampled and/or filtered samples.
-  std::vector<int16_t> processed;
   if (kInternalSampleRateHz != sample_rate_hz_) {
-    processed = resampler_->Resample(audio);
-    audio_for_encoding = absl::MakeConstSpan(processed);
+    ScopedStageTimer timer(stats_sink_, CodecStage::kResample);
+    const auto num_resampled =
+        resampler_->ResampleInto(audio, absl::MakeSpan(resampled_audio_));
+    audio_for_encoding = absl::MakeConstSpan(resampled_audio_)
+                             .first(num_resampled.value_or(0));
   }
 
   if (audio_for_encoding.size() != GetNumSamplesPerHop(kInternalSampleRateHz)) {
@@ -129,30 +159,53 @@ std::optional<std::vector<uint8_t>> LyraEncoder::Encode(
   }
 
   if (enable_dtx_) {
-    if (!noise_estimator_->ReceiveSamples(audio_for_encoding)) {
-      LOG(ERROR) << "Unable to update encoder noise estimator.";
-      return std::nullopt;
+    {
+      ScopedStageTimer timer(stats_sink_, CodecStage::kNoiseEstimation);
+      if (!noise_estimator_->ReceiveSamples(audio_for_encoding)) {
+        LOG(ERROR) << "Unable to update encoder noise estimator.";
+        return std::nullopt;
+      }
     }
     // We send an empty packet only if this hop is just noise.
     if (noise_estimator_->is_noise()) {
-      auto empty_packet = Packet<0>::Create(0, 0);
-      return empty_packet->PackQuantized(std::bitset<0>{}.to_string());
+      RecordCodecEvent(stats_sink_, CodecEvent::kDtxFrame);
+      LYRA_TRACE_INSTANT("LyraEncoder DTX frame");
+      return 0;
     }
   }
 
-  auto features = feature_extractor_->Extract(audio_for_encoding);
-  if (!features.has_value()) {
-    LOG(ERROR) << "Unable to extract features from audio hop.";
+  if (encoded.size() < packet_->PacketSize()) {
+    LOG(ERROR) << "The packet needs " << packet_->PacketSize()
+               << " bytes, but only " << encoded.size() << " are available.";
     return std::nullopt;
   }
-  auto quantized_features =
-      vector_quantizer_->Quantize(features.value(), num_quantized_bits_);
-  if (!quantized_features.has_value()) {
-    LOG(ERROR) << "Unable to quantize features.";
+  {
+    ScopedStageTimer timer(stats_sink_, CodecStage::kExtractFeatures);
+    if (!feature_extractor_->ExtractInto(audio_for_encoding,
+                                         absl::MakeSpan(features_))) {
+      LOG(ERROR) << "Unable to extract features from audio hop.";
+      return std::nullopt;
+    }
+  }
+  const int bits_per_quantizer = vector_quantizer_->bits_per_quantizer();
+  quantized_indices_.resize(num_quantized_bits_ / bits_per_quantizer);
+  {
+    ScopedStageTimer timer(stats_sink_, CodecStage::kQuantize);
+    if (!vector_quantizer_->QuantizeToIndices(
+            features_, num_quantized_bits_,
+            absl::MakeSpan(quantized_indices_))) {
+      LOG(ERROR) << "Unable to quantize features.";
+      return std::nullopt;
+    }
+  }
+  encoded = encoded.first(packet_->PacketSize());
+  ScopedStageTimer timer(stats_sink_, CodecStage::kPack);
+  if (!packet_->PackIndices(quantized_indices_, bits_per_quantizer,
+                            encoded)) {
+    LOG(ERROR) << "Unable to pack quantized features.";
     return std::nullopt;
   }
-  auto packet = CreatePacket(kNumHeaderBits, num_quantized_bits_);
-  return packet->PackQuantized(quantized_features.value());
+  return encoded.size();
 }
 
 bool LyraEncoder::set_bitrate(int bitrate) {
@@ -161,6 +214,9 @@ bool LyraEncoder::set_bitrate(int bitrate) {
     LOG(ERROR) << "Bitrate " << bitrate << " bps is not supported by codec.";
     return false;
   }
+  if (num_quantized_bits != num_quantized_bits_) {
+    packet_ = CreatePacket(kNumHeaderBits, num_quantized_bits);
+  }
   num_quantized_bits_ = num_quantized_bits;
   return true;
 }
@@ -172,5 +228,10 @@ int LyraEncoder::num_channels() const { return num_channels_; }
 int LyraEncoder::bitrate() const { return GetBitrate(num_quantized_bits_); }
 
 int LyraEncoder::frame_rate() const { return kFrameRate; }
+
+void LyraEncoder::set_stats_sink(CodecStatsSinkInterface* stats_sink) {
+  stats_sink_ = stats_sink;
+}
+
 }  // namespace codec
 }  // namespace chromemedia
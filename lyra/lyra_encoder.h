@@ -24,9 +24,12 @@
 
 #include "absl/types/span.h"
 #include "include/ghc/filesystem.hpp"
+#include "lyra/codec_stats_sink_interface.h"
 #include "lyra/feature_extractor_interface.h"
+#include "lyra/lyra_codec_options.h"
 #include "lyra/lyra_encoder_interface.h"
 #include "lyra/noise_estimator_interface.h"
+#include "lyra/packet_interface.h"
 #include "lyra/resampler_interface.h"
 #include "lyra/vector_quantizer_interface.h"
 
@@ -62,6 +65,15 @@ class LyraEncoder : public LyraEncoderInterface {
       int sample_rate_hz, int num_channels, int bitrate, bool enable_dtx,
       const ghc::filesystem::path& model_path);
 
+  /// Static method to create a LyraEncoder from options.
+  ///
+  /// @param options Parameters of the encoder and how it runs its models,
+  ///                for example built by |LyraEncoderOptionsBuilder|. Only
+  ///                |options.model_path| has no usable default.
+  /// @return A unique_ptr to a LyraEncoder if the options are valid. Else it
+  ///         returns a nullptr.
+  static std::unique_ptr<LyraEncoder> Create(const LyraEncoderOptions& options);
+
   /// Encodes the audio samples into a vector wrapped byte array.
   ///
   /// @param audio Span of int16-formatted samples. It is assumed to contain
@@ -74,6 +86,21 @@ class LyraEncoder : public LyraEncoderInterface {
   std::optional<std::vector<uint8_t>> Encode(
       const absl::Span<const int16_t> audio) override;
 
+  /// Encodes the audio samples into a caller-provided buffer.
+  ///
+  /// Behaves like |Encode(audio)| but writes the packet into |encoded|. Once
+  /// warmed up, this does not allocate on the heap.
+  ///
+  /// @param audio Span of int16-formatted samples. It is assumed to contain
+  ///              20ms of data at the sample rate chosen at Create time.
+  /// @param encoded Buffer for the packet. It has to hold at least the packet
+  ///                size of the current bitrate.
+  /// @return Number of bytes written to |encoded|, which is zero if
+  ///         discontinuous transmission mode is enabled and the frame
+  ///         contains background noise. Returns nullopt on failure.
+  std::optional<int> Encode(const absl::Span<const int16_t> audio,
+                            absl::Span<uint8_t> encoded) override;
+
   /// Setter for the bitrate.
   ///
   /// @param bitrate Desired bitrate in bps.
@@ -100,6 +127,14 @@ class LyraEncoder : public LyraEncoderInterface {
   /// @return Frame rate.
   int frame_rate() const override;
 
+  /// Setter for the stats sink.
+  ///
+  /// @param stats_sink Receives the duration of each encoding stage and the
+  ///                   DTX frames of every following call to |Encode|. It is
+  ///                   not owned and has to outlive its use. nullptr, the
+  ///                   default, disables instrumentation.
+  void set_stats_sink(CodecStatsSinkInterface* stats_sink);
+
  private:
   LyraEncoder() = delete;
   LyraEncoder(std::unique_ptr<ResamplerInterface> resampler,
@@ -118,6 +153,15 @@ class LyraEncoder : public LyraEncoderInterface {
   const int num_channels_;
   int num_quantized_bits_;
   const bool enable_dtx_;
+  // Packet layout of the current bitrate.
+  std::unique_ptr<PacketInterface> packet_;
+  // Resampled audio, features and code vector indices of the current hop,
+  // kept to avoid reallocating them.
+  std::vector<int16_t> resampled_audio_;
+  std::vector<float> features_;
+  std::vector<int> quantized_indices_;
+  // Not owned, may be nullptr.
+  CodecStatsSinkInterface* stats_sink_;
   friend class LyraEncoderPeer;
 };
 
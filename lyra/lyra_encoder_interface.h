@@ -36,6 +36,12 @@ class LyraEncoderInterface {
   virtual std::optional<std::vector<uint8_t>> Encode(
       const absl::Span<const int16_t> audio) = 0;
 
+  // Encodes |audio| into |encoded|. Returns the number of bytes written, which
+  // is zero for a hop skipped by discontinuous transmission. Returns nullopt
+  // on failure.
+  virtual std::optional<int> Encode(const absl::Span<const int16_t> audio,
+                                    absl::Span<uint8_t> encoded) = 0;
+
   virtual bool set_bitrate(int bitrate) = 0;
 
   virtual int sample_rate_hz() const = 0;
@@ -30,10 +30,14 @@
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
 #include "include/ghc/filesystem.hpp"
+#include "lyra/codec_stats.h"
+#include "lyra/codec_stats_sink_interface.h"
 #include "lyra/feature_extractor_interface.h"
+#include "lyra/lyra_codec_options.h"
 #include "lyra/lyra_config.h"
 #include "lyra/noise_estimator_interface.h"
 #include "lyra/packet.h"
+#include "lyra/quantizer_type.h"
 #include "lyra/resampler_interface.h"
 #include "lyra/testing/mock_feature_extractor.h"
 #include "lyra/testing/mock_noise_estimator.h"
@@ -64,8 +68,17 @@ class LyraEncoderPeer {
     return encoder_.Encode(audio);
   }
 
+  std::optional<int> Encode(const absl::Span<const int16_t> audio,
+                            absl::Span<uint8_t> encoded) {
+    return encoder_.Encode(audio, encoded);
+  }
+
   bool set_bitrate(int bitrate) { return encoder_.set_bitrate(bitrate); }
 
+  void set_stats_sink(CodecStatsSinkInterface* stats_sink) {
+    encoder_.set_stats_sink(stats_sink);
+  }
+
  private:
   LyraEncoder encoder_;
 };
@@ -257,6 +270,47 @@ TEST_P(LyraEncoderTest, NoiseDetectionReturnsEmptyPacket) {
   EXPECT_EQ(packed, encoded.value());
 }
 
+TEST_P(LyraEncoderTest, EncodeIntoBufferWritesPacket) {
+  SetResamplerExpectation(1);
+  EXPECT_CALL(*mock_feature_extractor_, Extract(internal_samples_span_))
+      .WillOnce(Return(mock_features_));
+  EXPECT_CALL(*mock_vector_quantizer_,
+              Quantize(mock_features_, num_quantized_bits_))
+      .WillOnce(Return(mock_quantized_));
+
+  LyraEncoderPeer encoder_peer(std::move(mock_resampler_),
+                               std::move(mock_feature_extractor_), nullptr,
+                               std::move(mock_vector_quantizer_),
+                               external_sample_rate_hz_, num_quantized_bits_,
+                               /*enable_dtx=*/false);
+  // Larger than needed, only the packet itself is written.
+  std::vector<uint8_t> encoded(GetPacketSize(num_quantized_bits_) + 1, 0xff);
+  const auto num_bytes =
+      encoder_peer.Encode(samples_span_, absl::MakeSpan(encoded));
+
+  ASSERT_TRUE(num_bytes.has_value());
+  EXPECT_EQ(num_bytes.value(), GetPacketSize(num_quantized_bits_));
+  EXPECT_EQ(encoded.back(), 0xff);
+  encoded.resize(num_bytes.value());
+  EXPECT_TRUE(DoesPacketContainQuantized(encoded, mock_quantized_));
+}
+
+TEST_P(LyraEncoderTest, EncodeIntoTooSmallBufferFails) {
+  SetResamplerExpectation(1);
+  EXPECT_CALL(*mock_feature_extractor_, Extract(_)).Times(0);
+  EXPECT_CALL(*mock_vector_quantizer_, Quantize(_, _)).Times(0);
+
+  LyraEncoderPeer encoder_peer(std::move(mock_resampler_),
+                               std::move(mock_feature_extractor_), nullptr,
+                               std::move(mock_vector_quantizer_),
+                               external_sample_rate_hz_, num_quantized_bits_,
+                               /*enable_dtx=*/false);
+  std::vector<uint8_t> encoded(GetPacketSize(num_quantized_bits_) - 1);
+
+  EXPECT_FALSE(encoder_peer.Encode(samples_span_, absl::MakeSpan(encoded))
+                   .has_value());
+}
+
 TEST_P(LyraEncoderTest, QuantizationFails) {
   SetResamplerExpectation(1);
   EXPECT_CALL(*mock_feature_extractor_, Extract(_))
@@ -301,6 +355,49 @@ TEST_P(LyraEncoderTest, MultipleEncodeCalls) {
   }
 }
 
+TEST_P(LyraEncoderTest, StatsSinkRecordsStagesAndDtxFrames) {
+  const int kNumEncodeCalls = 3;
+  SetResamplerExpectation(kNumEncodeCalls);
+  EXPECT_CALL(*mock_noise_estimator_, ReceiveSamples(_))
+      .Times(kNumEncodeCalls)
+      .WillRepeatedly(Return(true));
+  // Only the last hop is sent.
+  EXPECT_CALL(*mock_noise_estimator_, is_noise())
+      .Times(kNumEncodeCalls)
+      .WillOnce(Return(true))
+      .WillOnce(Return(true))
+      .WillOnce(Return(false));
+  EXPECT_CALL(*mock_feature_extractor_, Extract(_))
+      .WillOnce(Return(mock_features_));
+  EXPECT_CALL(*mock_vector_quantizer_,
+              Quantize(mock_features_, num_quantized_bits_))
+      .WillOnce(Return(mock_quantized_));
+
+  LyraEncoderPeer encoder_peer(
+      std::move(mock_resampler_), std::move(mock_feature_extractor_),
+      std::move(mock_noise_estimator_), std::move(mock_vector_quantizer_),
+      external_sample_rate_hz_, num_quantized_bits_,
+      /*enable_dtx=*/true);
+  CodecStats stats;
+  encoder_peer.set_stats_sink(&stats);
+  for (int i = 0; i < kNumEncodeCalls; ++i) {
+    ASSERT_TRUE(encoder_peer.Encode(samples_span_).has_value());
+  }
+
+  EXPECT_EQ(stats.event_count(CodecEvent::kDtxFrame), 2);
+  EXPECT_EQ(stats.stage_latency_ns(CodecStage::kResample).num_values(),
+            kInternalSampleRateHz == external_sample_rate_hz_
+                ? 0
+                : kNumEncodeCalls);
+  EXPECT_EQ(stats.stage_latency_ns(CodecStage::kNoiseEstimation).num_values(),
+            kNumEncodeCalls);
+  EXPECT_EQ(stats.stage_latency_ns(CodecStage::kExtractFeatures).num_values(),
+            1);
+  EXPECT_EQ(stats.stage_latency_ns(CodecStage::kQuantize).num_values(), 1);
+  EXPECT_EQ(stats.stage_latency_ns(CodecStage::kPack).num_values(), 1);
+  EXPECT_EQ(stats.stage_latency_ns(CodecStage::kUnpack).num_values(), 0);
+}
+
 TEST_P(LyraEncoderTest, GoodCreationParametersReturnNotNullptr) {
   const auto valid_model_path =
       ghc::filesystem::current_path() / "lyra/model_coeffs";
@@ -349,6 +446,38 @@ TEST_P(LyraEncoderTest, BadCreationParametersReturnNullptr) {
                                 /*enable_dtx=*/true, "bad_model_path"));
 }
 
+TEST_P(LyraEncoderTest, CreationFromOptions) {
+  LyraEncoderOptions options;
+  options.sample_rate_hz = external_sample_rate_hz_;
+  options.bitrate = GetBitrate(num_quantized_bits_);
+  options.enable_dtx = true;
+  options.model_path = ghc::filesystem::current_path() / "lyra/model_coeffs";
+  options.model_options.threading.num_threads = 2;
+  options.model_options.warm_up = true;
+  options.quantizer_type = QuantizerType::kNative;
+  EXPECT_NE(nullptr, LyraEncoder::Create(options));
+
+  options.model_options.threading.num_threads = 0;
+  EXPECT_EQ(nullptr, LyraEncoder::Create(options));
+}
+
+TEST_P(LyraEncoderTest, CreationFromOptionsRecordsStats) {
+  CodecStats stats;
+  std::unique_ptr<LyraEncoder> encoder = LyraEncoder::Create(
+      *LyraEncoderOptionsBuilder(ghc::filesystem::current_path() /
+                                 "lyra/model_coeffs")
+           .SetSampleRateHz(external_sample_rate_hz_)
+           .SetBitrate(GetBitrate(num_quantized_bits_))
+           .SetStatsSink(&stats)
+           .Build());
+  ASSERT_NE(encoder, nullptr);
+  ASSERT_TRUE(encoder
+                  ->Encode(std::vector<int16_t>(
+                      GetNumSamplesPerHop(external_sample_rate_hz_)))
+                  .has_value());
+  EXPECT_EQ(stats.stage_latency_ns(CodecStage::kPack).num_values(), 1);
+}
+
 TEST_P(LyraEncoderTest, SetBitrateSucceeds) {
   LyraEncoderPeer encoder_peer(std::move(mock_resampler_),
                                std::move(mock_feature_extractor_), nullptr,
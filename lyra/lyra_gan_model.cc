@@ -28,20 +28,30 @@
 #include "absl/types/span.h"
 #include "glog/logging.h"  // IWYU pragma: keep
 #include "lyra/dsp_utils.h"
+#include "lyra/tflite_model_options.h"
 #include "lyra/tflite_model_wrapper.h"
+#include "lyra/tracing.h"
 
 namespace chromemedia {
 namespace codec {
 
 std::unique_ptr<LyraGanModel> LyraGanModel::Create(
-    const ghc::filesystem::path& model_path, int num_features) {
+    const ghc::filesystem::path& model_path, int num_features,
+    const TfLiteModelOptions& model_options) {
   auto model =
       TfLiteModelWrapper::Create(model_path / "lyragan.tflite",
-                                 /*use_xnn=*/true, /*int8_quantized=*/true);
+                                 model_options.use_xnnpack,
+                                 /*int8_quantized=*/true,
+                                 model_options.use_weights_cache,
+                                 model_options.threading);
   if (model == nullptr) {
     LOG(ERROR) << "Unable to create LyraGAN TFLite model wrapper.";
     return nullptr;
   }
+  if (model_options.warm_up && !model->WarmUp()) {
+    LOG(ERROR) << "Unable to warm up LyraGAN TFLite model wrapper.";
+    return nullptr;
+  }
   return absl::WrapUnique(new LyraGanModel(std::move(model), num_features));
 }
 
@@ -51,16 +61,20 @@ LyraGanModel::LyraGanModel(std::unique_ptr<TfLiteModelWrapper> model,
       model_(std::move(model)) {}
 
 bool LyraGanModel::RunConditioning(const std::vector<float>& features) {
+  LYRA_TRACE_SCOPE("LyraGanModel::RunConditioning");
   absl::Span<float> input = model_->get_input_tensor<float>(0);
   std::copy(features.begin(), features.end(), input.begin());
   model_->Invoke();
   return true;
 }
 
-std::optional<std::vector<int16_t>> LyraGanModel::RunModel(int num_samples) {
-  return UnitToInt16(absl::MakeConstSpan(
-      &model_->get_output_tensor<float>(0).at(next_sample_in_hop()),
-      num_samples));
+bool LyraGanModel::RunModel(absl::Span<int16_t> samples) {
+  LYRA_TRACE_SCOPE("LyraGanModel::RunModel");
+  UnitToInt16(absl::MakeConstSpan(
+                  &model_->get_output_tensor<float>(0).at(next_sample_in_hop()),
+                  samples.size()),
+              samples);
+  return true;
 }
 
 }  // namespace codec
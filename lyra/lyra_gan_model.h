@@ -22,8 +22,10 @@
 #include <optional>
 #include <vector>
 
+#include "absl/types/span.h"
 #include "include/ghc/filesystem.hpp"
 #include "lyra/generative_model_interface.h"
+#include "lyra/tflite_model_options.h"
 #include "lyra/tflite_model_wrapper.h"
 
 namespace chromemedia {
@@ -34,7 +36,8 @@ class LyraGanModel : public GenerativeModel {
  public:
   // Returns a nullptr on failure.
   static std::unique_ptr<LyraGanModel> Create(
-      const ghc::filesystem::path& model_path, int num_features);
+      const ghc::filesystem::path& model_path, int num_features,
+      const TfLiteModelOptions& model_options = TfLiteModelOptions());
 
   ~LyraGanModel() override {}
 
@@ -44,7 +47,7 @@ class LyraGanModel : public GenerativeModel {
 
   bool RunConditioning(const std::vector<float>& features) override;
 
-  std::optional<std::vector<int16_t>> RunModel(int num_samples) override;
+  bool RunModel(absl::Span<int16_t> samples) override;
 
   const std::unique_ptr<TfLiteModelWrapper> model_;
 };
@@ -0,0 +1,93 @@
+// Copyright 2022 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <string>
+#include <thread>  // NOLINT(build/c++11)
+#include <vector>
+
+#include "absl/flags/flag.h"
+#include "absl/flags/parse.h"
+#include "absl/flags/usage.h"
+#include "absl/strings/numbers.h"
+#include "absl/time/time.h"
+#include "glog/logging.h"  // IWYU pragma: keep
+#include "lyra/lyra_stream_benchmark_lib.h"
+#include "lyra/stream_scaling_benchmark.h"
+
+ABSL_FLAG(std::vector<std::string>, num_streams, {},
+          "Comma separated numbers of concurrent streams to run, in order. "
+          "Empty runs powers of two up to twice the number of cores.");
+
+ABSL_FLAG(absl::Duration, duration_per_run, absl::Seconds(10),
+          "How long each number of streams runs, like '10s'.");
+
+ABSL_FLAG(int, sample_rate_hz, 16000, "Sample rate of the streams.");
+
+ABSL_FLAG(int, bitrate, 3200, "Bitrate of the streams in bps.");
+
+ABSL_FLAG(bool, encode, true,
+          "Whether every stream encodes a hop every 20 ms.");
+
+ABSL_FLAG(bool, decode, true,
+          "Whether every stream decodes a hop every 20 ms. Without --encode, "
+          "streams decode packets encoded before the run.");
+
+ABSL_FLAG(bool, pin_threads, false,
+          "Whether to run stream i on core i modulo the number of cores. Only "
+          "supported on Linux.");
+
+ABSL_FLAG(double, max_missed_deadline_rate, 0.001,
+          "The sweep stops after the first number of streams which misses more "
+          "than this fraction of its deadlines.");
+
+ABSL_FLAG(std::string, model_path, "lyra/model_coeffs",
+          "Path to directory containing TFLite files. For mobile this is the "
+          "absolute path, like "
+          "'/data/local/tmp/lyra/model_coeffs/'."
+          " For desktop this is the path relative to the binary.");
+
+ABSL_FLAG(std::string, output_dir, "/tmp/benchmarks",
+          "Directory for a lyra_stream_benchmark.json report. Created if it "
+          "does not exist. Empty only logs the results.");
+
+int main(int argc, char** argv) {
+  absl::SetProgramUsageMessage(argv[0]);
+  absl::ParseCommandLine(argc, argv);
+
+  chromemedia::codec::StreamBenchmarkOptions options;
+  for (const std::string& text : absl::GetFlag(FLAGS_num_streams)) {
+    int num_streams;
+    if (!absl::SimpleAtoi(text, &num_streams) || num_streams < 1) {
+      LOG(ERROR) << "Invalid number of streams '" << text << "'.";
+      return -1;
+    }
+    options.num_streams.push_back(num_streams);
+  }
+  if (options.num_streams.empty()) {
+    options.num_streams = chromemedia::codec::DefaultStreamCounts(
+        std::thread::hardware_concurrency());
+  }
+  options.duration_per_run = absl::GetFlag(FLAGS_duration_per_run);
+  options.sample_rate_hz = absl::GetFlag(FLAGS_sample_rate_hz);
+  options.bitrate = absl::GetFlag(FLAGS_bitrate);
+  options.encode = absl::GetFlag(FLAGS_encode);
+  options.decode = absl::GetFlag(FLAGS_decode);
+  options.pin_threads = absl::GetFlag(FLAGS_pin_threads);
+  options.max_missed_deadline_rate =
+      absl::GetFlag(FLAGS_max_missed_deadline_rate);
+  options.model_base_path = absl::GetFlag(FLAGS_model_path);
+  options.output_dir = absl::GetFlag(FLAGS_output_dir);
+
+  return chromemedia::codec::lyra_stream_benchmark(options);
+}
@@ -0,0 +1,258 @@
+// Copyright 2022 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "lyra/lyra_stream_benchmark_lib.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <random>
+#include <string>
+#include <system_error>  // NOLINT(build/c++11)
+#include <thread>        // NOLINT(build/c++11)
+#include <utility>
+#include <vector>
+
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_format.h"
+#include "absl/time/time.h"
+#include "absl/types/span.h"
+#include "glog/logging.h"  // IWYU pragma: keep
+#include "include/ghc/filesystem.hpp"
+#include "lyra/architecture_utils.h"
+#include "lyra/benchmark_report.h"
+#include "lyra/dsp_utils.h"
+#include "lyra/lyra_config.h"
+#include "lyra/lyra_decoder.h"
+#include "lyra/lyra_encoder.h"
+#include "lyra/stream_scaling_benchmark.h"
+
+namespace chromemedia {
+namespace codec {
+namespace {
+
+// Every stream loops over the same 5 seconds of audio.
+constexpr int kNumSourceHops = 250;
+
+class LyraBenchmarkStream : public BenchmarkStream {
+ public:
+  // Either of |encoder| and |decoder| may be nullptr. Without an encoder,
+  // |packets| are decoded.
+  LyraBenchmarkStream(std::unique_ptr<LyraEncoder> encoder,
+                      std::unique_ptr<LyraDecoder> decoder, int bitrate,
+                      int num_samples_per_hop,
+                      const std::vector<int16_t>& audio,
+                      const std::vector<std::vector<uint8_t>>& packets)
+      : encoder_(std::move(encoder)),
+        decoder_(std::move(decoder)),
+        num_samples_per_hop_(num_samples_per_hop),
+        audio_(audio),
+        packets_(packets),
+        packet_(BitrateToPacketSize(bitrate)),
+        decoded_(num_samples_per_hop) {}
+
+  // Uses the allocation-free calls, as a real-time stream would.
+  bool ProcessHop(int64_t hop_index) override {
+    const int source_hop = hop_index % kNumSourceHops;
+    absl::Span<const uint8_t> packet;
+    if (encoder_ != nullptr) {
+      const std::optional<int> packet_size =
+          encoder_->Encode(absl::MakeConstSpan(audio_).subspan(
+                               source_hop * num_samples_per_hop_,
+                               num_samples_per_hop_),
+                           absl::MakeSpan(packet_));
+      if (!packet_size.has_value()) {
+        return false;
+      }
+      packet = absl::MakeConstSpan(packet_).first(*packet_size);
+    } else {
+      packet = packets_[source_hop];
+    }
+    if (decoder_ != nullptr) {
+      if (!decoder_->SetEncodedPacket(packet) ||
+          !decoder_->DecodeSamples(absl::MakeSpan(decoded_))) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+ private:
+  const std::unique_ptr<LyraEncoder> encoder_;
+  const std::unique_ptr<LyraDecoder> decoder_;
+  const int num_samples_per_hop_;
+  const std::vector<int16_t>& audio_;
+  const std::vector<std::vector<uint8_t>>& packets_;
+  std::vector<uint8_t> packet_;
+  std::vector<int16_t> decoded_;
+};
+
+// Encodes |audio| hop by hop for streams that only decode.
+std::optional<std::vector<std::vector<uint8_t>>> EncodeSourceAudio(
+    const std::vector<int16_t>& audio, const StreamBenchmarkOptions& options,
+    const ghc::filesystem::path& model_path) {
+  auto encoder =
+      LyraEncoder::Create(options.sample_rate_hz, kNumChannels,
+                          options.bitrate, /*enable_dtx=*/false, model_path);
+  if (encoder == nullptr) {
+    LOG(ERROR) << "Could not create lyra encoder.";
+    return std::nullopt;
+  }
+  const int num_samples_per_hop = GetNumSamplesPerHop(options.sample_rate_hz);
+  std::vector<std::vector<uint8_t>> packets;
+  for (int hop = 0; hop < kNumSourceHops; ++hop) {
+    std::optional<std::vector<uint8_t>> packet =
+        encoder->Encode(absl::MakeConstSpan(audio).subspan(
+            hop * num_samples_per_hop, num_samples_per_hop));
+    if (!packet.has_value()) {
+      LOG(ERROR) << "Could not encode hop " << hop << ".";
+      return std::nullopt;
+    }
+    packets.push_back(*std::move(packet));
+  }
+  return packets;
+}
+
+}  // namespace
+
+int lyra_stream_benchmark(const StreamBenchmarkOptions& options) {
+  if (!options.encode && !options.decode) {
+    LOG(ERROR) << "Streams have to encode, decode or both.";
+    return -1;
+  }
+  if (!IsSampleRateSupported(options.sample_rate_hz)) {
+    LOG(ERROR) << "Sample rate " << options.sample_rate_hz
+               << " Hz is not supported.";
+    return -1;
+  }
+  const absl::Duration hop_duration = absl::Seconds(1) / kFrameRate;
+  absl::Duration remainder;
+  const int64_t num_hops =
+      absl::IDivDuration(options.duration_per_run, hop_duration, &remainder);
+  if (options.num_streams.empty() || num_hops < 1) {
+    LOG(ERROR) << "Nothing to run.";
+    return -1;
+  }
+  if (!options.output_dir.empty()) {
+    std::error_code error_code;
+    if (!ghc::filesystem::is_directory(options.output_dir, error_code) &&
+        !ghc::filesystem::create_directories(options.output_dir,
+                                             error_code)) {
+      LOG(ERROR) << "Could not create output dir " << options.output_dir
+                 << ": " << error_code.message();
+      return -1;
+    }
+  }
+  const ghc::filesystem::path model_path =
+      GetCompleteArchitecturePath(options.model_base_path);
+  const int num_samples_per_hop = GetNumSamplesPerHop(options.sample_rate_hz);
+
+  // Like lyra_benchmark, uses noise, which is never skipped or handled
+  // differently from speech.
+  std::uniform_real_distribution<float> distribution(-1.0, 1.0);
+  std::default_random_engine generator;
+  std::vector<int16_t> audio(kNumSourceHops * num_samples_per_hop);
+  std::generate(audio.begin(), audio.end(),
+                [&]() { return UnitToInt16Scalar(distribution(generator)); });
+  std::vector<std::vector<uint8_t>> packets;
+  if (!options.encode) {
+    auto encoded = EncodeSourceAudio(audio, options, model_path);
+    if (!encoded.has_value()) {
+      return -1;
+    }
+    packets = *std::move(encoded);
+  }
+
+  const BenchmarkStreamFactory create_stream =
+      [&](int stream_index) -> std::unique_ptr<BenchmarkStream> {
+    std::unique_ptr<LyraEncoder> encoder;
+    if (options.encode) {
+      encoder = LyraEncoder::Create(options.sample_rate_hz, kNumChannels,
+                                    options.bitrate, /*enable_dtx=*/false,
+                                    model_path);
+      if (encoder == nullptr) {
+        return nullptr;
+      }
+    }
+    std::unique_ptr<LyraDecoder> decoder;
+    if (options.decode) {
+      decoder =
+          LyraDecoder::Create(options.sample_rate_hz, kNumChannels, model_path);
+      if (decoder == nullptr) {
+        return nullptr;
+      }
+    }
+    return std::make_unique<LyraBenchmarkStream>(
+        std::move(encoder), std::move(decoder), options.bitrate,
+        num_samples_per_hop, audio, packets);
+  };
+
+  const int num_cpus = std::max<int>(std::thread::hardware_concurrency(), 1);
+  BenchmarkReport report("lyra_stream_benchmark");
+  report.AddParameter("sample_rate_hz", options.sample_rate_hz);
+  report.AddParameter("bitrate", options.bitrate);
+  report.AddParameter("encode", options.encode);
+  report.AddParameter("decode", options.decode);
+  report.AddParameter("pin_threads", options.pin_threads);
+  report.AddParameter("num_hops_per_run", num_hops);
+  report.AddMetric("max_missed_deadline_rate",
+                   options.max_missed_deadline_rate);
+
+  LOG(INFO) << "Running each number of streams for " << num_hops
+            << " hops on " << num_cpus << " cores:";
+  int max_sustained_streams = 0;
+  for (const int num_streams : options.num_streams) {
+    const std::optional<StreamScalingResult> result = RunRealtimeStreams(
+        num_streams, num_hops, hop_duration, options.pin_threads,
+        create_stream);
+    if (!result.has_value()) {
+      return -1;
+    }
+    const LatencyHistogram& latency = result->latency;
+    LOG(INFO) << absl::StrFormat(
+        "%4d streams (%5.2f per core):  missed: %7.3f%%  p50: %7.3f ms  "
+        "p95: %7.3f ms  p99: %7.3f ms  p99.9: %7.3f ms  max: %7.3f ms",
+        num_streams, static_cast<float>(num_streams) / num_cpus,
+        100.0 * result->missed_deadline_rate(),
+        latency.Percentile(50) / 1000.0, latency.Percentile(95) / 1000.0,
+        latency.Percentile(99) / 1000.0, latency.Percentile(99.9) / 1000.0,
+        latency.max() / 1000.0);
+    const std::string name = absl::StrCat("streams_", num_streams);
+    report.AddStage(name, latency);
+    report.AddMetric(absl::StrCat(name, "_missed_deadline_rate"),
+                     result->missed_deadline_rate());
+    if (result->missed_deadline_rate() > options.max_missed_deadline_rate) {
+      break;
+    }
+    max_sustained_streams = std::max(max_sustained_streams, num_streams);
+  }
+  LOG(INFO) << "Sustained " << max_sustained_streams << " streams, "
+            << static_cast<float>(max_sustained_streams) / num_cpus
+            << " per core, missing at most "
+            << 100.0 * options.max_missed_deadline_rate
+            << "% of the deadlines.";
+  report.AddMetric("max_sustained_streams", max_sustained_streams);
+  report.AddMetric("max_sustained_streams_per_core",
+                   static_cast<double>(max_sustained_streams) / num_cpus);
+  if (!options.output_dir.empty() &&
+      !report.WriteJson(ghc::filesystem::path(options.output_dir) /
+                        "lyra_stream_benchmark.json")) {
+    return -1;
+  }
+  return 0;
+}
+
+}  // namespace codec
+}  // namespace chromemedia
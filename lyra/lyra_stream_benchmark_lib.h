@@ -0,0 +1,57 @@
+/*
+ * Copyright 2022 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LYRA_LYRA_STREAM_BENCHMARK_LIB_H_
+#define LYRA_LYRA_STREAM_BENCHMARK_LIB_H_
+
+#include <string>
+#include <vector>
+
+#include "absl/time/time.h"
+
+namespace chromemedia {
+namespace codec {
+
+struct StreamBenchmarkOptions {
+  // The numbers of concurrent streams to run, in order.
+  std::vector<int> num_streams;
+  // How long each number of streams runs.
+  absl::Duration duration_per_run = absl::Seconds(10);
+  int sample_rate_hz = 16000;
+  int bitrate = 3200;
+  // Each stream encodes and/or decodes a hop every 20 ms. Streams that only
+  // decode replay packets encoded before the run.
+  bool encode = true;
+  bool decode = true;
+  // Runs stream i on core i modulo the number of cores.
+  bool pin_threads = false;
+  // The sweep stops after the first number of streams which misses more of its
+  // deadlines.
+  double max_missed_deadline_rate = 0.001;
+  std::string model_base_path = "lyra/model_coeffs";
+  // If not empty, a lyra_stream_benchmark.json report is written here.
+  std::string output_dir;
+};
+
+// Answers how many real-time streams a machine sustains: runs an increasing
+// number of concurrent streams, each on its own thread, and logs how many
+// deadlines they miss and their tail latencies. Returns 0 on success.
+int lyra_stream_benchmark(const StreamBenchmarkOptions& options);
+
+}  // namespace codec
+}  // namespace chromemedia
+
+#endif  // LYRA_LYRA_STREAM_BENCHMARK_LIB_H_
@@ -0,0 +1,161 @@
+// Copyright 2022 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "lyra/lyra_stream_encoder.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <utility>
+#include <vector>
+
+#include "absl/memory/memory.h"
+#include "absl/types/span.h"
+#include "glog/logging.h"  // IWYU pragma: keep
+#include "include/ghc/filesystem.hpp"
+#include "lyra/lyra_config.h"
+#include "lyra/lyra_encoder.h"
+
+namespace chromemedia {
+namespace codec {
+namespace {
+
+int GetMaxPacketSize() {
+  const std::vector<int>& supported_quantized_bits =
+      GetSupportedQuantizedBits();
+  return GetPacketSize(*std::max_element(supported_quantized_bits.begin(),
+                                         supported_quantized_bits.end()));
+}
+
+}  // namespace
+
+std::unique_ptr<LyraStreamEncoder> LyraStreamEncoder::Create(
+    int sample_rate_hz, int num_channels, int bitrate, bool enable_dtx,
+    const ghc::filesystem::path& model_path) {
+  auto encoder = LyraEncoder::Create(sample_rate_hz, num_channels, bitrate,
+                                     enable_dtx, model_path);
+  if (encoder == nullptr) {
+    LOG(ERROR) << "Could not create lyra encoder.";
+    return nullptr;
+  }
+
+  // WrapUnique is used because of private c'tor.
+  return absl::WrapUnique(new LyraStreamEncoder(std::move(encoder)));
+}
+
+LyraStreamEncoder::LyraStreamEncoder(
+    std::unique_ptr<LyraEncoderInterface> encoder)
+    : encoder_(std::move(encoder)),
+      num_samples_per_hop_(encoder_->sample_rate_hz() / encoder_->frame_rate()),
+      hop_buffer_(num_samples_per_hop_),
+      num_buffered_samples_(0),
+      packet_buffer_(GetMaxPacketSize()) {}
+
+std::optional<int> LyraStreamEncoder::Encode(
+    absl::Span<const int16_t> audio, const PacketCallback& packet_callback) {
+  int num_packets = 0;
+  // Complete the hop left over from previous calls first.
+  if (num_buffered_samples_ > 0) {
+    const int num_copied = std::min<int>(
+        audio.size(), num_samples_per_hop_ - num_buffered_samples_);
+    std::copy_n(audio.begin(), num_copied,
+                hop_buffer_.begin() + num_buffered_samples_);
+    num_buffered_samples_ += num_copied;
+    audio.remove_prefix(num_copied);
+    if (num_buffered_samples_ < num_samples_per_hop_) {
+      return num_packets;
+    }
+    num_buffered_samples_ = 0;
+    if (!EncodeHop(hop_buffer_, packet_callback)) {
+      return std::nullopt;
+    }
+    ++num_packets;
+  }
+
+  // Whole hops are encoded in place.
+  while (static_cast<int>(audio.size()) >= num_samples_per_hop_) {
+    if (!EncodeHop(audio.first(num_samples_per_hop_), packet_callback)) {
+      return std::nullopt;
+    }
+    audio.remove_prefix(num_samples_per_hop_);
+    ++num_packets;
+  }
+
+  std::copy(audio.begin(), audio.end(), hop_buffer_.begin());
+  num_buffered_samples_ = audio.size();
+  return num_packets;
+}
+
+std::optional<std::vector<std::vector<uint8_t>>> LyraStreamEncoder::Encode(
+    absl::Span<const int16_t> audio) {
+  std::vector<std::vector<uint8_t>> packets;
+  const auto append_packet = [&packets](absl::Span<const uint8_t> packet) {
+    packets.emplace_back(packet.begin(), packet.end());
+  };
+  if (!Encode(audio, append_packet).has_value()) {
+    return std::nullopt;
+  }
+  return packets;
+}
+
+std::optional<int> LyraStreamEncoder::Flush(
+    const PacketCallback& packet_callback) {
+  if (num_buffered_samples_ == 0) {
+    return 0;
+  }
+  std::fill(hop_buffer_.begin() + num_buffered_samples_, hop_buffer_.end(), 0);
+  num_buffered_samples_ = 0;
+  if (!EncodeHop(hop_buffer_, packet_callback)) {
+    return std::nullopt;
+  }
+  return 1;
+}
+
+bool LyraStreamEncoder::EncodeHop(absl::Span<const int16_t> hop,
+                                  const PacketCallback& packet_callback) {
+  const std::optional<int> num_bytes =
+      encoder_->Encode(hop, absl::MakeSpan(packet_buffer_));
+  if (!num_bytes.has_value()) {
+    LOG(ERROR) << "Could not encode hop.";
+    // A failed hop ends the current call, so leftover samples would no longer
+    // be contiguous with the next call's audio.
+    num_buffered_samples_ = 0;
+    return false;
+  }
+  packet_callback(
+      absl::MakeConstSpan(packet_buffer_).first(num_bytes.value()));
+  return true;
+}
+
+bool LyraStreamEncoder::set_bitrate(int bitrate) {
+  return encoder_->set_bitrate(bitrate);
+}
+
+int LyraStreamEncoder::num_buffered_samples() const {
+  return num_buffered_samples_;
+}
+
+int LyraStreamEncoder::num_samples_per_hop() const {
+  return num_samples_per_hop_;
+}
+
+int LyraStreamEncoder::sample_rate_hz() const {
+  return encoder_->sample_rate_hz();
+}
+
+int LyraStreamEncoder::bitrate() const { return encoder_->bitrate(); }
+
+}  // namespace codec
+}  // namespace chromemedia
@@ -0,0 +1,141 @@
+/*
+ * Copyright 2022 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LYRA_LYRA_STREAM_ENCODER_H_
+#define LYRA_LYRA_STREAM_ENCODER_H_
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <vector>
+
+#include "absl/types/span.h"
+#include "include/ghc/filesystem.hpp"
+#include "lyra/lyra_encoder_interface.h"
+
+namespace chromemedia {
+namespace codec {
+
+/// Streaming front end of a Lyra encoder.
+///
+/// |LyraEncoder| only accepts exactly one hop of audio per call. This class
+/// accepts any number of samples, buffers the samples that do not fill a hop
+/// across calls and emits one packet per completed hop. Whole hops are encoded
+/// straight from the caller's audio, so only the ragged edges are copied.
+class LyraStreamEncoder {
+ public:
+  /// Called once per encoded hop, in order. |packet| points into a buffer
+  /// owned by the stream encoder and is only valid during the call. It is
+  /// empty if discontinuous transmission skipped the hop.
+  using PacketCallback = std::function<void(absl::Span<const uint8_t> packet)>;
+
+  /// Static method to create a LyraStreamEncoder.
+  ///
+  /// @param sample_rate_hz Desired sample rate in Hertz. The supported sample
+  ///                       rates are 8000, 16000, 32000 and 48000.
+  /// @param num_channels Desired number of channels. Currently only 1 is
+  ///                     supported.
+  /// @param bitrate Desired bit rate. The supported bit rates are 3200, 6000
+  ///                and 9200.
+  /// @param enable_dtx Set to true if discontinuous transmission should be
+  ///                   enabled.
+  /// @param model_path Path to the model weights.
+  /// @return A unique_ptr to a |LyraStreamEncoder| if all desired params are
+  ///         supported. Else it returns a nullptr.
+  static std::unique_ptr<LyraStreamEncoder> Create(
+      int sample_rate_hz, int num_channels, int bitrate, bool enable_dtx,
+      const ghc::filesystem::path& model_path);
+
+  /// Appends audio to the stream and encodes every hop it completes.
+  ///
+  /// @param audio Span of int16-formatted samples of any length at the sample
+  ///              rate chosen at Create time.
+  /// @param packet_callback Called with each packet encoded by this call.
+  /// @return Number of packets emitted, or nullopt if encoding a hop failed.
+  ///         Samples after the failed hop are dropped.
+  std::optional<int> Encode(absl::Span<const int16_t> audio,
+                            const PacketCallback& packet_callback);
+
+  /// Appends audio to the stream and returns the packets it completes.
+  ///
+  /// @param audio Span of int16-formatted samples of any length at the sample
+  ///              rate chosen at Create time.
+  /// @return The packets encoded by this call, which may be none, or nullopt
+  ///         if encoding a hop failed.
+  std::optional<std::vector<std::vector<uint8_t>>> Encode(
+      absl::Span<const int16_t> audio);
+
+  /// Pads the buffered samples with silence to a full hop and encodes it.
+  ///
+  /// Does nothing if no samples are buffered. The stream may continue
+  /// afterwards.
+  ///
+  /// @param packet_callback Called with the final packet, if any.
+  /// @return Number of packets emitted, which is 0 or 1, or nullopt if
+  ///         encoding failed.
+  std::optional<int> Flush(const PacketCallback& packet_callback);
+
+  /// Setter for the bitrate. Takes effect from the next encoded hop.
+  ///
+  /// @param bitrate Desired bitrate in bps.
+  /// @return True if the bitrate is supported and set correctly.
+  bool set_bitrate(int bitrate);
+
+  /// Getter for the number of samples waiting for a hop to complete.
+  ///
+  /// @return Number of buffered samples, less than |num_samples_per_hop()|.
+  int num_buffered_samples() const;
+
+  /// Getter for the number of samples per hop.
+  ///
+  /// @return Number of samples per hop.
+  int num_samples_per_hop() const;
+
+  /// Getter for the sample rate in Hertz.
+  ///
+  /// @return Sample rate in Hertz.
+  int sample_rate_hz() const;
+
+  /// Getter for the bitrate.
+  ///
+  /// @return Bitrate.
+  int bitrate() const;
+
+ private:
+  LyraStreamEncoder() = delete;
+  explicit LyraStreamEncoder(std::unique_ptr<LyraEncoderInterface> encoder);
+
+  // Encodes one full hop and passes the packet to |packet_callback|.
+  bool EncodeHop(absl::Span<const int16_t> hop,
+                 const PacketCallback& packet_callback);
+
+  const std::unique_ptr<LyraEncoderInterface> encoder_;
+  const int num_samples_per_hop_;
+  // Samples of the incomplete hop. Only the first |num_buffered_samples_| are
+  // valid.
+  std::vector<int16_t> hop_buffer_;
+  int num_buffered_samples_;
+  // Large enough for a packet at any supported bitrate.
+  std::vector<uint8_t> packet_buffer_;
+
+  friend class LyraStreamEncoderPeer;
+};
+
+}  // namespace codec
+}  // namespace chromemedia
+
+#endif  // LYRA_LYRA_STREAM_ENCODER_H_
@@ -0,0 +1,225 @@
+// Copyright 2022 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "lyra/lyra_stream_encoder.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <memory>
+#include <numeric>
+#include <optional>
+#include <utility>
+#include <vector>
+
+// Placeholder for get runfiles header.
+#include "absl/memory/memory.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/span.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "include/ghc/filesystem.hpp"
+#include "lyra/lyra_config.h"
+#include "lyra/lyra_encoder.h"
+#include "lyra/lyra_encoder_interface.h"
+#include "lyra/testing/mock_lyra_encoder.h"
+
+namespace chromemedia {
+namespace codec {
+
+// Use a test peer to access the private constructor of LyraStreamEncoder in
+// order to inject a MockLyraEncoder.
+class LyraStreamEncoderPeer {
+ public:
+  static std::unique_ptr<LyraStreamEncoder> Create(
+      std::unique_ptr<LyraEncoderInterface> encoder) {
+    return absl::WrapUnique(new LyraStreamEncoder(std::move(encoder)));
+  }
+};
+
+namespace {
+
+using testing::_;
+using testing::Invoke;
+using testing::Return;
+
+static constexpr absl::string_view kExportedModelPath = "lyra/model_coeffs";
+static constexpr int kSampleRateHz = 16000;
+static constexpr int kNumSamplesPerHop = kSampleRateHz / 50;
+
+// Returns a MockLyraEncoder whose packets hold the first sample of their hop
+// divided by |kNumSamplesPerHop|, after checking the hop is contiguous.
+std::unique_ptr<MockLyraEncoder> CreateRampEncoder() {
+  auto encoder = std::make_unique<MockLyraEncoder>();
+  ON_CALL(*encoder, sample_rate_hz()).WillByDefault(Return(kSampleRateHz));
+  ON_CALL(*encoder, frame_rate()).WillByDefault(Return(50));
+  ON_CALL(*encoder, Encode(_, _))
+      .WillByDefault(Invoke([](absl::Span<const int16_t> audio,
+                               absl::Span<uint8_t> encoded) {
+        EXPECT_EQ(audio.size(), kNumSamplesPerHop);
+        for (int i = 1; i < audio.size(); ++i) {
+          // Padding after the end of the ramp is zero.
+          if (audio[i] != 0) {
+            EXPECT_EQ(audio[i], audio[0] + i);
+          }
+        }
+        encoded[0] = static_cast<uint8_t>(audio[0] / kNumSamplesPerHop);
+        return std::optional<int>(1);
+      }));
+  EXPECT_CALL(*encoder, Encode(_)).Times(0);
+  return encoder;
+}
+
+std::vector<int16_t> Ramp(int num_samples) {
+  std::vector<int16_t> ramp(num_samples);
+  std::iota(ramp.begin(), ramp.end(), 0);
+  return ramp;
+}
+
+TEST(LyraStreamEncoderTest, CreateFailsWithUnsupportedSampleRate) {
+  EXPECT_EQ(LyraStreamEncoder::Create(
+                /*sample_rate_hz=*/17000, kNumChannels, /*bitrate=*/3200,
+                /*enable_dtx=*/false,
+                ghc::filesystem::current_path() / kExportedModelPath),
+            nullptr);
+}
+
+TEST(LyraStreamEncoderTest, ArbitraryChunksEmitOnePacketPerHop) {
+  auto stream_encoder = LyraStreamEncoderPeer::Create(CreateRampEncoder());
+  ASSERT_EQ(stream_encoder->num_samples_per_hop(), kNumSamplesPerHop);
+
+  constexpr int kNumHops = 10;
+  const std::vector<int16_t> audio = Ramp(kNumHops * kNumSamplesPerHop);
+  std::vector<uint8_t> packets;
+  const auto append_packet = [&packets](absl::Span<const uint8_t> packet) {
+    ASSERT_EQ(packet.size(), 1);
+    packets.push_back(packet[0]);
+  };
+
+  // Chunks smaller than, equal to and spanning several hops.
+  int num_packets = 0;
+  int position = 0;
+  for (int chunk_size : {1, 100, 219, 320, 1000, 7, 1553}) {
+    const auto emitted = stream_encoder->Encode(
+        absl::MakeConstSpan(audio).subspan(position, chunk_size),
+        append_packet);
+    ASSERT_TRUE(emitted.has_value());
+    position += chunk_size;
+    num_packets += emitted.value();
+    EXPECT_EQ(num_packets, position / kNumSamplesPerHop);
+    EXPECT_EQ(stream_encoder->num_buffered_samples(),
+              position % kNumSamplesPerHop);
+  }
+  ASSERT_EQ(position, audio.size());
+
+  std::vector<uint8_t> expected(kNumHops);
+  std::iota(expected.begin(), expected.end(), 0);
+  EXPECT_EQ(packets, expected);
+}
+
+TEST(LyraStreamEncoderTest, FlushPadsFinalHop) {
+  auto mock_encoder = CreateRampEncoder();
+  std::vector<int16_t> last_hop;
+  EXPECT_CALL(*mock_encoder, Encode(_, _))
+      .WillOnce(Invoke([&last_hop](absl::Span<const int16_t> audio,
+                                   absl::Span<uint8_t> encoded) {
+        last_hop.assign(audio.begin(), audio.end());
+        return std::optional<int>(0);
+      }));
+  auto stream_encoder = LyraStreamEncoderPeer::Create(std::move(mock_encoder));
+
+  const std::vector<int16_t> audio(kNumSamplesPerHop / 2, 7);
+  int num_callbacks = 0;
+  const auto count_packet = [&num_callbacks](absl::Span<const uint8_t> packet) {
+    EXPECT_TRUE(packet.empty());
+    ++num_callbacks;
+  };
+  ASSERT_EQ(stream_encoder->Encode(audio, count_packet), 0);
+  EXPECT_EQ(stream_encoder->Flush(count_packet), 1);
+  EXPECT_EQ(num_callbacks, 1);
+  EXPECT_EQ(stream_encoder->num_buffered_samples(), 0);
+
+  ASSERT_EQ(last_hop.size(), kNumSamplesPerHop);
+  EXPECT_TRUE(std::all_of(last_hop.begin(), last_hop.begin() + audio.size(),
+                          [](int16_t sample) { return sample == 7; }));
+  EXPECT_TRUE(std::all_of(last_hop.begin() + audio.size(), last_hop.end(),
+                          [](int16_t sample) { return sample == 0; }));
+
+  // Nothing is left to flush.
+  EXPECT_EQ(stream_encoder->Flush(count_packet), 0);
+  EXPECT_EQ(num_callbacks, 1);
+}
+
+TEST(LyraStreamEncoderTest, EncodeFailsIfHopFails) {
+  auto mock_encoder = CreateRampEncoder();
+  EXPECT_CALL(*mock_encoder, Encode(_, _)).WillOnce(Return(std::nullopt));
+  auto stream_encoder = LyraStreamEncoderPeer::Create(std::move(mock_encoder));
+
+  const std::vector<int16_t> audio = Ramp(kNumSamplesPerHop + 10);
+  EXPECT_FALSE(stream_encoder->Encode(audio).has_value());
+  EXPECT_EQ(stream_encoder->num_buffered_samples(), 0);
+}
+
+TEST(LyraStreamEncoderTest, MatchesHopByHopEncoding) {
+  for (const int sample_rate_hz : kSupportedSampleRates) {
+    const ghc::filesystem::path model_path =
+        ghc::filesystem::current_path() / kExportedModelPath;
+    auto encoder = LyraEncoder::Create(sample_rate_hz, kNumChannels, 6000,
+                                       /*enable_dtx=*/false, model_path);
+    ASSERT_NE(encoder, nullptr);
+    auto stream_encoder = LyraStreamEncoder::Create(
+        sample_rate_hz, kNumChannels, 6000, /*enable_dtx=*/false, model_path);
+    ASSERT_NE(stream_encoder, nullptr);
+
+    const int num_samples_per_hop = GetNumSamplesPerHop(sample_rate_hz);
+    // Ends in a partial hop so that Flush() has to pad it.
+    std::vector<int16_t> audio(5 * num_samples_per_hop / 2);
+    for (int i = 0; i < audio.size(); ++i) {
+      audio[i] = static_cast<int16_t>(
+          5000.f * std::sin(2.f * M_PI * 300.f * i / sample_rate_hz));
+    }
+
+    std::vector<std::vector<uint8_t>> expected_packets;
+    std::vector<int16_t> hop(num_samples_per_hop, 0);
+    for (int begin = 0; begin < audio.size(); begin += num_samples_per_hop) {
+      const int end =
+          std::min<int>(begin + num_samples_per_hop, audio.size());
+      std::fill(std::copy(audio.begin() + begin, audio.begin() + end,
+                          hop.begin()),
+                hop.end(), 0);
+      auto packet = encoder->Encode(hop);
+      ASSERT_TRUE(packet.has_value());
+      expected_packets.push_back(packet.value());
+    }
+
+    std::vector<std::vector<uint8_t>> packets;
+    const auto append_packet = [&packets](absl::Span<const uint8_t> packet) {
+      packets.emplace_back(packet.begin(), packet.end());
+    };
+    const int chunk_size = num_samples_per_hop / 3 + 1;
+    for (int begin = 0; begin < audio.size(); begin += chunk_size) {
+      ASSERT_TRUE(stream_encoder
+                      ->Encode(absl::MakeConstSpan(audio).subspan(
+                                   begin, chunk_size),
+                               append_packet)
+                      .has_value());
+    }
+    ASSERT_EQ(stream_encoder->Flush(append_packet), 1);
+    EXPECT_EQ(packets, expected_packets) << "Sample rate: " << sample_rate_hz;
+  }
+}
+
+}  // namespace
+}  // namespace codec
+}  // namespace chromemedia
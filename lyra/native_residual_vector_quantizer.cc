@@ -0,0 +1,488 @@
+// Copyright 2022 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "lyra/native_residual_vector_quantizer.h"
+
+#include <algorithm>
+#include <bitset>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <optional>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define LYRA_RVQ_X86 1
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#define LYRA_RVQ_NEON 1
+#endif
+
+#include "absl/base/thread_annotations.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/memory/memory.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/types/span.h"
+#include "glog/logging.h"  // IWYU pragma: keep
+#include "include/ghc/filesystem.hpp"
+#include "lyra/residual_vector_quantizer.h"
+#include "lyra/tflite_model_registry.h"
+#include "lyra/tflite_model_wrapper.h"
+#include "lyra/tracing.h"
+
+namespace chromemedia {
+namespace codec {
+namespace {
+
+// Number of random feature vectors used to check the native results against
+// the TFLite model at creation time.
+constexpr int kNumProbeVectors = 64;
+
+// The kernels below accumulate (r - c)^2 over features in increasing order,
+// one code per lane, which is the summation order of the SQUARED_DIFFERENCE
+// and SUM ops in quantizer.tflite. Keeping the order is what makes the results
+// bit-exact, so no kernel may reassociate or fuse these operations.
+using SquaredDistancesFunction = void (*)(const float* residual,
+                                          const float* transposed_codes,
+                                          int num_features, int codebook_size,
+                                          float* distances);
+
+void SquaredDistancesScalar(const float* residual,
+                            const float* transposed_codes, int num_features,
+                            int codebook_size, float* distances) {
+  std::fill(distances, distances + codebook_size, 0.f);
+  for (int f = 0; f < num_features; ++f) {
+    const float* codes = transposed_codes + f * codebook_size;
+    for (int c = 0; c < codebook_size; ++c) {
+      const float difference = residual[f] - codes[c];
+      distances[c] += difference * difference;
+    }
+  }
+}
+
+#if defined(LYRA_RVQ_X86)
+__attribute__((target("avx2"))) void SquaredDistancesAvx2(
+    const float* residual, const float* transposed_codes, int num_features,
+    int codebook_size, float* distances) {
+  int c = 0;
+  for (; c + 8 <= codebook_size; c += 8) {
+    __m256 sum = _mm256_setzero_ps();
+    for (int f = 0; f < num_features; ++f) {
+      const __m256 difference =
+          _mm256_sub_ps(_mm256_set1_ps(residual[f]),
+                        _mm256_loadu_ps(transposed_codes + f * codebook_size +
+                                        c));
+      sum = _mm256_add_ps(sum, _mm256_mul_ps(difference, difference));
+    }
+    _mm256_storeu_ps(distances + c, sum);
+  }
+  for (; c < codebook_size; ++c) {
+    float sum = 0.f;
+    for (int f = 0; f < num_features; ++f) {
+      const float difference =
+          residual[f] - transposed_codes[f * codebook_size + c];
+      sum += difference * difference;
+    }
+    distances[c] = sum;
+  }
+}
+#endif  // defined(LYRA_RVQ_X86)
+
+#if defined(LYRA_RVQ_NEON)
+void SquaredDistancesNeon(const float* residual, const float* transposed_codes,
+                          int num_features, int codebook_size,
+                          float* distances) {
+  int c = 0;
+  for (; c + 4 <= codebook_size; c += 4) {
+    float32x4_t sum = vdupq_n_f32(0.f);
+    for (int f = 0; f < num_features; ++f) {
+      const float32x4_t difference =
+          vsubq_f32(vdupq_n_f32(residual[f]),
+                    vld1q_f32(transposed_codes + f * codebook_size + c));
+      sum = vaddq_f32(sum, vmulq_f32(difference, difference));
+    }
+    vst1q_f32(distances + c, sum);
+  }
+  for (; c < codebook_size; ++c) {
+    float sum = 0.f;
+    for (int f = 0; f < num_features; ++f) {
+      const float difference =
+          residual[f] - transposed_codes[f * codebook_size + c];
+      sum += difference * difference;
+    }
+    distances[c] = sum;
+  }
+}
+#endif  // defined(LYRA_RVQ_NEON)
+
+SquaredDistancesFunction SelectSquaredDistances() {
+#if defined(LYRA_RVQ_X86)
+  if (__builtin_cpu_supports("avx2")) {
+    return &SquaredDistancesAvx2;
+  }
+#elif defined(LYRA_RVQ_NEON)
+  return &SquaredDistancesNeon;
+#endif
+  return &SquaredDistancesScalar;
+}
+
+// Reads every code vector by decoding index vectors in which only one
+// quantizer is in use. Unused quantizers contribute exact zeros, so each
+// decoded vector is exactly one code vector.
+std::optional<ResidualVectorQuantizerCodebooks> ReadCodebooks(
+    const ghc::filesystem::path& model_file, int max_num_quantized_bits) {
+  auto quantizer_model = TfLiteModelWrapper::Create(
+      model_file, /*use_xnn=*/false, /*int8_quantized=*/false);
+  if (quantizer_model == nullptr) {
+    LOG(ERROR) << "Unable to create the quantizer TfLite model wrapper.";
+    return std::nullopt;
+  }
+  tflite::SignatureRunner* encode_runner =
+      quantizer_model->GetSignatureRunner("encode");
+  tflite::SignatureRunner* decode_runner =
+      quantizer_model->GetSignatureRunner("decode");
+  if (encode_runner == nullptr || decode_runner == nullptr) {
+    LOG(ERROR) << "The quantizer TFLite model lacks encode/decode signatures.";
+    return std::nullopt;
+  }
+  if (encode_runner->AllocateTensors() != kTfLiteOk) {
+    LOG(ERROR) << "Could not allocate encode runner TFLite tensors.";
+    return std::nullopt;
+  }
+
+  ResidualVectorQuantizerCodebooks codebooks;
+  codebooks.bits_per_quantizer =
+      encode_runner->output_tensor("output_1")->data.i32[0];
+  if (codebooks.bits_per_quantizer <= 0 ||
+      max_num_quantized_bits % codebooks.bits_per_quantizer != 0) {
+    LOG(ERROR) << "Unexpected number of bits per quantizer ("
+               << codebooks.bits_per_quantizer << ").";
+    return std::nullopt;
+  }
+  codebooks.num_quantizers =
+      max_num_quantized_bits / codebooks.bits_per_quantizer;
+  codebooks.codebook_size = 1 << codebooks.bits_per_quantizer;
+  if (decode_runner->ResizeInputTensor("encoding_indices",
+                                       {codebooks.num_quantizers, 1, 1}) !=
+          kTfLiteOk ||
+      decode_runner->AllocateTensors() != kTfLiteOk) {
+    LOG(ERROR) << "Could not allocate decode runner TFLite tensors.";
+    return std::nullopt;
+  }
+  const TfLiteTensor* features_tensor =
+      decode_runner->output_tensor("output_0");
+  codebooks.num_features = features_tensor->bytes / sizeof(float);
+
+  const int num_codes = codebooks.num_quantizers * codebooks.codebook_size;
+  codebooks.code_vectors.resize(num_codes * codebooks.num_features);
+  codebooks.transposed_code_vectors.resize(codebooks.code_vectors.size());
+  int32_t* indices = decode_runner->input_tensor("encoding_indices")->data.i32;
+  for (int q = 0; q < codebooks.num_quantizers; ++q) {
+    for (int c = 0; c < codebooks.codebook_size; ++c) {
+      std::fill(indices, indices + codebooks.num_quantizers, -1);
+      indices[q] = c;
+      // Not profiled, like |TfLiteModelWrapper::WarmUp|: this only runs while
+      // creating the quantizer.
+      if (decode_runner->Invoke() != kTfLiteOk) {
+        LOG(ERROR) << "Unable to invoke the decode runner.";
+        return std::nullopt;
+      }
+      const float* code = decode_runner->output_tensor("output_0")->data.f;
+      for (int f = 0; f < codebooks.num_features; ++f) {
+        codebooks.code_vectors[(q * codebooks.codebook_size + c) *
+                                   codebooks.num_features +
+                               f] = code[f];
+        codebooks.transposed_code_vectors[(q * codebooks.num_features + f) *
+                                              codebooks.codebook_size +
+                                          c] = code[f];
+      }
+    }
+  }
+  return codebooks;
+}
+
+bool BitExact(const std::vector<float>& a, const std::vector<float>& b) {
+  return a.size() == b.size() &&
+         std::memcmp(a.data(), b.data(), a.size() * sizeof(float)) == 0;
+}
+
+// Compares both implementations on random features at every bitrate.
+bool MatchesTfLite(const VectorQuantizerInterface& native,
+                   const VectorQuantizerInterface& tflite, int num_features,
+                   int bits_per_quantizer, int max_num_quantized_bits) {
+  std::mt19937 gen(5489);
+  // Roughly the range of SoundStream features.
+  std::normal_distribution<float> feature_distribution(1.f, 3.f);
+  for (int i = 0; i < kNumProbeVectors; ++i) {
+    std::vector<float> features(num_features);
+    for (float& feature : features) {
+      feature = feature_distribution(gen);
+    }
+    for (int num_bits = bits_per_quantizer; num_bits <= max_num_quantized_bits;
+         num_bits += bits_per_quantizer) {
+      const auto native_bits = native.Quantize(features, num_bits);
+      const auto tflite_bits = tflite.Quantize(features, num_bits);
+      if (!native_bits.has_value() || !tflite_bits.has_value() ||
+          native_bits.value() != tflite_bits.value()) {
+        LOG(ERROR) << "Native quantization differs from TFLite at " << num_bits
+                   << " bits.";
+        return false;
+      }
+      const auto native_features =
+          native.DecodeToLossyFeatures(native_bits.value());
+      const auto tflite_features =
+          tflite.DecodeToLossyFeatures(tflite_bits.value());
+      if (!native_features.has_value() || !tflite_features.has_value() ||
+          !BitExact(native_features.value(), tflite_features.value())) {
+        LOG(ERROR) << "Native reconstruction differs from TFLite at "
+                   << num_bits << " bits.";
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+}  // namespace
+
+std::unique_ptr<NativeResidualVectorQuantizer>
+NativeResidualVectorQuantizer::Create(const ghc::filesystem::path& model_path) {
+  // Reading and verifying the codebooks takes a few milliseconds, so it is
+  // done once per model and shared by all instances.
+  static absl::Mutex* const mutex = new absl::Mutex();
+  static auto* const cache = new absl::flat_hash_map<
+      std::string, std::shared_ptr<const ResidualVectorQuantizerCodebooks>>();
+
+  const ghc::filesystem::path model_file = model_path / "quantizer.tflite";
+  const std::string key = TfLiteModelRegistry::ModelKey(model_file);
+  absl::MutexLock lock(mutex);
+  auto it = cache->find(key);
+  if (it != cache->end()) {
+    return absl::WrapUnique(new NativeResidualVectorQuantizer(it->second));
+  }
+
+  auto codebooks = ReadCodebooks(model_file, kMaxNumQuantizedBits);
+  if (!codebooks.has_value()) {
+    LOG(ERROR) << "Could not read the residual vector quantizer codebooks.";
+    return nullptr;
+  }
+  auto shared_codebooks =
+      std::make_shared<const ResidualVectorQuantizerCodebooks>(
+          std::move(codebooks.value()));
+  auto native_quantizer =
+      absl::WrapUnique(new NativeResidualVectorQuantizer(shared_codebooks));
+  auto tflite_quantizer = ResidualVectorQuantizer::Create(model_path);
+  if (tflite_quantizer == nullptr ||
+      !MatchesTfLite(*native_quantizer, *tflite_quantizer,
+                     shared_codebooks->num_features,
+                     shared_codebooks->bits_per_quantizer,
+                     kMaxNumQuantizedBits)) {
+    LOG(ERROR) << "Native residual vector quantizer is not bit-exact with "
+                  "the TFLite model.";
+    return nullptr;
+  }
+  cache->emplace(key, std::move(shared_codebooks));
+  return native_quantizer;
+}
+
+NativeResidualVectorQuantizer::NativeResidualVectorQuantizer(
+    std::shared_ptr<const ResidualVectorQuantizerCodebooks> codebooks)
+    : codebooks_(std::move(codebooks)),
+      residual_(codebooks_->num_features),
+      distances_(codebooks_->codebook_size),
+      all_indices_(codebooks_->num_quantizers) {}
+
+std::optional<std::string> NativeResidualVectorQuantizer::Quantize(
+    const std::vector<float>& features, int num_bits) const {
+  if (num_bits > kMaxNumQuantizedBits) {
+    LOG(ERROR) << "The number of bits cannot exceed maximum ("
+               << kMaxNumQuantizedBits << ").";
+    return std::nullopt;
+  }
+  const int bits_per_quantizer = codebooks_->bits_per_quantizer;
+  if (num_bits % bits_per_quantizer != 0) {
+    LOG(ERROR) << "The number of bits (" << num_bits
+               << ") has to be divisible by the number of bits per quantizer ("
+               << bits_per_quantizer << ").";
+    return std::nullopt;
+  }
+  const int required_quantizers = num_bits / bits_per_quantizer;
+  std::vector<int> nearest_neighbors(required_quantizers);
+  if (!QuantizeToIndices(features, num_bits,
+                         absl::MakeSpan(nearest_neighbors))) {
+    return std::nullopt;
+  }
+
+  std::bitset<kMaxNumQuantizedBits> quantized_bits = 0;
+  for (int i = 0; i < required_quantizers; ++i) {
+    // The first quantizer is positioned in the most significant bits.
+    quantized_bits |= std::bitset<quantized_bits.size()>(nearest_neighbors[i])
+                      << ((required_quantizers - i - 1) * bits_per_quantizer);
+  }
+  return quantized_bits.to_string().substr(kMaxNumQuantizedBits - num_bits);
+}
+
+std::optional<std::vector<float>>
+NativeResidualVectorQuantizer::DecodeToLossyFeatures(
+    const std::string& quantized_features) const {
+  const int num_bits = quantized_features.size();
+  if (num_bits > kMaxNumQuantizedBits) {
+    LOG(ERROR) << "The number of bits cannot exceed maximum ("
+               << kMaxNumQuantizedBits << ").";
+    return std::nullopt;
+  }
+  const int bits_per_quantizer = codebooks_->bits_per_quantizer;
+  if (num_bits % bits_per_quantizer != 0) {
+    LOG(ERROR) << "The number of bits (" << num_bits
+               << ") has to be divisible by the number of bits per quantizer ("
+               << bits_per_quantizer << ").";
+    return std::nullopt;
+  }
+  const int required_quantizers = num_bits / bits_per_quantizer;
+  const std::bitset<kMaxNumQuantizedBits> quantized_bits(quantized_features);
+  const std::bitset<kMaxNumQuantizedBits> quantizer_mask(
+      (1 << bits_per_quantizer) - 1);
+  std::vector<int> indices(required_quantizers);
+  for (int i = 0; i < required_quantizers; ++i) {
+    // The first quantizer is expected to be in the most significant bits.
+    indices[i] = static_cast<int>(
+        ((quantized_bits >>
+          ((required_quantizers - i - 1) * bits_per_quantizer)) &
+         quantizer_mask)
+            .to_ulong());
+  }
+  return DecodeIndicesToLossyFeatures(indices);
+}
+
+int NativeResidualVectorQuantizer::bits_per_quantizer() const {
+  return codebooks_->bits_per_quantizer;
+}
+
+bool NativeResidualVectorQuantizer::QuantizeToIndices(
+    const std::vector<float>& features, int num_bits,
+    absl::Span<int> indices) const {
+  LYRA_TRACE_SCOPE("NativeResidualVectorQuantizer::QuantizeToIndices");
+  if (num_bits > kMaxNumQuantizedBits) {
+    LOG(ERROR) << "The number of bits cannot exceed maximum ("
+               << kMaxNumQuantizedBits << ").";
+    return false;
+  }
+  const int bits_per_quantizer = codebooks_->bits_per_quantizer;
+  if (num_bits != indices.size() * bits_per_quantizer) {
+    LOG(ERROR) << "The number of bits (" << num_bits << ") has to equal "
+               << indices.size() << " indices of " << bits_per_quantizer
+               << " bits.";
+    return false;
+  }
+  if (features.size() != codebooks_->num_features) {
+    LOG(ERROR) << "Expected " << codebooks_->num_features
+               << " features but got " << features.size() << ".";
+    return false;
+  }
+  NearestNeighbors(features, indices.size(), indices.data());
+  return true;
+}
+
+std::optional<std::vector<float>>
+NativeResidualVectorQuantizer::DecodeIndicesToLossyFeatures(
+    absl::Span<const int> indices) const {
+  std::vector<float> features(codebooks_->num_features);
+  if (!DecodeIndicesToLossyFeaturesInto(indices, absl::MakeSpan(features))) {
+    return std::nullopt;
+  }
+  return features;
+}
+
+bool NativeResidualVectorQuantizer::DecodeIndicesToLossyFeaturesInto(
+    absl::Span<const int> indices, absl::Span<float> features) const {
+  LYRA_TRACE_SCOPE(
+      "NativeResidualVectorQuantizer::DecodeIndicesToLossyFeaturesInto");
+  if (indices.size() > codebooks_->num_quantizers) {
+    LOG(ERROR) << "The number of indices (" << indices.size()
+               << ") cannot exceed the number of quantizers ("
+               << codebooks_->num_quantizers << ").";
+    return false;
+  }
+  for (const int index : indices) {
+    if (index < 0 || index >= codebooks_->codebook_size) {
+      LOG(ERROR) << "Code vector index " << index << " is out of range.";
+      return false;
+    }
+  }
+  if (features.size() != codebooks_->num_features) {
+    LOG(ERROR) << "Expected space for " << codebooks_->num_features
+               << " features but got " << features.size() << ".";
+    return false;
+  }
+  std::copy(indices.begin(), indices.end(), all_indices_.begin());
+  std::fill(all_indices_.begin() + indices.size(), all_indices_.end(), -1);
+  Reconstruct(all_indices_.data(), features.data());
+  return true;
+}
+
+void NativeResidualVectorQuantizer::NearestNeighbors(
+    const std::vector<float>& features, int num_quantizers,
+    int* indices) const {
+  static const SquaredDistancesFunction squared_distances =
+      SelectSquaredDistances();
+  const int num_features = codebooks_->num_features;
+  const int codebook_size = codebooks_->codebook_size;
+  std::vector<float>& residual = residual_;
+  std::vector<float>& distances = distances_;
+  std::copy(features.begin(), features.end(), residual.begin());
+  for (int q = 0; q < num_quantizers; ++q) {
+    squared_distances(residual.data(),
+                      codebooks_->transposed_code_vectors.data() +
+                          q * num_features * codebook_size,
+                      num_features, codebook_size, distances.data());
+    // Ties resolve to the lowest index, like ARG_MIN.
+    const int nearest = std::min_element(distances.begin(), distances.end()) -
+                        distances.begin();
+    indices[q] = nearest;
+
+    // The model updates the residual through a straight-through estimator,
+    // r - (r + (c - r)), which is not always exactly r - c in floating point.
+    const float* code = codebooks_->code_vectors.data() +
+                        (q * codebook_size + nearest) * num_features;
+    for (int f = 0; f < num_features; ++f) {
+      const float straight_through = residual[f] + (code[f] - residual[f]);
+      residual[f] = residual[f] - straight_through;
+    }
+  }
+}
+
+void NativeResidualVectorQuantizer::Reconstruct(const int* indices,
+                                                float* features) const {
+  const int num_features = codebooks_->num_features;
+  const int codebook_size = codebooks_->codebook_size;
+  // Like the model, every quantizer contributes its code vector scaled by
+  // 1 or 0 and the contributions are summed in quantizer order; unused
+  // quantizers select code 0.
+  for (int q = 0; q < codebooks_->num_quantizers; ++q) {
+    const float mask = indices[q] == -1 ? 0.f : 1.f;
+    const float* code =
+        codebooks_->code_vectors.data() +
+        (q * codebook_size + std::max(indices[q], 0)) * num_features;
+    for (int f = 0; f < num_features; ++f) {
+      features[f] = q == 0 ? code[f] * mask : features[f] + code[f] * mask;
+    }
+  }
+}
+
+}  // namespace codec
+}  // namespace chromemedia
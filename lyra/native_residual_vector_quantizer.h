@@ -0,0 +1,114 @@
+/*
+ * Copyright 2022 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LYRA_NATIVE_RESIDUAL_VECTOR_QUANTIZER_H_
+#define LYRA_NATIVE_RESIDUAL_VECTOR_QUANTIZER_H_
+
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "absl/types/span.h"
+#include "include/ghc/filesystem.hpp"
+#include "lyra/vector_quantizer_interface.h"
+
+namespace chromemedia {
+namespace codec {
+
+// Codebooks of a residual vector quantizer, read once from quantizer.tflite.
+struct ResidualVectorQuantizerCodebooks {
+  int num_quantizers;
+  int bits_per_quantizer;
+  int codebook_size;
+  int num_features;
+  // Indexed as [quantizer][code][feature], as used for reconstruction.
+  std::vector<float> code_vectors;
+  // Indexed as [quantizer][feature][code], so that the nearest-neighbour
+  // search can compare several codes per SIMD register.
+  std::vector<float> transposed_code_vectors;
+};
+
+// Runs the same residual vector quantization as |ResidualVectorQuantizer| in
+// plain C++, without a TFLite interpreter per call. The arithmetic follows the
+// operations of quantizer.tflite step by step, so quantized bits and decoded
+// features are bit-exact with the TFLite path; |Create| verifies this on probe
+// vectors before returning.
+class NativeResidualVectorQuantizer : public VectorQuantizerInterface {
+ public:
+  // Returns nullptr if the codebooks can't be read or the native results
+  // don't match the TFLite model.
+  static std::unique_ptr<NativeResidualVectorQuantizer> Create(
+      const ghc::filesystem::path& model_path);
+
+  // Quantizes the features using vector quantization.
+  std::optional<std::string> Quantize(const std::vector<float>& features,
+                                      int num_bits) const override;
+
+  // Unpacks the string of bits into features.
+  std::optional<std::vector<float>> DecodeToLossyFeatures(
+      const std::string& quantized_features) const override;
+
+  int bits_per_quantizer() const override;
+
+  // Quantizes the features straight to code vector indices.
+  bool QuantizeToIndices(const std::vector<float>& features, int num_bits,
+                         absl::Span<int> indices) const override;
+
+  // Decodes code vector indices into features.
+  std::optional<std::vector<float>> DecodeIndicesToLossyFeatures(
+      absl::Span<const int> indices) const override;
+
+  // Decodes code vector indices into |features| without allocating.
+  bool DecodeIndicesToLossyFeaturesInto(
+      absl::Span<const int> indices,
+      absl::Span<float> features) const override;
+
+ private:
+  // LINT.IfChange
+  static constexpr int kMaxNumQuantizedBits = 184;
+  // LINT.ThenChange(
+  // lyra_components.cc,
+  // lyra_config.cc,
+  // residual_vector_quantizer.h,
+  // )
+
+  explicit NativeResidualVectorQuantizer(
+      std::shared_ptr<const ResidualVectorQuantizerCodebooks> codebooks);
+
+  // Writes the code index chosen by each of the first |num_quantizers|
+  // quantizers to |indices|.
+  void NearestNeighbors(const std::vector<float>& features, int num_quantizers,
+                        int* indices) const;
+
+  // Sums the code vectors selected by |indices|, where -1 marks an unused
+  // quantizer, into |features|.
+  void Reconstruct(const int* indices, float* features) const;
+
+  const std::shared_ptr<const ResidualVectorQuantizerCodebooks> codebooks_;
+
+  // Scratch buffers, so that quantizing and decoding do not allocate. Like
+  // the TFLite quantizer, an instance must not be used from several threads
+  // at once.
+  mutable std::vector<float> residual_;
+  mutable std::vector<float> distances_;
+  mutable std::vector<int> all_indices_;
+};
+
+}  // namespace codec
+}  // namespace chromemedia
+
+#endif  // LYRA_NATIVE_RESIDUAL_VECTOR_QUANTIZER_H_
@@ -0,0 +1,160 @@
+// Copyright 2022 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "lyra/native_residual_vector_quantizer.h"
+
+#include <cstring>
+#include <memory>
+#include <optional>
+#include <random>
+#include <string>
+#include <vector>
+
+// Placeholder for get runfiles header.
+#include "absl/types/span.h"
+#include "gtest/gtest.h"
+#include "include/ghc/filesystem.hpp"
+#include "lyra/lyra_components.h"
+#include "lyra/lyra_config.h"
+#include "lyra/residual_vector_quantizer.h"
+
+namespace chromemedia {
+namespace codec {
+namespace {
+
+class NativeResidualVectorQuantizerTest : public testing::TestWithParam<int> {
+ protected:
+  NativeResidualVectorQuantizerTest()
+      : num_quantized_bits_(GetParam()),
+        native_quantizer_(NativeResidualVectorQuantizer::Create(
+            ghc::filesystem::current_path() / "lyra/model_coeffs")),
+        tflite_quantizer_(ResidualVectorQuantizer::Create(
+            ghc::filesystem::current_path() / "lyra/model_coeffs")) {}
+
+  // Checks that both quantizers produce identical bits and features.
+  void ExpectBitExact(const std::vector<float>& features) {
+    const auto native_bits =
+        native_quantizer_->Quantize(features, num_quantized_bits_);
+    const auto tflite_bits =
+        tflite_quantizer_->Quantize(features, num_quantized_bits_);
+    ASSERT_TRUE(native_bits.has_value());
+    ASSERT_TRUE(tflite_bits.has_value());
+    EXPECT_EQ(native_bits.value(), tflite_bits.value());
+
+    const auto native_features =
+        native_quantizer_->DecodeToLossyFeatures(tflite_bits.value());
+    const auto tflite_features =
+        tflite_quantizer_->DecodeToLossyFeatures(tflite_bits.value());
+    ASSERT_TRUE(native_features.has_value());
+    ASSERT_TRUE(tflite_features.has_value());
+    ASSERT_EQ(native_features->size(), tflite_features->size());
+    EXPECT_EQ(std::memcmp(native_features->data(), tflite_features->data(),
+                          native_features->size() * sizeof(float)),
+              0);
+  }
+
+  const int num_quantized_bits_;
+  std::unique_ptr<NativeResidualVectorQuantizer> native_quantizer_;
+  std::unique_ptr<ResidualVectorQuantizer> tflite_quantizer_;
+};
+
+TEST_P(NativeResidualVectorQuantizerTest, CreationFailsWithInvalidModelPath) {
+  EXPECT_EQ(NativeResidualVectorQuantizer::Create("invalid/model/path"),
+            nullptr);
+}
+
+TEST_P(NativeResidualVectorQuantizerTest, CreationSucceedsWithValidModelPath) {
+  EXPECT_NE(native_quantizer_, nullptr);
+}
+
+TEST_P(NativeResidualVectorQuantizerTest, QuantizationFailsWithTooManyBits) {
+  constexpr int kTooManyBits = 185;
+  EXPECT_FALSE(native_quantizer_->Quantize(std::vector<float>(kNumFeatures),
+                                           kTooManyBits)
+                   .has_value());
+}
+
+TEST_P(NativeResidualVectorQuantizerTest,
+       QuantizationFailsWithWrongNumberOfFeatures) {
+  EXPECT_FALSE(
+      native_quantizer_
+          ->Quantize(std::vector<float>(kNumFeatures + 1), num_quantized_bits_)
+          .has_value());
+}
+
+TEST_P(NativeResidualVectorQuantizerTest, DecodingFailsWithNonDivisibleBits) {
+  constexpr int kNonDivisibleBits = 62;
+  EXPECT_FALSE(
+      native_quantizer_
+          ->DecodeToLossyFeatures(std::string(kNonDivisibleBits, '0'))
+          .has_value());
+}
+
+TEST_P(NativeResidualVectorQuantizerTest, BitExactWithTfLiteOnRandomFeatures) {
+  std::mt19937 gen(1234);
+  std::normal_distribution<float> feature_distribution(1.f, 4.f);
+  for (int i = 0; i < 200; ++i) {
+    std::vector<float> features(kNumFeatures);
+    for (float& feature : features) {
+      feature = feature_distribution(gen);
+    }
+    ExpectBitExact(features);
+  }
+}
+
+TEST_P(NativeResidualVectorQuantizerTest, BitExactWithTfLiteOnZeros) {
+  ExpectBitExact(std::vector<float>(kNumFeatures, 0.f));
+}
+
+TEST_P(NativeResidualVectorQuantizerTest, IndicesMatchTfLite) {
+  std::mt19937 gen(1234);
+  std::normal_distribution<float> feature_distribution(1.f, 4.f);
+  std::vector<float> features(kNumFeatures);
+  for (float& feature : features) {
+    feature = feature_distribution(gen);
+  }
+  const int num_indices =
+      num_quantized_bits_ / native_quantizer_->bits_per_quantizer();
+  std::vector<int> native_indices(num_indices);
+  std::vector<int> tflite_indices(num_indices);
+  ASSERT_TRUE(native_quantizer_->QuantizeToIndices(
+      features, num_quantized_bits_, absl::MakeSpan(native_indices)));
+  ASSERT_TRUE(tflite_quantizer_->QuantizeToIndices(
+      features, num_quantized_bits_, absl::MakeSpan(tflite_indices)));
+  EXPECT_EQ(native_indices, tflite_indices);
+
+  const auto native_features =
+      native_quantizer_->DecodeIndicesToLossyFeatures(native_indices);
+  const auto tflite_features =
+      tflite_quantizer_->DecodeIndicesToLossyFeatures(tflite_indices);
+  ASSERT_TRUE(native_features.has_value());
+  ASSERT_TRUE(tflite_features.has_value());
+  EXPECT_EQ(native_features.value(), tflite_features.value());
+}
+
+TEST_P(NativeResidualVectorQuantizerTest, SelectableThroughCreateQuantizer) {
+  auto quantizer = CreateQuantizer(
+      ghc::filesystem::current_path() / "lyra/model_coeffs",
+      QuantizerType::kNative);
+  ASSERT_NE(quantizer, nullptr);
+  EXPECT_NE(dynamic_cast<NativeResidualVectorQuantizer*>(quantizer.get()),
+            nullptr);
+}
+
+INSTANTIATE_TEST_SUITE_P(NumQuantizedBits, NativeResidualVectorQuantizerTest,
+                         testing::ValuesIn(GetSupportedQuantizedBits()));
+
+}  // namespace
+}  // namespace codec
+}  // namespace chromemedia
@@ -28,6 +28,7 @@
 #include "audio/dsp/signal_vector_util.h"
 #include "glog/logging.h"  // IWYU pragma: keep
 #include "lyra/log_mel_spectrogram_extractor_impl.h"
+#include "lyra/tracing.h"
 
 namespace chromemedia {
 namespace codec {
@@ -71,10 +72,11 @@ void UpdateMinAndTemp(uint64_t num_hops_received,
 // Values closer to 0 indicate smoothed_power should take on the current
 // power level at this frequency bin (when there is speech in this
 // frequency bin).
-std::vector<float> SmoothingFactor(float max_smoothing,
-                                   const std::vector<float>& current_power_db,
-                                   const std::vector<float>& smoothed_power,
-                                   const std::vector<float>& noise_estimate) {
+void SmoothingFactor(float max_smoothing,
+                     const std::vector<float>& current_power_db,
+                     const std::vector<float>& smoothed_power,
+                     const std::vector<float>& noise_estimate,
+                     std::vector<float>* smoothing_factor) {
   constexpr float kPowDiff = 0.3f;
   // The smoothing correction factor approaches 0 as the current power value
   // moves away from the previously calculated smoothed power, and is 1 when
@@ -82,15 +84,12 @@ std::vector<float> SmoothingFactor(float max_smoothing,
   float smoothing_correction = std::exp(-audio_dsp::Square(
       (Average(smoothed_power) - Average(current_power_db)) / kPowDiff));
 
-  std::vector<float> smoothing_factor(noise_estimate.size());
   for (int i = 0; i < smoothed_power.size(); ++i) {
-    smoothing_factor.at(i) =
+    smoothing_factor->at(i) =
         max_smoothing * smoothing_correction *
         std::exp(-audio_dsp::Square(
             (smoothed_power.at(i) - noise_estimate.at(i)) / kPowDiff));
   }
-
-  return smoothing_factor;
 }
 
 }  // namespace
@@ -135,6 +134,8 @@ NoiseEstimator::NoiseEstimator(int num_samples_per_hop, int num_hops_per_update,
       noise_estimate_(num_features, 0.f),
       noise_bound_(num_features, 0.f),
       past_samples_hop_(num_samples_per_hop),
+      log_mel_features_(num_features),
+      smoothing_factor_(num_features),
       is_noise_(true),
       num_hops_received_(0),
       next_sample_in_hop_(0),
@@ -142,6 +143,7 @@ NoiseEstimator::NoiseEstimator(int num_samples_per_hop, int num_hops_per_update,
 }
 
 bool NoiseEstimator::ReceiveSamples(const absl::Span<const int16_t> samples) {
+  LYRA_TRACE_SCOPE("NoiseEstimator::ReceiveSamples");
   if (samples.size() + next_sample_in_hop_ > num_samples_per_hop_) {
     LOG(ERROR) << "Buffer overflow in NoiseEstimator. Max sample"
                << " vector size is " << num_samples_per_hop_ << " but "
@@ -156,17 +158,17 @@ bool NoiseEstimator::ReceiveSamples(const absl::Span<const int16_t> samples) {
   // noise estimator.
   if (next_sample_in_hop_ == num_samples_per_hop_) {
     next_sample_in_hop_ = 0;
-    auto log_mel_spectrogram = log_mel_spectrogram_extractor_->Extract(
-        absl::MakeConstSpan(past_samples_hop_));
-    if (!log_mel_spectrogram.has_value()) {
+    if (!log_mel_spectrogram_extractor_->ExtractInto(
+            absl::MakeConstSpan(past_samples_hop_),
+            absl::MakeSpan(log_mel_features_))) {
       LOG(ERROR) << "Unable to extract features from decoded audio.";
       return false;
     }
-    is_noise_ = ComputeIsNoise(log_mel_spectrogram.value());
+    is_noise_ = ComputeIsNoise(log_mel_features_);
     if (is_noise_) {
       DecayBounds();
     } else {
-      UpdateNoiseEstimate(log_mel_spectrogram.value());
+      UpdateNoiseEstimate(log_mel_features_);
     }
   }
   return true;
@@ -184,18 +186,18 @@ void NoiseEstimator::UpdateNoiseEstimate(
     tmp_min_smoothed_power_ = current_power_db;
   }
 
-  std::vector<float> smoothing_factor = SmoothingFactor(
-      max_smoothing_, current_power_db, smoothed_power_, noise_estimate_);
+  SmoothingFactor(max_smoothing_, current_power_db, smoothed_power_,
+                  noise_estimate_, &smoothing_factor_);
   // |smoothed_power_| per frequency band =
-  //     |smoothing_factor| * |smoothed_power_| +
-  //     (1 - |smoothing_factor|) * |current_power_db|.
+  //     |smoothing_factor_| * |smoothed_power_| +
+  //     (1 - |smoothing_factor_|) * |current_power_db|.
   for (int i = 0; i < smoothed_power_.size(); ++i) {
     smoothed_power_.at(i) =
-        smoothing_factor.at(i) * smoothed_power_.at(i) +
-        (1.f - smoothing_factor.at(i)) * current_power_db.at(i);
+        smoothing_factor_.at(i) * smoothed_power_.at(i) +
+        (1.f - smoothing_factor_.at(i)) * current_power_db.at(i);
     squared_smoothed_power_.at(i) =
-        smoothing_factor.at(i) * squared_smoothed_power_.at(i) +
-        (1.f - smoothing_factor.at(i)) *
+        smoothing_factor_.at(i) * squared_smoothed_power_.at(i) +
+        (1.f - smoothing_factor_.at(i)) *
             audio_dsp::Square(current_power_db.at(i));
   }
 
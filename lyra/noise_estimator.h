@@ -85,6 +85,9 @@ class NoiseEstimator : public NoiseEstimatorInterface {
   std::vector<float> noise_estimate_;
   std::vector<float> noise_bound_;
   std::vector<int16_t> past_samples_hop_;
+  // Buffers reused across hops.
+  std::vector<float> log_mel_features_;
+  std::vector<float> smoothing_factor_;
 
   bool is_noise_;
   int num_hops_received_;
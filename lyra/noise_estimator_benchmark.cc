@@ -0,0 +1,56 @@
+// Copyright 2022 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "absl/random/random.h"
+#include "benchmark/benchmark.h"
+#include "lyra/lyra_config.h"
+#include "lyra/noise_estimator.h"
+
+static constexpr int kNumRandVectors = 100;
+
+// Feeds one hop at the internal sample rate per iteration, which extracts a
+// log mel spectrogram and updates the noise estimate. The level of the random
+// hops varies so that some are classified as noise and some are not.
+void BM_ReceiveSamples(benchmark::State& state) {
+  const int num_samples_per_hop = chromemedia::codec::GetNumSamplesPerHop(
+      chromemedia::codec::kInternalSampleRateHz);
+  auto noise_estimator = chromemedia::codec::NoiseEstimator::Create(
+      chromemedia::codec::kInternalSampleRateHz, num_samples_per_hop,
+      chromemedia::codec::GetNumSamplesPerWindow(
+          chromemedia::codec::kInternalSampleRateHz),
+      chromemedia::codec::kNumMelBins);
+  absl::BitGen gen;
+  std::vector<std::vector<int16_t>> hops(
+      kNumRandVectors, std::vector<int16_t>(num_samples_per_hop));
+  for (auto& hop : hops) {
+    const int16_t amplitude = absl::Uniform<int16_t>(gen, 1, 10000);
+    for (auto& sample : hop) {
+      sample = absl::Uniform<int16_t>(absl::IntervalClosed, gen, -amplitude,
+                                      amplitude);
+    }
+  }
+  int i = 0;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(noise_estimator->ReceiveSamples(hops[i]));
+    i = (i + 1) % kNumRandVectors;
+  }
+  state.SetItemsProcessed(state.iterations() * num_samples_per_hop);
+}
+
+BENCHMARK(BM_ReceiveSamples);
+BENCHMARK_MAIN();
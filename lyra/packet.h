@@ -17,6 +17,7 @@
 #ifndef LYRA_PACKET_H_
 #define LYRA_PACKET_H_
 
+#include <algorithm>
 #include <bitset>
 #include <climits>
 #include <cmath>
@@ -70,6 +71,93 @@ class Packet : public PacketInterface {
                                                  num_quantized_bits_);
   }
 
+  bool PackIndices(absl::Span<const int> indices, int bits_per_index,
+                   absl::Span<uint8_t> packet) const override {
+    if (!IsIndexLayoutValid(indices.size(), bits_per_index, packet.size())) {
+      return false;
+    }
+    for (const int index : indices) {
+      if (index < 0 || (index >> bits_per_index) != 0) {
+        LOG(ERROR) << "Index " << index << " does not fit into "
+                   << bits_per_index << " bits.";
+        return false;
+      }
+    }
+
+    // Bits are shifted into the least significant end of |word|, which is
+    // stored most significant byte first each time it fills up. The header
+    // is all zeros and simply shifted in ahead of the indices.
+    uint64_t word = 0;
+    int num_word_bits = 0;
+    uint8_t* packet_byte = packet.data();
+    const auto append_bits = [&](uint64_t bits, int num_bits) {
+      if (num_word_bits + num_bits < kWordBits) {
+        word = (word << num_bits) | bits;
+        num_word_bits += num_bits;
+        return;
+      }
+      const int num_remaining_bits = num_word_bits + num_bits - kWordBits;
+      word = (word << (num_bits - num_remaining_bits)) |
+             (bits >> num_remaining_bits);
+      StoreWord(word, kWordBits / CHAR_BIT, packet_byte);
+      packet_byte += kWordBits / CHAR_BIT;
+      word = bits & LowBitsMask(num_remaining_bits);
+      num_word_bits = num_remaining_bits;
+    };
+    for (int i = 0; i < num_header_bits_; i += kMaxBitsPerAppend) {
+      append_bits(0, std::min(kMaxBitsPerAppend, num_header_bits_ - i));
+    }
+    for (const int index : indices) {
+      append_bits(index, bits_per_index);
+    }
+    // Left-align the remaining bits in the last bytes.
+    const int num_tail_bytes = (num_word_bits + CHAR_BIT - 1) / CHAR_BIT;
+    StoreWord(word << (num_tail_bytes * CHAR_BIT - num_word_bits),
+              num_tail_bytes, packet_byte);
+    return true;
+  }
+
+  bool UnpackIndices(absl::Span<const uint8_t> packet, int bits_per_index,
+                     absl::Span<int> indices) const override {
+    if (!IsIndexLayoutValid(indices.size(), bits_per_index, packet.size())) {
+      return false;
+    }
+
+    // The lowest |num_word_bits| of |word| are the next unread bits. Whole
+    // words are loaded while at least eight bytes remain, single bytes after.
+    uint64_t word = 0;
+    int num_word_bits = 0;
+    const uint8_t* packet_byte = packet.data();
+    const uint8_t* const packet_end = packet_byte + packet.size();
+    const auto read_bits = [&](int num_bits) -> uint64_t {
+      if (num_word_bits < num_bits) {
+        if (packet_end - packet_byte >= kWordBits / CHAR_BIT) {
+          const uint64_t next_word = LoadWord(packet_byte);
+          packet_byte += kWordBits / CHAR_BIT;
+          const int num_next_bits = num_bits - num_word_bits;
+          const uint64_t bits = (word << num_next_bits) |
+                                (next_word >> (kWordBits - num_next_bits));
+          word = next_word;
+          num_word_bits = kWordBits - num_next_bits;
+          return bits & LowBitsMask(num_bits);
+        }
+        while (num_word_bits < num_bits) {
+          word = (word << CHAR_BIT) | *packet_byte++;
+          num_word_bits += CHAR_BIT;
+        }
+      }
+      num_word_bits -= num_bits;
+      return (word >> num_word_bits) & LowBitsMask(num_bits);
+    };
+    for (int i = 0; i < num_header_bits_; i += kMaxBitsPerAppend) {
+      read_bits(std::min(kMaxBitsPerAppend, num_header_bits_ - i));
+    }
+    for (int& index : indices) {
+      index = static_cast<int>(read_bits(bits_per_index));
+    }
+    return true;
+  }
+
   int PacketSize() const override {
     return static_cast<int>(std::ceil(
         static_cast<float>(num_quantized_bits_ + num_header_bits_) / CHAR_BIT));
@@ -80,6 +168,51 @@ class Packet : public PacketInterface {
       : num_header_bits_(num_header_bits),
         num_quantized_bits_(num_quantized_bits) {}
 
+  // Width of the accumulator used by |PackIndices| and |UnpackIndices|.
+  static constexpr int kWordBits = 64;
+  // Largest number of bits shifted into or out of the accumulator at once, so
+  // that a partially filled word always has room for them.
+  static constexpr int kMaxBitsPerAppend = 32;
+
+  static uint64_t LowBitsMask(int num_bits) {
+    return (uint64_t{1} << num_bits) - 1;
+  }
+
+  // Stores the lowest |num_bytes| bytes of |word| most significant byte first.
+  static void StoreWord(uint64_t word, int num_bytes, uint8_t* bytes) {
+    for (int i = 0; i < num_bytes; ++i) {
+      bytes[i] = static_cast<uint8_t>(word >> ((num_bytes - i - 1) * CHAR_BIT));
+    }
+  }
+
+  // Loads eight bytes as a word, most significant byte first.
+  static uint64_t LoadWord(const uint8_t* bytes) {
+    uint64_t word = 0;
+    for (int i = 0; i < kWordBits / CHAR_BIT; ++i) {
+      word = (word << CHAR_BIT) | bytes[i];
+    }
+    return word;
+  }
+
+  bool IsIndexLayoutValid(int num_indices, int bits_per_index,
+                          int packet_size) const {
+    if (packet_size != PacketSize()) {
+      LOG(ERROR) << "Packet of unexpected length: " << packet_size;
+      return false;
+    }
+    if (bits_per_index <= 0 || bits_per_index >= kMaxBitsPerAppend) {
+      LOG(ERROR) << "Unsupported number of bits per index: " << bits_per_index;
+      return false;
+    }
+    if (num_indices * bits_per_index != num_quantized_bits_) {
+      LOG(ERROR) << num_indices << " indices of " << bits_per_index
+                 << " bits do not fill the " << num_quantized_bits_
+                 << " quantized bits.";
+      return false;
+    }
+    return true;
+  }
+
   // Creates a vector of bytes containing a header of variable bits with the
   // quantized data following directly after. For example:
   //  +--------+--------+---------+
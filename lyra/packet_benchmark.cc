@@ -0,0 +1,139 @@
+// Copyright 2022 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/random/random.h"
+#include "absl/types/span.h"
+#include "benchmark/benchmark.h"
+#include "lyra/lyra_config.h"
+#include "lyra/packet.h"
+
+// Matches the packet size the codec is built with in lyra_components.cc.
+static constexpr int kMaxNumPacketBits = 184;
+static constexpr int kNumRandVectors = 100;
+// Each of the codec's quantizers picks one of 16 codebook entries.
+static constexpr int kBitsPerIndex = 4;
+
+std::unique_ptr<chromemedia::codec::Packet<kMaxNumPacketBits>> CreatePacket(
+    int num_quantized_bits) {
+  return chromemedia::codec::Packet<kMaxNumPacketBits>::Create(
+      chromemedia::codec::kNumHeaderBits, num_quantized_bits);
+}
+
+// Returns random strings of |num_quantized_bits| '0' or '1' characters.
+std::vector<std::string> RandomQuantizedStrings(int num_quantized_bits) {
+  absl::BitGen gen;
+  std::vector<std::string> quantized(kNumRandVectors,
+                                     std::string(num_quantized_bits, '0'));
+  for (auto& bits : quantized) {
+    for (auto& bit : bits) {
+      bit = absl::Bernoulli(gen, 0.5) ? '1' : '0';
+    }
+  }
+  return quantized;
+}
+
+// Packs the quantized bits of one hop at |state.range(0)| bits per iteration.
+void BM_PackQuantized(benchmark::State& state) {
+  auto packet = CreatePacket(state.range(0));
+  const std::vector<std::string> quantized =
+      RandomQuantizedStrings(state.range(0));
+  int i = 0;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(packet->PackQuantized(quantized[i]));
+    i = (i + 1) % kNumRandVectors;
+  }
+  state.SetBytesProcessed(state.iterations() * packet->PacketSize());
+}
+
+// Unpacks one packet of |state.range(0)| quantized bits per iteration.
+void BM_UnpackPacket(benchmark::State& state) {
+  auto packet = CreatePacket(state.range(0));
+  std::vector<std::vector<uint8_t>> packets;
+  for (const std::string& quantized : RandomQuantizedStrings(state.range(0))) {
+    packets.push_back(packet->PackQuantized(quantized));
+  }
+  int i = 0;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(packet->UnpackPacket(packets[i]));
+    i = (i + 1) % kNumRandVectors;
+  }
+  state.SetBytesProcessed(state.iterations() * packet->PacketSize());
+}
+
+// Returns random indices of |kBitsPerIndex| bits filling |num_quantized_bits|.
+std::vector<std::vector<int>> RandomIndices(int num_quantized_bits) {
+  absl::BitGen gen;
+  std::vector<std::vector<int>> indices(
+      kNumRandVectors, std::vector<int>(num_quantized_bits / kBitsPerIndex));
+  for (auto& vector : indices) {
+    for (int& index : vector) {
+      index = absl::Uniform(gen, 0, 1 << kBitsPerIndex);
+    }
+  }
+  return indices;
+}
+
+// Packs the quantizer indices of one hop straight into packet bytes, the path
+// LyraEncoder takes.
+void BM_PackIndices(benchmark::State& state) {
+  auto packet = CreatePacket(state.range(0));
+  const std::vector<std::vector<int>> indices = RandomIndices(state.range(0));
+  std::vector<uint8_t> encoded(packet->PacketSize());
+  int i = 0;
+  for (auto _ : state) {
+    packet->PackIndices(indices[i], kBitsPerIndex, absl::MakeSpan(encoded));
+    benchmark::DoNotOptimize(encoded.data());
+    benchmark::ClobberMemory();
+    i = (i + 1) % kNumRandVectors;
+  }
+  state.SetBytesProcessed(state.iterations() * packet->PacketSize());
+}
+
+// Unpacks the quantizer indices of one packet, the path LyraDecoder takes.
+void BM_UnpackIndices(benchmark::State& state) {
+  auto packet = CreatePacket(state.range(0));
+  std::vector<std::vector<uint8_t>> packets;
+  for (const std::vector<int>& indices : RandomIndices(state.range(0))) {
+    packets.emplace_back(packet->PacketSize());
+    packet->PackIndices(indices, kBitsPerIndex, absl::MakeSpan(packets.back()));
+  }
+  std::vector<int> indices(state.range(0) / kBitsPerIndex);
+  int i = 0;
+  for (auto _ : state) {
+    packet->UnpackIndices(packets[i], kBitsPerIndex, absl::MakeSpan(indices));
+    benchmark::DoNotOptimize(indices.data());
+    benchmark::ClobberMemory();
+    i = (i + 1) % kNumRandVectors;
+  }
+  state.SetBytesProcessed(state.iterations() * packet->PacketSize());
+}
+
+void SupportedQuantizedBits(benchmark::internal::Benchmark* benchmark) {
+  benchmark->ArgName("num_quantized_bits");
+  for (int num_quantized_bits :
+       chromemedia::codec::GetSupportedQuantizedBits()) {
+    benchmark->Arg(num_quantized_bits);
+  }
+}
+
+BENCHMARK(BM_PackQuantized)->Apply(SupportedQuantizedBits);
+BENCHMARK(BM_UnpackPacket)->Apply(SupportedQuantizedBits);
+BENCHMARK(BM_PackIndices)->Apply(SupportedQuantizedBits);
+BENCHMARK(BM_UnpackIndices)->Apply(SupportedQuantizedBits);
+BENCHMARK_MAIN();
@@ -41,6 +41,23 @@ class PacketInterface {
   virtual std::optional<std::string> UnpackPacket(
       const absl::Span<const uint8_t> packet) = 0;
 
+  // Packs quantizer indices of |bits_per_index| bits each into |packet|, which
+  // must be |PacketSize()| bytes long. The first index occupies the most
+  // significant bits, so the bytes are identical to those |PackQuantized|
+  // produces for the same indices written as a bit string.
+  // Returns false if the indices don't fill exactly the quantized bits or an
+  // index doesn't fit into |bits_per_index| bits.
+  virtual bool PackIndices(absl::Span<const int> indices, int bits_per_index,
+                           absl::Span<uint8_t> packet) const = 0;
+
+  // Unpacks an encoded packet into quantizer indices of |bits_per_index| bits
+  // each, the inverse of |PackIndices|.
+  // Returns false if |packet| is not |PacketSize()| bytes long or the indices
+  // don't fill exactly the quantized bits.
+  virtual bool UnpackIndices(absl::Span<const uint8_t> packet,
+                             int bits_per_index,
+                             absl::Span<int> indices) const = 0;
+
   virtual int PacketSize() const = 0;
 };
 
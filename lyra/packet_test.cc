@@ -21,6 +21,7 @@
 #include <cstdint>
 #include <memory>
 #include <optional>
+#include <random>
 #include <string>
 #include <vector>
 
@@ -60,6 +61,29 @@ class PacketTest : public testing::Test {
   }
 };
 
+// Formats indices as the bit string a quantizer would return for them.
+std::string IndicesToBitString(const std::vector<int>& indices,
+                               int bits_per_index) {
+  std::string bits;
+  for (const int index : indices) {
+    for (int i = bits_per_index - 1; i >= 0; --i) {
+      bits.push_back((index >> i) & 1 ? '1' : '0');
+    }
+  }
+  return bits;
+}
+
+std::vector<int> RandomIndices(int num_indices, int bits_per_index,
+                               std::mt19937& gen) {
+  std::uniform_int_distribution<int> distribution(0,
+                                                  (1 << bits_per_index) - 1);
+  std::vector<int> indices(num_indices);
+  for (int& index : indices) {
+    index = distribution(gen);
+  }
+  return indices;
+}
+
 TEST_F(PacketTest, MaxNumPacketBitsTooLow) {
   constexpr int kNumHeaderBitsTest = 8;
   constexpr int kNumQuantizedBitsTest = 56;
@@ -299,6 +323,130 @@ TEST_F(PacketTest, PackBigHeader) {
       encoded, quantized.to_string(), kNumHeaderBitsTest, kNumQuantizedBits));
 }
 
+TEST_F(PacketTest, PackIndicesMatchesPackQuantized) {
+  constexpr int kMaxNumPacketBitsTest = 512;
+  std::mt19937 gen(0);
+  for (int num_header_bits : {0, 3, 8, 22, 100}) {
+    for (int bits_per_index : {1, 4, 7, 13, 31}) {
+      for (int num_indices : {0, 1, 5, 16, 46}) {
+        const int num_quantized_bits = num_indices * bits_per_index;
+        if (num_header_bits + num_quantized_bits > kMaxNumPacketBitsTest) {
+          continue;
+        }
+        auto packet = Packet<kMaxNumPacketBitsTest>::Create(
+            num_header_bits, num_quantized_bits);
+        ASSERT_NE(packet, nullptr);
+        const std::vector<int> indices =
+            RandomIndices(num_indices, bits_per_index, gen);
+
+        std::vector<uint8_t> encoded(packet->PacketSize());
+        ASSERT_TRUE(packet->PackIndices(indices, bits_per_index,
+                                        absl::MakeSpan(encoded)));
+        EXPECT_EQ(encoded, packet->PackQuantized(
+                               IndicesToBitString(indices, bits_per_index)))
+            << "header bits: " << num_header_bits
+            << ", bits per index: " << bits_per_index
+            << ", indices: " << num_indices;
+      }
+    }
+  }
+}
+
+TEST_F(PacketTest, UnpackIndicesMatchesUnpackPacket) {
+  constexpr int kMaxNumPacketBitsTest = 512;
+  std::mt19937 gen(0);
+  std::uniform_int_distribution<int> random_byte(0, 255);
+  for (int num_header_bits : {0, 3, 8, 22, 100}) {
+    for (int bits_per_index : {1, 4, 7, 13, 31}) {
+      for (int num_indices : {0, 1, 5, 16, 46}) {
+        const int num_quantized_bits = num_indices * bits_per_index;
+        if (num_header_bits + num_quantized_bits > kMaxNumPacketBitsTest) {
+          continue;
+        }
+        auto packet = Packet<kMaxNumPacketBitsTest>::Create(
+            num_header_bits, num_quantized_bits);
+        ASSERT_NE(packet, nullptr);
+        // Random bytes also exercise ignoring the header and trailing bits.
+        std::vector<uint8_t> encoded(packet->PacketSize());
+        for (uint8_t& byte : encoded) {
+          byte = random_byte(gen);
+        }
+
+        std::vector<int> indices(num_indices);
+        ASSERT_TRUE(packet->UnpackIndices(encoded, bits_per_index,
+                                          absl::MakeSpan(indices)));
+        EXPECT_EQ(IndicesToBitString(indices, bits_per_index),
+                  packet->UnpackPacket(encoded).value())
+            << "header bits: " << num_header_bits
+            << ", bits per index: " << bits_per_index
+            << ", indices: " << num_indices;
+      }
+    }
+  }
+}
+
+TEST_F(PacketTest, UnpackIndicesInvertsPackIndices) {
+  constexpr int kBitsPerIndex = 4;
+  constexpr int kNumIndices = kNumQuantizedBits / kBitsPerIndex;
+  std::mt19937 gen(0);
+  const std::vector<int> indices =
+      RandomIndices(kNumIndices, kBitsPerIndex, gen);
+
+  auto packet =
+      Packet<kMaxNumPacketBits>::Create(kNumHeaderBits, kNumQuantizedBits);
+  ASSERT_NE(packet, nullptr);
+  std::vector<uint8_t> encoded(packet->PacketSize());
+  ASSERT_TRUE(
+      packet->PackIndices(indices, kBitsPerIndex, absl::MakeSpan(encoded)));
+  std::vector<int> unpacked(kNumIndices);
+  ASSERT_TRUE(
+      packet->UnpackIndices(encoded, kBitsPerIndex, absl::MakeSpan(unpacked)));
+  EXPECT_EQ(unpacked, indices);
+}
+
+TEST_F(PacketTest, PackIndicesRejectsInvalidLayouts) {
+  constexpr int kBitsPerIndex = 8;
+  constexpr int kNumIndices = kNumQuantizedBits / kBitsPerIndex;
+  auto packet =
+      Packet<kMaxNumPacketBits>::Create(kNumHeaderBits, kNumQuantizedBits);
+  ASSERT_NE(packet, nullptr);
+  std::vector<int> indices(kNumIndices, 0);
+  std::vector<uint8_t> encoded(kPacketSize);
+
+  // Indices that don't fill the quantized bits.
+  EXPECT_FALSE(packet->PackIndices(absl::MakeConstSpan(indices).subspan(1),
+                                   kBitsPerIndex, absl::MakeSpan(encoded)));
+  EXPECT_FALSE(
+      packet->PackIndices(indices, kBitsPerIndex / 2, absl::MakeSpan(encoded)));
+  // Packet of the wrong size.
+  EXPECT_FALSE(packet->PackIndices(indices, kBitsPerIndex,
+                                   absl::MakeSpan(encoded).subspan(1)));
+  // Indices that don't fit into their bits.
+  indices.back() = 1 << kBitsPerIndex;
+  EXPECT_FALSE(
+      packet->PackIndices(indices, kBitsPerIndex, absl::MakeSpan(encoded)));
+  indices.back() = -1;
+  EXPECT_FALSE(
+      packet->PackIndices(indices, kBitsPerIndex, absl::MakeSpan(encoded)));
+}
+
+TEST_F(PacketTest, UnpackIndicesRejectsInvalidLayouts) {
+  constexpr int kBitsPerIndex = 8;
+  constexpr int kNumIndices = kNumQuantizedBits / kBitsPerIndex;
+  auto packet =
+      Packet<kMaxNumPacketBits>::Create(kNumHeaderBits, kNumQuantizedBits);
+  ASSERT_NE(packet, nullptr);
+  std::vector<int> indices(kNumIndices);
+  const std::vector<uint8_t> encoded(kPacketSize);
+
+  EXPECT_FALSE(packet->UnpackIndices(encoded, kBitsPerIndex,
+                                     absl::MakeSpan(indices).subspan(1)));
+  EXPECT_FALSE(packet->UnpackIndices(
+      absl::MakeConstSpan(encoded).subspan(1), kBitsPerIndex,
+      absl::MakeSpan(indices)));
+}
+
 }  // namespace
 }  // namespace codec
 }  // namespace chromemedia
+
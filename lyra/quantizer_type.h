@@ -0,0 +1,34 @@
+/*
+ * Copyright 2022 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LYRA_QUANTIZER_TYPE_H_
+#define LYRA_QUANTIZER_TYPE_H_
+
+namespace chromemedia {
+namespace codec {
+
+// Selects how residual vector quantization is computed.
+enum class QuantizerType {
+  // Runs the encode and decode signatures of quantizer.tflite.
+  kTfLite,
+  // Runs bit-exact native code on the codebooks of quantizer.tflite.
+  kNative,
+};
+
+}  // namespace codec
+}  // namespace chromemedia
+
+#endif  // LYRA_QUANTIZER_TYPE_H_
@@ -17,6 +17,7 @@
 #include <algorithm>
 #include <cstdint>
 #include <memory>
+#include <optional>
 #include <utility>
 #include <vector>
 
@@ -25,6 +26,7 @@
 #include "audio/dsp/resampler_q.h"
 #include "glog/logging.h"  // IWYU pragma: keep
 #include "lyra/dsp_utils.h"
+#include "lyra/tracing.h"
 
 namespace chromemedia {
 namespace codec {
@@ -59,10 +61,28 @@ Resampler::Resampler(audio_dsp::QResampler<float> dsp_resampler,
 }
 
 std::vector<int16_t> Resampler::Resample(absl::Span<const int16_t> audio) {
-  std::vector<float> input_floats(audio.begin(), audio.end());
-  std::vector<float> output_floats;
-  resampler_.ProcessSamples(input_floats, &output_floats);
-  return ClipToInt16(absl::MakeConstSpan(output_floats));
+  ResampleToFloats(audio);
+  return ClipToInt16(absl::MakeConstSpan(output_floats_));
+}
+
+std::optional<int> Resampler::ResampleInto(absl::Span<const int16_t> audio,
+                                           absl::Span<int16_t> resampled) {
+  ResampleToFloats(audio);
+  if (output_floats_.size() > resampled.size()) {
+    LOG(ERROR) << "Resampling produced " << output_floats_.size()
+               << " samples but only " << resampled.size()
+               << " fit into the output.";
+    return std::nullopt;
+  }
+  ClipToInt16(absl::MakeConstSpan(output_floats_),
+              resampled.first(output_floats_.size()));
+  return output_floats_.size();
+}
+
+void Resampler::ResampleToFloats(absl::Span<const int16_t> audio) {
+  LYRA_TRACE_SCOPE("Resampler::ResampleToFloats");
+  input_floats_.assign(audio.begin(), audio.end());
+  resampler_.ProcessSamples(input_floats_, &output_floats_);
 }
 
 void Resampler::Reset() { resampler_.ResetFullyPrimed(); }
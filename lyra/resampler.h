@@ -19,6 +19,7 @@
 
 #include <cstdint>
 #include <memory>
+#include <optional>
 #include <vector>
 
 #include "absl/types/span.h"
@@ -39,6 +40,11 @@ class Resampler : public ResamplerInterface {
   // Resamples audio at |input_sample_rate_hz| to |target_sample_rate_hz|.
   std::vector<int16_t> Resample(absl::Span<const int16_t> audio) override;
 
+  // Resamples without allocating once the internal buffers have grown to the
+  // size of |audio|.
+  std::optional<int> ResampleInto(absl::Span<const int16_t> audio,
+                                  absl::Span<int16_t> resampled) override;
+
   void Reset() override;
 
   int input_sample_rate_hz() const override;
@@ -53,7 +59,14 @@ class Resampler : public ResamplerInterface {
 
   explicit Resampler(audio_dsp::QResampler<float> dsp_resampler,
                      int input_sample_rate_hz, int target_sample_rate_hz);
+
+  // Resamples |audio| into |output_floats_|.
+  void ResampleToFloats(absl::Span<const int16_t> audio);
+
   audio_dsp::QResampler<float> resampler_;
+  // Reused between calls to avoid allocating.
+  std::vector<float> input_floats_;
+  std::vector<float> output_floats_;
 };
 
 }  // namespace codec
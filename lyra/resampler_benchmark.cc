@@ -0,0 +1,93 @@
+// Copyright 2022 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "absl/random/random.h"
+#include "absl/types/span.h"
+#include "benchmark/benchmark.h"
+#include "lyra/dsp_utils.h"
+#include "lyra/lyra_config.h"
+#include "lyra/resampler.h"
+
+static constexpr int kNumRandVectors = 100;
+
+// Returns random hops of audio at |sample_rate_hz|. Cycling through several of
+// them keeps a single input from staying in cache.
+std::vector<std::vector<int16_t>> RandomHops(int sample_rate_hz) {
+  absl::BitGen gen;
+  std::vector<std::vector<int16_t>> hops(
+      kNumRandVectors,
+      std::vector<int16_t>(chromemedia::codec::GetNumSamplesPerHop(
+          sample_rate_hz)));
+  for (auto& hop : hops) {
+    for (auto& sample : hop) {
+      sample = absl::Uniform<uint16_t>(gen);
+    }
+  }
+  return hops;
+}
+
+// Resamples one hop from |state.range(0)| Hz to |state.range(1)| Hz per
+// iteration.
+void BM_Resample(benchmark::State& state) {
+  const int input_sample_rate_hz = state.range(0);
+  auto resampler = chromemedia::codec::Resampler::Create(input_sample_rate_hz,
+                                                         state.range(1));
+  const std::vector<std::vector<int16_t>> hops =
+      RandomHops(input_sample_rate_hz);
+  int i = 0;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(resampler->Resample(hops[i]));
+    i = (i + 1) % kNumRandVectors;
+  }
+  state.SetItemsProcessed(state.iterations() * hops[0].size());
+}
+
+void BM_ResampleInto(benchmark::State& state) {
+  const int input_sample_rate_hz = state.range(0);
+  const int target_sample_rate_hz = state.range(1);
+  auto resampler = chromemedia::codec::Resampler::Create(input_sample_rate_hz,
+                                                         target_sample_rate_hz);
+  const std::vector<std::vector<int16_t>> hops =
+      RandomHops(input_sample_rate_hz);
+  std::vector<int16_t> resampled(
+      chromemedia::codec::ConvertNumSamplesBetweenSampleRate(
+          hops[0].size(), input_sample_rate_hz, target_sample_rate_hz));
+  int i = 0;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(
+        resampler->ResampleInto(hops[i], absl::MakeSpan(resampled)));
+    i = (i + 1) % kNumRandVectors;
+  }
+  state.SetItemsProcessed(state.iterations() * hops[0].size());
+}
+
+// Every ordered pair of distinct supported sample rates.
+void SampleRatePairs(benchmark::internal::Benchmark* benchmark) {
+  benchmark->ArgNames({"input_hz", "target_hz"});
+  for (int input : chromemedia::codec::kSupportedSampleRates) {
+    for (int target : chromemedia::codec::kSupportedSampleRates) {
+      if (input != target) {
+        benchmark->Args({input, target});
+      }
+    }
+  }
+}
+
+BENCHMARK(BM_Resample)->Apply(SampleRatePairs);
+BENCHMARK(BM_ResampleInto)->Apply(SampleRatePairs);
+BENCHMARK_MAIN();
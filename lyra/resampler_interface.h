@@ -17,7 +17,9 @@
 #ifndef LYRA_RESAMPLER_INTERFACE_H_
 #define LYRA_RESAMPLER_INTERFACE_H_
 
+#include <algorithm>
 #include <cstdint>
+#include <optional>
 #include <vector>
 
 #include "absl/types/span.h"
@@ -31,6 +33,20 @@ class ResamplerInterface {
 
   virtual std::vector<int16_t> Resample(absl::Span<const int16_t> audio) = 0;
 
+  // Resamples |audio| into the front of |resampled| and returns the number of
+  // samples written, or nullopt if |resampled| is too small.
+  // The default implementation copies the result of |Resample|;
+  // implementations override it to avoid allocating.
+  virtual std::optional<int> ResampleInto(absl::Span<const int16_t> audio,
+                                          absl::Span<int16_t> resampled) {
+    const std::vector<int16_t> samples = Resample(audio);
+    if (samples.size() > resampled.size()) {
+      return std::nullopt;
+    }
+    std::copy(samples.begin(), samples.end(), resampled.begin());
+    return samples.size();
+  }
+
   virtual void Reset() = 0;
 
   virtual int input_sample_rate_hz() const = 0;
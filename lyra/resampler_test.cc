@@ -77,6 +77,39 @@ TEST(ResamplerTest, UpsampleThenDownsampleSimilar) {
   }
 }
 
+TEST(ResamplerTest, ResampleIntoMatchesResample) {
+  std::vector<double> doubles_samples;
+  audio_dsp::ComputeSineWaveVector(1000, kInternalSampleRateHz, 0.0, 100,
+                                   &doubles_samples);
+  std::vector<int16_t> samples;
+  for (auto val : doubles_samples) {
+    samples.push_back(val * 100);
+  }
+  auto resampler = Resampler::Create(kInternalSampleRateHz, 48000);
+  auto into_resampler = Resampler::Create(kInternalSampleRateHz, 48000);
+
+  const auto expected = resampler->Resample(absl::MakeConstSpan(samples));
+  std::vector<int16_t> resampled(expected.size() + 1);
+  const auto num_resampled = into_resampler->ResampleInto(
+      absl::MakeConstSpan(samples), absl::MakeSpan(resampled));
+
+  ASSERT_TRUE(num_resampled.has_value());
+  ASSERT_EQ(num_resampled.value(), expected.size());
+  resampled.resize(num_resampled.value());
+  EXPECT_EQ(resampled, expected);
+}
+
+TEST(ResamplerTest, ResampleIntoTooSmallOutputFails) {
+  std::vector<int16_t> samples(GetNumSamplesPerHop(kInternalSampleRateHz));
+  auto resampler = Resampler::Create(kInternalSampleRateHz, 48000);
+  std::vector<int16_t> resampled(GetNumSamplesPerHop(48000) - 1);
+
+  EXPECT_FALSE(resampler
+                   ->ResampleInto(absl::MakeConstSpan(samples),
+                                  absl::MakeSpan(resampled))
+                   .has_value());
+}
+
 // This test will fail without clipping, as ubsan will catch the overflow when
 // converting from float to int16_t after resampling.
 TEST(ResamplerExtremeValuesTest, AlternatingExtremeValuesTest) {
@@ -26,18 +26,24 @@
 #include <vector>
 
 #include "absl/memory/memory.h"
+#include "absl/types/span.h"
 #include "glog/logging.h"  // IWYU pragma: keep
 #include "include/ghc/filesystem.hpp"
+#include "lyra/tflite_model_options.h"
 #include "lyra/tflite_model_wrapper.h"
+#include "lyra/tracing.h"
 
 namespace chromemedia {
 namespace codec {
 
 std::unique_ptr<ResidualVectorQuantizer> ResidualVectorQuantizer::Create(
-    const ghc::filesystem::path& model_path) {
+    const ghc::filesystem::path& model_path,
+    const TfLiteModelOptions& model_options) {
   auto quantizer_model =
       TfLiteModelWrapper::Create(model_path / "quantizer.tflite",
-                                 /*use_xnn=*/false, /*int8_quantized=*/false);
+                                 /*use_xnn=*/false, /*int8_quantized=*/false,
+                                 /*use_weights_cache=*/true,
+                                 model_options.threading);
   if (quantizer_model == nullptr) {
     LOG(ERROR) << "Unable to create the quantizer TfLite model wrapper.";
     return nullptr;
@@ -58,6 +64,16 @@ std::unique_ptr<ResidualVectorQuantizer> ResidualVectorQuantizer::Create(
     LOG(ERROR) << "The quantizer TFLite interpreter has no decode signature";
     return nullptr;
   }
+  const int max_num_quantizers =
+      kMaxNumQuantizedBits /
+      encode_runner->output_tensor("output_1")->data.i32[0];
+  if (decode_runner->ResizeInputTensor(
+          "encoding_indices", {max_num_quantizers, 1, 1}) != kTfLiteOk) {
+    LOG(ERROR)
+        << "Failed to resize the indices tensor to the required number of "
+        << "quantizers (" << max_num_quantizers << ").";
+    return nullptr;
+  }
   if (decode_runner->AllocateTensors() != kTfLiteOk) {
     LOG(ERROR) << "Could not allocate decode runner TFLite tensors.";
     return nullptr;
@@ -88,16 +104,11 @@ std::optional<std::string> ResidualVectorQuantizer::Quantize(
     return std::nullopt;
   }
   const int required_quantizers = num_bits / bits_per_quantizer_;
-  encode_runner_->input_tensor("num_quantizers")->data.i32[0] =
-      required_quantizers;
-  std::copy(features.begin(), features.end(),
-            encode_runner_->input_tensor("input_frames")->data.f);
-  if (encode_runner_->Invoke() != kTfLiteOk) {
-    LOG(ERROR) << "Unable to invoke the quantize runner.";
+  std::vector<int> nearest_neighbors(required_quantizers);
+  if (!QuantizeToIndices(features, num_bits,
+                         absl::MakeSpan(nearest_neighbors))) {
     return std::nullopt;
   }
-  const int32_t* nearest_neighbors =
-      encode_runner_->output_tensor("output_0")->data.i32;
   std::bitset<kMaxNumQuantizedBits> quantized_bits = 0;
   for (int i = 0; i < required_quantizers; ++i) {
     // First cast the current quantizer bits into a bitset that can contain all,
@@ -125,46 +136,107 @@ ResidualVectorQuantizer::DecodeToLossyFeatures(
     return std::nullopt;
   }
   const int required_quantizers = num_bits / bits_per_quantizer_;
-  const int max_num_quantizers = kMaxNumQuantizedBits / bits_per_quantizer_;
-  if (decode_runner_->ResizeInputTensor(
-          "encoding_indices", {max_num_quantizers, 1, 1}) != kTfLiteOk) {
-    LOG(ERROR)
-        << "Failed to resize the indices tensor to the required number of "
-        << "quantizers (" << max_num_quantizers << ").";
-    return std::nullopt;
-  }
-  if (decode_runner_->AllocateTensors() != kTfLiteOk) {
-    LOG(ERROR) << "Unable to allocate tensors.";
-    return std::nullopt;
-  }
   const std::bitset<kMaxNumQuantizedBits> quantized_bits(quantized_features);
   const std::bitset<kMaxNumQuantizedBits> quantizer_mask(
       (1 << bits_per_quantizer_) - 1);
-  int32_t* indices = decode_runner_->input_tensor("encoding_indices")->data.i32;
+  std::vector<int> indices(required_quantizers);
   for (int i = 0; i < required_quantizers; ++i) {
     // First shift the desired quantizer bits into the least significant
     // section, then mask out any more significant bits from other quantizers
-    // and finally cast to int32.
+    // and finally cast to int.
     // The first quantizer is expected to be in the most significant bits.
-    indices[i] = static_cast<int32_t>(
+    indices[i] = static_cast<int>(
         ((quantized_bits >>
           ((required_quantizers - i - 1) * bits_per_quantizer_)) &
          quantizer_mask)
             .to_ulong());
   }
-  for (int j = required_quantizers; j < max_num_quantizers; ++j) {
-    indices[j] = -1;
+  return DecodeIndicesToLossyFeatures(indices);
+}
+
+int ResidualVectorQuantizer::bits_per_quantizer() const {
+  return bits_per_quantizer_;
+}
+
+bool ResidualVectorQuantizer::QuantizeToIndices(
+    const std::vector<float>& features, int num_bits,
+    absl::Span<int> indices) const {
+  LYRA_TRACE_SCOPE("ResidualVectorQuantizer::QuantizeToIndices");
+  if (num_bits > kMaxNumQuantizedBits) {
+    LOG(ERROR) << "The number of bits cannot exceed maximum ("
+               << kMaxNumQuantizedBits << ").";
+    return false;
+  }
+  if (num_bits != indices.size() * bits_per_quantizer_) {
+    LOG(ERROR) << "The number of bits (" << num_bits << ") has to equal "
+               << indices.size() << " indices of " << bits_per_quantizer_
+               << " bits.";
+    return false;
   }
+  encode_runner_->input_tensor("num_quantizers")->data.i32[0] =
+      indices.size();
+  std::copy(features.begin(), features.end(),
+            encode_runner_->input_tensor("input_frames")->data.f);
+  if (!quantizer_model_->InvokeSignature(encode_runner_)) {
+    LOG(ERROR) << "Unable to invoke the quantize runner.";
+    return false;
+  }
+  const int32_t* nearest_neighbors =
+      encode_runner_->output_tensor("output_0")->data.i32;
+  std::copy(nearest_neighbors, nearest_neighbors + indices.size(),
+            indices.begin());
+  return true;
+}
 
-  if (decode_runner_->Invoke() != kTfLiteOk) {
-    LOG(ERROR) << "Unable to invoke the decode runner.";
+std::optional<std::vector<float>>
+ResidualVectorQuantizer::DecodeIndicesToLossyFeatures(
+    absl::Span<const int> indices) const {
+  std::vector<float> features(
+      decode_runner_->output_tensor("output_0")->bytes / sizeof(float));
+  if (!DecodeIndicesToLossyFeaturesInto(indices, absl::MakeSpan(features))) {
     return std::nullopt;
   }
+  return features;
+}
+
+bool ResidualVectorQuantizer::DecodeIndicesToLossyFeaturesInto(
+    absl::Span<const int> indices, absl::Span<float> features) const {
+  LYRA_TRACE_SCOPE(
+      "ResidualVectorQuantizer::DecodeIndicesToLossyFeaturesInto");
+  const int max_num_quantizers = kMaxNumQuantizedBits / bits_per_quantizer_;
+  if (indices.size() > max_num_quantizers) {
+    LOG(ERROR) << "The number of indices (" << indices.size()
+               << ") cannot exceed the number of quantizers ("
+               << max_num_quantizers << ").";
+    return false;
+  }
+  for (const int index : indices) {
+    if (index < 0 || index >= (1 << bits_per_quantizer_)) {
+      LOG(ERROR) << "Code vector index " << index << " is out of range.";
+      return false;
+    }
+  }
   const TfLiteTensor* features_tensor =
       decode_runner_->output_tensor("output_0");
-  const float* features = features_tensor->data.f;
-  const int num_features = features_tensor->bytes / sizeof(features[0]);
-  return std::vector<float>(features, features + num_features);
+  const int num_features = features_tensor->bytes / sizeof(float);
+  if (features.size() != num_features) {
+    LOG(ERROR) << "Expected space for " << num_features
+               << " features but got " << features.size() << ".";
+    return false;
+  }
+  int32_t* encoding_indices =
+      decode_runner_->input_tensor("encoding_indices")->data.i32;
+  std::copy(indices.begin(), indices.end(), encoding_indices);
+  std::fill(encoding_indices + indices.size(),
+            encoding_indices + max_num_quantizers, -1);
+
+  if (!quantizer_model_->InvokeSignature(decode_runner_)) {
+    LOG(ERROR) << "Unable to invoke the decode runner.";
+    return false;
+  }
+  const float* decoded = features_tensor->data.f;
+  std::copy(decoded, decoded + num_features, features.begin());
+  return true;
 }
 
 }  // namespace codec
@@ -22,7 +22,9 @@
 #include <string>
 #include <vector>
 
+#include "absl/types/span.h"
 #include "include/ghc/filesystem.hpp"
+#include "lyra/tflite_model_options.h"
 #include "lyra/tflite_model_wrapper.h"
 #include "lyra/vector_quantizer_interface.h"
 
@@ -35,7 +37,8 @@ class ResidualVectorQuantizer : public VectorQuantizerInterface {
  public:
   // Returns nullptr if the TFLite model can't be built or allocated.
   static std::unique_ptr<ResidualVectorQuantizer> Create(
-      const ghc::filesystem::path& model_path);
+      const ghc::filesystem::path& model_path,
+      const TfLiteModelOptions& model_options = TfLiteModelOptions());
 
   // Quantizes the features using vector quantization.
   std::optional<std::string> Quantize(const std::vector<float>& features,
@@ -45,12 +48,28 @@ class ResidualVectorQuantizer : public VectorQuantizerInterface {
   std::optional<std::vector<float>> DecodeToLossyFeatures(
       const std::string& quantized_features) const override;
 
+  int bits_per_quantizer() const override;
+
+  // Quantizes the features straight to code vector indices.
+  bool QuantizeToIndices(const std::vector<float>& features, int num_bits,
+                         absl::Span<int> indices) const override;
+
+  // Decodes code vector indices into features.
+  std::optional<std::vector<float>> DecodeIndicesToLossyFeatures(
+      absl::Span<const int> indices) const override;
+
+  // Decodes code vector indices into |features| without allocating.
+  bool DecodeIndicesToLossyFeaturesInto(
+      absl::Span<const int> indices,
+      absl::Span<float> features) const override;
+
  private:
   // LINT.IfChange
   static constexpr int kMaxNumQuantizedBits = 184;
   // LINT.ThenChange(
   // lyra_components.cc,
   // lyra_config.cc,
+  // native_residual_vector_quantizer.h,
   // )
 
   explicit ResidualVectorQuantizer(
@@ -0,0 +1,142 @@
+// Copyright 2022 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "absl/random/random.h"
+#include "absl/types/span.h"
+#include "benchmark/benchmark.h"
+#include "include/ghc/filesystem.hpp"
+#include "lyra/lyra_config.h"
+#include "lyra/native_residual_vector_quantizer.h"
+#include "lyra/residual_vector_quantizer.h"
+
+static constexpr int kNumRandVectors = 100;
+
+// Both quantizers load the same model, relative to the working directory like
+// the tests do.
+template <typename Quantizer>
+std::unique_ptr<Quantizer> CreateQuantizer() {
+  return Quantizer::Create(ghc::filesystem::current_path() /
+                           "lyra/model_coeffs");
+}
+
+// Returns random features with roughly the range of the encoder output.
+std::vector<std::vector<float>> RandomFeatures() {
+  absl::BitGen gen;
+  std::vector<std::vector<float>> features(
+      kNumRandVectors, std::vector<float>(chromemedia::codec::kNumFeatures));
+  for (auto& feature_vector : features) {
+    for (auto& feature : feature_vector) {
+      feature = absl::Gaussian(gen, 1.5f, 2.f);
+    }
+  }
+  return features;
+}
+
+// Quantizes the features of one hop to |state.range(0)| bits per iteration.
+template <typename Quantizer>
+void BM_Quantize(benchmark::State& state) {
+  auto quantizer = CreateQuantizer<Quantizer>();
+  const std::vector<std::vector<float>> features = RandomFeatures();
+  int i = 0;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(quantizer->Quantize(features[i], state.range(0)));
+    i = (i + 1) % kNumRandVectors;
+  }
+}
+
+// Decodes |state.range(0)| quantized bits to features per iteration.
+template <typename Quantizer>
+void BM_DecodeToLossyFeatures(benchmark::State& state) {
+  auto quantizer = CreateQuantizer<Quantizer>();
+  std::vector<std::string> quantized;
+  for (const std::vector<float>& feature_vector : RandomFeatures()) {
+    quantized.push_back(
+        quantizer->Quantize(feature_vector, state.range(0)).value());
+  }
+  int i = 0;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(quantizer->DecodeToLossyFeatures(quantized[i]));
+    i = (i + 1) % kNumRandVectors;
+  }
+}
+
+// Quantizes to code vector indices, which is what LyraEncoder calls.
+template <typename Quantizer>
+void BM_QuantizeToIndices(benchmark::State& state) {
+  auto quantizer = CreateQuantizer<Quantizer>();
+  const std::vector<std::vector<float>> features = RandomFeatures();
+  std::vector<int> indices(state.range(0) / quantizer->bits_per_quantizer());
+  int i = 0;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(quantizer->QuantizeToIndices(
+        features[i], state.range(0), absl::MakeSpan(indices)));
+    i = (i + 1) % kNumRandVectors;
+  }
+}
+
+// Decodes code vector indices, which is what LyraDecoder calls.
+template <typename Quantizer>
+void BM_DecodeIndicesToLossyFeaturesInto(benchmark::State& state) {
+  auto quantizer = CreateQuantizer<Quantizer>();
+  const int num_quantizers = state.range(0) / quantizer->bits_per_quantizer();
+  std::vector<std::vector<int>> indices;
+  for (const std::vector<float>& feature_vector : RandomFeatures()) {
+    indices.emplace_back(num_quantizers);
+    quantizer->QuantizeToIndices(feature_vector, state.range(0),
+                                 absl::MakeSpan(indices.back()));
+  }
+  std::vector<float> features(chromemedia::codec::kNumFeatures);
+  int i = 0;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(quantizer->DecodeIndicesToLossyFeaturesInto(
+        indices[i], absl::MakeSpan(features)));
+    i = (i + 1) % kNumRandVectors;
+  }
+}
+
+void SupportedQuantizedBits(benchmark::internal::Benchmark* benchmark) {
+  benchmark->ArgName("num_quantized_bits");
+  for (int num_quantized_bits :
+       chromemedia::codec::GetSupportedQuantizedBits()) {
+    benchmark->Arg(num_quantized_bits);
+  }
+}
+
+using chromemedia::codec::NativeResidualVectorQuantizer;
+using chromemedia::codec::ResidualVectorQuantizer;
+
+BENCHMARK_TEMPLATE(BM_Quantize, ResidualVectorQuantizer)
+    ->Apply(SupportedQuantizedBits);
+BENCHMARK_TEMPLATE(BM_Quantize, NativeResidualVectorQuantizer)
+    ->Apply(SupportedQuantizedBits);
+BENCHMARK_TEMPLATE(BM_DecodeToLossyFeatures, ResidualVectorQuantizer)
+    ->Apply(SupportedQuantizedBits);
+BENCHMARK_TEMPLATE(BM_DecodeToLossyFeatures, NativeResidualVectorQuantizer)
+    ->Apply(SupportedQuantizedBits);
+BENCHMARK_TEMPLATE(BM_QuantizeToIndices, ResidualVectorQuantizer)
+    ->Apply(SupportedQuantizedBits);
+BENCHMARK_TEMPLATE(BM_QuantizeToIndices, NativeResidualVectorQuantizer)
+    ->Apply(SupportedQuantizedBits);
+BENCHMARK_TEMPLATE(BM_DecodeIndicesToLossyFeaturesInto,
+                   ResidualVectorQuantizer)
+    ->Apply(SupportedQuantizedBits);
+BENCHMARK_TEMPLATE(BM_DecodeIndicesToLossyFeaturesInto,
+                   NativeResidualVectorQuantizer)
+    ->Apply(SupportedQuantizedBits);
+BENCHMARK_MAIN();
@@ -23,6 +23,7 @@
 #include <vector>
 
 // Placeholder for get runfiles header.
+#include "absl/types/span.h"
 #include "gtest/gtest.h"
 #include "include/ghc/filesystem.hpp"
 #include "lyra/log_mel_spectrogram_extractor_impl.h"
@@ -110,6 +111,63 @@ TEST_P(ResidualVectorQuantizerTest, EncodeDecodeResultsInSimilarFeatures) {
   EXPECT_LT(FeatureDistance(decoded_features.value()), 1.11);
 }
 
+TEST_P(ResidualVectorQuantizerTest, IndicesMatchQuantizedBits) {
+  const int bits_per_quantizer = quantizer_->bits_per_quantizer();
+  ASSERT_GT(bits_per_quantizer, 0);
+  std::vector<int> indices(num_quantized_bits_ / bits_per_quantizer);
+  ASSERT_TRUE(quantizer_->QuantizeToIndices(features_, num_quantized_bits_,
+                                            absl::MakeSpan(indices)));
+  const auto quantized = quantizer_->Quantize(features_, num_quantized_bits_);
+  ASSERT_TRUE(quantized.has_value());
+  for (int i = 0; i < indices.size(); ++i) {
+    EXPECT_EQ(indices[i], std::stoi(quantized->substr(i * bits_per_quantizer,
+                                                      bits_per_quantizer),
+                                    nullptr, 2));
+  }
+
+  const auto index_features = quantizer_->DecodeIndicesToLossyFeatures(indices);
+  const auto bit_features =
+      quantizer_->DecodeToLossyFeatures(quantized.value());
+  ASSERT_TRUE(index_features.has_value());
+  ASSERT_TRUE(bit_features.has_value());
+  EXPECT_EQ(index_features.value(), bit_features.value());
+}
+
+TEST_P(ResidualVectorQuantizerTest, DecodeIndicesIntoMatchesDecodeIndices) {
+  std::vector<int> indices(num_quantized_bits_ /
+                           quantizer_->bits_per_quantizer());
+  ASSERT_TRUE(quantizer_->QuantizeToIndices(features_, num_quantized_bits_,
+                                            absl::MakeSpan(indices)));
+  const auto expected_features =
+      quantizer_->DecodeIndicesToLossyFeatures(indices);
+  ASSERT_TRUE(expected_features.has_value());
+
+  std::vector<float> features(features_.size());
+  ASSERT_TRUE(quantizer_->DecodeIndicesToLossyFeaturesInto(
+      indices, absl::MakeSpan(features)));
+  EXPECT_EQ(features, expected_features.value());
+
+  std::vector<float> too_few_features(features_.size() - 1);
+  EXPECT_FALSE(quantizer_->DecodeIndicesToLossyFeaturesInto(
+      indices, absl::MakeSpan(too_few_features)));
+}
+
+TEST_P(ResidualVectorQuantizerTest, QuantizeToIndicesFailsWithWrongIndexCount) {
+  std::vector<int> indices(num_quantized_bits_ /
+                               quantizer_->bits_per_quantizer() +
+                           1);
+  EXPECT_FALSE(quantizer_->QuantizeToIndices(features_, num_quantized_bits_,
+                                             absl::MakeSpan(indices)));
+}
+
+TEST_P(ResidualVectorQuantizerTest, DecodeIndicesFailsWithOutOfRangeIndex) {
+  std::vector<int> indices(num_quantized_bits_ /
+                               quantizer_->bits_per_quantizer(),
+                           0);
+  indices.back() = 1 << quantizer_->bits_per_quantizer();
+  EXPECT_FALSE(quantizer_->DecodeIndicesToLossyFeatures(indices).has_value());
+}
+
 INSTANTIATE_TEST_SUITE_P(NumQuantizedBits, ResidualVectorQuantizerTest,
                          testing::ValuesIn(GetSupportedQuantizedBits()));
 
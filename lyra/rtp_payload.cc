@@ -0,0 +1,298 @@
+// Copyright 2022 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "lyra/rtp_payload.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <vector>
+
+#include "absl/memory/memory.h"
+#include "absl/types/span.h"
+#include "glog/logging.h"  // IWYU pragma: keep
+#include "lyra/lyra_config.h"
+
+namespace chromemedia {
+namespace codec {
+namespace {
+
+constexpr int kRtpVersion = 2;
+constexpr int kRtpHeaderSize = 12;
+
+constexpr uint8_t kTocFollowsBit = 0x80;
+constexpr uint8_t kTocDtxBit = 0x40;
+constexpr uint8_t kTocReservedBits = 0x30;
+constexpr uint8_t kTocQuantizedBitsIndexMask = 0x0F;
+
+int GetHopDurationMs() { return 1000 / kFrameRate; }
+
+void WriteBigEndian16(uint16_t value, uint8_t* bytes) {
+  bytes[0] = value >> 8;
+  bytes[1] = value & 0xFF;
+}
+
+void WriteBigEndian32(uint32_t value, uint8_t* bytes) {
+  WriteBigEndian16(value >> 16, bytes);
+  WriteBigEndian16(value & 0xFFFF, bytes + 2);
+}
+
+uint16_t ReadBigEndian16(const uint8_t* bytes) {
+  return (bytes[0] << 8) | bytes[1];
+}
+
+uint32_t ReadBigEndian32(const uint8_t* bytes) {
+  return (static_cast<uint32_t>(ReadBigEndian16(bytes)) << 16) |
+         ReadBigEndian16(bytes + 2);
+}
+
+// Returns the index into |GetSupportedQuantizedBits()| of packets of
+// |packet_size| bytes, or -1 if no bitrate has packets of that size.
+int PacketSizeToQuantizedBitsIndex(int packet_size) {
+  const std::vector<int>& supported_quantized_bits =
+      GetSupportedQuantizedBits();
+  for (int i = 0; i < supported_quantized_bits.size(); ++i) {
+    if (GetPacketSize(supported_quantized_bits[i]) == packet_size) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+int GetMaxPacketSize() {
+  const std::vector<int>& supported_quantized_bits =
+      GetSupportedQuantizedBits();
+  return GetPacketSize(*std::max_element(supported_quantized_bits.begin(),
+                                         supported_quantized_bits.end()));
+}
+
+}  // namespace
+
+std::unique_ptr<RtpPacketizer> RtpPacketizer::Create(
+    int packet_duration_ms, int clock_rate_hz, uint8_t payload_type,
+    uint32_t ssrc, uint16_t initial_sequence_number,
+    uint32_t initial_timestamp) {
+  if (packet_duration_ms < kMinPacketDurationMs ||
+      packet_duration_ms > kMaxPacketDurationMs ||
+      packet_duration_ms % GetHopDurationMs() != 0) {
+    LOG(ERROR) << "Packet duration of " << packet_duration_ms
+               << " ms is not a multiple of " << GetHopDurationMs()
+               << " ms in [" << kMinPacketDurationMs << ", "
+               << kMaxPacketDurationMs << "].";
+    return nullptr;
+  }
+  if (!IsSampleRateSupported(clock_rate_hz)) {
+    LOG(ERROR) << "RTP clock rate " << clock_rate_hz
+               << " Hz is not a supported sample rate.";
+    return nullptr;
+  }
+  if (payload_type > 127) {
+    LOG(ERROR) << "RTP payload type " << static_cast<int>(payload_type)
+               << " does not fit in 7 bits.";
+    return nullptr;
+  }
+
+  // WrapUnique is used because of private c'tor.
+  return absl::WrapUnique(new RtpPacketizer(
+      packet_duration_ms / GetHopDurationMs(),
+      GetNumSamplesPerHop(clock_rate_hz), payload_type, ssrc,
+      initial_sequence_number, initial_timestamp));
+}
+
+RtpPacketizer::RtpPacketizer(int num_frames_per_packet, int num_samples_per_hop,
+                             uint8_t payload_type, uint32_t ssrc,
+                             uint16_t initial_sequence_number,
+                             uint32_t initial_timestamp)
+    : num_frames_per_packet_(num_frames_per_packet),
+      num_samples_per_hop_(num_samples_per_hop),
+      payload_type_(payload_type),
+      ssrc_(ssrc),
+      sequence_number_(initial_sequence_number),
+      timestamp_(initial_timestamp),
+      marker_(true),
+      toc_(num_frames_per_packet),
+      num_frames_(0),
+      frame_data_(num_frames_per_packet * GetMaxPacketSize()),
+      frame_data_size_(0),
+      rtp_packet_(kRtpHeaderSize + toc_.size() + frame_data_.size()) {}
+
+bool RtpPacketizer::AddFrame(absl::Span<const uint8_t> packet,
+                             const RtpPacketCallback& callback) {
+  if (packet.empty()) {
+    toc_[num_frames_] = kTocDtxBit;
+  } else {
+    const int quantized_bits_index =
+        PacketSizeToQuantizedBitsIndex(packet.size());
+    if (quantized_bits_index < 0) {
+      LOG(ERROR) << "Packet of " << packet.size()
+                 << " bytes is not a Lyra packet.";
+      return false;
+    }
+    toc_[num_frames_] = quantized_bits_index;
+    std::copy(packet.begin(), packet.end(),
+              frame_data_.begin() + frame_data_size_);
+    frame_data_size_ += packet.size();
+  }
+  if (++num_frames_ == num_frames_per_packet_) {
+    Flush(callback);
+  }
+  return true;
+}
+
+void RtpPacketizer::Flush(const RtpPacketCallback& callback) {
+  if (num_frames_ == 0) {
+    return;
+  }
+  const int num_frames = num_frames_;
+  const uint32_t timestamp = timestamp_;
+  num_frames_ = 0;
+  timestamp_ += num_frames * num_samples_per_hop_;
+
+  const bool all_dtx = std::all_of(
+      toc_.begin(), toc_.begin() + num_frames,
+      [](uint8_t toc_entry) { return (toc_entry & kTocDtxBit) != 0; });
+  if (all_dtx) {
+    // Nothing to send; the next packet starts a new talkspurt.
+    marker_ = true;
+    return;
+  }
+
+  uint8_t* bytes = rtp_packet_.data();
+  bytes[0] = kRtpVersion << 6;
+  bytes[1] = (marker_ ? 0x80 : 0) | payload_type_;
+  WriteBigEndian16(sequence_number_, bytes + 2);
+  WriteBigEndian32(timestamp, bytes + 4);
+  WriteBigEndian32(ssrc_, bytes + 8);
+  bytes += kRtpHeaderSize;
+  for (int i = 0; i < num_frames; ++i) {
+    *bytes++ = toc_[i] | (i + 1 < num_frames ? kTocFollowsBit : 0);
+  }
+  bytes = std::copy_n(frame_data_.begin(), frame_data_size_, bytes);
+  frame_data_size_ = 0;
+  ++sequence_number_;
+  marker_ = false;
+
+  callback(absl::MakeConstSpan(rtp_packet_.data(), bytes));
+}
+
+int RtpPacketizer::num_frames_per_packet() const {
+  return num_frames_per_packet_;
+}
+
+int RtpPacketizer::max_rtp_packet_size() const { return rtp_packet_.size(); }
+
+std::unique_ptr<RtpDepacketizer> RtpDepacketizer::Create(int clock_rate_hz) {
+  if (!IsSampleRateSupported(clock_rate_hz)) {
+    LOG(ERROR) << "RTP clock rate " << clock_rate_hz
+               << " Hz is not a supported sample rate.";
+    return nullptr;
+  }
+
+  // WrapUnique is used because of private c'tor.
+  return absl::WrapUnique(
+      new RtpDepacketizer(GetNumSamplesPerHop(clock_rate_hz)));
+}
+
+RtpDepacketizer::RtpDepacketizer(int num_samples_per_hop)
+    : num_samples_per_hop_(num_samples_per_hop) {}
+
+std::optional<RtpHeader> RtpDepacketizer::Depacketize(
+    absl::Span<const uint8_t> rtp_packet, std::vector<RtpFrame>* frames) const {
+  frames->clear();
+  if (rtp_packet.size() < kRtpHeaderSize ||
+      (rtp_packet[0] >> 6) != kRtpVersion) {
+    LOG(ERROR) << "Not an RTP packet.";
+    return std::nullopt;
+  }
+  RtpHeader header;
+  header.marker = (rtp_packet[1] & 0x80) != 0;
+  header.payload_type = rtp_packet[1] & 0x7F;
+  header.sequence_number = ReadBigEndian16(&rtp_packet[2]);
+  header.timestamp = ReadBigEndian32(&rtp_packet[4]);
+  header.ssrc = ReadBigEndian32(&rtp_packet[8]);
+
+  // Skips CSRCs, the header extension and padding, which mixers and
+  // middleboxes may add.
+  const bool has_padding = (rtp_packet[0] & 0x20) != 0;
+  const bool has_extension = (rtp_packet[0] & 0x10) != 0;
+  const int num_csrcs = rtp_packet[0] & 0x0F;
+  int begin = kRtpHeaderSize + 4 * num_csrcs;
+  int end = rtp_packet.size();
+  if (has_extension) {
+    if (begin + 4 > end) {
+      LOG(ERROR) << "RTP header extension is truncated.";
+      return std::nullopt;
+    }
+    begin += 4 + 4 * ReadBigEndian16(&rtp_packet[begin + 2]);
+  }
+  if (has_padding && begin < end) {
+    end -= rtp_packet[end - 1];
+  }
+  if (begin >= end) {
+    LOG(ERROR) << "RTP packet has no payload.";
+    return std::nullopt;
+  }
+
+  // Reads the table of contents, then checks the frame data adds up before
+  // handing out any frames.
+  const int max_num_frames =
+      RtpPacketizer::kMaxPacketDurationMs / GetHopDurationMs();
+  int num_frames = 0;
+  int frame_data_size = 0;
+  bool follows = true;
+  for (; follows; ++num_frames) {
+    if (begin + num_frames >= end || num_frames == max_num_frames) {
+      LOG(ERROR) << "RTP packet has a malformed table of contents.";
+      return std::nullopt;
+    }
+    const uint8_t toc_entry = rtp_packet[begin + num_frames];
+    const int quantized_bits_index = toc_entry & kTocQuantizedBitsIndexMask;
+    if ((toc_entry & kTocReservedBits) != 0 ||
+        ((toc_entry & kTocDtxBit) != 0 && quantized_bits_index != 0) ||
+        quantized_bits_index >= GetSupportedQuantizedBits().size()) {
+      LOG(ERROR) << "RTP packet has an invalid table of contents entry.";
+      return std::nullopt;
+    }
+    if ((toc_entry & kTocDtxBit) == 0) {
+      frame_data_size +=
+          GetPacketSize(GetSupportedQuantizedBits()[quantized_bits_index]);
+    }
+    follows = (toc_entry & kTocFollowsBit) != 0;
+  }
+  if (begin + num_frames + frame_data_size != end) {
+    LOG(ERROR) << "RTP packet has " << end - begin - num_frames
+               << " bytes of frame data but its table of contents lists "
+               << frame_data_size << ".";
+    return std::nullopt;
+  }
+
+  const uint8_t* frame_data = rtp_packet.data() + begin + num_frames;
+  for (int i = 0; i < num_frames; ++i) {
+    const uint8_t toc_entry = rtp_packet[begin + i];
+    int packet_size = 0;
+    if ((toc_entry & kTocDtxBit) == 0) {
+      packet_size = GetPacketSize(
+          GetSupportedQuantizedBits()[toc_entry & kTocQuantizedBitsIndexMask]);
+    }
+    frames->push_back(
+        {header.timestamp + static_cast<uint32_t>(i * num_samples_per_hop_),
+         absl::MakeConstSpan(frame_data, packet_size)});
+    frame_data += packet_size;
+  }
+  return header;
+}
+
+}  // namespace codec
+}  // namespace chromemedia
@@ -0,0 +1,159 @@
+/*
+ * Copyright 2022 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LYRA_RTP_PAYLOAD_H_
+#define LYRA_RTP_PAYLOAD_H_
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <vector>
+
+#include "absl/types/span.h"
+
+namespace chromemedia {
+namespace codec {
+
+// RTP payload format for Lyra.
+//
+// Lyra packets carry no header of their own (|kNumHeaderBits| is 0), so the
+// sequence number, timestamp and bitrate are carried by RTP instead. Each RTP
+// packet (RFC 3550) bundles the packets of one or more consecutive hops:
+//
+//   RTP header | TOC 1 | ... | TOC n | frame 1 | ... | frame n
+//
+// Every frame has a one byte table of contents (TOC) entry:
+//
+//    0 1 2 3 4 5 6 7
+//   +-+-+-+-+-+-+-+-+
+//   |F|D|0 0|   Q   |
+//   +-+-+-+-+-+-+-+-+
+//
+//   F: Another TOC entry follows.
+//   D: The hop was skipped by discontinuous transmission and has no frame
+//      data. Q is 0.
+//   Q: Index into |GetSupportedQuantizedBits()| of the frame's bitrate, which
+//      determines its size. Frames in one RTP packet may differ in bitrate.
+//
+// The RTP timestamp is that of the first frame, and each frame advances it by
+// one hop at the RTP clock rate. RTP packets whose frames were all skipped by
+// discontinuous transmission are not sent, and the marker bit is set on the
+// first packet of every talkspurt.
+
+// Fields of an RTP header, without CSRCs or extensions.
+struct RtpHeader {
+  bool marker;
+  uint8_t payload_type;
+  uint16_t sequence_number;
+  uint32_t timestamp;
+  uint32_t ssrc;
+};
+
+// One frame of a depacketized RTP packet.
+struct RtpFrame {
+  uint32_t timestamp;
+  // Lyra packet of the hop, or empty if the hop was skipped by discontinuous
+  // transmission.
+  absl::Span<const uint8_t> packet;
+};
+
+// Bundles consecutive Lyra packets into RTP packets.
+class RtpPacketizer {
+ public:
+  // Called with each complete RTP packet. |rtp_packet| points into a buffer
+  // owned by the packetizer and is only valid during the call.
+  using RtpPacketCallback =
+      std::function<void(absl::Span<const uint8_t> rtp_packet)>;
+
+  static constexpr int kMinPacketDurationMs = 20;
+  static constexpr int kMaxPacketDurationMs = 120;
+
+  // Returns nullptr if |packet_duration_ms| (the ptime) is not a multiple of
+  // the hop duration in [|kMinPacketDurationMs|, |kMaxPacketDurationMs|], if
+  // |clock_rate_hz| is not a supported sample rate or if |payload_type| does
+  // not fit in 7 bits. RFC 3550 recommends a random |ssrc|,
+  // |initial_sequence_number| and |initial_timestamp|.
+  static std::unique_ptr<RtpPacketizer> Create(int packet_duration_ms,
+                                               int clock_rate_hz,
+                                               uint8_t payload_type,
+                                               uint32_t ssrc,
+                                               uint16_t initial_sequence_number,
+                                               uint32_t initial_timestamp);
+
+  // Adds the Lyra packet of the next hop, which is empty if discontinuous
+  // transmission skipped the hop, and passes the RTP packet to |callback| once
+  // |num_frames_per_packet()| hops have been added. Returns false without
+  // adding the hop if |packet| is neither empty nor the size of a Lyra packet.
+  bool AddFrame(absl::Span<const uint8_t> packet,
+                const RtpPacketCallback& callback);
+
+  // Sends the hops added since the last RTP packet, if any, as a shorter RTP
+  // packet.
+  void Flush(const RtpPacketCallback& callback);
+
+  int num_frames_per_packet() const;
+
+  // Size of the largest RTP packet this packetizer emits.
+  int max_rtp_packet_size() const;
+
+ private:
+  RtpPacketizer(int num_frames_per_packet, int num_samples_per_hop,
+                uint8_t payload_type, uint32_t ssrc,
+                uint16_t initial_sequence_number, uint32_t initial_timestamp);
+
+  const int num_frames_per_packet_;
+  const int num_samples_per_hop_;
+  const uint8_t payload_type_;
+  const uint32_t ssrc_;
+  uint16_t sequence_number_;
+  // Timestamp of the first hop added since the last RTP packet.
+  uint32_t timestamp_;
+  // Whether the next RTP packet starts a talkspurt.
+  bool marker_;
+
+  std::vector<uint8_t> toc_;
+  int num_frames_;
+  // Frame data added since the last RTP packet; only the first
+  // |frame_data_size_| bytes are valid.
+  std::vector<uint8_t> frame_data_;
+  int frame_data_size_;
+  std::vector<uint8_t> rtp_packet_;
+};
+
+// Splits RTP packets in the Lyra payload format back into Lyra packets.
+class RtpDepacketizer {
+ public:
+  // Returns nullptr if |clock_rate_hz| is not a supported sample rate.
+  static std::unique_ptr<RtpDepacketizer> Create(int clock_rate_hz);
+
+  // Parses |rtp_packet| and replaces the contents of |frames| with its frames,
+  // whose packets point into |rtp_packet|. Reusing |frames| across calls
+  // avoids allocations. Returns nullopt if |rtp_packet| is malformed, in
+  // which case |frames| is left empty.
+  std::optional<RtpHeader> Depacketize(absl::Span<const uint8_t> rtp_packet,
+                                       std::vector<RtpFrame>* frames) const;
+
+ private:
+  explicit RtpDepacketizer(int num_samples_per_hop);
+
+  const int num_samples_per_hop_;
+};
+
+}  // namespace codec
+}  // namespace chromemedia
+
+#endif  // LYRA_RTP_PAYLOAD_H_
@@ -0,0 +1,247 @@
+// Copyright 2022 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "lyra/rtp_payload.h"
+
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <vector>
+
+#include "absl/types/span.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "lyra/lyra_config.h"
+
+namespace chromemedia {
+namespace codec {
+namespace {
+
+static constexpr int kClockRateHz = 16000;
+static constexpr int kNumSamplesPerHop = 320;
+static constexpr uint8_t kPayloadType = 96;
+static constexpr uint32_t kSsrc = 0x12345678;
+
+// Returns a Lyra packet of |num_quantized_bits| filled with |value|.
+std::vector<uint8_t> MakePacket(int num_quantized_bits, uint8_t value) {
+  return std::vector<uint8_t>(GetPacketSize(num_quantized_bits), value);
+}
+
+class RtpPayloadTest : public testing::Test {
+ protected:
+  void CreatePacketizer(int packet_duration_ms,
+                        uint16_t initial_sequence_number = 1000,
+                        uint32_t initial_timestamp = 5000) {
+    packetizer_ = RtpPacketizer::Create(packet_duration_ms, kClockRateHz,
+                                        kPayloadType, kSsrc,
+                                        initial_sequence_number,
+                                        initial_timestamp);
+    ASSERT_NE(packetizer_, nullptr);
+  }
+
+  bool AddFrame(absl::Span<const uint8_t> packet) {
+    return packetizer_->AddFrame(packet, [this](absl::Span<const uint8_t> p) {
+      rtp_packets_.emplace_back(p.begin(), p.end());
+    });
+  }
+
+  std::unique_ptr<RtpPacketizer> packetizer_;
+  std::unique_ptr<RtpDepacketizer> depacketizer_ =
+      RtpDepacketizer::Create(kClockRateHz);
+  std::vector<std::vector<uint8_t>> rtp_packets_;
+  std::vector<RtpFrame> frames_;
+};
+
+TEST_F(RtpPayloadTest, CreateFailsWithInvalidArguments) {
+  EXPECT_EQ(RtpPacketizer::Create(0, kClockRateHz, kPayloadType, kSsrc, 0, 0),
+            nullptr);
+  EXPECT_EQ(RtpPacketizer::Create(50, kClockRateHz, kPayloadType, kSsrc, 0, 0),
+            nullptr);
+  EXPECT_EQ(RtpPacketizer::Create(140, kClockRateHz, kPayloadType, kSsrc, 0, 0),
+            nullptr);
+  EXPECT_EQ(RtpPacketizer::Create(20, 44100, kPayloadType, kSsrc, 0, 0),
+            nullptr);
+  EXPECT_EQ(RtpPacketizer::Create(20, kClockRateHz, 128, kSsrc, 0, 0), nullptr);
+  EXPECT_EQ(RtpDepacketizer::Create(44100), nullptr);
+}
+
+TEST_F(RtpPayloadTest, WritesRtpHeaderAndTableOfContents) {
+  CreatePacketizer(20, 0xABCD, 0x01020304);
+  const std::vector<uint8_t> packet =
+      MakePacket(GetSupportedQuantizedBits()[1], 0x55);
+  ASSERT_TRUE(AddFrame(packet));
+
+  ASSERT_EQ(rtp_packets_.size(), 1);
+  // Version 2 with the marker set, sequence number, timestamp, SSRC and a
+  // single TOC entry for the second bitrate.
+  std::vector<uint8_t> expected = {0x80, 0x80 | kPayloadType, 0xAB, 0xCD, 0x01,
+                                   0x02, 0x03, 0x04, 0x12, 0x34, 0x56, 0x78,
+                                   0x01};
+  expected.insert(expected.end(), packet.begin(), packet.end());
+  EXPECT_EQ(rtp_packets_[0], expected);
+}
+
+TEST_F(RtpPayloadTest, AggregatesFramesOfMixedBitrates) {
+  CreatePacketizer(60);
+  const std::vector<int>& quantized_bits = GetSupportedQuantizedBits();
+  std::vector<std::vector<uint8_t>> packets;
+  for (int i = 0; i < 3; ++i) {
+    packets.push_back(MakePacket(quantized_bits[i % quantized_bits.size()], i));
+  }
+  for (const auto& packet : packets) {
+    EXPECT_TRUE(rtp_packets_.empty());
+    ASSERT_TRUE(AddFrame(packet));
+  }
+  ASSERT_EQ(rtp_packets_.size(), 1);
+  EXPECT_LE(rtp_packets_[0].size(), packetizer_->max_rtp_packet_size());
+
+  const std::optional<RtpHeader> header =
+      depacketizer_->Depacketize(rtp_packets_[0], &frames_);
+  ASSERT_TRUE(header.has_value());
+  EXPECT_TRUE(header->marker);
+  EXPECT_EQ(header->payload_type, kPayloadType);
+  EXPECT_EQ(header->sequence_number, 1000);
+  EXPECT_EQ(header->timestamp, 5000);
+  EXPECT_EQ(header->ssrc, kSsrc);
+  ASSERT_EQ(frames_.size(), packets.size());
+  for (int i = 0; i < packets.size(); ++i) {
+    EXPECT_EQ(frames_[i].timestamp, 5000 + i * kNumSamplesPerHop);
+    EXPECT_THAT(frames_[i].packet, testing::ElementsAreArray(packets[i]));
+  }
+}
+
+TEST_F(RtpPayloadTest, MarksDtxFramesAndSkipsSilentPackets) {
+  CreatePacketizer(40);
+  const std::vector<uint8_t> packet =
+      MakePacket(GetSupportedQuantizedBits()[0], 7);
+  // A talkspurt ending in DTX, two hops of silence, then a new talkspurt.
+  for (absl::Span<const uint8_t> frame :
+       {absl::Span<const uint8_t>(packet), absl::Span<const uint8_t>(),
+        absl::Span<const uint8_t>(), absl::Span<const uint8_t>(),
+        absl::Span<const uint8_t>(packet), absl::Span<const uint8_t>(packet)}) {
+    ASSERT_TRUE(AddFrame(frame));
+  }
+  ASSERT_EQ(rtp_packets_.size(), 2);
+
+  std::optional<RtpHeader> header =
+      depacketizer_->Depacketize(rtp_packets_[0], &frames_);
+  ASSERT_TRUE(header.has_value());
+  ASSERT_EQ(frames_.size(), 2);
+  EXPECT_EQ(frames_[0].packet.size(), packet.size());
+  EXPECT_TRUE(frames_[1].packet.empty());
+
+  header = depacketizer_->Depacketize(rtp_packets_[1], &frames_);
+  ASSERT_TRUE(header.has_value());
+  EXPECT_TRUE(header->marker);
+  // Sequence numbers count sent packets, timestamps count hops.
+  EXPECT_EQ(header->sequence_number, 1001);
+  EXPECT_EQ(header->timestamp, 5000 + 4 * kNumSamplesPerHop);
+  EXPECT_EQ(frames_.size(), 2);
+}
+
+TEST_F(RtpPayloadTest, FlushSendsPartialPacket) {
+  CreatePacketizer(120);
+  const std::vector<uint8_t> packet =
+      MakePacket(GetSupportedQuantizedBits()[0], 1);
+  ASSERT_TRUE(AddFrame(packet));
+  ASSERT_TRUE(AddFrame(packet));
+  EXPECT_TRUE(rtp_packets_.empty());
+
+  packetizer_->Flush([this](absl::Span<const uint8_t> p) {
+    rtp_packets_.emplace_back(p.begin(), p.end());
+  });
+  ASSERT_EQ(rtp_packets_.size(), 1);
+  ASSERT_TRUE(depacketizer_->Depacketize(rtp_packets_[0], &frames_));
+  EXPECT_EQ(frames_.size(), 2);
+}
+
+TEST_F(RtpPayloadTest, RejectsFramesThatAreNotLyraPackets) {
+  CreatePacketizer(20);
+  const std::vector<uint8_t> packet(1);
+  EXPECT_FALSE(AddFrame(packet));
+  EXPECT_TRUE(rtp_packets_.empty());
+}
+
+TEST_F(RtpPayloadTest, TimestampAndSequenceNumberWrapAround) {
+  CreatePacketizer(20, 0xFFFF, 0xFFFFFFFF - kNumSamplesPerHop + 1);
+  const std::vector<uint8_t> packet =
+      MakePacket(GetSupportedQuantizedBits()[0], 1);
+  ASSERT_TRUE(AddFrame(packet));
+  ASSERT_TRUE(AddFrame(packet));
+  ASSERT_EQ(rtp_packets_.size(), 2);
+
+  const std::optional<RtpHeader> header =
+      depacketizer_->Depacketize(rtp_packets_[1], &frames_);
+  ASSERT_TRUE(header.has_value());
+  EXPECT_EQ(header->sequence_number, 0);
+  EXPECT_EQ(header->timestamp, 0);
+}
+
+TEST_F(RtpPayloadTest, SkipsCsrcsExtensionAndPadding) {
+  CreatePacketizer(20);
+  const std::vector<uint8_t> packet =
+      MakePacket(GetSupportedQuantizedBits()[2], 9);
+  ASSERT_TRUE(AddFrame(packet));
+  std::vector<uint8_t> rtp_packet = rtp_packets_[0];
+
+  // One CSRC, a one word header extension and three bytes of padding.
+  rtp_packet[0] |= 0x20 | 0x10 | 0x01;
+  const std::vector<uint8_t> csrc_and_extension = {1, 2, 3, 4, 0xBE, 0xDE,
+                                                   0, 1, 5, 6, 7,    8};
+  rtp_packet.insert(rtp_packet.begin() + 12, csrc_and_extension.begin(),
+                    csrc_and_extension.end());
+  rtp_packet.insert(rtp_packet.end(), {0, 0, 3});
+
+  ASSERT_TRUE(depacketizer_->Depacketize(rtp_packet, &frames_));
+  ASSERT_EQ(frames_.size(), 1);
+  EXPECT_THAT(frames_[0].packet, testing::ElementsAreArray(packet));
+}
+
+TEST_F(RtpPayloadTest, RejectsMalformedPackets) {
+  CreatePacketizer(40);
+  const std::vector<uint8_t> packet =
+      MakePacket(GetSupportedQuantizedBits()[0], 3);
+  ASSERT_TRUE(AddFrame(packet));
+  ASSERT_TRUE(AddFrame(packet));
+  const std::vector<uint8_t>& valid = rtp_packets_[0];
+  ASSERT_TRUE(depacketizer_->Depacketize(valid, &frames_));
+
+  // Too short for a header.
+  EXPECT_FALSE(depacketizer_->Depacketize(
+      absl::MakeConstSpan(valid).first(11), &frames_));
+  // Wrong RTP version.
+  std::vector<uint8_t> malformed = valid;
+  malformed[0] = 0x40;
+  EXPECT_FALSE(depacketizer_->Depacketize(malformed, &frames_));
+  // Frame data is truncated.
+  EXPECT_FALSE(depacketizer_->Depacketize(
+      absl::MakeConstSpan(valid).first(valid.size() - 1), &frames_));
+  // Table of contents runs past the end.
+  malformed = std::vector<uint8_t>(valid.begin(), valid.begin() + 13);
+  malformed[12] |= 0x80;
+  EXPECT_FALSE(depacketizer_->Depacketize(malformed, &frames_));
+  // Reserved bits are set.
+  malformed = valid;
+  malformed[12] |= 0x10;
+  EXPECT_FALSE(depacketizer_->Depacketize(malformed, &frames_));
+  // Unknown bitrate.
+  malformed = valid;
+  malformed[13] |= 0x0F;
+  EXPECT_FALSE(depacketizer_->Depacketize(malformed, &frames_));
+  EXPECT_TRUE(frames_.empty());
+}
+
+}  // namespace
+}  // namespace codec
+}  // namespace chromemedia
@@ -28,20 +28,30 @@
 #include "glog/logging.h"  // IWYU pragma: keep
 #include "include/ghc/filesystem.hpp"
 #include "lyra/dsp_utils.h"
+#include "lyra/tflite_model_options.h"
 #include "lyra/tflite_model_wrapper.h"
+#include "lyra/tracing.h"
 
 namespace chromemedia {
 namespace codec {
 
 std::unique_ptr<SoundStreamEncoder> SoundStreamEncoder::Create(
-    const ghc::filesystem::path& model_path) {
+    const ghc::filesystem::path& model_path,
+    const TfLiteModelOptions& model_options) {
   auto model =
       TfLiteModelWrapper::Create(model_path / "soundstream_encoder.tflite",
-                                 /*use_xnn=*/true, /*int8_quantized=*/true);
+                                 model_options.use_xnnpack,
+                                 /*int8_quantized=*/true,
+                                 model_options.use_weights_cache,
+                                 model_options.threading);
   if (model == nullptr) {
     LOG(ERROR) << "Unable to create SoundStream encoder TFLite model wrapper.";
     return nullptr;
   }
+  if (model_options.warm_up && !model->WarmUp()) {
+    LOG(ERROR) << "Unable to warm up SoundStream encoder TFLite model wrapper.";
+    return nullptr;
+  }
   return absl::WrapUnique(new SoundStreamEncoder(std::move(model)));
 }
 
@@ -52,15 +62,32 @@ SoundStreamEncoder::SoundStreamEncoder(
 
 std::optional<std::vector<float>> SoundStreamEncoder::Extract(
     const absl::Span<const int16_t> audio) {
+  std::vector<float> features(model_->get_output_tensor<float>(0).size());
+  if (!ExtractInto(audio, absl::MakeSpan(features))) {
+    return std::nullopt;
+  }
+  return features;
+}
+
+bool SoundStreamEncoder::ExtractInto(const absl::Span<const int16_t> audio,
+                                     absl::Span<float> features) {
+  LYRA_TRACE_SCOPE("SoundStreamEncoder::ExtractInto");
+  if (features.size() != model_->get_output_tensor<float>(0).size()) {
+    LOG(ERROR) << "Expected space for "
+               << model_->get_output_tensor<float>(0).size()
+               << " features but got " << features.size() << ".";
+    return false;
+  }
   absl::Span<float> input = model_->get_input_tensor<float>(0);
   std::transform(audio.begin(), audio.end(), input.begin(),
                  Int16ToUnitScalar<float>);
   if (!model_->Invoke()) {
     LOG(ERROR) << "Unable to invoke SoundStream encoder TFLite model wrapper.";
-    return std::nullopt;
+    return false;
   }
   absl::Span<const float> output = model_->get_output_tensor<float>(0);
-  return std::vector<float>(output.begin(), output.end());
+  std::copy(output.begin(), output.end(), features.begin());
+  return true;
 }
 
 }  // namespace codec
@@ -25,6 +25,7 @@
 #include "absl/types/span.h"
 #include "include/ghc/filesystem.hpp"
 #include "lyra/feature_extractor_interface.h"
+#include "lyra/tflite_model_options.h"
 #include "lyra/tflite_model_wrapper.h"
 
 namespace chromemedia {
@@ -36,7 +37,8 @@ class SoundStreamEncoder : public FeatureExtractorInterface {
  public:
   // Returns a nullptr on failure.
   static std::unique_ptr<SoundStreamEncoder> Create(
-      const ghc::filesystem::path& model_path);
+      const ghc::filesystem::path& model_path,
+      const TfLiteModelOptions& model_options = TfLiteModelOptions());
 
   ~SoundStreamEncoder() override {}
 
@@ -44,6 +46,11 @@ class SoundStreamEncoder : public FeatureExtractorInterface {
   std::optional<std::vector<float>> Extract(
       const absl::Span<const int16_t> audio) override;
 
+  // Same as |Extract|, but writes into |features|, which must have one
+  // element per model output. Does not allocate.
+  bool ExtractInto(const absl::Span<const int16_t> audio,
+                   absl::Span<float> features) override;
+
  private:
   explicit SoundStreamEncoder(std::unique_ptr<TfLiteModelWrapper> model);
 
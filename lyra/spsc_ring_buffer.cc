@@ -0,0 +1,75 @@
+// Copyright 2022 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "lyra/spsc_ring_buffer.h"
+
+#include <algorithm>
+#include <atomic>
+#include <climits>
+#include <cstdint>
+
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+
+#if defined(__linux__)
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+#endif
+
+namespace chromemedia {
+namespace codec {
+namespace internal {
+
+static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t),
+              "A futex word has to be a plain 32 bit integer.");
+
+#if defined(__linux__)
+
+void WaitWhileEqual(std::atomic<uint32_t>* word, uint32_t expected,
+                    absl::Duration timeout) {
+  if (timeout == absl::InfiniteDuration()) {
+    syscall(SYS_futex, reinterpret_cast<uint32_t*>(word), FUTEX_WAIT_PRIVATE,
+            expected, nullptr, nullptr, 0);
+    return;
+  }
+  const timespec relative_timeout = absl::ToTimespec(timeout);
+  syscall(SYS_futex, reinterpret_cast<uint32_t*>(word), FUTEX_WAIT_PRIVATE,
+          expected, &relative_timeout, nullptr, 0);
+}
+
+void WakeAll(std::atomic<uint32_t>* word) {
+  syscall(SYS_futex, reinterpret_cast<uint32_t*>(word), FUTEX_WAKE_PRIVATE,
+          INT_MAX, nullptr, nullptr, 0);
+}
+
+#else
+
+// Without futexes, waiters poll at a fine granularity instead.
+void WaitWhileEqual(std::atomic<uint32_t>* word, uint32_t expected,
+                    absl::Duration timeout) {
+  const absl::Duration kPollInterval = absl::Microseconds(200);
+  if (word->load(std::memory_order_acquire) == expected) {
+    absl::SleepFor(std::min(timeout, kPollInterval));
+  }
+}
+
+void WakeAll(std::atomic<uint32_t>* word) {}
+
+#endif
+
+}  // namespace internal
+}  // namespace codec
+}  // namespace chromemedia
@@ -0,0 +1,254 @@
+/*
+ * Copyright 2022 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LYRA_SPSC_RING_BUFFER_H_
+#define LYRA_SPSC_RING_BUFFER_H_
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+#include "absl/base/optimization.h"
+#include "absl/memory/memory.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "absl/types/span.h"
+#include "glog/logging.h"  // IWYU pragma: keep
+
+namespace chromemedia {
+namespace codec {
+namespace internal {
+
+// Blocks while |*word| equals |expected|, until woken by |WakeAll| or until
+// |timeout| expires. May return spuriously. Uses a futex on Linux and falls
+// back to a short sleep elsewhere.
+void WaitWhileEqual(std::atomic<uint32_t>* word, uint32_t expected,
+                    absl::Duration timeout);
+
+// Wakes every thread blocked in |WaitWhileEqual| on |word|.
+void WakeAll(std::atomic<uint32_t>* word);
+
+}  // namespace internal
+
+// A bounded lock-free queue between exactly one producer thread and one
+// consumer thread, such as a network thread handing packets to a decoder
+// thread, or a decoder thread handing PCM to an audio device callback.
+//
+// |Write| and |Read| never block and never take a lock, so they are safe to
+// call from a realtime audio callback. They only enter the kernel to wake the
+// other side if it is blocked in |WaitForSpace| or |WaitForItems|.
+//
+// Items are copied in and out with memcpy semantics, so |T| is either a sample
+// type or a fixed-size struct such as a packet slot.
+template <typename T>
+class SpscRingBuffer {
+  static_assert(std::is_trivially_copyable<T>::value,
+                "SpscRingBuffer items must be trivially copyable.");
+
+ public:
+  // Creates a buffer holding at least |min_capacity| items; the capacity is
+  // rounded up to a power of two. Returns nullptr if |min_capacity| is not in
+  // [1, 2^30].
+  static std::unique_ptr<SpscRingBuffer<T>> Create(int min_capacity) {
+    if (min_capacity < 1 || min_capacity > (1 << 30)) {
+      LOG(ERROR) << "Capacity of a ring buffer must be in [1, 2^30] but was "
+                 << min_capacity << ".";
+      return nullptr;
+    }
+    uint32_t capacity = 1;
+    while (capacity < min_capacity) {
+      capacity <<= 1;
+    }
+    // WrapUnique is used because of private c'tor.
+    return absl::WrapUnique(new SpscRingBuffer<T>(capacity));
+  }
+
+  // Producer side. Copies as many of |items| as fit and returns how many were
+  // copied.
+  int Write(absl::Span<const T> items) {
+    const uint32_t write_index = write_index_.load(std::memory_order_relaxed);
+    uint32_t free = capacity_ - (write_index - cached_read_index_);
+    if (free < items.size()) {
+      cached_read_index_ = read_index_.load(std::memory_order_acquire);
+      free = capacity_ - (write_index - cached_read_index_);
+    }
+    const uint32_t num_items = std::min<uint32_t>(free, items.size());
+    if (num_items == 0) {
+      return 0;
+    }
+    const uint32_t begin = write_index & mask_;
+    const uint32_t num_before_wrap = std::min(num_items, capacity_ - begin);
+    std::copy_n(items.begin(), num_before_wrap, items_.begin() + begin);
+    std::copy_n(items.begin() + num_before_wrap, num_items - num_before_wrap,
+                items_.begin());
+    // Sequentially consistent so that it is ordered before the check of
+    // |consumer_waiting_|; see |Wait|.
+    write_index_.store(write_index + num_items, std::memory_order_seq_cst);
+    Notify(consumer_waiting_, items_signal_);
+    return num_items;
+  }
+
+  // Consumer side. Copies up to |items.size()| items into |items| and returns
+  // how many were copied.
+  int Read(absl::Span<T> items) {
+    const uint32_t read_index = read_index_.load(std::memory_order_relaxed);
+    uint32_t available = cached_write_index_ - read_index;
+    if (available < items.size()) {
+      cached_write_index_ = write_index_.load(std::memory_order_acquire);
+      available = cached_write_index_ - read_index;
+    }
+    const uint32_t num_items = std::min<uint32_t>(available, items.size());
+    if (num_items == 0) {
+      return 0;
+    }
+    const uint32_t begin = read_index & mask_;
+    const uint32_t num_before_wrap = std::min(num_items, capacity_ - begin);
+    std::copy_n(items_.begin() + begin, num_before_wrap, items.begin());
+    std::copy_n(items_.begin(), num_items - num_before_wrap,
+                items.begin() + num_before_wrap);
+    read_index_.store(read_index + num_items, std::memory_order_seq_cst);
+    Notify(producer_waiting_, space_signal_);
+    return num_items;
+  }
+
+  // Producer side. Blocks until at least |num_items| items can be written.
+  // Returns false on timeout, if the buffer was closed or if |num_items|
+  // exceeds the capacity.
+  bool WaitForSpace(int num_items,
+                    absl::Duration timeout = absl::InfiniteDuration()) {
+    if (num_items > capacity()) {
+      return false;
+    }
+    return Wait(producer_waiting_, space_signal_, timeout, [this, num_items] {
+      return !closed() && capacity() - size() >= num_items;
+    });
+  }
+
+  // Consumer side. Blocks until at least |num_items| items can be read.
+  // Returns false on timeout, if |num_items| exceeds the capacity, or if the
+  // buffer was closed and fewer items remain, so that a consumer can drain the
+  // buffer after the producer closed it.
+  bool WaitForItems(int num_items,
+                    absl::Duration timeout = absl::InfiniteDuration()) {
+    if (num_items > capacity()) {
+      return false;
+    }
+    return Wait(consumer_waiting_, items_signal_, timeout,
+                [this, num_items] { return size() >= num_items; });
+  }
+
+  // Wakes both sides and makes every later wait return without blocking. May
+  // be called from any thread.
+  void Close() {
+    closed_.store(true, std::memory_order_seq_cst);
+    items_signal_.fetch_add(1, std::memory_order_seq_cst);
+    space_signal_.fetch_add(1, std::memory_order_seq_cst);
+    internal::WakeAll(&items_signal_);
+    internal::WakeAll(&space_signal_);
+  }
+
+  bool closed() const { return closed_.load(std::memory_order_acquire); }
+
+  // Number of items that can be read. While the other side is active this is
+  // only a snapshot.
+  int size() const {
+    return write_index_.load(std::memory_order_acquire) -
+           read_index_.load(std::memory_order_acquire);
+  }
+
+  int capacity() const { return capacity_; }
+
+ private:
+  explicit SpscRingBuffer(uint32_t capacity)
+      : capacity_(capacity),
+        mask_(capacity - 1),
+        items_(capacity),
+        write_index_(0),
+        cached_read_index_(0),
+        producer_waiting_(false),
+        space_signal_(0),
+        read_index_(0),
+        cached_write_index_(0),
+        consumer_waiting_(false),
+        items_signal_(0),
+        closed_(false) {}
+
+  // Wakes the other side after its index moved, if it is waiting.
+  static void Notify(std::atomic<bool>& waiting,
+                     std::atomic<uint32_t>& signal) {
+    if (waiting.load(std::memory_order_seq_cst)) {
+      signal.fetch_add(1, std::memory_order_seq_cst);
+      internal::WakeAll(&signal);
+    }
+  }
+
+  // Blocks until |ready| or |closed()|. The waiter publishes |waiting| before
+  // sampling |signal| and re-checking |ready|, and the notifier moves its
+  // index before checking |waiting|. Either the notifier sees the waiter and
+  // bumps |signal|, which makes the futex wait return at once, or the waiter's
+  // re-check sees the moved index.
+  template <typename Ready>
+  bool Wait(std::atomic<bool>& waiting, std::atomic<uint32_t>& signal,
+            absl::Duration timeout, const Ready& ready) {
+    if (ready()) {
+      return true;
+    }
+    const absl::Time deadline = absl::Now() + timeout;
+    while (true) {
+      waiting.store(true, std::memory_order_seq_cst);
+      const uint32_t signal_value = signal.load(std::memory_order_seq_cst);
+      if (ready() || closed()) {
+        break;
+      }
+      const absl::Duration remaining = deadline - absl::Now();
+      if (remaining <= absl::ZeroDuration()) {
+        break;
+      }
+      internal::WaitWhileEqual(&signal, signal_value, remaining);
+    }
+    waiting.store(false, std::memory_order_relaxed);
+    return ready();
+  }
+
+  const uint32_t capacity_;
+  const uint32_t mask_;
+  std::vector<T> items_;
+
+  // Producer side, on its own cache line to avoid false sharing with the
+  // consumer side.
+  alignas(ABSL_CACHELINE_SIZE) std::atomic<uint32_t> write_index_;
+  // Last value of |read_index_| seen by the producer.
+  uint32_t cached_read_index_;
+  std::atomic<bool> producer_waiting_;
+  std::atomic<uint32_t> space_signal_;
+
+  // Consumer side.
+  alignas(ABSL_CACHELINE_SIZE) std::atomic<uint32_t> read_index_;
+  // Last value of |write_index_| seen by the consumer.
+  uint32_t cached_write_index_;
+  std::atomic<bool> consumer_waiting_;
+  std::atomic<uint32_t> items_signal_;
+
+  alignas(ABSL_CACHELINE_SIZE) std::atomic<bool> closed_;
+};
+
+}  // namespace codec
+}  // namespace chromemedia
+
+#endif  // LYRA_SPSC_RING_BUFFER_H_
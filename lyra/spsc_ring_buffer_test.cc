@@ -0,0 +1,161 @@
+// Copyright 2022 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "lyra/spsc_ring_buffer.h"
+
+#include <array>
+#include <cstdint>
+#include <numeric>
+#include <thread>  // NOLINT(build/c++11)
+#include <vector>
+
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "absl/types/span.h"
+#include "gtest/gtest.h"
+
+namespace chromemedia {
+namespace codec {
+namespace {
+
+struct Packet {
+  int size;
+  std::array<uint8_t, 8> bytes;
+};
+
+TEST(SpscRingBufferTest, CreateFailsWithoutCapacity) {
+  EXPECT_EQ(SpscRingBuffer<int16_t>::Create(0), nullptr);
+}
+
+TEST(SpscRingBufferTest, CapacityIsRoundedUpToPowerOfTwo) {
+  EXPECT_EQ(SpscRingBuffer<int16_t>::Create(1)->capacity(), 1);
+  EXPECT_EQ(SpscRingBuffer<int16_t>::Create(5)->capacity(), 8);
+  EXPECT_EQ(SpscRingBuffer<int16_t>::Create(640)->capacity(), 1024);
+}
+
+TEST(SpscRingBufferTest, WritesOnlyWhatFits) {
+  auto ring_buffer = SpscRingBuffer<int16_t>::Create(8);
+  std::vector<int16_t> samples(10);
+  std::iota(samples.begin(), samples.end(), 0);
+
+  EXPECT_EQ(ring_buffer->Write(samples), 8);
+  EXPECT_EQ(ring_buffer->size(), 8);
+  EXPECT_EQ(ring_buffer->Write(samples), 0);
+
+  std::vector<int16_t> read(10, -1);
+  EXPECT_EQ(ring_buffer->Read(absl::MakeSpan(read)), 8);
+  EXPECT_EQ(ring_buffer->size(), 0);
+  EXPECT_EQ(std::vector<int16_t>(read.begin(), read.begin() + 8),
+            std::vector<int16_t>(samples.begin(), samples.begin() + 8));
+  EXPECT_EQ(ring_buffer->Read(absl::MakeSpan(read)), 0);
+}
+
+TEST(SpscRingBufferTest, PreservesOrderAcrossWrapAround) {
+  auto ring_buffer = SpscRingBuffer<int16_t>::Create(8);
+  int16_t next_written = 0;
+  int16_t next_read = 0;
+  // Chunk sizes that do not divide the capacity move the wrap point around.
+  for (int i = 0; i < 100; ++i) {
+    std::vector<int16_t> chunk(3);
+    std::iota(chunk.begin(), chunk.end(), next_written);
+    ASSERT_EQ(ring_buffer->Write(chunk), 3);
+    next_written += 3;
+
+    std::vector<int16_t> read(3);
+    ASSERT_EQ(ring_buffer->Read(absl::MakeSpan(read)), 3);
+    for (int16_t sample : read) {
+      EXPECT_EQ(sample, next_read++);
+    }
+  }
+}
+
+TEST(SpscRingBufferTest, HoldsFixedSizePackets) {
+  auto ring_buffer = SpscRingBuffer<Packet>::Create(4);
+  const Packet written = {3, {1, 2, 3}};
+  ASSERT_EQ(ring_buffer->Write(absl::MakeConstSpan(&written, 1)), 1);
+
+  Packet read;
+  ASSERT_EQ(ring_buffer->Read(absl::MakeSpan(&read, 1)), 1);
+  EXPECT_EQ(read.size, written.size);
+  EXPECT_EQ(read.bytes, written.bytes);
+}
+
+TEST(SpscRingBufferTest, WaitTimesOut) {
+  auto ring_buffer = SpscRingBuffer<int16_t>::Create(4);
+  EXPECT_FALSE(ring_buffer->WaitForItems(1, absl::Milliseconds(10)));
+
+  const std::vector<int16_t> samples(4);
+  ASSERT_EQ(ring_buffer->Write(samples), 4);
+  EXPECT_TRUE(ring_buffer->WaitForItems(4, absl::Milliseconds(10)));
+  EXPECT_FALSE(ring_buffer->WaitForSpace(1, absl::Milliseconds(10)));
+}
+
+TEST(SpscRingBufferTest, WaitFailsForMoreThanCapacity) {
+  auto ring_buffer = SpscRingBuffer<int16_t>::Create(4);
+  EXPECT_FALSE(ring_buffer->WaitForItems(5));
+  EXPECT_FALSE(ring_buffer->WaitForSpace(5));
+}
+
+TEST(SpscRingBufferTest, CloseWakesBlockedConsumer) {
+  auto ring_buffer = SpscRingBuffer<int16_t>::Create(4);
+  const int16_t sample = 7;
+  ASSERT_EQ(ring_buffer->Write(absl::MakeConstSpan(&sample, 1)), 1);
+
+  std::thread closer([&ring_buffer] {
+    absl::SleepFor(absl::Milliseconds(20));
+    ring_buffer->Close();
+  });
+  // Only one item is available, so this blocks until the buffer is closed.
+  EXPECT_FALSE(ring_buffer->WaitForItems(2));
+  closer.join();
+
+  // Remaining items can still be drained after closing.
+  EXPECT_TRUE(ring_buffer->WaitForItems(1));
+  int16_t read = 0;
+  EXPECT_EQ(ring_buffer->Read(absl::MakeSpan(&read, 1)), 1);
+  EXPECT_EQ(read, sample);
+  EXPECT_FALSE(ring_buffer->WaitForSpace(1));
+}
+
+TEST(SpscRingBufferTest, BlockingProducerAndConsumerTransferEverything) {
+  static constexpr int kNumSamples = 1 << 20;
+  static constexpr int kChunkSize = 96;
+  auto ring_buffer = SpscRingBuffer<int32_t>::Create(256);
+
+  std::thread producer([&ring_buffer] {
+    std::vector<int32_t> chunk(kChunkSize);
+    for (int begin = 0; begin < kNumSamples; begin += kChunkSize) {
+      std::iota(chunk.begin(), chunk.end(), begin);
+      ASSERT_TRUE(ring_buffer->WaitForSpace(kChunkSize));
+      ASSERT_EQ(ring_buffer->Write(chunk), kChunkSize);
+    }
+    ring_buffer->Close();
+  });
+
+  // The consumer reads in a different chunk size than the producer writes.
+  std::vector<int32_t> chunk(160);
+  int32_t expected = 0;
+  while (ring_buffer->WaitForItems(1)) {
+    const int num_read = ring_buffer->Read(absl::MakeSpan(chunk));
+    for (int i = 0; i < num_read; ++i) {
+      ASSERT_EQ(chunk[i], expected++);
+    }
+  }
+  producer.join();
+  EXPECT_EQ(expected, (kNumSamples + kChunkSize - 1) / kChunkSize * kChunkSize);
+}
+
+}  // namespace
+}  // namespace codec
+}  // namespace chromemedia
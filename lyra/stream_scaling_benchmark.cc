@@ -0,0 +1,162 @@
+// Copyright 2022 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "lyra/stream_scaling_benchmark.h"
+
+#ifdef __linux__
+#include <sched.h>
+#endif
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <thread>  // NOLINT(build/c++11)
+#include <vector>
+
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "glog/logging.h"  // IWYU pragma: keep
+#include "lyra/latency_histogram.h"
+
+namespace chromemedia {
+namespace codec {
+namespace {
+
+// Gives the threads time to be spawned before the first hop is due.
+constexpr absl::Duration kStartDelay = absl::Milliseconds(100);
+
+#ifdef __linux__
+void PinToCore(int stream_index) {
+  const int num_cores = std::thread::hardware_concurrency();
+  if (num_cores < 1) {
+    return;
+  }
+  cpu_set_t cpu_set;
+  CPU_ZERO(&cpu_set);
+  CPU_SET(stream_index % num_cores, &cpu_set);
+  if (sched_setaffinity(0, sizeof(cpu_set), &cpu_set) != 0) {
+    LOG(WARNING) << "Could not pin stream " << stream_index << " to core "
+                 << stream_index % num_cores << ".";
+  }
+}
+#endif  // __linux__
+
+struct StreamStats {
+  int64_t num_missed_deadlines = 0;
+  LatencyHistogram latency;
+  bool failed = false;
+};
+
+void RunStream(BenchmarkStream* stream, int64_t num_hops,
+               absl::Time first_due, absl::Duration hop_duration,
+               StreamStats* stats) {
+  for (int64_t hop = 0; hop < num_hops; ++hop) {
+    const absl::Time due = first_due + hop * hop_duration;
+    const absl::Duration wait = due - absl::Now();
+    if (wait > absl::ZeroDuration()) {
+      absl::SleepFor(wait);
+    }
+    if (!stream->ProcessHop(hop)) {
+      stats->failed = true;
+      return;
+    }
+    const absl::Duration latency = absl::Now() - due;
+    stats->latency.Record(absl::ToInt64Microseconds(latency));
+    if (latency > hop_duration) {
+      ++stats->num_missed_deadlines;
+    }
+  }
+}
+
+}  // namespace
+
+double StreamScalingResult::missed_deadline_rate() const {
+  return num_hops == 0 ? 0.0
+                       : static_cast<double>(num_missed_deadlines) / num_hops;
+}
+
+std::optional<StreamScalingResult> RunRealtimeStreams(
+    int num_streams, int64_t num_hops, absl::Duration hop_duration,
+    bool pin_threads, const BenchmarkStreamFactory& create_stream) {
+  if (num_streams < 1 || num_hops < 1 || hop_duration <= absl::ZeroDuration()) {
+    LOG(ERROR) << "Need at least 1 stream of at least 1 hop, but got "
+               << num_streams << " streams of " << num_hops << " hops of "
+               << hop_duration << ".";
+    return std::nullopt;
+  }
+  // Created up front, so that loading models does not count against the
+  // deadlines.
+  std::vector<std::unique_ptr<BenchmarkStream>> streams;
+  for (int i = 0; i < num_streams; ++i) {
+    streams.push_back(create_stream(i));
+    if (streams.back() == nullptr) {
+      LOG(ERROR) << "Could not create stream " << i << ".";
+      return std::nullopt;
+    }
+  }
+
+#ifndef __linux__
+  if (pin_threads) {
+    LOG(WARNING) << "Pinning threads is only supported on Linux.";
+  }
+#endif  // __linux__
+
+  std::vector<StreamStats> stats(num_streams);
+  std::vector<std::thread> threads;
+  const absl::Time start = absl::Now() + kStartDelay;
+  for (int i = 0; i < num_streams; ++i) {
+    threads.emplace_back([&, i]() {
+#ifdef __linux__
+      if (pin_threads) {
+        PinToCore(i);
+      }
+#endif  // __linux__
+      RunStream(streams[i].get(), num_hops,
+                start + hop_duration * i / num_streams, hop_duration,
+                &stats[i]);
+    });
+  }
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+
+  StreamScalingResult result;
+  result.num_streams = num_streams;
+  for (int i = 0; i < num_streams; ++i) {
+    if (stats[i].failed) {
+      LOG(ERROR) << "Stream " << i << " failed.";
+      return std::nullopt;
+    }
+    result.num_hops += stats[i].latency.num_values();
+    result.num_missed_deadlines += stats[i].num_missed_deadlines;
+    result.latency.Merge(stats[i].latency);
+  }
+  return result;
+}
+
+std::vector<int> DefaultStreamCounts(int num_cpus) {
+  num_cpus = std::max(num_cpus, 1);
+  std::vector<int> num_streams = {num_cpus, 2 * num_cpus};
+  for (int n = 1; n < 2 * num_cpus; n *= 2) {
+    num_streams.push_back(n);
+  }
+  std::sort(num_streams.begin(), num_streams.end());
+  num_streams.erase(std::unique(num_streams.begin(), num_streams.end()),
+                    num_streams.end());
+  return num_streams;
+}
+
+}  // namespace codec
+}  // namespace chromemedia
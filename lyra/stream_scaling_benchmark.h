@@ -0,0 +1,76 @@
+/*
+ * Copyright 2022 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LYRA_STREAM_SCALING_BENCHMARK_H_
+#define LYRA_STREAM_SCALING_BENCHMARK_H_
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <vector>
+
+#include "absl/time/time.h"
+#include "lyra/latency_histogram.h"
+
+namespace chromemedia {
+namespace codec {
+
+// One stream of a scaling benchmark, like a call that is encoded and decoded.
+class BenchmarkStream {
+ public:
+  virtual ~BenchmarkStream() = default;
+
+  // Processes the hop of |hop_index|. Returns false on failure.
+  virtual bool ProcessHop(int64_t hop_index) = 0;
+};
+
+// Creates the stream of |stream_index|, or returns nullptr on failure.
+using BenchmarkStreamFactory =
+    std::function<std::unique_ptr<BenchmarkStream>(int stream_index)>;
+
+struct StreamScalingResult {
+  int num_streams = 0;
+  int64_t num_hops = 0;
+  // Hops that were not processed before the next hop of their stream was due.
+  int64_t num_missed_deadlines = 0;
+  // Microseconds from a hop being due until it was processed, over all hops of
+  // all streams.
+  LatencyHistogram latency;
+
+  double missed_deadline_rate() const;
+};
+
+// Runs |num_streams| streams on a thread each for |num_hops| hops, simulating
+// audio that arrives in real time: hop i of a stream is due |i| *
+// |hop_duration| after the start and has to be processed before the next hop
+// is due. The streams start evenly spread over the first hop, so that they do
+// not all wake at once. A late hop is processed right away, so an overloaded
+// stream falls further behind, as a real one would. If |pin_threads| is true,
+// stream i runs on core i modulo the number of cores, where supported.
+// Returns nullopt if a stream cannot be created or fails.
+std::optional<StreamScalingResult> RunRealtimeStreams(
+    int num_streams, int64_t num_hops, absl::Duration hop_duration,
+    bool pin_threads, const BenchmarkStreamFactory& create_stream);
+
+// Numbers of streams to sweep on |num_cpus| cores: powers of two up to twice
+// |num_cpus|, plus |num_cpus| itself.
+std::vector<int> DefaultStreamCounts(int num_cpus);
+
+}  // namespace codec
+}  // namespace chromemedia
+
+#endif  // LYRA_STREAM_SCALING_BENCHMARK_H_
@@ -0,0 +1,118 @@
+// Copyright 2022 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "lyra/stream_scaling_benchmark.h"
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <vector>
+
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "gtest/gtest.h"
+
+namespace chromemedia {
+namespace codec {
+namespace {
+
+// Busy waits for a fixed time per hop, as if it were encoding.
+class FakeStream : public BenchmarkStream {
+ public:
+  FakeStream(absl::Duration processing_time, int64_t failing_hop)
+      : processing_time_(processing_time), failing_hop_(failing_hop) {}
+
+  bool ProcessHop(int64_t hop_index) override {
+    const absl::Time end = absl::Now() + processing_time_;
+    while (absl::Now() < end) {
+    }
+    return hop_index != failing_hop_;
+  }
+
+ private:
+  const absl::Duration processing_time_;
+  const int64_t failing_hop_;
+};
+
+BenchmarkStreamFactory FakeStreams(absl::Duration processing_time,
+                                   int64_t failing_hop = -1) {
+  return [=](int stream_index) {
+    return std::make_unique<FakeStream>(processing_time, failing_hop);
+  };
+}
+
+TEST(StreamScalingBenchmarkTest, FastStreamsMeetDeadlines) {
+  const std::optional<StreamScalingResult> result = RunRealtimeStreams(
+      /*num_streams=*/2, /*num_hops=*/10, absl::Milliseconds(20),
+      /*pin_threads=*/true, FakeStreams(absl::Microseconds(100)));
+  ASSERT_TRUE(result.has_value());
+  EXPECT_EQ(result->num_streams, 2);
+  EXPECT_EQ(result->num_hops, 20);
+  EXPECT_EQ(result->latency.num_values(), 20);
+  EXPECT_GE(result->latency.min(), 100);
+  EXPECT_EQ(result->num_missed_deadlines, 0);
+  EXPECT_EQ(result->missed_deadline_rate(), 0.0);
+}
+
+TEST(StreamScalingBenchmarkTest, SlowStreamsFallBehind) {
+  // Every hop takes twice as long as the audio it holds, so every hop is late,
+  // and each later than the one before.
+  const std::optional<StreamScalingResult> result = RunRealtimeStreams(
+      /*num_streams=*/1, /*num_hops=*/5, absl::Milliseconds(4),
+      /*pin_threads=*/false, FakeStreams(absl::Milliseconds(8)));
+  ASSERT_TRUE(result.has_value());
+  EXPECT_EQ(result->num_missed_deadlines, 5);
+  EXPECT_EQ(result->missed_deadline_rate(), 1.0);
+  // The last hop is due after 16 ms and done after 40 ms.
+  EXPECT_GE(result->latency.max(), 24000);
+}
+
+TEST(StreamScalingBenchmarkTest, CreatesEveryStream) {
+  std::atomic<int> num_created(0);
+  const std::optional<StreamScalingResult> result = RunRealtimeStreams(
+      /*num_streams=*/3, /*num_hops=*/1, absl::Milliseconds(1),
+      /*pin_threads=*/false, [&](int stream_index) {
+        EXPECT_EQ(stream_index, num_created++);
+        return std::make_unique<FakeStream>(absl::ZeroDuration(), -1);
+      });
+  ASSERT_TRUE(result.has_value());
+  EXPECT_EQ(num_created, 3);
+}
+
+TEST(StreamScalingBenchmarkTest, Failures) {
+  EXPECT_FALSE(RunRealtimeStreams(0, 10, absl::Milliseconds(20), false,
+                                  FakeStreams(absl::ZeroDuration()))
+                   .has_value());
+  EXPECT_FALSE(RunRealtimeStreams(1, 10, absl::ZeroDuration(), false,
+                                  FakeStreams(absl::ZeroDuration()))
+                   .has_value());
+  EXPECT_FALSE(RunRealtimeStreams(2, 10, absl::Milliseconds(1), false,
+                                  [](int) { return nullptr; })
+                   .has_value());
+  EXPECT_FALSE(RunRealtimeStreams(2, 10, absl::Milliseconds(1), false,
+                                  FakeStreams(absl::ZeroDuration(), 3))
+                   .has_value());
+}
+
+TEST(StreamScalingBenchmarkTest, DefaultStreamCounts) {
+  EXPECT_EQ(DefaultStreamCounts(1), (std::vector<int>{1, 2}));
+  EXPECT_EQ(DefaultStreamCounts(4), (std::vector<int>{1, 2, 4, 8}));
+  EXPECT_EQ(DefaultStreamCounts(6), (std::vector<int>{1, 2, 4, 6, 8, 12}));
+  EXPECT_EQ(DefaultStreamCounts(0), (std::vector<int>{1, 2}));
+}
+
+}  // namespace
+}  // namespace codec
+}  // namespace chromemedia
@@ -17,10 +17,12 @@
 #ifndef LYRA_TESTING_MOCK_GENERATIVE_MODEL_H_
 #define LYRA_TESTING_MOCK_GENERATIVE_MODEL_H_
 
+#include <algorithm>
 #include <cstdint>
 #include <optional>
 #include <vector>
 
+#include "absl/types/span.h"
 #include "gmock/gmock.h"
 #include "lyra/generative_model_interface.h"
 
@@ -44,8 +46,9 @@ class FakeGenerativeModel : public GenerativeModel {
     return true;
   }
 
-  std::optional<std::vector<int16_t>> RunModel(int num_samples) override {
-    return std::vector<int16_t>(num_samples, sample_value_);
+  bool RunModel(absl::Span<int16_t> samples) override {
+    std::fill(samples.begin(), samples.end(), sample_value_);
+    return true;
   }
 
  private:
@@ -37,6 +37,8 @@ class MockLyraDecoder : public LyraDecoderInterface {
   MOCK_METHOD(std::optional<std::vector<int16_t>>, DecodeSamples, (int),
               (override));
 
+  MOCK_METHOD(bool, DecodeSamples, (absl::Span<int16_t>), (override));
+
   MOCK_METHOD(int, sample_rate_hz, (), (const, override));
 
   MOCK_METHOD(int, num_channels, (), (const, override));
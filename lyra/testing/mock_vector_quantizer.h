@@ -29,6 +29,14 @@ namespace codec {
 
 class MockVectorQuantizer : public VectorQuantizerInterface {
  public:
+  // Matches the code vector index width of quantizer.tflite.
+  static constexpr int kDefaultBitsPerQuantizer = 4;
+
+  MockVectorQuantizer() {
+    ON_CALL(*this, bits_per_quantizer)
+        .WillByDefault(testing::Return(kDefaultBitsPerQuantizer));
+  }
+
   ~MockVectorQuantizer() override {}
 
   MOCK_METHOD(std::optional<std::string>, Quantize,
@@ -37,6 +45,8 @@ class MockVectorQuantizer : public VectorQuantizerInterface {
 
   MOCK_METHOD(std::optional<std::vector<float>>, DecodeToLossyFeatures,
               (const std::string& quantized_features), (const, override));
+
+  MOCK_METHOD(int, bits_per_quantizer, (), (const, override));
 };
 
 }  // namespace codec
@@ -0,0 +1,49 @@
+/*
+ * Copyright 2022 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LYRA_TFLITE_MODEL_OPTIONS_H_
+#define LYRA_TFLITE_MODEL_OPTIONS_H_
+
+#include "lyra/tflite_threading_options.h"
+
+namespace chromemedia {
+namespace codec {
+
+// How the TFLite models of an encoder or decoder are run.
+struct TfLiteModelOptions {
+  // Runs the feature extractor and the generative model on the XNNPack
+  // delegate. Otherwise every op runs on the builtin kernels, which is slower
+  // but helps to compare against or rule out the delegate. The quantizer
+  // always runs on the builtin kernels.
+  bool use_xnnpack = true;
+
+  // Packs the XNNPack weights of each model once per process and shares them
+  // between all its interpreters. Otherwise every interpreter packs and owns
+  // its own copy.
+  bool use_weights_cache = true;
+
+  // Runs the feature extractor and the generative model once when they are
+  // created and resets their state afterwards, so that the one-time setup of
+  // the kernels is not paid by the first hop of a stream.
+  bool warm_up = false;
+
+  TfLiteThreadingOptions threading;
+};
+
+}  // namespace codec
+}  // namespace chromemedia
+
+#endif  // LYRA_TFLITE_MODEL_OPTIONS_H_
@@ -0,0 +1,102 @@
+// Copyright 2022 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "lyra/tflite_model_registry.h"
+
+#include <memory>
+#include <string>
+#include <system_error>  // NOLINT(build/c++11)
+#include <utility>
+
+#include "absl/synchronization/mutex.h"
+#include "glog/logging.h"  // IWYU pragma: keep
+#include "include/ghc/filesystem.hpp"
+#include "lyra/xnnpack_weights_cache.h"
+#include "tensorflow/lite/model_builder.h"
+
+namespace chromemedia {
+namespace codec {
+
+std::string TfLiteModelRegistry::ModelKey(
+    const ghc::filesystem::path& model_file) {
+  std::error_code error_code;
+  const ghc::filesystem::path canonical =
+      ghc::filesystem::weakly_canonical(model_file, error_code);
+  if (error_code) {
+    return model_file.lexically_normal().string();
+  }
+  return canonical.string();
+}
+
+TfLiteModelRegistry& TfLiteModelRegistry::Get() {
+  // Intentionally leaked so interpreters destroyed during static destruction
+  // never observe a dead registry.
+  static TfLiteModelRegistry* const registry = new TfLiteModelRegistry();
+  return *registry;
+}
+
+std::shared_ptr<const tflite::FlatBufferModel> TfLiteModelRegistry::GetModel(
+    const ghc::filesystem::path& model_file) {
+  absl::MutexLock lock(&mutex_);
+  Entry* entry = GetEntryLocked(model_file);
+  return entry == nullptr ? nullptr : entry->model;
+}
+
+std::shared_ptr<XnnpackWeightsCache> TfLiteModelRegistry::GetWeightsCache(
+    const ghc::filesystem::path& model_file,
+    const tflite::FlatBufferModel* model) {
+  absl::MutexLock lock(&mutex_);
+  auto it = models_.find(ModelKey(model_file));
+  if (it == models_.end() || it->second.model.get() != model) {
+    return nullptr;
+  }
+  Entry* entry = &it->second;
+  if (entry->weights_cache == nullptr) {
+    entry->weights_cache = XnnpackWeightsCache::Create();
+  }
+  return entry->weights_cache;
+}
+
+TfLiteModelRegistry::Entry* TfLiteModelRegistry::GetEntryLocked(
+    const ghc::filesystem::path& model_file) {
+  const std::string key = ModelKey(model_file);
+  auto it = models_.find(key);
+  if (it != models_.end()) {
+    return &it->second;
+  }
+
+  // Building happens under the lock so concurrent first calls for the same
+  // file load it only once.
+  std::shared_ptr<const tflite::FlatBufferModel> model =
+      tflite::FlatBufferModel::BuildFromFile(model_file.c_str());
+  if (model == nullptr) {
+    LOG(ERROR) << "Could not build TFLite FlatBufferModel for file: "
+               << model_file;
+    return nullptr;
+  }
+  return &models_.emplace(key, Entry{std::move(model), nullptr}).first->second;
+}
+
+int TfLiteModelRegistry::num_models() const {
+  absl::MutexLock lock(&mutex_);
+  return models_.size();
+}
+
+void TfLiteModelRegistry::Clear() {
+  absl::MutexLock lock(&mutex_);
+  models_.clear();
+}
+
+}  // namespace codec
+}  // namespace chromemedia
@@ -0,0 +1,90 @@
+/*
+ * Copyright 2022 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LYRA_TFLITE_MODEL_REGISTRY_H_
+#define LYRA_TFLITE_MODEL_REGISTRY_H_
+
+#include <memory>
+#include <string>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/synchronization/mutex.h"
+#include "include/ghc/filesystem.hpp"
+#include "lyra/xnnpack_weights_cache.h"
+#include "tensorflow/lite/model_builder.h"
+
+namespace chromemedia {
+namespace codec {
+
+// Process-wide cache of read-only TFLite flatbuffers, keyed by model path.
+// A flatbuffer is immutable once built, so every interpreter created from the
+// same file can share one copy of the weights and only owns its own tensor
+// arenas. Each model also gets an XNNPack weights cache so that its weights
+// are packed once per process rather than once per interpreter. This class is
+// thread-safe.
+class TfLiteModelRegistry {
+ public:
+  // Returns the registry shared by the whole process.
+  static TfLiteModelRegistry& Get();
+
+  // Maps equivalent spellings of |model_file|, such as relative paths or
+  // symlinks, onto the key the registry stores it under. Other per-model
+  // caches use it too, so that they agree with the registry on which paths
+  // name the same model.
+  static std::string ModelKey(const ghc::filesystem::path& model_file);
+
+  // Returns the flatbuffer for |model_file|, building it on first use.
+  // Returns nullptr if the file could not be loaded.
+  std::shared_ptr<const tflite::FlatBufferModel> GetModel(
+      const ghc::filesystem::path& model_file);
+
+  // Returns the XNNPack weights cache for |model|, which must have been
+  // returned by |GetModel| for |model_file|, creating it on first use.
+  // Returns nullptr if |model| is no longer the registered model for
+  // |model_file|, e.g. after |Clear|.
+  std::shared_ptr<XnnpackWeightsCache> GetWeightsCache(
+      const ghc::filesystem::path& model_file,
+      const tflite::FlatBufferModel* model);
+
+  // Number of distinct models currently held by the registry.
+  int num_models() const;
+
+  // Drops the registry's references. Models stay alive for as long as an
+  // interpreter created from them still holds a reference.
+  void Clear();
+
+ private:
+  // The weights cache is only valid for the exact model instance it was
+  // filled from, so both are kept and dropped together.
+  struct Entry {
+    std::shared_ptr<const tflite::FlatBufferModel> model;
+    std::shared_ptr<XnnpackWeightsCache> weights_cache;
+  };
+
+  TfLiteModelRegistry() = default;
+
+  Entry* GetEntryLocked(const ghc::filesystem::path& model_file)
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+
+  mutable absl::Mutex mutex_;
+  absl::flat_hash_map<std::string, Entry> models_ ABSL_GUARDED_BY(mutex_);
+};
+
+}  // namespace codec
+}  // namespace chromemedia
+
+#endif  // LYRA_TFLITE_MODEL_REGISTRY_H_
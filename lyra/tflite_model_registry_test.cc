@@ -0,0 +1,114 @@
+// Copyright 2022 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "lyra/tflite_model_registry.h"
+
+#include <memory>
+#include <string>
+#include <system_error>  // NOLINT(build/c++11)
+
+// Placeholder for get runfiles header.
+#include "gtest/gtest.h"
+#include "include/ghc/filesystem.hpp"
+#include "lyra/tflite_model_wrapper.h"
+
+namespace chromemedia {
+namespace codec {
+namespace {
+
+class TfLiteModelRegistryTest : public testing::Test {
+ protected:
+  void SetUp() override { TfLiteModelRegistry::Get().Clear(); }
+
+  const ghc::filesystem::path model_path_ =
+      ghc::filesystem::current_path() / "lyra/model_coeffs/lyragan.tflite";
+};
+
+TEST_F(TfLiteModelRegistryTest, InvalidModelFileIsNotCached) {
+  EXPECT_EQ(TfLiteModelRegistry::Get().GetModel("invalid/model/path"),
+            nullptr);
+  EXPECT_EQ(TfLiteModelRegistry::Get().num_models(), 0);
+}
+
+TEST_F(TfLiteModelRegistryTest, SameFileIsLoadedOnce) {
+  auto first = TfLiteModelRegistry::Get().GetModel(model_path_);
+  ASSERT_NE(first, nullptr);
+  auto second = TfLiteModelRegistry::Get().GetModel(
+      model_path_.parent_path() / "." / model_path_.filename());
+  EXPECT_EQ(first.get(), second.get());
+  EXPECT_EQ(TfLiteModelRegistry::Get().num_models(), 1);
+}
+
+TEST_F(TfLiteModelRegistryTest, ModelKeyResolvesRelativePathsAndSymlinks) {
+  const std::string key = TfLiteModelRegistry::ModelKey(model_path_);
+  EXPECT_EQ(TfLiteModelRegistry::ModelKey(
+                ghc::filesystem::path("lyra/model_coeffs/lyragan.tflite")),
+            key);
+
+  const ghc::filesystem::path link =
+      ghc::filesystem::path(testing::TempDir()) / "model_coeffs_link";
+  std::error_code error_code;
+  ghc::filesystem::remove(link, error_code);
+  ghc::filesystem::create_directory_symlink(model_path_.parent_path(), link,
+                                            error_code);
+  ASSERT_FALSE(error_code) << error_code.message();
+  EXPECT_EQ(TfLiteModelRegistry::ModelKey(link / model_path_.filename()), key);
+  ghc::filesystem::remove(link, error_code);
+}
+
+TEST_F(TfLiteModelRegistryTest, WrappersShareOneModel) {
+  auto first_wrapper = TfLiteModelWrapper::Create(model_path_, true, true);
+  auto second_wrapper = TfLiteModelWrapper::Create(model_path_, true, true);
+  ASSERT_NE(first_wrapper, nullptr);
+  ASSERT_NE(second_wrapper, nullptr);
+  EXPECT_EQ(TfLiteModelRegistry::Get().num_models(), 1);
+
+  // Interpreters keep working after the registry lets go of the model.
+  TfLiteModelRegistry::Get().Clear();
+  EXPECT_TRUE(first_wrapper->Invoke());
+  EXPECT_TRUE(second_wrapper->Invoke());
+}
+
+TEST_F(TfLiteModelRegistryTest, WeightsCacheIsSharedAndFinalized) {
+  auto model = TfLiteModelRegistry::Get().GetModel(model_path_);
+  ASSERT_NE(model, nullptr);
+  auto weights_cache =
+      TfLiteModelRegistry::Get().GetWeightsCache(model_path_, model.get());
+  ASSERT_NE(weights_cache, nullptr);
+  EXPECT_FALSE(weights_cache->is_finalized());
+
+  auto first_wrapper = TfLiteModelWrapper::Create(model_path_, true, true);
+  ASSERT_NE(first_wrapper, nullptr);
+  EXPECT_TRUE(weights_cache->is_finalized());
+  auto second_wrapper = TfLiteModelWrapper::Create(model_path_, true, true);
+  ASSERT_NE(second_wrapper, nullptr);
+  EXPECT_EQ(TfLiteModelRegistry::Get().GetWeightsCache(model_path_,
+                                                       model.get()),
+            weights_cache);
+  EXPECT_TRUE(second_wrapper->Invoke());
+}
+
+TEST_F(TfLiteModelRegistryTest, NoWeightsCacheForStaleModel) {
+  auto model = TfLiteModelRegistry::Get().GetModel(model_path_);
+  ASSERT_NE(model, nullptr);
+  TfLiteModelRegistry::Get().Clear();
+  ASSERT_NE(TfLiteModelRegistry::Get().GetModel(model_path_), nullptr);
+  EXPECT_EQ(TfLiteModelRegistry::Get().GetWeightsCache(model_path_,
+                                                       model.get()),
+            nullptr);
+}
+
+}  // namespace
+}  // namespace codec
+}  // namespace chromemedia
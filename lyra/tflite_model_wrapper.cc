@@ -16,30 +16,60 @@
 
 #include "lyra/tflite_model_wrapper.h"
 
+#include <cstring>
+#include <map>
 #include <memory>
+#include <string>
 #include <utility>
 #include <vector>
 
 #include "absl/memory/memory.h"
+#include "absl/time/time.h"
 #include "glog/logging.h"  // IWYU pragma: keep
 #include "include/ghc/filesystem.hpp"
+#include "lyra/tflite_model_registry.h"
+#include "lyra/tflite_op_profile.h"
+#include "lyra/tflite_threading_options.h"
+#include "lyra/tracing.h"
+#include "lyra/xnnpack_weights_cache.h"
 #include "tensorflow/lite/delegates/xnnpack/xnnpack_delegate.h"
+#include "tensorflow/lite/external_cpu_backend_context.h"
 #include "tensorflow/lite/interpreter.h"
 #include "tensorflow/lite/interpreter_builder.h"
 #include "tensorflow/lite/kernels/register.h"
 #include "tensorflow/lite/model_builder.h"
+#include "tensorflow/lite/profiling/buffered_profiler.h"
+#include "tensorflow/lite/schema/schema_generated.h"
 #include "tensorflow/lite/signature_runner.h"
 
 namespace chromemedia {
 namespace codec {
+namespace {
+
+// Delegate kernels are named after their delegate, like
+// "TfLiteXNNPackDelegate".
+std::string OpName(const TfLiteRegistration& registration) {
+  if (registration.custom_name != nullptr) {
+    return registration.custom_name;
+  }
+  return tflite::EnumNameBuiltinOperator(
+      static_cast<tflite::BuiltinOperator>(registration.builtin_code));
+}
+
+}  // namespace
 
 std::unique_ptr<TfLiteModelWrapper> TfLiteModelWrapper::Create(
     const ghc::filesystem::path& model_file, bool use_xnn,
-    bool int8_quantized) {
-  auto model = tflite::FlatBufferModel::BuildFromFile(model_file.c_str());
+    bool int8_quantized, bool use_weights_cache,
+    const TfLiteThreadingOptions& threading_options) {
+  if (threading_options.num_threads < 1) {
+    LOG(ERROR) << "The number of threads has to be positive, but is "
+               << threading_options.num_threads << ".";
+    return nullptr;
+  }
+  std::shared_ptr<const tflite::FlatBufferModel> model =
+      TfLiteModelRegistry::Get().GetModel(model_file);
   if (model == nullptr) {
-    LOG(ERROR) << "Could not build TFLite FlatBufferModel for file: "
-               << model_file;
     return nullptr;
   }
 
@@ -48,7 +78,7 @@ std::unique_ptr<TfLiteModelWrapper> TfLiteModelWrapper::Create(
   tflite::ops::builtin::BuiltinOpResolverWithoutDefaultDelegates resolver;
 
   auto builder = tflite::InterpreterBuilder(*model, resolver);
-  if (builder.SetNumThreads(1) != 0) {
+  if (builder.SetNumThreads(threading_options.num_threads) != 0) {
     LOG(ERROR) << "Failed to SetNumThreads in TFLite interpreter.";
     return nullptr;
   }
@@ -58,23 +88,32 @@ std::unique_ptr<TfLiteModelWrapper> TfLiteModelWrapper::Create(
     LOG(ERROR) << "Could not build TFLite Interpreter for file: " << model_file;
     return nullptr;
   }
+  // Set before any kernel is prepared, since kernels look the context up
+  // then.
+  if (threading_options.cpu_backend_context != nullptr) {
+    interpreter->SetExternalContext(kTfLiteCpuBackendContext,
+                                    threading_options.cpu_backend_context);
+  }
 
   // Start of XNNPack delegate creation.
+  std::shared_ptr<XnnpackWeightsCache> weights_cache;
   if (use_xnn) {
     // Enable XXNPack.
     auto options = TfLiteXNNPackDelegateOptionsDefault();
     // TODO(b/219786261) Remove once XNNPACK is enabled by default.
     options.flags |= TFLITE_XNNPACK_DELEGATE_FLAG_QU8;
-    options.num_threads = 1;
-    auto delegate =
-        std::unique_ptr<TfLiteDelegate, std::function<void(TfLiteDelegate*)> >(
-            TfLiteXNNPackDelegateCreate(&options),
-            &TfLiteXNNPackDelegateDelete);
-    // Allow dynamic tensors.
-    // TODO(b/204470960): Remove this flag once the bug is fixed.
-    delegate->flags |= kTfLiteDelegateFlagsAllowDynamicTensors;
-
-    auto status = interpreter->ModifyGraphWithDelegate(std::move(delegate));
+    options.num_threads = threading_options.num_threads;
+
+    if (use_weights_cache) {
+      weights_cache =
+          TfLiteModelRegistry::Get().GetWeightsCache(model_file, model.get());
+    }
+    TfLiteStatus status;
+    if (weights_cache != nullptr) {
+      status = weights_cache->ApplyDelegate(options, interpreter.get());
+    } else {
+      status = ApplyXnnpackDelegate(options, interpreter.get());
+    }
     if (status == kTfLiteDelegateError) {
       LOG(WARNING) << "Failed to set delegate; continuing without.";
     } else if (status != kTfLiteOk) {
@@ -90,17 +129,109 @@ std::unique_ptr<TfLiteModelWrapper> TfLiteModelWrapper::Create(
     return nullptr;
   }
 
-  return absl::WrapUnique(
-      new TfLiteModelWrapper(std::move(model), std::move(interpreter)));
+  auto wrapper = absl::WrapUnique(new TfLiteModelWrapper(
+      std::move(model), std::move(weights_cache), std::move(interpreter)));
+  if (TfLiteOpProfileRegistry::Get().enabled()) {
+    wrapper->EnableOpProfiling(model_file.filename().string());
+  }
+  return wrapper;
 }
 
 TfLiteModelWrapper::TfLiteModelWrapper(
-    std::unique_ptr<tflite::FlatBufferModel> model,
+    std::shared_ptr<const tflite::FlatBufferModel> model,
+    std::shared_ptr<XnnpackWeightsCache> weights_cache,
     std::unique_ptr<tflite::Interpreter> interpreter)
-    : model_(std::move(model)), interpreter_(std::move(interpreter)) {}
+    : model_(std::move(model)),
+      weights_cache_(std::move(weights_cache)),
+      interpreter_(std::move(interpreter)) {}
 
 bool TfLiteModelWrapper::Invoke() {
-  return interpreter_->Invoke() == kTfLiteOk;
+  LYRA_TRACE_SCOPE("TfLiteModelWrapper::Invoke");
+  if (profiler_ == nullptr) {
+    return interpreter_->Invoke() == kTfLiteOk;
+  }
+  profiler_->StartProfiling();
+  const bool success = interpreter_->Invoke() == kTfLiteOk;
+  RecordOpProfiles();
+  return success;
+}
+
+bool TfLiteModelWrapper::InvokeSignature(tflite::SignatureRunner* runner) {
+  LYRA_TRACE_SCOPE("TfLiteModelWrapper::InvokeSignature");
+  if (profiler_ == nullptr) {
+    return runner->Invoke() == kTfLiteOk;
+  }
+  profiler_->StartProfiling();
+  const bool success = runner->Invoke() == kTfLiteOk;
+  RecordOpProfiles();
+  return success;
+}
+
+void TfLiteModelWrapper::EnableOpProfiling(const std::string& model_name) {
+  model_name_ = model_name;
+  // Signatures other than the primary one run their own subgraph.
+  node_op_names_.resize(interpreter_->subgraphs_size());
+  std::map<std::string, std::pair<int, int>> node_counts;
+  for (int s = 0; s < node_op_names_.size(); ++s) {
+    const tflite::Subgraph& subgraph = *interpreter_->subgraph(s);
+    std::vector<std::string>& op_names = node_op_names_[s];
+    op_names.resize(subgraph.nodes_size());
+    for (int i = 0; i < op_names.size(); ++i) {
+      op_names[i] = OpName(subgraph.node_and_registration(i)->second);
+    }
+
+    // Nodes replaced by a delegate stay in the graph, but only the delegate
+    // kernel which runs them is in the execution plan.
+    for (const int node_index : subgraph.execution_plan()) {
+      const TfLiteNode& node =
+          subgraph.node_and_registration(node_index)->first;
+      ++node_counts[op_names[node_index]].first;
+      if (node.delegate == nullptr) {
+        continue;
+      }
+      const auto* params =
+          static_cast<const TfLiteDelegateParams*>(node.builtin_data);
+      for (int i = 0; i < params->nodes_to_replace->size; ++i) {
+        ++node_counts[op_names[params->nodes_to_replace->data[i]]].second;
+      }
+    }
+  }
+  for (const auto& [op_name, counts] : node_counts) {
+    TfLiteOpProfileRegistry::Get().SetNodeCounts(model_name_, op_name,
+                                                 counts.first, counts.second);
+  }
+
+  // Lyra's models have well below a thousand nodes, but the buffer grows if
+  // needed.
+  profiler_ = std::make_unique<tflite::profiling::BufferedProfiler>(
+      /*max_num_initial_entries=*/1024,
+      /*allow_dynamic_buffer_increase=*/true);
+  interpreter_->SetProfiler(profiler_.get());
+}
+
+void TfLiteModelWrapper::RecordOpProfiles() {
+  profiler_->StopProfiling();
+  for (const tflite::profiling::ProfileEvent* event :
+       profiler_->GetProfileEvents()) {
+    // Operator events carry the node index and, as extra metadata, the index
+    // of the subgraph that ran it.
+    if (event->event_type !=
+            tflite::Profiler::EventType::OPERATOR_INVOKE_EVENT ||
+        event->extra_event_metadata < 0 ||
+        event->extra_event_metadata >= node_op_names_.size()) {
+      continue;
+    }
+    const std::vector<std::string>& op_names =
+        node_op_names_[event->extra_event_metadata];
+    if (event->event_metadata < 0 ||
+        event->event_metadata >= op_names.size()) {
+      continue;
+    }
+    TfLiteOpProfileRegistry::Get().AddInvocation(
+        model_name_, op_names[event->event_metadata],
+        absl::Microseconds(event->elapsed_time));
+  }
+  profiler_->Reset();
 }
 
 tflite::SignatureRunner* TfLiteModelWrapper::GetSignatureRunner(
@@ -112,6 +243,15 @@ bool TfLiteModelWrapper::ResetVariableTensors() {
   return interpreter_->ResetVariableTensors() == kTfLiteOk;
 }
 
+bool TfLiteModelWrapper::WarmUp() {
+  for (const int input : interpreter_->inputs()) {
+    TfLiteTensor* tensor = interpreter_->tensor(input);
+    std::memset(tensor->data.raw, 0, tensor->bytes);
+  }
+  // Bypasses |Invoke| so that the warm-up is not profiled.
+  return interpreter_->Invoke() == kTfLiteOk && ResetVariableTensors();
+}
+
 int TfLiteModelWrapper::num_input_tensors() {
   return interpreter_->inputs().size();
 }
@@ -19,28 +19,54 @@
 
 #include <functional>
 #include <memory>
+#include <string>
+#include <vector>
 
 #include "absl/types/span.h"
 #include "include/ghc/filesystem.hpp"
+#include "lyra/tflite_threading_options.h"
+#include "lyra/xnnpack_weights_cache.h"
 #include "tensorflow/lite/interpreter.h"
 #include "tensorflow/lite/model_builder.h"
+#include "tensorflow/lite/profiling/buffered_profiler.h"
 #include "tensorflow/lite/signature_runner.h"
 
 namespace chromemedia {
 namespace codec {
 
+// Owns a TFLite interpreter for one codec instance. The read-only flatbuffer
+// behind it comes from |TfLiteModelRegistry| and is shared by every wrapper
+// created from the same model file.
 class TfLiteModelWrapper {
  public:
+  // When |use_xnn| and |use_weights_cache| are both set, the XNNPack packed
+  // weights are also shared process-wide, so only the first wrapper created
+  // for |model_file| repacks them.
+  // While op profiling is enabled in |TfLiteOpProfileRegistry|, the wrapper
+  // reports which nodes were delegated and the time of every op it runs
+  // there. Returns nullptr if |threading_options| are invalid.
   static std::unique_ptr<TfLiteModelWrapper> Create(
       const ghc::filesystem::path& model_file, bool use_xnn,
-      bool int8_quantized);
+      bool int8_quantized, bool use_weights_cache = true,
+      const TfLiteThreadingOptions& threading_options =
+          TfLiteThreadingOptions());
 
   bool Invoke();
 
   tflite::SignatureRunner* GetSignatureRunner(const char* signature);
 
+  // Invokes |runner|, which must come from |GetSignatureRunner|. Unlike
+  // calling |runner| directly, the ops it runs are profiled like those of
+  // |Invoke|.
+  bool InvokeSignature(tflite::SignatureRunner* runner);
+
   bool ResetVariableTensors();
 
+  // Invokes the model once on zeroed inputs and resets the variable tensors,
+  // so that lazily initialized kernels are set up before the first real
+  // |Invoke|. Leaves the model in the state it was created in.
+  bool WarmUp();
+
   int num_input_tensors();
 
   int num_output_tensors();
@@ -59,11 +85,30 @@ class TfLiteModelWrapper {
   }
 
  private:
-  TfLiteModelWrapper(std::unique_ptr<tflite::FlatBufferModel> model,
+  TfLiteModelWrapper(std::shared_ptr<const tflite::FlatBufferModel> model,
+                     std::shared_ptr<XnnpackWeightsCache> weights_cache,
                      std::unique_ptr<tflite::Interpreter> interpreter);
 
-  std::unique_ptr<tflite::FlatBufferModel> model_;
+  // Attaches a profiler to |interpreter_| and reports the nodes of each op
+  // type of |model_name|, summed over all of its subgraphs.
+  void EnableOpProfiling(const std::string& model_name);
+
+  // Stops the profiler and reports the time of each op run since it was
+  // started.
+  void RecordOpProfiles();
+
+  // All must outlive |interpreter_|, which references the model's buffers
+  // and, through its delegate, the packed weights, and reports to the
+  // profiler.
+  std::shared_ptr<const tflite::FlatBufferModel> model_;
+  std::shared_ptr<XnnpackWeightsCache> weights_cache_;
+  std::unique_ptr<tflite::profiling::BufferedProfiler> profiler_;
   std::unique_ptr<tflite::Interpreter> interpreter_;
+
+  // Only set while profiling ops. The op name of each node, by subgraph and
+  // node index.
+  std::string model_name_;
+  std::vector<std::vector<std::string>> node_op_names_;
 };
 
 }  // namespace codec
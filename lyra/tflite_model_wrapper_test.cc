@@ -17,6 +17,7 @@
 #include "lyra/tflite_model_wrapper.h"
 
 #include <algorithm>
+#include <cstdint>
 #include <memory>
 #include <string>
 
@@ -24,6 +25,10 @@
 #include "absl/types/span.h"
 #include "gtest/gtest.h"
 #include "include/ghc/filesystem.hpp"
+#include "lyra/tflite_op_profile.h"
+#include "lyra/tflite_threading_options.h"
+#include "tensorflow/lite/external_cpu_backend_context.h"
+#include "tensorflow/lite/signature_runner.h"
 
 namespace chromemedia {
 namespace codec {
@@ -48,6 +53,147 @@ TEST_P(TfLiteModelWrapperTest, CreateSucceedsAndMethodsRun) {
   EXPECT_TRUE(model_wrapper->ResetVariableTensors());
 }
 
+TEST(TfLiteModelWrapperTest, CreateSucceedsWithoutWeightsCache) {
+  auto model_wrapper = TfLiteModelWrapper::Create(
+      ghc::filesystem::current_path() / "lyra/model_coeffs/lyragan.tflite",
+      true, true, /*use_weights_cache=*/false);
+  ASSERT_NE(model_wrapper, nullptr);
+  EXPECT_TRUE(model_wrapper->Invoke());
+}
+
+TEST(TfLiteModelWrapperTest, CreateSucceedsWithMultipleThreads) {
+  TfLiteThreadingOptions threading_options;
+  threading_options.num_threads = 2;
+  auto model_wrapper = TfLiteModelWrapper::Create(
+      ghc::filesystem::current_path() / "lyra/model_coeffs/lyragan.tflite",
+      true, true, /*use_weights_cache=*/true, threading_options);
+  ASSERT_NE(model_wrapper, nullptr);
+  EXPECT_TRUE(model_wrapper->Invoke());
+}
+
+TEST(TfLiteModelWrapperTest, CreateFailsWithInvalidNumThreads) {
+  TfLiteThreadingOptions threading_options;
+  threading_options.num_threads = 0;
+  EXPECT_EQ(TfLiteModelWrapper::Create(
+                ghc::filesystem::current_path() /
+                    "lyra/model_coeffs/lyragan.tflite",
+                true, true, /*use_weights_cache=*/true, threading_options),
+            nullptr);
+}
+
+TEST(TfLiteModelWrapperTest, WrappersShareCpuBackendContext) {
+  tflite::ExternalCpuBackendContext cpu_backend_context;
+  TfLiteThreadingOptions threading_options;
+  threading_options.num_threads = 2;
+  threading_options.cpu_backend_context = &cpu_backend_context;
+  const ghc::filesystem::path model_file =
+      ghc::filesystem::current_path() / "lyra/model_coeffs/lyragan.tflite";
+  for (const bool use_xnn : {false, true}) {
+    auto first_wrapper = TfLiteModelWrapper::Create(
+        model_file, use_xnn, true, /*use_weights_cache=*/true,
+        threading_options);
+    auto second_wrapper = TfLiteModelWrapper::Create(
+        model_file, use_xnn, true, /*use_weights_cache=*/true,
+        threading_options);
+    ASSERT_NE(first_wrapper, nullptr);
+    ASSERT_NE(second_wrapper, nullptr);
+    // Interleaved, but not concurrent, invocations.
+    for (int i = 0; i < 3; ++i) {
+      EXPECT_TRUE(first_wrapper->Invoke());
+      EXPECT_TRUE(second_wrapper->Invoke());
+    }
+  }
+}
+
+TEST(TfLiteModelWrapperTest, WarmUpKeepsOutputsUnchanged) {
+  const ghc::filesystem::path model_file =
+      ghc::filesystem::current_path() / "lyra/model_coeffs/lyragan.tflite";
+  auto warm_wrapper = TfLiteModelWrapper::Create(model_file, true, true);
+  auto cold_wrapper = TfLiteModelWrapper::Create(model_file, true, true);
+  ASSERT_NE(warm_wrapper, nullptr);
+  ASSERT_NE(cold_wrapper, nullptr);
+  ASSERT_TRUE(warm_wrapper->WarmUp());
+
+  for (int i = 0; i < 3; ++i) {
+    for (TfLiteModelWrapper* wrapper :
+         {warm_wrapper.get(), cold_wrapper.get()}) {
+      absl::Span<float> input = wrapper->get_input_tensor<float>(0);
+      std::fill(input.begin(), input.end(), 0.5f);
+      ASSERT_TRUE(wrapper->Invoke());
+    }
+    const absl::Span<const float> warm_output =
+        warm_wrapper->get_output_tensor<float>(0);
+    const absl::Span<const float> cold_output =
+        cold_wrapper->get_output_tensor<float>(0);
+    EXPECT_TRUE(std::equal(warm_output.begin(), warm_output.end(),
+                           cold_output.begin(), cold_output.end()));
+  }
+}
+
+TEST(TfLiteModelWrapperTest, ProfilesOpsWhenEnabled) {
+  TfLiteOpProfileRegistry& registry = TfLiteOpProfileRegistry::Get();
+  registry.Clear();
+  registry.set_enabled(true);
+  auto model_wrapper = TfLiteModelWrapper::Create(
+      ghc::filesystem::current_path() / "lyra/model_coeffs/lyragan.tflite",
+      true, true);
+  registry.set_enabled(false);
+  ASSERT_NE(model_wrapper, nullptr);
+  ASSERT_TRUE(model_wrapper->Invoke());
+  ASSERT_TRUE(model_wrapper->Invoke());
+
+  const auto profiles = registry.GetProfiles();
+  ASSERT_EQ(profiles.count("lyragan.tflite"), 1);
+  int num_delegated_nodes = 0;
+  int64_t num_invocations = 0;
+  for (const TfLiteOpProfile& profile : profiles.at("lyragan.tflite")) {
+    num_delegated_nodes += profile.num_delegated_nodes;
+    num_invocations += profile.num_invocations;
+    // Each node of the execution plan runs once per Invoke.
+    EXPECT_EQ(profile.num_invocations, 2 * profile.num_nodes)
+        << profile.op_name;
+  }
+  EXPECT_GT(num_delegated_nodes, 0);
+  EXPECT_GT(num_invocations, 0);
+  registry.Clear();
+}
+
+TEST(TfLiteModelWrapperTest, ProfilesSignatureOpsWhenEnabled) {
+  TfLiteOpProfileRegistry& registry = TfLiteOpProfileRegistry::Get();
+  registry.Clear();
+  registry.set_enabled(true);
+  auto model_wrapper = TfLiteModelWrapper::Create(
+      ghc::filesystem::current_path() / "lyra/model_coeffs/quantizer.tflite",
+      false, false);
+  registry.set_enabled(false);
+  ASSERT_NE(model_wrapper, nullptr);
+  tflite::SignatureRunner* encode_runner =
+      model_wrapper->GetSignatureRunner("encode");
+  ASSERT_NE(encode_runner, nullptr);
+  ASSERT_EQ(encode_runner->AllocateTensors(), kTfLiteOk);
+  encode_runner->input_tensor("num_quantizers")->data.i32[0] = 1;
+  ASSERT_TRUE(model_wrapper->InvokeSignature(encode_runner));
+
+  const auto profiles = registry.GetProfiles();
+  ASSERT_EQ(profiles.count("quantizer.tflite"), 1);
+  int64_t num_invocations = 0;
+  for (const TfLiteOpProfile& profile : profiles.at("quantizer.tflite")) {
+    num_invocations += profile.num_invocations;
+  }
+  EXPECT_GT(num_invocations, 0);
+  registry.Clear();
+}
+
+TEST(TfLiteModelWrapperTest, DoesNotProfileOpsByDefault) {
+  TfLiteOpProfileRegistry::Get().Clear();
+  auto model_wrapper = TfLiteModelWrapper::Create(
+      ghc::filesystem::current_path() / "lyra/model_coeffs/lyragan.tflite",
+      true, true);
+  ASSERT_NE(model_wrapper, nullptr);
+  ASSERT_TRUE(model_wrapper->Invoke());
+  EXPECT_TRUE(TfLiteOpProfileRegistry::Get().GetProfiles().empty());
+}
+
 INSTANTIATE_TEST_SUITE_P(Int8QuantizedOrNot, TfLiteModelWrapperTest,
                          testing::Bool());
 
@@ -0,0 +1,113 @@
+// Copyright 2022 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "lyra/tflite_op_profile.h"
+
+#include <algorithm>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_format.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/time.h"
+
+namespace chromemedia {
+namespace codec {
+
+TfLiteOpProfileRegistry& TfLiteOpProfileRegistry::Get() {
+  // Intentionally leaked so wrappers destroyed during static destruction
+  // never observe a dead registry.
+  static TfLiteOpProfileRegistry* const registry =
+      new TfLiteOpProfileRegistry();
+  return *registry;
+}
+
+void TfLiteOpProfileRegistry::SetNodeCounts(const std::string& model,
+                                            const std::string& op_name,
+                                            int num_nodes,
+                                            int num_delegated_nodes) {
+  absl::MutexLock lock(&mutex_);
+  TfLiteOpProfile& profile = profiles_[model][op_name];
+  profile.op_name = op_name;
+  profile.num_nodes = num_nodes;
+  profile.num_delegated_nodes = num_delegated_nodes;
+}
+
+void TfLiteOpProfileRegistry::AddInvocation(const std::string& model,
+                                            const std::string& op_name,
+                                            absl::Duration time) {
+  absl::MutexLock lock(&mutex_);
+  TfLiteOpProfile& profile = profiles_[model][op_name];
+  profile.op_name = op_name;
+  ++profile.num_invocations;
+  profile.total_time += time;
+}
+
+std::map<std::string, std::vector<TfLiteOpProfile>>
+TfLiteOpProfileRegistry::GetProfiles() const {
+  absl::MutexLock lock(&mutex_);
+  std::map<std::string, std::vector<TfLiteOpProfile>> profiles;
+  for (const auto& [model, op_profiles] : profiles_) {
+    std::vector<TfLiteOpProfile>& sorted = profiles[model];
+    for (const auto& [op_name, profile] : op_profiles) {
+      sorted.push_back(profile);
+    }
+    // Op types which are never run, like fully delegated ones, come last in
+    // name order.
+    std::stable_sort(sorted.begin(), sorted.end(),
+                     [](const TfLiteOpProfile& a, const TfLiteOpProfile& b) {
+                       return a.total_time > b.total_time;
+                     });
+  }
+  return profiles;
+}
+
+std::string TfLiteOpProfileRegistry::ToString() const {
+  std::string result;
+  for (const auto& [model, profiles] : GetProfiles()) {
+    absl::Duration model_time;
+    for (const TfLiteOpProfile& profile : profiles) {
+      model_time += profile.total_time;
+    }
+    absl::StrAppend(&result, model, ":\n");
+    absl::StrAppendFormat(&result, "%32s %6s %9s %9s %10s %9s %6s\n", "op",
+                          "nodes", "delegated", "calls", "total ms",
+                          "mean us", "share");
+    for (const TfLiteOpProfile& profile : profiles) {
+      absl::StrAppendFormat(
+          &result, "%32s %6d %9d %9d %10.3f %9.2f %5.1f%%\n", profile.op_name,
+          profile.num_nodes, profile.num_delegated_nodes,
+          profile.num_invocations,
+          absl::ToDoubleMilliseconds(profile.total_time),
+          profile.num_invocations > 0
+              ? absl::ToDoubleMicroseconds(profile.total_time) /
+                    profile.num_invocations
+              : 0.0,
+          model_time > absl::ZeroDuration()
+              ? 100.0 * absl::FDivDuration(profile.total_time, model_time)
+              : 0.0);
+    }
+  }
+  return result;
+}
+
+void TfLiteOpProfileRegistry::Clear() {
+  absl::MutexLock lock(&mutex_);
+  profiles_.clear();
+}
+
+}  // namespace codec
+}  // namespace chromemedia
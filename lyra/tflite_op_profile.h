@@ -0,0 +1,98 @@
+/*
+ * Copyright 2022 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LYRA_TFLITE_OP_PROFILE_H_
+#define LYRA_TFLITE_OP_PROFILE_H_
+
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/time.h"
+
+namespace chromemedia {
+namespace codec {
+
+// Time spent in the nodes of one op type of a model, aggregated over the
+// Invokes of all TfLiteModelWrappers of that model while op profiling was
+// enabled.
+struct TfLiteOpProfile {
+  // A builtin op like "CONV_2D", or a delegate kernel like
+  // "TfLiteXNNPackDelegate" which runs a whole partition of the graph.
+  std::string op_name;
+  // Nodes of this op type which run on their own kernel. For a builtin op
+  // these are the ones which fell back from the delegate.
+  int num_nodes = 0;
+  // Nodes of this op type which were replaced by a delegate kernel. Their
+  // time is part of that kernel's.
+  int num_delegated_nodes = 0;
+  int64_t num_invocations = 0;
+  absl::Duration total_time;
+};
+
+// Process-wide collection of the per-op profiles of TfLiteModelWrapper, keyed
+// by model file name. This class is thread-safe.
+class TfLiteOpProfileRegistry {
+ public:
+  // Returns the registry shared by the whole process.
+  static TfLiteOpProfileRegistry& Get();
+
+  // A registry of its own, for tests.
+  TfLiteOpProfileRegistry() = default;
+
+  // Only TfLiteModelWrappers created while profiling is enabled attach the
+  // TFLite profiler, which adds a little overhead to every Invoke.
+  bool enabled() const { return enabled_.load(std::memory_order_relaxed); }
+  void set_enabled(bool enabled) {
+    enabled_.store(enabled, std::memory_order_relaxed);
+  }
+
+  // Sets the number of nodes of |op_name| in |model| which run on their own
+  // kernel and which were delegated. Every wrapper of a model has the same
+  // graph, so the counts are replaced rather than added up.
+  void SetNodeCounts(const std::string& model, const std::string& op_name,
+                     int num_nodes, int num_delegated_nodes);
+
+  // Adds one run of a node of |op_name| in |model| which took |time|.
+  void AddInvocation(const std::string& model, const std::string& op_name,
+                     absl::Duration time);
+
+  // Returns the profiles of each model, the slowest op type first.
+  std::map<std::string, std::vector<TfLiteOpProfile>> GetProfiles() const;
+
+  // Returns a table per model of the time spent in each op type and of which
+  // nodes ran on a delegate versus their own kernel.
+  std::string ToString() const;
+
+  // Drops all profiles, including the node counts of existing wrappers.
+  void Clear();
+
+ private:
+  std::atomic<bool> enabled_{false};
+  mutable absl::Mutex mutex_;
+  // Model file name to op name to profile.
+  std::map<std::string, std::map<std::string, TfLiteOpProfile>> profiles_
+      ABSL_GUARDED_BY(mutex_);
+};
+
+}  // namespace codec
+}  // namespace chromemedia
+
+#endif  // LYRA_TFLITE_OP_PROFILE_H_
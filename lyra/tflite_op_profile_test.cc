@@ -0,0 +1,105 @@
+// Copyright 2022 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "lyra/tflite_op_profile.h"
+
+#include <string>
+
+#include "absl/strings/match.h"
+#include "absl/time/time.h"
+#include "gtest/gtest.h"
+
+namespace chromemedia {
+namespace codec {
+namespace {
+
+TEST(TfLiteOpProfileRegistryTest, DisabledByDefault) {
+  EXPECT_FALSE(TfLiteOpProfileRegistry::Get().enabled());
+  TfLiteOpProfileRegistry registry;
+  EXPECT_FALSE(registry.enabled());
+  registry.set_enabled(true);
+  EXPECT_TRUE(registry.enabled());
+}
+
+TEST(TfLiteOpProfileRegistryTest, AggregatesInvocationsPerModelAndOp) {
+  TfLiteOpProfileRegistry registry;
+  registry.SetNodeCounts("a.tflite", "TfLiteXNNPackDelegate", 2, 0);
+  registry.SetNodeCounts("a.tflite", "CONV_2D", 0, 5);
+  registry.SetNodeCounts("a.tflite", "TANH", 1, 3);
+  registry.AddInvocation("a.tflite", "TfLiteXNNPackDelegate",
+                         absl::Microseconds(30));
+  registry.AddInvocation("a.tflite", "TfLiteXNNPackDelegate",
+                         absl::Microseconds(50));
+  registry.AddInvocation("a.tflite", "TANH", absl::Microseconds(20));
+  registry.AddInvocation("b.tflite", "FULLY_CONNECTED", absl::Microseconds(7));
+
+  const auto profiles = registry.GetProfiles();
+  ASSERT_EQ(profiles.size(), 2);
+  const auto& a = profiles.at("a.tflite");
+  ASSERT_EQ(a.size(), 3);
+  // The slowest op type comes first.
+  EXPECT_EQ(a[0].op_name, "TfLiteXNNPackDelegate");
+  EXPECT_EQ(a[0].num_nodes, 2);
+  EXPECT_EQ(a[0].num_delegated_nodes, 0);
+  EXPECT_EQ(a[0].num_invocations, 2);
+  EXPECT_EQ(a[0].total_time, absl::Microseconds(80));
+  EXPECT_EQ(a[1].op_name, "TANH");
+  EXPECT_EQ(a[1].num_nodes, 1);
+  EXPECT_EQ(a[1].num_delegated_nodes, 3);
+  EXPECT_EQ(a[1].num_invocations, 1);
+  EXPECT_EQ(a[2].op_name, "CONV_2D");
+  EXPECT_EQ(a[2].num_delegated_nodes, 5);
+  EXPECT_EQ(a[2].num_invocations, 0);
+  EXPECT_EQ(profiles.at("b.tflite")[0].total_time, absl::Microseconds(7));
+}
+
+TEST(TfLiteOpProfileRegistryTest, NodeCountsAreReplaced) {
+  TfLiteOpProfileRegistry registry;
+  registry.AddInvocation("a.tflite", "TANH", absl::Microseconds(20));
+  registry.SetNodeCounts("a.tflite", "TANH", 1, 3);
+  registry.SetNodeCounts("a.tflite", "TANH", 1, 3);
+
+  const auto& a = registry.GetProfiles().at("a.tflite");
+  ASSERT_EQ(a.size(), 1);
+  EXPECT_EQ(a[0].num_nodes, 1);
+  EXPECT_EQ(a[0].num_delegated_nodes, 3);
+  EXPECT_EQ(a[0].num_invocations, 1);
+}
+
+TEST(TfLiteOpProfileRegistryTest, ToStringListsEveryOp) {
+  TfLiteOpProfileRegistry registry;
+  EXPECT_EQ(registry.ToString(), "");
+  registry.SetNodeCounts("a.tflite", "CONV_2D", 0, 5);
+  registry.AddInvocation("a.tflite", "TfLiteXNNPackDelegate",
+                         absl::Microseconds(75));
+  registry.AddInvocation("a.tflite", "TANH", absl::Microseconds(25));
+
+  const std::string table = registry.ToString();
+  EXPECT_TRUE(absl::StartsWith(table, "a.tflite:\n")) << table;
+  EXPECT_TRUE(absl::StrContains(table, "delegated")) << table;
+  EXPECT_TRUE(absl::StrContains(table, "CONV_2D")) << table;
+  EXPECT_TRUE(absl::StrContains(table, "75.0%")) << table;
+  EXPECT_TRUE(absl::StrContains(table, "25.0%")) << table;
+}
+
+TEST(TfLiteOpProfileRegistryTest, ClearDropsProfiles) {
+  TfLiteOpProfileRegistry registry;
+  registry.AddInvocation("a.tflite", "TANH", absl::Microseconds(20));
+  registry.Clear();
+  EXPECT_TRUE(registry.GetProfiles().empty());
+}
+
+}  // namespace
+}  // namespace codec
+}  // namespace chromemedia
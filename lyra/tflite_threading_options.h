@@ -0,0 +1,48 @@
+/*
+ * Copyright 2022 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LYRA_TFLITE_THREADING_OPTIONS_H_
+#define LYRA_TFLITE_THREADING_OPTIONS_H_
+
+namespace tflite {
+class ExternalCpuBackendContext;
+}  // namespace tflite
+
+namespace chromemedia {
+namespace codec {
+
+// How the TFLite interpreters of an encoder or decoder use threads.
+struct TfLiteThreadingOptions {
+  // The number of threads each interpreter may use for one Invoke, including
+  // the calling thread. The default of 1 runs everything on the calling
+  // thread, which suits many concurrent real-time streams. More threads speed
+  // up a single stream, like the offline transcoding of a long file.
+  int num_threads = 1;
+
+  // If set, the builtin kernels of every interpreter created with these
+  // options share the threadpool and scratch buffers of this context, instead
+  // of each owning its own. It must outlive the interpreters, and is not
+  // thread-safe, so they must not run concurrently, like the codecs of all
+  // streams served by one thread. Every interpreter sharing it has to use the
+  // same |num_threads|. Ops delegated to XNNPack still run on threads owned
+  // by their delegate.
+  tflite::ExternalCpuBackendContext* cpu_backend_context = nullptr;
+};
+
+}  // namespace codec
+}  // namespace chromemedia
+
+#endif  // LYRA_TFLITE_THREADING_OPTIONS_H_
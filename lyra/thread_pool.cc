@@ -0,0 +1,118 @@
+// Copyright 2022 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "lyra/thread_pool.h"
+
+#include <functional>
+#include <memory>
+#include <thread>  // NOLINT(build/c++11)
+
+#include "absl/memory/memory.h"
+#include "absl/synchronization/mutex.h"
+#include "glog/logging.h"  // IWYU pragma: keep
+
+namespace chromemedia {
+namespace codec {
+
+std::unique_ptr<ThreadPool> ThreadPool::Create(int num_threads) {
+  if (num_threads < 1) {
+    LOG(ERROR) << "Number of threads must be at least 1 but was "
+               << num_threads << ".";
+    return nullptr;
+  }
+  return absl::WrapUnique(new ThreadPool(num_threads));
+}
+
+ThreadPool::ThreadPool(int num_threads)
+    : generation_(0),
+      busy_workers_(0),
+      shutdown_(false),
+      fn_(nullptr),
+      num_items_(0),
+      next_item_(0) {
+  workers_.reserve(num_threads - 1);
+  for (int i = 0; i < num_threads - 1; ++i) {
+    workers_.emplace_back(&ThreadPool::WorkerLoop, this);
+  }
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    absl::MutexLock lock(&mutex_);
+    shutdown_ = true;
+  }
+  for (auto& worker : workers_) {
+    worker.join();
+  }
+}
+
+void ThreadPool::ParallelFor(int num_items,
+                             const std::function<void(int)>& fn) {
+  if (workers_.empty() || num_items <= 1) {
+    for (int i = 0; i < num_items; ++i) {
+      fn(i);
+    }
+    return;
+  }
+
+  absl::MutexLock call_lock(&call_mutex_);
+  fn_ = &fn;
+  num_items_ = num_items;
+  next_item_.store(0, std::memory_order_relaxed);
+  {
+    absl::MutexLock lock(&mutex_);
+    busy_workers_ = workers_.size();
+    ++generation_;
+  }
+
+  RunItems();
+
+  absl::MutexLock lock(&mutex_);
+  mutex_.Await(absl::Condition(
+      +[](int* busy_workers) { return *busy_workers == 0; }, &busy_workers_));
+  fn_ = nullptr;
+}
+
+void ThreadPool::WorkerLoop() {
+  int64_t seen_generation = 0;
+  while (true) {
+    {
+      absl::MutexLock lock(&mutex_);
+      auto has_work = [this, seen_generation]()
+                          ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_) {
+                            return shutdown_ || generation_ != seen_generation;
+                          };
+      mutex_.Await(absl::Condition(&has_work));
+      if (shutdown_) {
+        return;
+      }
+      seen_generation = generation_;
+    }
+
+    RunItems();
+
+    absl::MutexLock lock(&mutex_);
+    --busy_workers_;
+  }
+}
+
+void ThreadPool::RunItems() {
+  for (int i = next_item_.fetch_add(1, std::memory_order_relaxed);
+       i < num_items_; i = next_item_.fetch_add(1, std::memory_order_relaxed)) {
+    (*fn_)(i);
+  }
+}
+
+}  // namespace codec
+}  // namespace chromemedia
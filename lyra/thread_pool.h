@@ -0,0 +1,80 @@
+/*
+ * Copyright 2022 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LYRA_THREAD_POOL_H_
+#define LYRA_THREAD_POOL_H_
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <thread>  // NOLINT(build/c++11)
+#include <vector>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/synchronization/mutex.h"
+
+namespace chromemedia {
+namespace codec {
+
+// A fixed set of worker threads for fork-join loops over independent items,
+// such as the streams of a multi-stream codec. Workers persist between calls
+// so that a loop running every 20 ms hop does not pay for thread creation.
+class ThreadPool {
+ public:
+  // |num_threads| counts the thread calling |ParallelFor|, so a pool of one
+  // thread runs every item inline. Returns nullptr if |num_threads| < 1.
+  static std::unique_ptr<ThreadPool> Create(int num_threads);
+
+  ~ThreadPool();
+
+  // Runs |fn(i)| for every i in [0, |num_items|) and returns once all calls
+  // have finished. Calls are distributed over all threads and may run in any
+  // order. Concurrent calls to |ParallelFor| are serialized.
+  void ParallelFor(int num_items, const std::function<void(int)>& fn);
+
+  int num_threads() const { return workers_.size() + 1; }
+
+ private:
+  explicit ThreadPool(int num_threads);
+
+  void WorkerLoop();
+
+  // Runs items of the current loop until none are left.
+  void RunItems();
+
+  // Held for the whole of |ParallelFor| to serialize callers.
+  absl::Mutex call_mutex_;
+
+  absl::Mutex mutex_;
+  // Incremented for every loop so that workers notice new work.
+  int64_t generation_ ABSL_GUARDED_BY(mutex_);
+  // Workers still running items of the current loop.
+  int busy_workers_ ABSL_GUARDED_BY(mutex_);
+  bool shutdown_ ABSL_GUARDED_BY(mutex_);
+
+  // Written only while no worker is busy.
+  const std::function<void(int)>* fn_;
+  int num_items_;
+  std::atomic<int> next_item_;
+
+  std::vector<std::thread> workers_;
+};
+
+}  // namespace codec
+}  // namespace chromemedia
+
+#endif  // LYRA_THREAD_POOL_H_
@@ -0,0 +1,52 @@
+// Copyright 2022 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "lyra/thread_pool.h"
+
+#include <atomic>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+namespace chromemedia {
+namespace codec {
+namespace {
+
+TEST(ThreadPoolTest, CreateFailsWithoutThreads) {
+  EXPECT_EQ(ThreadPool::Create(0), nullptr);
+}
+
+class ThreadPoolTest : public testing::TestWithParam<int> {};
+
+TEST_P(ThreadPoolTest, EveryItemRunsExactlyOnce) {
+  auto thread_pool = ThreadPool::Create(GetParam());
+  ASSERT_NE(thread_pool, nullptr);
+  EXPECT_EQ(thread_pool->num_threads(), GetParam());
+
+  // Repeated loops exercise the hand-off between generations.
+  for (int num_items : {0, 1, 3, 64, 1000}) {
+    std::vector<std::atomic<int>> counts(num_items);
+    thread_pool->ParallelFor(num_items, [&counts](int i) { ++counts[i]; });
+    for (int i = 0; i < num_items; ++i) {
+      EXPECT_EQ(counts[i].load(), 1) << "item " << i;
+    }
+  }
+}
+
+INSTANTIATE_TEST_SUITE_P(NumThreads, ThreadPoolTest,
+                         testing::Values(1, 2, 4, 8));
+
+}  // namespace
+}  // namespace codec
+}  // namespace chromemedia
@@ -0,0 +1,305 @@
+// Copyright 2022 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "lyra/tracing.h"
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/status/status.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_format.h"
+#include "absl/synchronization/mutex.h"
+
+namespace chromemedia {
+namespace codec {
+namespace tracing_internal {
+
+std::atomic<bool> is_tracing(false);
+
+namespace {
+
+// An event with a negative duration is an instant event. The fields are
+// atomics so that a snapshot may read a slot while its thread overwrites it;
+// such reads are detected and dropped, see |ThreadTraceBuffer|.
+struct TraceEvent {
+  std::atomic<const char*> name{nullptr};
+  std::atomic<int64_t> begin_ns{0};
+  std::atomic<int64_t> duration_ns{0};
+};
+
+// The most recent events of one thread, written only by that thread. Events
+// are numbered in the order they are written and event i lives in slot
+// i % kTraceEventsPerThread. Before a slot is written |num_started| is
+// incremented, and after it is written |num_written| is, like a seqlock: a
+// reader copies the events below |num_written| and afterwards discards the
+// ones that |num_started| shows may have been overwritten meanwhile.
+struct ThreadTraceBuffer {
+  explicit ThreadTraceBuffer(int thread_id)
+      : thread_id(thread_id), events(new TraceEvent[kTraceEventsPerThread]) {}
+
+  void Record(const char* name, int64_t begin_ns, int64_t duration_ns) {
+    const int64_t index = num_written.load(std::memory_order_relaxed);
+    num_started.store(index + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    TraceEvent& event = events[index % kTraceEventsPerThread];
+    event.name.store(name, std::memory_order_relaxed);
+    event.begin_ns.store(begin_ns, std::memory_order_relaxed);
+    event.duration_ns.store(duration_ns, std::memory_order_relaxed);
+    num_written.store(index + 1, std::memory_order_release);
+  }
+
+  const int thread_id;
+  std::atomic<const char*> thread_name{nullptr};
+  // The next buffer of the reserved list of |TraceRegistry|.
+  ThreadTraceBuffer* next_reserved = nullptr;
+  std::atomic<int64_t> num_started{0};
+  std::atomic<int64_t> num_written{0};
+  // Events below this number were dropped by |ClearTrace|.
+  std::atomic<int64_t> num_cleared{0};
+  const std::unique_ptr<TraceEvent[]> events;
+};
+
+struct EventSnapshot {
+  const char* name;
+  int64_t begin_ns;
+  int64_t duration_ns;
+};
+
+class TraceRegistry {
+ public:
+  static TraceRegistry& Get() {
+    static TraceRegistry* const registry = new TraceRegistry();
+    return *registry;
+  }
+
+  // Buffers are never freed, so the events of threads which have exited
+  // stay in the trace.
+  ThreadTraceBuffer* AddBuffer() {
+    absl::MutexLock lock(&mutex_);
+    return AddBufferLocked();
+  }
+
+  void ReserveBuffers(int num_buffers) {
+    absl::MutexLock lock(&mutex_);
+    for (int i = 0; i < num_buffers; ++i) {
+      ThreadTraceBuffer* buffer = AddBufferLocked();
+      buffer->next_reserved = reserved_.load(std::memory_order_relaxed);
+      while (!reserved_.compare_exchange_weak(buffer->next_reserved, buffer,
+                                              std::memory_order_release,
+                                              std::memory_order_relaxed)) {
+      }
+    }
+  }
+
+  // Pops a reserved buffer without locking, or returns nullptr if none is
+  // left. Buffers are never pushed back, so the pop cannot suffer from ABA.
+  ThreadTraceBuffer* ClaimReservedBuffer() {
+    ThreadTraceBuffer* buffer = reserved_.load(std::memory_order_acquire);
+    while (buffer != nullptr &&
+           !reserved_.compare_exchange_weak(buffer, buffer->next_reserved,
+                                            std::memory_order_acquire,
+                                            std::memory_order_acquire)) {
+    }
+    return buffer;
+  }
+
+  std::vector<ThreadTraceBuffer*> buffers() {
+    absl::MutexLock lock(&mutex_);
+    std::vector<ThreadTraceBuffer*> buffers;
+    for (const auto& buffer : buffers_) {
+      buffers.push_back(buffer.get());
+    }
+    return buffers;
+  }
+
+ private:
+  ThreadTraceBuffer* AddBufferLocked() ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_) {
+    buffers_.push_back(
+        std::make_unique<ThreadTraceBuffer>(static_cast<int>(buffers_.size())));
+    return buffers_.back().get();
+  }
+
+  absl::Mutex mutex_;
+  std::vector<std::unique_ptr<ThreadTraceBuffer>> buffers_
+      ABSL_GUARDED_BY(mutex_);
+  // Buffers not yet claimed by any thread, linked by |next_reserved|.
+  std::atomic<ThreadTraceBuffer*> reserved_{nullptr};
+};
+
+// Set by |SetTraceThreadName|. Events of threads without a buffer are
+// dropped, so that recording never allocates.
+thread_local ThreadTraceBuffer* thread_buffer = nullptr;
+
+std::vector<EventSnapshot> Snapshot(ThreadTraceBuffer* buffer) {
+  const int64_t end = buffer->num_written.load(std::memory_order_acquire);
+  const int64_t begin =
+      std::max(buffer->num_cleared.load(std::memory_order_relaxed),
+               end - kTraceEventsPerThread);
+  std::vector<EventSnapshot> events;
+  events.reserve(std::max<int64_t>(0, end - begin));
+  for (int64_t i = begin; i < end; ++i) {
+    const TraceEvent& event = buffer->events[i % kTraceEventsPerThread];
+    events.push_back({event.name.load(std::memory_order_relaxed),
+                      event.begin_ns.load(std::memory_order_relaxed),
+                      event.duration_ns.load(std::memory_order_relaxed)});
+  }
+  std::atomic_thread_fence(std::memory_order_acquire);
+  // The slots of events below |first_intact| may have been overwritten while
+  // they were copied.
+  const int64_t first_intact =
+      buffer->num_started.load(std::memory_order_relaxed) -
+      kTraceEventsPerThread;
+  if (first_intact > begin) {
+    events.erase(events.begin(),
+                 events.begin() + std::min(first_intact - begin, end - begin));
+  }
+  return events;
+}
+
+void AppendJsonString(const char* text, std::string* json) {
+  json->push_back('"');
+  for (const char* c = text; *c != '\0'; ++c) {
+    if (*c == '"' || *c == '\\') {
+      json->push_back('\\');
+      json->push_back(*c);
+    } else if (static_cast<unsigned char>(*c) < 0x20) {
+      absl::StrAppendFormat(json, "\\u%04x", *c);
+    } else {
+      json->push_back(*c);
+    }
+  }
+  json->push_back('"');
+}
+
+}  // namespace
+
+void RecordSpan(const char* name, int64_t begin_ns, int64_t end_ns) {
+  if (thread_buffer != nullptr) {
+    thread_buffer->Record(name, begin_ns, end_ns - begin_ns);
+  }
+}
+
+}  // namespace tracing_internal
+
+void StartTracing() {
+  tracing_internal::is_tracing.store(true, std::memory_order_relaxed);
+}
+
+void StopTracing() {
+  tracing_internal::is_tracing.store(false, std::memory_order_relaxed);
+}
+
+void ClearTrace() {
+  for (tracing_internal::ThreadTraceBuffer* buffer :
+       tracing_internal::TraceRegistry::Get().buffers()) {
+    buffer->num_cleared.store(
+        buffer->num_written.load(std::memory_order_relaxed),
+        std::memory_order_relaxed);
+  }
+}
+
+void ReserveTraceThreads(int num_threads) {
+  tracing_internal::TraceRegistry::Get().ReserveBuffers(num_threads);
+}
+
+void SetTraceThreadName(const char* name) {
+  if (tracing_internal::thread_buffer == nullptr) {
+    tracing_internal::TraceRegistry& registry =
+        tracing_internal::TraceRegistry::Get();
+    tracing_internal::thread_buffer = registry.ClaimReservedBuffer();
+    if (tracing_internal::thread_buffer == nullptr) {
+      tracing_internal::thread_buffer = registry.AddBuffer();
+    }
+  }
+  tracing_internal::thread_buffer->thread_name.store(
+      name, std::memory_order_relaxed);
+}
+
+void RecordTraceInstant(const char* name) {
+  if (tracing_internal::is_tracing.load(std::memory_order_relaxed) &&
+      tracing_internal::thread_buffer != nullptr) {
+    tracing_internal::thread_buffer->Record(
+        name, tracing_internal::NowNanos(), -1);
+  }
+}
+
+std::string TraceToChromeJson() {
+  const int pid = getpid();
+  std::string json = "{\"traceEvents\":[";
+  bool first = true;
+  const auto start_event = [&]() {
+    if (!first) {
+      json += ",";
+    }
+    first = false;
+    json += "\n";
+  };
+  for (tracing_internal::ThreadTraceBuffer* buffer :
+       tracing_internal::TraceRegistry::Get().buffers()) {
+    const char* thread_name =
+        buffer->thread_name.load(std::memory_order_relaxed);
+    if (thread_name != nullptr) {
+      start_event();
+      absl::StrAppendFormat(
+          &json,
+          "{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":%d,\"tid\":%d,"
+          "\"args\":{\"name\":",
+          pid, buffer->thread_id);
+      tracing_internal::AppendJsonString(thread_name, &json);
+      json += "}}";
+    }
+    for (const tracing_internal::EventSnapshot& event :
+         tracing_internal::Snapshot(buffer)) {
+      start_event();
+      json += "{\"name\":";
+      tracing_internal::AppendJsonString(event.name, &json);
+      // Timestamps are in microseconds.
+      if (event.duration_ns >= 0) {
+        absl::StrAppendFormat(&json, ",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f",
+                              event.begin_ns / 1000.0,
+                              event.duration_ns / 1000.0);
+      } else {
+        absl::StrAppendFormat(&json, ",\"ph\":\"i\",\"s\":\"t\",\"ts\":%.3f",
+                              event.begin_ns / 1000.0);
+      }
+      absl::StrAppendFormat(&json, ",\"pid\":%d,\"tid\":%d}", pid,
+                            buffer->thread_id);
+    }
+  }
+  json += "\n],\"displayTimeUnit\":\"ms\"}\n";
+  return json;
+}
+
+absl::Status WriteChromeTrace(const std::string& path) {
+  std::ofstream stream(path);
+  stream << TraceToChromeJson();
+  stream.close();
+  if (!stream) {
+    return absl::AbortedError(
+        absl::StrCat("Failed to write trace to: ", path));
+  }
+  return absl::OkStatus();
+}
+
+}  // namespace codec
+}  // namespace chromemedia
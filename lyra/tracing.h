@@ -0,0 +1,160 @@
+/*
+ * Copyright 2022 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LYRA_TRACING_H_
+#define LYRA_TRACING_H_
+
+#include <atomic>
+#include <chrono>  // NOLINT(build/c++11)
+#include <cstdint>
+#include <string>
+
+#include "absl/status/status.h"
+
+// Spans of the codec pipeline which can be exported as a Chrome trace, to be
+// viewed in chrome://tracing or https://ui.perfetto.dev.
+//
+//   void LyraGanModel::RunConditioning(...) {
+//     LYRA_TRACE_SCOPE("LyraGanModel::RunConditioning");
+//     ...
+//   }
+//
+// The macros compile to nothing unless LYRA_TRACING is defined, which
+// `bazel build --define=lyra_tracing=1` does. When compiled in, recording
+// starts with |StartTracing| and a span costs a relaxed atomic load while
+// tracing is stopped, and two clock reads and a write to a buffer of the
+// calling thread while it runs. No locks are taken and nothing is allocated
+// on the recording path. Each thread keeps its most recent
+// |kTraceEventsPerThread| events, so tracing can be left running and dumped
+// when something goes wrong. Only threads registered with
+// |SetTraceThreadName| record events.
+#ifdef LYRA_TRACING
+#define LYRA_TRACE_CONCAT_INNER(a, b) a##b
+#define LYRA_TRACE_CONCAT(a, b) LYRA_TRACE_CONCAT_INNER(a, b)
+// Records the enclosing scope as a span named |name|, which must be a string
+// literal or otherwise outlive the trace.
+#define LYRA_TRACE_SCOPE(name)                             \
+  ::chromemedia::codec::ScopedTraceSpan LYRA_TRACE_CONCAT( \
+      lyra_trace_span_, __LINE__)(name)
+// Records an instant event named |name|, which must outlive the trace.
+#define LYRA_TRACE_INSTANT(name) ::chromemedia::codec::RecordTraceInstant(name)
+// Names the calling thread, see |SetTraceThreadName|.
+#define LYRA_TRACE_THREAD_NAME(name) \
+  ::chromemedia::codec::SetTraceThreadName(name)
+// Reserves buffers for realtime threads, see |ReserveTraceThreads|.
+#define LYRA_TRACE_RESERVE_THREADS(num_threads) \
+  ::chromemedia::codec::ReserveTraceThreads(num_threads)
+#else
+#define LYRA_TRACE_SCOPE(name) static_cast<void>(0)
+#define LYRA_TRACE_INSTANT(name) static_cast<void>(0)
+#define LYRA_TRACE_THREAD_NAME(name) static_cast<void>(0)
+#define LYRA_TRACE_RESERVE_THREADS(num_threads) static_cast<void>(0)
+#endif  // LYRA_TRACING
+
+namespace chromemedia {
+namespace codec {
+
+// The number of most recent events each thread keeps.
+inline constexpr int kTraceEventsPerThread = 1 << 15;
+
+// Returns whether the LYRA_TRACE_* macros record anything in this build.
+constexpr bool IsTracingCompiledIn() {
+#ifdef LYRA_TRACING
+  return true;
+#else
+  return false;
+#endif
+}
+
+// Starts or stops recording in all threads. Events recorded before stopping
+// are kept until |ClearTrace|.
+void StartTracing();
+void StopTracing();
+
+// Drops the events recorded so far.
+void ClearTrace();
+
+// Allocates buffers for |num_threads| threads which will call
+// |SetTraceThreadName| for the first time from a realtime callback, such as
+// the audio callback of PortAudio, whose thread cannot be registered up front.
+void ReserveTraceThreads(int num_threads);
+
+// Names the calling thread in the trace, like "audio" or "network", and gives
+// it a buffer, so that its events are recorded. |name| must outlive the trace.
+// The first call on a thread takes a buffer reserved by
+// |ReserveTraceThreads| without locking, or else allocates one under a lock,
+// so threads should be registered when they start. Later calls only rename
+// the thread and are cheap enough for every audio callback. Use
+// LYRA_TRACE_THREAD_NAME and LYRA_TRACE_RESERVE_THREADS instead of these two
+// so that builds without tracing never allocate a buffer.
+void SetTraceThreadName(const char* name);
+
+// Returns the recorded events in the Chrome trace event format. Safe to call
+// while other threads record; events they overwrite during the call are left
+// out.
+std::string TraceToChromeJson();
+
+// Writes |TraceToChromeJson| to |path|.
+absl::Status WriteChromeTrace(const std::string& path);
+
+// Records an instant event named |name| if tracing is running. Use
+// LYRA_TRACE_INSTANT instead so that it can be compiled out.
+void RecordTraceInstant(const char* name);
+
+namespace tracing_internal {
+
+extern std::atomic<bool> is_tracing;
+
+inline int64_t NowNanos() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+void RecordSpan(const char* name, int64_t begin_ns, int64_t end_ns);
+
+}  // namespace tracing_internal
+
+// Records its scope as a span named |name| if tracing is running when it is
+// constructed. Use LYRA_TRACE_SCOPE instead so that it can be compiled out.
+class ScopedTraceSpan {
+ public:
+  explicit ScopedTraceSpan(const char* name)
+      : name_(name),
+        begin_ns_(
+            tracing_internal::is_tracing.load(std::memory_order_relaxed)
+                ? tracing_internal::NowNanos()
+                : -1) {}
+
+  ~ScopedTraceSpan() {
+    if (begin_ns_ >= 0) {
+      tracing_internal::RecordSpan(name_, begin_ns_,
+                                   tracing_internal::NowNanos());
+    }
+  }
+
+  ScopedTraceSpan(const ScopedTraceSpan&) = delete;
+  ScopedTraceSpan& operator=(const ScopedTraceSpan&) = delete;
+
+ private:
+  const char* const name_;
+  const int64_t begin_ns_;
+};
+
+}  // namespace codec
+}  // namespace chromemedia
+
+#endif  // LYRA_TRACING_H_
@@ -0,0 +1,186 @@
+// Copyright 2022 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "lyra/tracing.h"
+
+#include <atomic>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>  // NOLINT(build/c++11)
+
+#include "absl/strings/match.h"
+#include "absl/strings/str_cat.h"
+#include "gtest/gtest.h"
+
+namespace chromemedia {
+namespace codec {
+namespace {
+
+int CountOccurrences(const std::string& text, const std::string& pattern) {
+  int count = 0;
+  for (size_t pos = text.find(pattern); pos != std::string::npos;
+       pos = text.find(pattern, pos + pattern.size())) {
+    ++count;
+  }
+  return count;
+}
+
+class TracingTest : public testing::Test {
+ protected:
+  void SetUp() override {
+    SetTraceThreadName("main");
+    ClearTrace();
+    StartTracing();
+  }
+
+  void TearDown() override {
+    StopTracing();
+    ClearTrace();
+  }
+};
+
+TEST_F(TracingTest, IsCompiledIn) { EXPECT_TRUE(IsTracingCompiledIn()); }
+
+TEST_F(TracingTest, RecordsSpansAndInstants) {
+  {
+    LYRA_TRACE_SCOPE("Outer");
+    LYRA_TRACE_SCOPE("Inner");
+    LYRA_TRACE_INSTANT("Marker");
+  }
+  const std::string json = TraceToChromeJson();
+  EXPECT_TRUE(absl::StartsWith(json, "{\"traceEvents\":[")) << json;
+  EXPECT_TRUE(absl::StrContains(json, "{\"name\":\"Outer\",\"ph\":\"X\""))
+      << json;
+  EXPECT_TRUE(absl::StrContains(json, "{\"name\":\"Inner\",\"ph\":\"X\""))
+      << json;
+  EXPECT_TRUE(
+      absl::StrContains(json, "{\"name\":\"Marker\",\"ph\":\"i\",\"s\":\"t\""))
+      << json;
+  // Spans are recorded when they end, so the inner one comes first.
+  EXPECT_LT(json.find("\"Inner\""), json.find("\"Outer\""));
+}
+
+TEST_F(TracingTest, RecordsNothingWhenStopped) {
+  StopTracing();
+  {
+    LYRA_TRACE_SCOPE("Stopped");
+    LYRA_TRACE_INSTANT("StoppedMarker");
+  }
+  // A span started while tracing was stopped is not recorded either.
+  {
+    LYRA_TRACE_SCOPE("StartedWhileStopped");
+    StartTracing();
+  }
+  const std::string json = TraceToChromeJson();
+  EXPECT_FALSE(absl::StrContains(json, "Stopped")) << json;
+}
+
+TEST_F(TracingTest, ClearDropsEvents) {
+  { LYRA_TRACE_SCOPE("Cleared"); }
+  ClearTrace();
+  { LYRA_TRACE_SCOPE("Kept"); }
+  const std::string json = TraceToChromeJson();
+  EXPECT_FALSE(absl::StrContains(json, "Cleared")) << json;
+  EXPECT_TRUE(absl::StrContains(json, "Kept")) << json;
+}
+
+TEST_F(TracingTest, KeepsEventsAndNamesOfExitedThreads) {
+  std::thread thread([]() {
+    LYRA_TRACE_THREAD_NAME("worker \"1\"");
+    LYRA_TRACE_SCOPE("WorkerSpan");
+  });
+  thread.join();
+  const std::string json = TraceToChromeJson();
+  EXPECT_TRUE(absl::StrContains(json, "\"name\":\"thread_name\"")) << json;
+  EXPECT_TRUE(absl::StrContains(json, "{\"name\":\"worker \\\"1\\\"\"}"))
+      << json;
+  EXPECT_TRUE(absl::StrContains(json, "WorkerSpan")) << json;
+}
+
+TEST_F(TracingTest, DropsEventsOfUnregisteredThreads) {
+  std::thread thread([]() {
+    LYRA_TRACE_SCOPE("UnregisteredSpan");
+    LYRA_TRACE_INSTANT("UnregisteredMarker");
+  });
+  thread.join();
+  const std::string json = TraceToChromeJson();
+  EXPECT_FALSE(absl::StrContains(json, "Unregistered")) << json;
+}
+
+TEST_F(TracingTest, ThreadsClaimReservedBuffers) {
+  LYRA_TRACE_RESERVE_THREADS(2);
+  for (const char* name : {"reserved 1", "reserved 2", "allocated"}) {
+    std::thread thread([name]() {
+      SetTraceThreadName(name);
+      LYRA_TRACE_INSTANT(name);
+    });
+    thread.join();
+  }
+  const std::string json = TraceToChromeJson();
+  for (const char* name : {"reserved 1", "reserved 2", "allocated"}) {
+    EXPECT_EQ(CountOccurrences(json, absl::StrCat("\"", name, "\"")), 2)
+        << json;
+  }
+}
+
+TEST_F(TracingTest, KeepsMostRecentEvents) {
+  std::thread thread([]() {
+    SetTraceThreadName("recent");
+    for (int i = 0; i < kTraceEventsPerThread; ++i) {
+      LYRA_TRACE_INSTANT("Old");
+    }
+    for (int i = 0; i < kTraceEventsPerThread; ++i) {
+      LYRA_TRACE_INSTANT("New");
+    }
+  });
+  thread.join();
+  const std::string json = TraceToChromeJson();
+  EXPECT_EQ(CountOccurrences(json, "\"Old\""), 0);
+  EXPECT_EQ(CountOccurrences(json, "\"New\""), kTraceEventsPerThread);
+}
+
+TEST_F(TracingTest, SnapshotsWhileThreadsRecord) {
+  std::atomic<bool> done(false);
+  std::thread thread([&done]() {
+    SetTraceThreadName("busy");
+    do {
+      LYRA_TRACE_SCOPE("Busy");
+    } while (!done.load());
+  });
+  for (int i = 0; i < 5; ++i) {
+    const std::string json = TraceToChromeJson();
+    EXPECT_TRUE(absl::EndsWith(json, "],\"displayTimeUnit\":\"ms\"}\n"));
+    EXPECT_LE(CountOccurrences(json, "\"Busy\""), kTraceEventsPerThread);
+  }
+  done = true;
+  thread.join();
+  EXPECT_GT(CountOccurrences(TraceToChromeJson(), "\"Busy\""), 0);
+}
+
+TEST_F(TracingTest, WritesTraceFile) {
+  { LYRA_TRACE_SCOPE("Written"); }
+  const std::string path = testing::TempDir() + "/trace.json";
+  ASSERT_TRUE(WriteChromeTrace(path).ok());
+  std::ifstream stream(path);
+  std::stringstream contents;
+  contents << stream.rdbuf();
+  EXPECT_TRUE(absl::StrContains(contents.str(), "Written"));
+
+  EXPECT_FALSE(WriteChromeTrace("/invalid/path/trace.json").ok());
+}
+
+}  // namespace
+}  // namespace codec
+}  // namespace chromemedia
@@ -17,10 +17,13 @@
 #ifndef LYRA_VECTOR_QUANTIZER_INTERFACE_H_
 #define LYRA_VECTOR_QUANTIZER_INTERFACE_H_
 
+#include <algorithm>
 #include <optional>
 #include <string>
 #include <vector>
 
+#include "absl/types/span.h"
+
 namespace chromemedia {
 namespace codec {
 
@@ -38,6 +41,70 @@ class VectorQuantizerInterface {
   // spectrogram domain.
   virtual std::optional<std::vector<float>> DecodeToLossyFeatures(
       const std::string& quantized_features) const = 0;
+
+  // Number of bits each quantizer uses to encode the index of its code vector.
+  virtual int bits_per_quantizer() const = 0;
+
+  // Writes the index of the code vector chosen by each of the first
+  // |num_bits| / |bits_per_quantizer()| quantizers to |indices|, which must
+  // hold exactly that many entries. Returns false on failure.
+  // The default implementation parses the bits returned by |Quantize|.
+  virtual bool QuantizeToIndices(const std::vector<float>& features,
+                                 int num_bits, absl::Span<int> indices) const {
+    const int bits_per_index = bits_per_quantizer();
+    if (bits_per_index <= 0 ||
+        num_bits != static_cast<int>(indices.size()) * bits_per_index) {
+      return false;
+    }
+    const auto quantized_features = Quantize(features, num_bits);
+    if (!quantized_features.has_value() ||
+        quantized_features->size() != num_bits) {
+      return false;
+    }
+    // The first quantizer is positioned in the most significant bits.
+    auto bit = quantized_features->begin();
+    for (int& index : indices) {
+      index = 0;
+      for (int i = 0; i < bits_per_index; ++i) {
+        index = (index << 1) | (*bit++ == '1' ? 1 : 0);
+      }
+    }
+    return true;
+  }
+
+  // Converts the code vector indices of the first |indices.size()| quantizers
+  // back into lossy features in the log mel spectrogram domain.
+  // The default implementation formats the indices as bits for
+  // |DecodeToLossyFeatures|.
+  virtual std::optional<std::vector<float>> DecodeIndicesToLossyFeatures(
+      absl::Span<const int> indices) const {
+    const int bits_per_index = bits_per_quantizer();
+    if (bits_per_index <= 0) {
+      return std::nullopt;
+    }
+    std::string quantized_features;
+    quantized_features.reserve(indices.size() * bits_per_index);
+    for (const int index : indices) {
+      for (int i = bits_per_index - 1; i >= 0; --i) {
+        quantized_features.push_back((index >> i) & 1 ? '1' : '0');
+      }
+    }
+    return DecodeToLossyFeatures(quantized_features);
+  }
+
+  // Same as |DecodeIndicesToLossyFeatures|, but writes the features into
+  // |features|, which must be sized to the number of features. Returns false
+  // on failure. The default implementation copies the result of
+  // |DecodeIndicesToLossyFeatures|.
+  virtual bool DecodeIndicesToLossyFeaturesInto(
+      absl::Span<const int> indices, absl::Span<float> features) const {
+    const auto decoded = DecodeIndicesToLossyFeatures(indices);
+    if (!decoded.has_value() || decoded->size() != features.size()) {
+      return false;
+    }
+    std::copy(decoded->begin(), decoded->end(), features.begin());
+    return true;
+  }
 };
 
 }  // namespace codec
@@ -14,19 +14,87 @@
 
 #include "lyra/wav_utils.h"
 
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
 #include <cstddef>
 #include <cstdint>
 #include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <istream>
+#include <memory>
+#include <optional>
+#include <ostream>
+#include <streambuf>
 #include <string>
+#include <utility>
 #include <vector>
 
+#include "absl/base/config.h"
+#include "absl/memory/memory.h"
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
 #include "absl/strings/str_cat.h"
+#include "absl/types/span.h"
 #include "audio/dsp/portable/read_wav_file.h"
 #include "audio/dsp/portable/write_wav_file.h"
 
 namespace chromemedia::codec {
+namespace {
+
+constexpr uint16_t kWavFormatPcm = 1;
+constexpr uint16_t kWavFormatExtensible = 0xFFFE;
+constexpr int kMinFormatChunkSize = 16;
+constexpr int kMaxFormatChunkSize = 40;
+constexpr uint32_t kUnknownSize = 0xFFFFFFFF;
+
+// Layout of the header written by `Write16BitWavStreamHeader`.
+constexpr int kStreamHeaderSize = 44;
+constexpr int kRiffSizeOffset = 4;
+constexpr int kDataSizeOffset = 40;
+// The RIFF size counts everything after its own field.
+constexpr int64_t kRiffSizeOverhead = kStreamHeaderSize - 8;
+// The largest data chunk whose sizes stay below `kUnknownSize`.
+constexpr int64_t kMaxDataSize =
+    (kUnknownSize - 1 - kRiffSizeOverhead) & ~int64_t{1};
+
+// Reads from memory in place, so that the stream header parser also serves
+// mapped files.
+class MemoryStreamBuf : public std::streambuf {
+ public:
+  MemoryStreamBuf(const char* data, size_t size) {
+    char* begin = const_cast<char*>(data);
+    setg(begin, begin, begin + size);
+  }
+
+  size_t position() const { return gptr() - eback(); }
+};
+
+bool ReadBytes(int num_bytes, std::istream* stream, char* bytes) {
+  stream->read(bytes, num_bytes);
+  return stream->gcount() == num_bytes;
+}
+
+uint16_t LittleEndian16(const char* bytes) {
+  return static_cast<uint8_t>(bytes[0]) |
+         (static_cast<uint16_t>(static_cast<uint8_t>(bytes[1])) << 8);
+}
+
+uint32_t LittleEndian32(const char* bytes) {
+  return LittleEndian16(bytes) |
+         (static_cast<uint32_t>(LittleEndian16(bytes + 2)) << 16);
+}
+
+void WriteLittleEndian(uint32_t value, int num_bytes, std::ostream* stream) {
+  for (int i = 0; i < num_bytes; ++i) {
+    stream->put(static_cast<char>((value >> (8 * i)) & 0xFF));
+  }
+}
+
+}  // namespace
 
 absl::StatusOr<ReadWavResult> Read16BitWavFileToVector(
     const std::string& file_name) {
@@ -60,4 +128,236 @@ absl::Status Write16BitWavFileFromVector(const std::string& file_name,
       absl::StrCat("Failed to write to wav file at: ", file_name));
 }
 
+absl::StatusOr<WavStreamHeader> Read16BitWavStreamHeader(std::istream* stream) {
+  char riff_header[12];
+  if (!ReadBytes(sizeof(riff_header), stream, riff_header) ||
+      std::memcmp(riff_header, "RIFF", 4) != 0 ||
+      std::memcmp(riff_header + 8, "WAVE", 4) != 0) {
+    return absl::InvalidArgumentError("Stream is not a wav file.");
+  }
+  std::optional<WavStreamHeader> header;
+  while (true) {
+    char chunk_header[8];
+    if (!ReadBytes(sizeof(chunk_header), stream, chunk_header)) {
+      return absl::InvalidArgumentError("Wav stream has no data chunk.");
+    }
+    const uint32_t chunk_size = LittleEndian32(chunk_header + 4);
+    if (std::memcmp(chunk_header, "data", 4) == 0) {
+      if (!header.has_value()) {
+        return absl::InvalidArgumentError(
+            "Wav stream has no format chunk before its data.");
+      }
+      // Writers of pipes leave the size at 0 or the maximum.
+      if (chunk_size != 0 && chunk_size != kUnknownSize) {
+        header->num_data_bytes = chunk_size;
+      }
+      return *header;
+    }
+    if (std::memcmp(chunk_header, "fmt ", 4) == 0) {
+      char format[kMaxFormatChunkSize];
+      if (chunk_size < kMinFormatChunkSize ||
+          chunk_size > kMaxFormatChunkSize ||
+          !ReadBytes(chunk_size, stream, format)) {
+        return absl::InvalidArgumentError("Wav stream has a bad format chunk.");
+      }
+      const uint16_t audio_format = LittleEndian16(format);
+      const int bits_per_sample = LittleEndian16(format + 14);
+      if ((audio_format != kWavFormatPcm &&
+           audio_format != kWavFormatExtensible) ||
+          bits_per_sample != 16) {
+        return absl::InvalidArgumentError(
+            absl::StrCat("Wav stream has format ", audio_format, " with ",
+                         bits_per_sample, " bits per sample, but only 16 bit "
+                         "PCM is supported."));
+      }
+      header = WavStreamHeader{LittleEndian16(format + 2),
+                               static_cast<int>(LittleEndian32(format + 4)),
+                               std::nullopt};
+    } else {
+      // Chunks are padded to an even size.
+      const std::streamsize padded_size = chunk_size + chunk_size % 2;
+      stream->ignore(padded_size);
+      if (stream->gcount() != padded_size) {
+        return absl::InvalidArgumentError("Wav stream ended inside a chunk.");
+      }
+    }
+  }
+}
+
+absl::Status Write16BitWavStreamHeader(int num_channels, int sample_rate_hz,
+                                       std::ostream* stream) {
+  constexpr int kBytesPerSample = 2;
+  stream->write("RIFF", 4);
+  WriteLittleEndian(kUnknownSize, 4, stream);
+  stream->write("WAVEfmt ", 8);
+  WriteLittleEndian(kMinFormatChunkSize, 4, stream);
+  WriteLittleEndian(kWavFormatPcm, 2, stream);
+  WriteLittleEndian(num_channels, 2, stream);
+  WriteLittleEndian(sample_rate_hz, 4, stream);
+  WriteLittleEndian(sample_rate_hz * num_channels * kBytesPerSample, 4,
+                    stream);
+  WriteLittleEndian(num_channels * kBytesPerSample, 2, stream);
+  WriteLittleEndian(8 * kBytesPerSample, 2, stream);
+  stream->write("data", 4);
+  WriteLittleEndian(kUnknownSize, 4, stream);
+  if (!stream->good()) {
+    return absl::AbortedError("Failed to write wav stream header.");
+  }
+  return absl::OkStatus();
+}
+
+absl::StatusOr<std::unique_ptr<WavReader>> WavReader::Open(
+    const std::string& file_name) {
+#ifndef ABSL_IS_LITTLE_ENDIAN
+  return absl::UnimplementedError(
+      "Mapped wav files are only supported on little-endian hosts.");
+#endif
+  const int fd = open(file_name.c_str(), O_RDONLY);
+  if (fd < 0) {
+    return absl::NotFoundError(
+        absl::StrCat("Failed to open wav at path: ", file_name));
+  }
+  struct stat file_stat;
+  if (fstat(fd, &file_stat) != 0 || file_stat.st_size == 0) {
+    close(fd);
+    return absl::InvalidArgumentError(
+        absl::StrCat("Wav at path is empty: ", file_name));
+  }
+  const size_t size = file_stat.st_size;
+  void* mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  // The mapping keeps the file alive.
+  close(fd);
+  if (mapped == MAP_FAILED) {
+    return absl::AbortedError(
+        absl::StrCat("Failed to map wav at path: ", file_name));
+  }
+  // Samples are usually consumed front to back.
+  madvise(mapped, size, MADV_SEQUENTIAL);
+
+  const char* data = static_cast<const char*>(mapped);
+  MemoryStreamBuf buffer(data, size);
+  std::istream stream(&buffer);
+  absl::StatusOr<WavStreamHeader> header = Read16BitWavStreamHeader(&stream);
+  if (!header.ok() || header->num_channels < 1 ||
+      buffer.position() % sizeof(int16_t) != 0) {
+    munmap(mapped, size);
+    return absl::InvalidArgumentError(absl::StrCat(
+        "Not a 16 bit PCM wav at path: ", file_name,
+        header.ok() ? "" : absl::StrCat(" (", header.status().message(), ")")));
+  }
+  // Truncated files are read up to the last whole frame.
+  const size_t frame_size = header->num_channels * sizeof(int16_t);
+  size_t num_data_bytes = size - buffer.position();
+  if (header->num_data_bytes.has_value() &&
+      *header->num_data_bytes < num_data_bytes) {
+    num_data_bytes = *header->num_data_bytes;
+  }
+  num_data_bytes -= num_data_bytes % frame_size;
+  const absl::Span<const int16_t> samples(
+      reinterpret_cast<const int16_t*>(data + buffer.position()),
+      num_data_bytes / sizeof(int16_t));
+
+  return absl::WrapUnique(new WavReader(mapped, size, samples,
+                                        header->num_channels,
+                                        header->sample_rate_hz));
+}
+
+WavReader::WavReader(void* mapped, size_t mapped_size,
+                     absl::Span<const int16_t> samples, int num_channels,
+                     int sample_rate_hz)
+    : mapped_(mapped),
+      mapped_size_(mapped_size),
+      samples_(samples),
+      num_channels_(num_channels),
+      sample_rate_hz_(sample_rate_hz) {}
+
+WavReader::~WavReader() { munmap(mapped_, mapped_size_); }
+
+absl::Span<const int16_t> WavReader::samples() const { return samples_; }
+
+int WavReader::num_channels() const { return num_channels_; }
+
+int WavReader::sample_rate_hz() const { return sample_rate_hz_; }
+
+absl::StatusOr<std::unique_ptr<WavWriter>> WavWriter::Create(
+    const std::string& file_name, int num_channels, int sample_rate_hz) {
+  if (num_channels < 1 || sample_rate_hz < 1) {
+    return absl::InvalidArgumentError(
+        absl::StrCat("Invalid wav format of ", num_channels, " channels at ",
+                     sample_rate_hz, " Hz."));
+  }
+  std::ofstream output(file_name, std::ios_base::binary | std::ios_base::trunc);
+  if (!output.is_open()) {
+    return absl::AbortedError(
+        absl::StrCat("Failed to write to wav file at: ", file_name));
+  }
+  absl::Status status =
+      Write16BitWavStreamHeader(num_channels, sample_rate_hz, &output);
+  if (!status.ok()) {
+    return status;
+  }
+  // WrapUnique is used because of private c'tor.
+  return absl::WrapUnique(new WavWriter(std::move(output), num_channels));
+}
+
+WavWriter::WavWriter(std::ofstream output, int num_channels)
+    : output_(std::move(output)),
+      num_channels_(num_channels),
+      num_samples_(0),
+      closed_(false) {}
+
+WavWriter::~WavWriter() {
+  if (!closed_) {
+    Close().IgnoreError();
+  }
+}
+
+absl::Status WavWriter::Write(absl::Span<const int16_t> samples) {
+  if (closed_) {
+    return absl::FailedPreconditionError("Wav file is already closed.");
+  }
+  if (samples.size() % num_channels_ != 0) {
+    return absl::InvalidArgumentError(
+        absl::StrCat(samples.size(), " samples are not a whole number of ",
+                     num_channels_, " channel frames."));
+  }
+  if ((num_samples_ + static_cast<int64_t>(samples.size())) *
+          static_cast<int64_t>(sizeof(int16_t)) >
+      kMaxDataSize) {
+    return absl::OutOfRangeError("Wav files are limited to 4 GiB.");
+  }
+#ifdef ABSL_IS_LITTLE_ENDIAN
+  output_.write(reinterpret_cast<const char*>(samples.data()),
+                samples.size() * sizeof(int16_t));
+#else
+  for (const int16_t sample : samples) {
+    WriteLittleEndian(static_cast<uint16_t>(sample), 2, &output_);
+  }
+#endif
+  if (!output_.good()) {
+    return absl::AbortedError("Failed to write wav samples.");
+  }
+  num_samples_ += samples.size();
+  return absl::OkStatus();
+}
+
+absl::Status WavWriter::Close() {
+  if (closed_) {
+    return absl::FailedPreconditionError("Wav file is already closed.");
+  }
+  closed_ = true;
+  const uint32_t data_size = num_samples_ * sizeof(int16_t);
+  output_.seekp(kRiffSizeOffset);
+  WriteLittleEndian(kRiffSizeOverhead + data_size, 4, &output_);
+  output_.seekp(kDataSizeOffset);
+  WriteLittleEndian(data_size, 4, &output_);
+  output_.close();
+  if (output_.fail()) {
+    return absl::AbortedError("Failed to finish wav file.");
+  }
+  return absl::OkStatus();
+}
+
+int64_t WavWriter::num_samples() const { return num_samples_; }
+
 }  // namespace chromemedia::codec
@@ -17,12 +17,19 @@
 #ifndef LYRA_WAV_UTILS_H_
 #define LYRA_WAV_UTILS_H_
 
+#include <cstddef>
 #include <cstdint>
+#include <fstream>
+#include <istream>
+#include <memory>
+#include <optional>
+#include <ostream>
 #include <string>
 #include <vector>
 
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
+#include "absl/types/span.h"
 
 namespace chromemedia::codec {
 
@@ -46,6 +53,91 @@ absl::Status Write16BitWavFileFromVector(const std::string& file_name,
                                          int num_channels, int sample_rate_hz,
                                          const std::vector<int16_t>& samples);
 
+struct WavStreamHeader {
+  int num_channels;
+  int sample_rate_hz;
+  // Size of the sample data in bytes, or nullopt if the writer of the stream
+  // did not know it, which is common for WAV files written to pipes.
+  std::optional<int64_t> num_data_bytes;
+};
+
+// Reads the header of a 16 bit PCM .wav stream, leaving `stream` at the first
+// byte of the interleaved little-endian samples so that they can be read
+// incrementally. Chunks other than the format are skipped.
+absl::StatusOr<WavStreamHeader> Read16BitWavStreamHeader(std::istream* stream);
+
+// Writes the header of a 16 bit PCM .wav stream of unknown length, after which
+// interleaved little-endian samples can be written incrementally. The sizes
+// are set to their maximum, which readers of pipes such as sox and ffmpeg
+// take to mean that the data runs to the end of the stream.
+absl::Status Write16BitWavStreamHeader(int num_channels, int sample_rate_hz,
+                                       std::ostream* stream);
+
+// A memory-mapped 16 bit PCM .wav file. The samples are read in place, so
+// opening a file copies nothing and only the pages that are touched are loaded.
+// Only supported on little-endian hosts.
+class WavReader {
+ public:
+  static absl::StatusOr<std::unique_ptr<WavReader>> Open(
+      const std::string& file_name);
+
+  ~WavReader();
+
+  WavReader(const WavReader&) = delete;
+  WavReader& operator=(const WavReader&) = delete;
+
+  // The interleaved samples of all channels, pointing into the mapped file.
+  // Valid for the lifetime of the reader.
+  absl::Span<const int16_t> samples() const;
+
+  int num_channels() const;
+
+  int sample_rate_hz() const;
+
+ private:
+  WavReader(void* mapped, size_t mapped_size,
+            absl::Span<const int16_t> samples, int num_channels,
+            int sample_rate_hz);
+
+  void* const mapped_;
+  const size_t mapped_size_;
+  const absl::Span<const int16_t> samples_;
+  const int num_channels_;
+  const int sample_rate_hz_;
+};
+
+// Writes a 16 bit PCM .wav file incrementally. The header is written first
+// with unknown sizes, which `Close` patches once the length is known.
+class WavWriter {
+ public:
+  static absl::StatusOr<std::unique_ptr<WavWriter>> Create(
+      const std::string& file_name, int num_channels, int sample_rate_hz);
+
+  // Closes the file if `Close` was not called.
+  ~WavWriter();
+
+  WavWriter(const WavWriter&) = delete;
+  WavWriter& operator=(const WavWriter&) = delete;
+
+  // Appends interleaved samples, which must be a whole number of frames.
+  absl::Status Write(absl::Span<const int16_t> samples);
+
+  // Writes the final sizes into the header and closes the file. No samples
+  // can be written afterwards.
+  absl::Status Close();
+
+  // Number of samples written so far, counting every channel.
+  int64_t num_samples() const;
+
+ private:
+  WavWriter(std::ofstream output, int num_channels);
+
+  std::ofstream output_;
+  const int num_channels_;
+  int64_t num_samples_;
+  bool closed_;
+};
+
 }  // namespace chromemedia::codec
 
 #endif  // LYRA_WAV_UTILS_H_
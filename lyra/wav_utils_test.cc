@@ -15,6 +15,9 @@
 #include "lyra/wav_utils.h"
 
 #include <cstdint>
+#include <fstream>
+#include <memory>
+#include <sstream>
 #include <string>
 #include <vector>
 
@@ -23,6 +26,7 @@
 #include "absl/flags/flag.h"
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
+#include "absl/types/span.h"
 #include "gtest/gtest.h"
 #include "include/ghc/filesystem.hpp"
 
@@ -94,5 +98,155 @@ TEST_F(WavUtilTest, WriteToBadPath) {
   EXPECT_FALSE(result.ok());
 }
 
+TEST_F(WavUtilTest, ReadsStreamHeaderOfWavFile) {
+  const ghc::filesystem::path wav_path =
+      ghc::filesystem::current_path() / "lyra/testdata/sample1_16kHz.wav";
+  std::ifstream stream(wav_path.string(), std::ios_base::binary);
+  absl::StatusOr<WavStreamHeader> header = Read16BitWavStreamHeader(&stream);
+  ASSERT_TRUE(header.ok()) << header.status();
+  EXPECT_EQ(header->num_channels, 1);
+  EXPECT_EQ(header->sample_rate_hz, 16000);
+
+  // The stream is left at the samples.
+  absl::StatusOr<ReadWavResult> read_result = ReadWav("sample1_16kHz.wav");
+  ASSERT_TRUE(read_result.ok());
+  ASSERT_TRUE(header->num_data_bytes.has_value());
+  EXPECT_EQ(*header->num_data_bytes, 2 * read_result->samples.size());
+  char sample[2];
+  ASSERT_TRUE(stream.read(sample, 2));
+  EXPECT_EQ(static_cast<int16_t>(static_cast<uint8_t>(sample[0]) |
+                                 static_cast<uint8_t>(sample[1]) << 8),
+            read_result->samples[0]);
+}
+
+TEST_F(WavUtilTest, StreamHeaderRoundTrips) {
+  std::stringstream stream;
+  ASSERT_TRUE(Write16BitWavStreamHeader(2, 48000, &stream).ok());
+  EXPECT_EQ(stream.str().size(), 44);
+  stream << "samples";
+
+  absl::StatusOr<WavStreamHeader> header = Read16BitWavStreamHeader(&stream);
+  ASSERT_TRUE(header.ok()) << header.status();
+  EXPECT_EQ(header->num_channels, 2);
+  EXPECT_EQ(header->sample_rate_hz, 48000);
+  EXPECT_FALSE(header->num_data_bytes.has_value());
+  std::string rest;
+  stream >> rest;
+  EXPECT_EQ(rest, "samples");
+}
+
+TEST_F(WavUtilTest, StreamHeaderSkipsOtherChunks) {
+  std::stringstream written;
+  ASSERT_TRUE(Write16BitWavStreamHeader(1, 8000, &written).ok());
+  std::string bytes = written.str();
+  // Inserts an odd sized LIST chunk, padded to an even size, before the data.
+  bytes.insert(36, std::string("LIST\x03\0\0\0abc\0", 12));
+  std::istringstream stream(bytes);
+
+  absl::StatusOr<WavStreamHeader> header = Read16BitWavStreamHeader(&stream);
+  ASSERT_TRUE(header.ok()) << header.status();
+  EXPECT_EQ(header->sample_rate_hz, 8000);
+  EXPECT_EQ(stream.tellg(), bytes.size());
+}
+
+TEST_F(WavUtilTest, StreamHeaderRejectsInvalidStreams) {
+  std::istringstream not_wav("raw pcm samples, not a wav header at all");
+  EXPECT_FALSE(Read16BitWavStreamHeader(&not_wav).ok());
+
+  std::stringstream written;
+  ASSERT_TRUE(Write16BitWavStreamHeader(1, 16000, &written).ok());
+  const std::string bytes = written.str();
+
+  // Ends before the data chunk.
+  std::istringstream truncated(bytes.substr(0, 40));
+  EXPECT_FALSE(Read16BitWavStreamHeader(&truncated).ok());
+
+  // 8 bits per sample.
+  std::string eight_bit = bytes;
+  eight_bit[34] = 8;
+  std::istringstream eight_bit_stream(eight_bit);
+  EXPECT_FALSE(Read16BitWavStreamHeader(&eight_bit_stream).ok());
+}
+
+TEST_F(WavUtilTest, WavReaderMatchesReadWav) {
+  const ghc::filesystem::path wav_path =
+      ghc::filesystem::current_path() / "lyra/testdata/sample1_16kHz.wav";
+  absl::StatusOr<std::unique_ptr<WavReader>> reader =
+      WavReader::Open(wav_path.string());
+  ASSERT_TRUE(reader.ok()) << reader.status();
+  EXPECT_EQ((*reader)->num_channels(), 1);
+  EXPECT_EQ((*reader)->sample_rate_hz(), 16000);
+
+  absl::StatusOr<ReadWavResult> read_result = ReadWav("sample1_16kHz.wav");
+  ASSERT_TRUE(read_result.ok());
+  const absl::Span<const int16_t> samples = (*reader)->samples();
+  EXPECT_EQ(std::vector<int16_t>(samples.begin(), samples.end()),
+            read_result->samples);
+}
+
+TEST_F(WavUtilTest, WavReaderRejectsInvalidFiles) {
+  EXPECT_FALSE(WavReader::Open("/should/not/exist.wav").ok());
+  const ghc::filesystem::path invalid_path =
+      ghc::filesystem::current_path() / "lyra/testdata/invalid.wav";
+  EXPECT_FALSE(WavReader::Open(invalid_path.string()).ok());
+}
+
+TEST_F(WavUtilTest, WavWriterRoundTripsThroughWavReader) {
+  const ghc::filesystem::path output_path =
+      ghc::filesystem::path(testing::TempDir()) / "incremental.wav";
+  absl::StatusOr<std::unique_ptr<WavWriter>> writer =
+      WavWriter::Create(output_path.string(), 2, 8000);
+  ASSERT_TRUE(writer.ok()) << writer.status();
+  std::vector<int16_t> samples;
+  for (int i = 0; i < 10; ++i) {
+    const std::vector<int16_t> frames = {static_cast<int16_t>(i), -1000, 7,
+                                         static_cast<int16_t>(-i)};
+    ASSERT_TRUE((*writer)->Write(frames).ok());
+    samples.insert(samples.end(), frames.begin(), frames.end());
+  }
+  // Half a frame.
+  EXPECT_FALSE((*writer)->Write(std::vector<int16_t>{1}).ok());
+  EXPECT_EQ((*writer)->num_samples(), samples.size());
+  ASSERT_TRUE((*writer)->Close().ok());
+  EXPECT_FALSE((*writer)->Write(samples).ok());
+  EXPECT_FALSE((*writer)->Close().ok());
+
+  // The sizes in the header are patched.
+  std::ifstream stream(output_path.string(), std::ios_base::binary);
+  absl::StatusOr<WavStreamHeader> header = Read16BitWavStreamHeader(&stream);
+  ASSERT_TRUE(header.ok()) << header.status();
+  EXPECT_EQ(header->num_data_bytes, 2 * samples.size());
+  stream.seekg(4);
+  char riff_size[4];
+  ASSERT_TRUE(stream.read(riff_size, 4));
+  EXPECT_EQ(static_cast<uint8_t>(riff_size[0]), 36 + 2 * samples.size());
+
+  absl::StatusOr<std::unique_ptr<WavReader>> reader =
+      WavReader::Open(output_path.string());
+  ASSERT_TRUE(reader.ok()) << reader.status();
+  EXPECT_EQ((*reader)->num_channels(), 2);
+  EXPECT_EQ((*reader)->sample_rate_hz(), 8000);
+  const absl::Span<const int16_t> read_samples = (*reader)->samples();
+  EXPECT_EQ(std::vector<int16_t>(read_samples.begin(), read_samples.end()),
+            samples);
+}
+
+TEST_F(WavUtilTest, WavWriterClosesOnDestruction) {
+  const ghc::filesystem::path output_path =
+      ghc::filesystem::path(testing::TempDir()) / "unclosed.wav";
+  {
+    absl::StatusOr<std::unique_ptr<WavWriter>> writer =
+        WavWriter::Create(output_path.string(), 1, 16000);
+    ASSERT_TRUE(writer.ok()) << writer.status();
+    ASSERT_TRUE((*writer)->Write(std::vector<int16_t>(320, 42)).ok());
+  }
+  absl::StatusOr<ReadWavResult> read_result = ReadWav(output_path.string());
+  ASSERT_TRUE(read_result.ok()) << read_result.status();
+  EXPECT_EQ(read_result->samples, std::vector<int16_t>(320, 42));
+
+  EXPECT_FALSE(WavWriter::Create("/invalid/path/test.wav", 1, 16000).ok());
+  EXPECT_FALSE(WavWriter::Create(output_path.string(), 0, 16000).ok());
+}
+
 }  // namespace
 }  // namespace chromemedia::codec
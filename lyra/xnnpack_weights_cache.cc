@@ -0,0 +1,91 @@
+// Copyright 2022 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "lyra/xnnpack_weights_cache.h"
+
+#include <functional>
+#include <memory>
+#include <utility>
+
+#include "absl/memory/memory.h"
+#include "absl/synchronization/mutex.h"
+#include "glog/logging.h"  // IWYU pragma: keep
+#include "tensorflow/lite/c/common.h"
+#include "tensorflow/lite/delegates/xnnpack/xnnpack_delegate.h"
+#include "tensorflow/lite/interpreter.h"
+
+namespace chromemedia {
+namespace codec {
+
+TfLiteStatus ApplyXnnpackDelegate(const TfLiteXNNPackDelegateOptions& options,
+                                  tflite::Interpreter* interpreter) {
+  auto delegate =
+      std::unique_ptr<TfLiteDelegate, std::function<void(TfLiteDelegate*)> >(
+          TfLiteXNNPackDelegateCreate(&options), &TfLiteXNNPackDelegateDelete);
+  // Allow dynamic tensors.
+  // TODO(b/204470960): Remove this flag once the bug is fixed.
+  delegate->flags |= kTfLiteDelegateFlagsAllowDynamicTensors;
+  return interpreter->ModifyGraphWithDelegate(std::move(delegate));
+}
+
+std::unique_ptr<XnnpackWeightsCache> XnnpackWeightsCache::Create() {
+  TfLiteXNNPackDelegateWeightsCache* cache =
+      TfLiteXNNPackDelegateWeightsCacheCreate();
+  if (cache == nullptr) {
+    LOG(ERROR) << "Could not create XNNPack weights cache.";
+    return nullptr;
+  }
+  return absl::WrapUnique(new XnnpackWeightsCache(cache));
+}
+
+XnnpackWeightsCache::XnnpackWeightsCache(
+    TfLiteXNNPackDelegateWeightsCache* cache)
+    : finalized_(false), cache_(cache) {}
+
+XnnpackWeightsCache::~XnnpackWeightsCache() {
+  TfLiteXNNPackDelegateWeightsCacheDelete(cache_);
+}
+
+TfLiteStatus XnnpackWeightsCache::ApplyDelegate(
+    TfLiteXNNPackDelegateOptions options, tflite::Interpreter* interpreter) {
+  absl::ReleasableMutexLock lock(&mutex_);
+  if (finalized_) {
+    // Lookups into a finalized cache are read-only and may run concurrently.
+    lock.Release();
+    return CreateAndApplyDelegate(options, interpreter);
+  }
+  const TfLiteStatus status = CreateAndApplyDelegate(options, interpreter);
+  if (status == kTfLiteOk) {
+    if (!TfLiteXNNPackDelegateWeightsCacheFinalizeHard(cache_)) {
+      LOG(ERROR) << "Could not finalize XNNPack weights cache.";
+      return kTfLiteError;
+    }
+    finalized_ = true;
+  }
+  return status;
+}
+
+TfLiteStatus XnnpackWeightsCache::CreateAndApplyDelegate(
+    TfLiteXNNPackDelegateOptions options, tflite::Interpreter* interpreter) {
+  options.weights_cache = cache_;
+  return ApplyXnnpackDelegate(options, interpreter);
+}
+
+bool XnnpackWeightsCache::is_finalized() const {
+  absl::MutexLock lock(&mutex_);
+  return finalized_;
+}
+
+}  // namespace codec
+}  // namespace chromemedia
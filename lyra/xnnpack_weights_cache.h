@@ -0,0 +1,72 @@
+/*
+ * Copyright 2022 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LYRA_XNNPACK_WEIGHTS_CACHE_H_
+#define LYRA_XNNPACK_WEIGHTS_CACHE_H_
+
+#include <functional>
+#include <memory>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/synchronization/mutex.h"
+#include "tensorflow/lite/c/common.h"
+#include "tensorflow/lite/delegates/xnnpack/xnnpack_delegate.h"
+#include "tensorflow/lite/interpreter.h"
+
+namespace chromemedia {
+namespace codec {
+
+// Creates an XNNPack delegate from |options| and applies it to |interpreter|.
+// Returns the status of |tflite::Interpreter::ModifyGraphWithDelegate|.
+TfLiteStatus ApplyXnnpackDelegate(const TfLiteXNNPackDelegateOptions& options,
+                                  tflite::Interpreter* interpreter);
+
+// Holds the XNNPack packed weights of one model so that only the first
+// interpreter built from it pays for repacking. The cache is keyed on the
+// addresses of the model's weight buffers, so every interpreter using it must
+// be built from the same FlatBufferModel instance. This class is thread-safe.
+class XnnpackWeightsCache {
+ public:
+  static std::unique_ptr<XnnpackWeightsCache> Create();
+
+  ~XnnpackWeightsCache();
+
+  // Creates an XNNPack delegate from |options| backed by this cache and
+  // applies it to |interpreter|. The first successful call fills and
+  // finalizes the cache; later calls only look packed weights up. Returns the
+  // status of |tflite::Interpreter::ModifyGraphWithDelegate|.
+  TfLiteStatus ApplyDelegate(TfLiteXNNPackDelegateOptions options,
+                             tflite::Interpreter* interpreter);
+
+  bool is_finalized() const;
+
+ private:
+  explicit XnnpackWeightsCache(TfLiteXNNPackDelegateWeightsCache* cache);
+
+  TfLiteStatus CreateAndApplyDelegate(TfLiteXNNPackDelegateOptions options,
+                                      tflite::Interpreter* interpreter);
+
+  // Serializes delegate creation until the cache is finalized, since
+  // inserting into the cache is not thread-safe.
+  mutable absl::Mutex mutex_;
+  bool finalized_ ABSL_GUARDED_BY(mutex_);
+  TfLiteXNNPackDelegateWeightsCache* const cache_;
+};
+
+}  // namespace codec
+}  // namespace chromemedia
+
+#endif  // LYRA_XNNPACK_WEIGHTS_CACHE_H_
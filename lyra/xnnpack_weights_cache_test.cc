@@ -0,0 +1,70 @@
+// Copyright 2022 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "lyra/xnnpack_weights_cache.h"
+
+#include <memory>
+
+// Placeholder for get runfiles header.
+#include "gtest/gtest.h"
+#include "include/ghc/filesystem.hpp"
+#include "tensorflow/lite/delegates/xnnpack/xnnpack_delegate.h"
+#include "tensorflow/lite/interpreter.h"
+#include "tensorflow/lite/interpreter_builder.h"
+#include "tensorflow/lite/kernels/register.h"
+#include "tensorflow/lite/model_builder.h"
+
+namespace chromemedia {
+namespace codec {
+namespace {
+
+std::unique_ptr<tflite::Interpreter> BuildInterpreter(
+    const tflite::FlatBufferModel& model) {
+  tflite::ops::builtin::BuiltinOpResolverWithoutDefaultDelegates resolver;
+  std::unique_ptr<tflite::Interpreter> interpreter;
+  if (tflite::InterpreterBuilder(model, resolver)(&interpreter) != kTfLiteOk) {
+    return nullptr;
+  }
+  return interpreter;
+}
+
+TEST(XnnpackWeightsCacheTest, FirstDelegateFinalizesCache) {
+  auto model = tflite::FlatBufferModel::BuildFromFile(
+      (ghc::filesystem::current_path() / "lyra/model_coeffs/lyragan.tflite")
+          .c_str());
+  ASSERT_NE(model, nullptr);
+  auto weights_cache = XnnpackWeightsCache::Create();
+  ASSERT_NE(weights_cache, nullptr);
+  EXPECT_FALSE(weights_cache->is_finalized());
+
+  auto options = TfLiteXNNPackDelegateOptionsDefault();
+  options.flags |= TFLITE_XNNPACK_DELEGATE_FLAG_QU8;
+  auto first_interpreter = BuildInterpreter(*model);
+  ASSERT_NE(first_interpreter, nullptr);
+  ASSERT_EQ(weights_cache->ApplyDelegate(options, first_interpreter.get()),
+            kTfLiteOk);
+  EXPECT_TRUE(weights_cache->is_finalized());
+
+  // The second interpreter only looks its packed weights up.
+  auto second_interpreter = BuildInterpreter(*model);
+  ASSERT_NE(second_interpreter, nullptr);
+  ASSERT_EQ(weights_cache->ApplyDelegate(options, second_interpreter.get()),
+            kTfLiteOk);
+  ASSERT_EQ(second_interpreter->AllocateTensors(), kTfLiteOk);
+  EXPECT_EQ(second_interpreter->Invoke(), kTfLiteOk);
+}
+
+}  // namespace
+}  // namespace codec
+}  // namespace chromemedia
@@ -33,7 +33,9 @@ class ZeroFeatureEstimator : public FeatureEstimatorInterface {
     // Do nothing.
   }
 
-  std::vector<float> Estimate() const override { return estimated_features_; }
+  const std::vector<float>& Estimate() const override {
+    return estimated_features_;
+  }
 
  private:
   ZeroFeatureEstimator() = delete;